@@ -1,5 +1,6 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
 
 // Набор констант
 #define LIGHT_TYPE_POINT 0        // Тип источника - точеченый
@@ -15,21 +16,30 @@
 #define TEXTURE_NORMAL 3
 #define TEXTURE_DISPLACE 4
 
+/*Специализационные константы (задаются при создании варианта конвейера)*/
+
+layout(constant_id = 1) const uint TEXTURE_MASK = 0xF;   // Маска используемых текстур (бит на каждую текстуру кроме карты глубины)
+layout(constant_id = 2) const bool PARALLAX = true;      // Использовать параллакс (карту глубины)
+
 /*Схема входа-выхода*/
 
 layout (location = 0) out vec4 outColor;
 
-layout (location = 0) in GS_OUT
+layout (location = 0) in VS_OUT
 {
     vec3 color;            // Цвет фрагмента
     vec3 position;         // Положение фрагмента в мировых координатах
     vec3 positionLocal;    // Положение фрагмента в локальных координатах
     vec3 normal;           // Вектор нормали фрагмента
     vec2 uv;               // Текстурные координаты фрагмента
-    mat3 tbnMatrix;        // Матрица для преобразования из касательного пространства треугольника в мировое
-    mat3 tbnMatrixInverse; // Матрица для преобразования из мирового пространства в касательное
+    mat3 tbnMatrix;        // Матрица для преобразования из касательного пространства в мировое
 } fs_in;
 
+// Параметры материала экземпляра (rgb - albedo, a - шероховатость; металличность отдельно)
+layout (location = 8) flat in vec4 fsMaterial;
+layout (location = 9) flat in float fsMetallic;
+layout (location = 10) flat in uvec3 fsTextures; // Индексы текстур экземпляра в глобальной таблице (по 16 бит)
+
 /*Вспомогательные типы*/
 
 // Параметры источника света
@@ -73,15 +83,8 @@ layout(set = 0, binding = 0) uniform UniformCamera {
     vec3 _camPosition;
 };
 
-layout(set = 2, binding = 2, std140) uniform UniformModel {
-    Material _materialSettings;
-};
-
-layout(set = 2, binding = 3) uniform sampler2D _textures[5];
-
-layout(set = 2, binding = 4, std140) uniform UniformTextureUsage {
-    uint _texturesUsed[5];
-};
+// Глобальная таблица текстур (массив переменной длины, текстура выбирается по индексу экземпляра)
+layout(set = 2, binding = 0) uniform sampler2D _textures[];
 
 layout(set = 1, binding = 0, std140) uniform UniformLightCount {
     uint _lightCount;
@@ -96,6 +99,25 @@ layout(set = 1, binding = 1, std140) uniform UniformLightArray {
 
 /*Функции*/
 
+// Индекс текстуры экземпляра в глобальной таблице (два 16-битных индекса в каждом компоненте)
+uint textureIndex(uint textureType)
+{
+    uint packed = fsTextures[textureType / 2u];
+    return (textureType % 2u) == 0u ? (packed & 0xFFFFu) : (packed >> 16u);
+}
+
+// Выборка из текстуры экземпляра (экземпляры одного вызова могут использовать разные текстуры)
+vec4 sampleTexture(uint textureType, vec2 uv)
+{
+    return texture(_textures[nonuniformEXT(textureIndex(textureType))], uv);
+}
+
+// Используется ли текстура (определяется специализационной константой, неиспользуемые ветви исключаются при создании конвейера)
+bool textureUsed(uint textureType)
+{
+    return (TEXTURE_MASK & (1u << textureType)) != 0u;
+}
+
 // Затухание для точечного источника
 float pointLightAttenuation(Fragment f, LightSource l)
 {
@@ -159,21 +181,21 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 // Получить нормаль из карты нормалей произведя необходимые преобразования
 vec3 normalMap(vec2 uv)
 {
-    vec3 normal = texture(_textures[TEXTURE_NORMAL],uv).rgb * 2.0 - 1.0;
+    vec3 normal = sampleTexture(TEXTURE_NORMAL, uv).rgb * 2.0 - 1.0;
     return normalize(fs_in.tbnMatrix * normal);
 }
 
 // Получить значение из карты глубины
 float depthMap(vec2 uv, bool inverse)
 {
-    return inverse ? 1 - texture(_textures[TEXTURE_DISPLACE], uv).r : texture(_textures[TEXTURE_DISPLACE], uv).r;
+    return inverse ? 1 - sampleTexture(TEXTURE_DISPLACE, uv).r : sampleTexture(TEXTURE_DISPLACE, uv).r;
 }
 
 // Сдвинуть UV координаты согласно карте глубин
 vec2 paralaxMappedUv(vec2 uv, vec3 toView, bool inverseMap)
 {
     // Вектор в направлении камеры от фрагмента (в касательном пространстве)
-    vec3 toViewT = normalize(fs_in.tbnMatrixInverse * toView);
+    vec3 toViewT = normalize(transpose(fs_in.tbnMatrix) * toView);
 
     // Кол-во слоев глубины
     const float minDepthLayers = 8;
@@ -234,16 +256,19 @@ void main()
     vec3 toView = normalize(_camPosition - fs_in.position);
 
     // UV координаты для текущего фрагмента
-    vec2 uv = _texturesUsed[TEXTURE_DISPLACE] > 0 ? paralaxMappedUv(fs_in.uv,toView,true) : fs_in.uv;
+    vec2 uv = PARALLAX ? paralaxMappedUv(fs_in.uv,toView,true) : fs_in.uv;
+
+    // Параметры материала экземпляра
+    Material material = Material(fsMaterial.rgb, fsMaterial.a, fsMetallic);
 
     // Структура описывающая текущий фрагмент
     Fragment f;
     f.toView = toView;
     f.position = fs_in.position;
-    f.normal = _texturesUsed[TEXTURE_NORMAL] > 0 ? normalMap(uv) : normalize(fs_in.normal);
-    f.albedo = _texturesUsed[TEXTURE_ALBEDO] > 0 ? texture(_textures[TEXTURE_ALBEDO],uv).rgb : _materialSettings.albedo;
-    f.roughness = _texturesUsed[TEXTURE_ROUGHNESS] > 0 ? texture(_textures[TEXTURE_ROUGHNESS],uv).r : _materialSettings.roughness;
-    f.metallic = _texturesUsed[TEXTURE_METALLIC] > 0 ? texture(_textures[TEXTURE_METALLIC],uv).r : _materialSettings.metallic;
+    f.normal = textureUsed(TEXTURE_NORMAL) ? normalMap(uv) : normalize(fs_in.normal);
+    f.albedo = textureUsed(TEXTURE_ALBEDO) ? sampleTexture(TEXTURE_ALBEDO, uv).rgb : material.albedo;
+    f.roughness = textureUsed(TEXTURE_ROUGHNESS) ? sampleTexture(TEXTURE_ROUGHNESS, uv).r : material.roughness;
+    f.metallic = textureUsed(TEXTURE_METALLIC) ? sampleTexture(TEXTURE_METALLIC, uv).r : material.metallic;
 
     // Коэффициент F0 для Френеля
     // Чем металичнее материал тем более коэффициент уходит в альбедо
@@ -16,15 +16,14 @@
 
 layout (location = 0) out vec4 outColor;
 
-layout (location = 0) in GS_OUT
+layout (location = 0) in VS_OUT
 {
     vec3 color;            // Цвет фрагмента
     vec3 position;         // Положение фрагмента в мировых координатах
     vec3 positionLocal;    // Положение фрагмента в локальных координатах
     vec3 normal;           // Вектор нормали фрагмента
     vec2 uv;               // Текстурные координаты фрагмента
-    mat3 tbnMatrix;        // Матрица для преобразования из касательного пространства треугольника в мировое
-    mat3 tbnMatrixInverse; // Матрица для преобразования из мирового пространства в касательное
+    mat3 tbnMatrix;        // Матрица для преобразования из касательного пространства в мировое
 } fs_in;
 
 /*Вспомогательные типы*/
@@ -219,7 +218,7 @@ float depthMap(vec2 uv, bool inverse)
 vec2 paralaxMappedUv(vec2 uv, vec3 toView, bool inverseMap)
 {
     // Вектор в направлении камеры от фрагмента (в касательном пространстве)
-    vec3 toViewT = normalize(fs_in.tbnMatrixInverse * toView);
+    vec3 toViewT = normalize(transpose(fs_in.tbnMatrix) * toView);
 
     // Кол-во слоев глубины
     const float minDepthLayers = 8;
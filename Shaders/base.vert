@@ -5,14 +5,25 @@
 #define MAX_SKELETON_BONES 50            // Максимальное кол-во костей скелета
 #define MAX_BONE_WEIGHTS 4               // Максимальное кол-во весов кости на вершину
 
+/*Специализационные константы (задаются при создании варианта конвейера)*/
+
+layout(constant_id = 0) const bool SKINNED = true;   // Использовать скелетную анимацию
+
 /*Схема входа-выхода*/
 
 layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inColor;
-layout (location = 2) in vec2 inUv;
-layout (location = 3) in vec3 inNormal;
-layout (location = 4) in ivec4 inBoneIndices;
-layout (location = 5) in vec4 inWeights;
+layout (location = 1) in vec4 inColor;        // Цвет (unorm8, отдельный поток - у геометрии без цветов всегда белый)
+layout (location = 2) in vec2 inUv;           // Текстурные координаты (half float)
+layout (location = 3) in vec2 inNormal;       // Нормаль (октаэдрическое кодирование, snorm16)
+layout (location = 4) in uvec4 inBoneIndices; // Индексы костей (uint8, отдельный поток)
+layout (location = 5) in vec4 inWeights;      // Веса костей (unorm8, отдельный поток)
+layout (location = 6) in vec4 inTangent;      // Касательная (xy - октаэдрическое кодирование, z - знак битангенса, snorm8)
+
+// Данные экземпляра (поток экземпляров, см. vk::tools::InstanceData)
+layout (location = 7) in mat4 inModel;        // Матрица модели (атрибуты 7-10)
+layout (location = 11) in mat3 inNormalMatrix;// Матрица преобразования нормалей (атрибуты 11-13, вычисляется на CPU)
+layout (location = 14) in vec4 inMaterial;    // Параметры материала (rgb - albedo, a - шероховатость)
+layout (location = 15) in uvec4 inMetallicTextures; // x - металличность (биты float), yzw - индексы текстур в глобальной таблице (по 16 бит)
 
 layout (location = 0) out VS_OUT
 {
@@ -21,9 +32,17 @@ layout (location = 0) out VS_OUT
     vec3 positionLocal;    // Положение вершины в локальных координатах
     vec3 normal;           // Вектор нормали вершины
     vec2 uv;               // Текстурные координаты
-    mat3 normalMatrix;     // Матрица преобразования нормалей (не интерполируется, наверное)
+    mat3 tbnMatrix;        // Матрица для преобразования из касательного пространства в мировое
 } vs_out;
 
+// Параметры материала экземпляра (постоянны в пределах примитива)
+layout (location = 8) flat out vec4 vsMaterial;
+layout (location = 9) flat out float vsMetallic;
+layout (location = 10) flat out uvec3 vsTextures; // Упакованные индексы текстур экземпляра
+
+// Глубина должна точно совпадать с глубиной пред-прохода (depth-prepass.vert), иначе проверка на равенство отбросит фрагменты
+invariant gl_Position;
+
 /*Вспомогательные типы*/
 
 // Параметры отображения текстуры
@@ -43,19 +62,11 @@ layout(set = 0, binding = 0, std140) uniform UniformCamera {
     vec3 _camPosition;
 };
 
-layout(set = 2, binding = 0, std140) uniform UniformModel {
-    mat4 _model;
-};
-
-layout(set = 2, binding = 1, std140) uniform UniformTextureMapping {
+// Блок данных объекта в кольцевом буфере кадра (смещение задается при привязке набора, см. vk::scene::Mesh::writeUniforms)
+// Матрицы костей записываются только для мешей со скелетной анимацией
+layout(set = 3, binding = 0, std140) uniform UniformObject {
     TextureMapping _textureMapping;
-};
-
-layout(set = 2, binding = 5, std140) uniform SkeletonBoneCount {
     uint _boneCount;
-};
-
-layout(set = 2, binding = 6, std140) uniform SkeletonBoneTransforms {
     mat4 _boneTransforms[MAX_SKELETON_BONES];
 };
 
@@ -71,6 +82,16 @@ mat2 rotate2D(float angle)
     );
 }
 
+// Декодирование единичного вектора из октаэдрической развертки
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.x += v.x >= 0.0 ? -t : t;
+    v.y += v.y >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
 // Подсчет UV координат с учетом параметров текстурирования
 vec2 calcUV(vec2 uv, TextureMapping mapping)
 {
@@ -81,40 +102,59 @@ vec2 calcUV(vec2 uv, TextureMapping mapping)
 // Преобразование координат (и прочих параметров) вершины и передача их следующим этапам
 void main()
 {
+    // Распаковка нормали и касательной
+    vec3 vertexNormal = octahedralDecode(inNormal);
+    vec3 vertexTangent = octahedralDecode(inTangent.xy);
+    float bitangentSign = inTangent.z < 0.0 ? -1.0 : 1.0;
+
     // Итоговые значения положения и нормали в пространстве модели
     vec4 position = vec4(0.0f);
     vec4 normal = vec4(0.0f);
+    vec4 tangent = vec4(0.0f);
 
     // Матрица преобразования нормалей
     // Учитывает только поворот, без искажения нормалей в процессе масштабирования
-    mat3 normalMatrix = transpose(inverse(mat3(_model)));
+    mat3 normalMatrix = inNormalMatrix;
 
-    // Пройтись по всем компонентам вектора весов
-    for(uint i = 0; i < MAX_BONE_WEIGHTS; i++)
+    // Вариант без скелетной анимации использует положение и нормаль как есть
+    if(!SKINNED)
     {
-        // Получаем индекс кости и соответствующий вес
-        int boneIndex = inBoneIndices[i];
-        float weight = inWeights[i];
-
-        // Если индек кости валиден - произвести приращение значения положения и нормали с учетом трансформации кости
-        if(boneIndex >= 0 && boneIndex < MAX_SKELETON_BONES)
+        position = vec4(inPosition, 1.0);
+        normal = vec4(vertexNormal, 0.0);
+        tangent = vec4(vertexTangent, 0.0);
+    }
+    else
+    {
+        // Пройтись по всем компонентам вектора весов
+        for(uint i = 0; i < MAX_BONE_WEIGHTS; i++)
         {
-            position += (_boneTransforms[boneIndex] * vec4(inPosition, 1.0)) * weight;
-            normal += (_boneTransforms[boneIndex] * vec4(inNormal,0.0)) * weight;
+            // Получаем индекс кости и соответствующий вес
+            uint boneIndex = inBoneIndices[i];
+            float weight = inWeights[i];
+
+            // Если индек кости валиден - произвести приращение значения положения и нормали с учетом трансформации кости
+            if(boneIndex < MAX_SKELETON_BONES)
+            {
+                position += (_boneTransforms[boneIndex] * vec4(inPosition, 1.0)) * weight;
+                normal += (_boneTransforms[boneIndex] * vec4(vertexNormal,0.0)) * weight;
+                tangent += (_boneTransforms[boneIndex] * vec4(vertexTangent,0.0)) * weight;
+            }
         }
     }
 
     // Координаты вершины после всех преобразований
-    gl_Position = _proj * _view * _model * position;
-
-    // Передача матрицы нормалей
-    vs_out.normalMatrix = normalMatrix;
+    gl_Position = _proj * _view * inModel * position;
 
     // Цвет вершины передается как есть
-    vs_out.color = inColor;
+    vs_out.color = inColor.rgb;
+
+    // Параметры материала экземпляра передаются фрагментному шейдеру без интерполяции
+    vsMaterial = inMaterial;
+    vsMetallic = uintBitsToFloat(inMetallicTextures.x);
+    vsTextures = inMetallicTextures.yzw;
 
     // Положение вершины в мировых координатах
-    vs_out.position = (_model * position).xyz;
+    vs_out.position = (inModel * position).xyz;
 
     // Положение вершины в локальном пространстве
     vs_out.positionLocal = position.xyz;
@@ -124,4 +164,20 @@ void main()
 
     // Нормаль вершины - используем матрицу нормалей для корректной передачи
     vs_out.normal = normalize(normalMatrix * normal.xyz);
+
+    // Касательная и битангенс в мировом пространстве
+    vec3 N = vs_out.normal;
+    vec3 T = normalMatrix * tangent.xyz;
+    vec3 B = cross(N, T) * bitangentSign;
+
+    // Параметры текстурирования (поворот, масштаб) меняют направления осей UV, поэтому касательные пересчитываются
+    // через обратную матрицу преобразования UV координат
+    mat2 uvTransformInverse = inverse(mat2(_textureMapping.scale.x,0.0,0.0,_textureMapping.scale.y) * rotate2D(radians(_textureMapping.angle)));
+    vec3 mappedT = T * uvTransformInverse[0][0] + B * uvTransformInverse[0][1];
+    vec3 mappedB = T * uvTransformInverse[1][0] + B * uvTransformInverse[1][1];
+
+    // Собрать TBN матрицу (касательная ортогонализируется относительно нормали вершины)
+    T = normalize(mappedT - N * dot(N, mappedT));
+    B = cross(N, T) * (dot(cross(N, T), mappedB) < 0.0 ? -1.0 : 1.0);
+    vs_out.tbnMatrix = mat3(T,B,N);
 }
\ No newline at end of file
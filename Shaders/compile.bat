@@ -1,9 +0,0 @@
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V base.vert -o base.vert.spv
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V base.geom -o base.geom.spv
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V base-phong.frag -o base-phong.frag.spv
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V base-pbr.frag -o base-pbr.frag.spv
-
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V post-process.vert -o post-process.vert.spv
-C:\VulkanSDK\1.2.154.1\Bin\glslangValidator.exe -V post-process.frag -o post-process.frag.spv
-
-pause
\ No newline at end of file
@@ -0,0 +1,76 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Набор констант
+#define MAX_SKELETON_BONES 50            // Максимальное кол-во костей скелета
+#define MAX_BONE_WEIGHTS 4               // Максимальное кол-во весов кости на вершину
+
+/*Специализационные константы (задаются при создании варианта конвейера)*/
+
+layout(constant_id = 0) const bool SKINNED = true;   // Использовать скелетную анимацию
+
+/*Схема входа-выхода*/
+
+// Номера атрибутов совпадают с основным вершинным шейдером (base.vert)
+layout (location = 0) in vec3 inPosition;     // Положение (отдельный плотный поток)
+layout (location = 4) in uvec4 inBoneIndices; // Индексы костей (uint8, отдельный поток)
+layout (location = 5) in vec4 inWeights;      // Веса костей (unorm8, отдельный поток)
+layout (location = 7) in mat4 inModel;        // Матрица модели (поток экземпляров)
+
+// Глубина должна точно совпадать с глубиной основного прохода (там она проверяется на равенство)
+invariant gl_Position;
+
+/*Вспомогательные типы*/
+
+// Параметры отображения текстуры (структура std140 занимает 32 байта, как в основном вершинном шейдере)
+struct TextureMapping
+{
+    vec2 offset;
+    vec2 origin;
+    vec2 scale;
+    float angle;
+};
+
+/*Uniform*/
+
+layout(set = 0, binding = 0, std140) uniform UniformCamera {
+    mat4 _view;
+    mat4 _proj;
+    vec3 _camPosition;
+};
+
+// Блок данных объекта (раскладка совпадает с основным вершинным шейдером, используются только матрицы костей)
+layout(set = 3, binding = 0, std140) uniform UniformObject {
+    TextureMapping _textureMapping;
+    uint _boneCount;
+    mat4 _boneTransforms[MAX_SKELETON_BONES];
+};
+
+/*Функции*/
+
+// Основная функция вершинного шейдера
+// Вычисляет только положение вершины (так же, как основной вершинный шейдер)
+void main()
+{
+    vec4 position = vec4(0.0f);
+
+    if(!SKINNED)
+    {
+        position = vec4(inPosition, 1.0);
+    }
+    else
+    {
+        for(uint i = 0; i < MAX_BONE_WEIGHTS; i++)
+        {
+            uint boneIndex = inBoneIndices[i];
+            float weight = inWeights[i];
+
+            if(boneIndex < MAX_SKELETON_BONES)
+            {
+                position += (_boneTransforms[boneIndex] * vec4(inPosition, 1.0)) * weight;
+            }
+        }
+    }
+
+    gl_Position = _proj * _view * inModel * position;
+}
@@ -1,8 +1,12 @@
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
 
 #include "VkRenderer.h"
 #include "VkHelpers.h"
 #include "Tools/Tools.hpp"
+#include "Tools/Profiler.hpp"
 
 /// Дескриптор исполняемого модуля программы
 HINSTANCE g_hInstance = nullptr;
@@ -42,16 +46,27 @@ void Controls(float camSpeed = 0.001f, float mouseSensitivity = 0.2f);
 /**
  * Точка входа
  * @param argc Кол-во аргументов
- * @param argv Аргументы
+ * @param argv Аргументы (первый аргумент - кол-во кадров в полете, по умолчанию 2; второй - режим показа: latency, throughput, power;
+ * третий - gpuprofile для профилирования GPU с записью в gpu_profile.csv; четвертый - depthprepass для включения
+ * пред-прохода глубины, во время работы переключается клавишей P; пятый - gpuculling для отсечения мешей на GPU,
+ * во время работы переключается клавишей G)
  * @return Код выполнения (выхода)
  */
 int main(int argc, char* argv[])
 {
-    (void) argc;
-    (void) argv;
-
     try
     {
+        // Кол-во кадров, обрабатываемых одновременно (для сравнения пропускной способности при разных значениях)
+        size_t framesInFlight = argc > 1 ? static_cast<size_t>(std::max<int>(1, std::atoi(argv[1]))) : 2;
+
+        // Режим показа кадров (подбирается под конкретное применение без изменения кода)
+        VkRendererPresentPolicy presentPolicy{};
+        if(argc > 2){
+            std::string mode(argv[2]);
+            if(mode == "throughput") presentPolicy.mode = VkRendererPresentMode::eThroughput;
+            else if(mode == "power") presentPolicy.mode = VkRendererPresentMode::ePowerSaving;
+        }
+
         // Получение дескриптора исполняемого модуля программы
         g_hInstance = GetModuleHandle(nullptr);
 
@@ -88,16 +103,32 @@ int main(int argc, char* argv[])
 
         // Загрузка кода шейдеров
         auto vsCode = tools::LoadBytesFromFile(tools::ShaderDir().append("base.vert.spv"));
-        auto gsCode = tools::LoadBytesFromFile(tools::ShaderDir().append("base.geom.spv"));
         auto fsCode = tools::LoadBytesFromFile(tools::ShaderDir().append("base-pbr.frag.spv"));
+        auto vsCodeDepth = tools::LoadBytesFromFile(tools::ShaderDir().append("depth-prepass.vert.spv"));
+        auto csCodeCulling = tools::LoadBytesFromFile(tools::ShaderDir().append("cull.comp.spv"));
         auto vsCodePp = tools::LoadBytesFromFile(tools::ShaderDir().append("post-process.vert.spv"));
         auto fsCodePp = tools::LoadBytesFromFile(tools::ShaderDir().append("post-process.frag.spv"));
 
         // Инициализация рендерера
-        g_vkRenderer = new VkRenderer(g_hInstance, g_hwnd, vsCode, gsCode, fsCode, vsCodePp, fsCodePp);
+        g_vkRenderer = new VkRenderer(g_hInstance, g_hwnd, vsCode, fsCode, vsCodeDepth, csCodeCulling, vsCodePp, fsCodePp, 1000, framesInFlight, 0, presentPolicy, tools::ExeDir().append("pipeline_cache.bin"));
+
+        // Профилирование GPU (время проходов, статистика конвейера, время отдельных вызовов отрисовки)
+        bool gpuProfile = argc > 3 && std::string(argv[3]) == "gpuprofile";
+        if(gpuProfile){
+            g_vkRenderer->enableGpuProfiler(true, "gpu_profile.csv");
+        }
+
+        // Пред-проход глубины (для сравнения времени основного прохода с пред-проходом и без него)
+        g_vkRenderer->setDepthPrePassEnabled(argc > 4 && std::string(argv[4]) == "depthprepass");
+
+        // Отсечение мешей вычислительным шейдером (вместо отсечения на CPU)
+        g_vkRenderer->setGpuCullingEnabled(argc > 5 && std::string(argv[5]) == "gpuculling");
 
         /** Рендерер - загрузка ресурсов **/
 
+        // Время загрузки ресурсов (до завершения всех загрузок на GPU)
+        auto loadStartTime = std::chrono::high_resolution_clock::now();
+
         // Геометрия
         auto sphereGeometry = vk::helpers::GenerateSphereGeometry(g_vkRenderer,32,1.0f);
 
@@ -107,6 +138,9 @@ int main(int argc, char* argv[])
         auto metallicTex    = vk::helpers::LoadVulkanTexture(g_vkRenderer,"rusted_iron/metallic.png",true);
         auto normalTex      = vk::helpers::LoadVulkanTexture(g_vkRenderer,"rusted_iron/normal.png",true);
 
+        g_vkRenderer->waitForUploads();
+        std::cout << "Resources loaded in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStartTime).count() << " ms." << std::endl;
+
 
         /** Рендерер - инициализация сцены **/
 
@@ -176,6 +210,27 @@ int main(int argc, char* argv[])
             if (g_pTimer->isFpsCounterReady()){
                 std::string fps = std::string("Vulkan samples (").append(std::to_string(g_pTimer->getFps())).append(" FPS)");
                 SetWindowTextA(g_hwnd, fps.c_str());
+
+                // Статистика кадров рендерера (за последний интервал счетчика)
+                auto stats = g_vkRenderer->getFrameStatistics();
+                std::cout << "Frames in flight: " << stats.framesInFlight
+                          << ", FPS: " << g_pTimer->getFps()
+                          << ", CPU frame: " << stats.avgCpuFrameTimeMs << " ms"
+                          << ", fence wait: " << stats.avgFenceWaitTimeMs << " ms"
+                          << ", input-to-present: " << stats.avgInputToPresentLatencyMs << " ms (max " << stats.maxInputToPresentLatencyMs << " ms)"
+                          << ", visible meshes: " << stats.avgVisibleMeshes << "/" << stats.avgSceneMeshes
+                          << ", draw calls: " << stats.avgDrawCalls
+                          << ", triangles: " << stats.avgTriangles
+                          << ", state binds: " << stats.avgStateBinds << " (skipped " << stats.avgStateBindsSkipped << ")" << std::endl;
+
+                if(gpuProfile){
+                    const auto& gpu = g_vkRenderer->getGpuProfile();
+                    std::cout << "GPU primary pass: " << gpu.passes[0].timeMs << " ms"
+                              << " (VS: " << gpu.passes[0].vertexShaderInvocations
+                              << ", FS: " << gpu.passes[0].fragmentShaderInvocations << ")"
+                              << ", post-process pass: " << gpu.passes[1].timeMs << " ms" << std::endl;
+                }
+                g_vkRenderer->resetFrameStatistics();
             }
 
             /// Обновление сцены
@@ -192,6 +247,13 @@ int main(int argc, char* argv[])
 
         // Уничтожение рендерера
         delete g_vkRenderer;
+
+#ifdef CPU_PROFILER_ENABLED
+        // Сохранить последние зоны профилировщика CPU (открывается в chrome://tracing или Perfetto)
+        if(tools::profiler::ExportChromeTrace(tools::ExeDir().append("cpu_trace.json"))){
+            std::cout << "CPU trace saved to cpu_trace.json" << std::endl;
+        }
+#endif
     }
     catch(vk::Error& error){
         std::cout << "vk::error: " << error.what() << std::endl;
@@ -241,8 +303,15 @@ void Controls(float camSpeed, float mouseSensitivity)
         g_camera->orientation.x += static_cast<float>(deltaMousePos.y) * mouseSensitivity;
         g_camera->orientation.y += static_cast<float>(deltaMousePos.x) * mouseSensitivity;
     }
+    bool mouseMoved = KEY_DOWN(VK_LBUTTON) && (currentMousePos.x != g_lastMousePos.x || currentMousePos.y != g_lastMousePos.y);
     g_lastMousePos = currentMousePos;
 
+    // Сообщить рендереру о вводе (для замера задержки от ввода до показа)
+    bool keysPressed = camMovementRel != glm::vec3(0.0f) || camMovementAbs != glm::vec3(0.0f);
+    if(g_vkRenderer != nullptr && (keysPressed || mouseMoved)){
+        g_vkRenderer->notifyInputEvent();
+    }
+
     // Установить векторы движения камеры
     if(g_camera != nullptr){
         g_camera->setTranslation(camMovementRel * camSpeed);
@@ -278,6 +347,37 @@ LRESULT CALLBACK tools::WindowProcedure(HWND hWnd, UINT message, WPARAM wParam,
             }
             return DefWindowProc(hWnd, message, wParam, lParam);
 
+            // Нажатие клавиши (P - переключение пред-прохода глубины, F - переключение отсечения по пирамиде видимости,
+            // G - переключение отсечения на GPU, I - переключение инстансинга, O - переключение сортировки списка отрисовки,
+            // L - переключение уровней детализации)
+        case WM_KEYDOWN:
+            if(g_vkRenderer != nullptr && wParam == 0x50u && !(lParam & (1 << 30))){
+                g_vkRenderer->setDepthPrePassEnabled(!g_vkRenderer->isDepthPrePassEnabled());
+                std::cout << "Depth pre-pass " << (g_vkRenderer->isDepthPrePassEnabled() ? "enabled" : "disabled") << "." << std::endl;
+            }
+            if(g_vkRenderer != nullptr && wParam == 0x46u && !(lParam & (1 << 30))){
+                g_vkRenderer->setFrustumCullingEnabled(!g_vkRenderer->isFrustumCullingEnabled());
+                std::cout << "Frustum culling " << (g_vkRenderer->isFrustumCullingEnabled() ? "enabled" : "disabled") << "." << std::endl;
+            }
+            if(g_vkRenderer != nullptr && wParam == 0x47u && !(lParam & (1 << 30))){
+                g_vkRenderer->setGpuCullingEnabled(!g_vkRenderer->isGpuCullingEnabled());
+                std::cout << "GPU culling " << (g_vkRenderer->isGpuCullingEnabled() ? "enabled" : "disabled")
+                          << (g_vkRenderer->isGpuCullingAvailable() ? "" : " (unavailable, culling on CPU)") << "." << std::endl;
+            }
+            if(g_vkRenderer != nullptr && wParam == 0x49u && !(lParam & (1 << 30))){
+                g_vkRenderer->setInstancingEnabled(!g_vkRenderer->isInstancingEnabled());
+                std::cout << "Instancing " << (g_vkRenderer->isInstancingEnabled() ? "enabled" : "disabled") << "." << std::endl;
+            }
+            if(g_vkRenderer != nullptr && wParam == 0x4Fu && !(lParam & (1 << 30))){
+                g_vkRenderer->setDrawSortingEnabled(!g_vkRenderer->isDrawSortingEnabled());
+                std::cout << "Draw sorting " << (g_vkRenderer->isDrawSortingEnabled() ? "enabled" : "disabled") << "." << std::endl;
+            }
+            if(g_vkRenderer != nullptr && wParam == 0x4Cu && !(lParam & (1 << 30))){
+                g_vkRenderer->setLodEnabled(!g_vkRenderer->isLodEnabled());
+                std::cout << "LOD selection " << (g_vkRenderer->isLodEnabled() ? "enabled" : "disabled") << "." << std::endl;
+            }
+            return DefWindowProc(hWnd, message, wParam, lParam);
+
             // Завершение изменения размера окна
         case WM_EXITSIZEMOVE:
             if(g_vkRenderer != nullptr){
@@ -0,0 +1,673 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+namespace tools
+{
+    /**
+     * Статистика кэша пост-трансформации вершин
+     */
+    struct VertexCacheStatistics
+    {
+        /// Среднее кол-во обработок вершинного шейдера на треугольник (Average Cache Miss Ratio, от 0.5 до 3)
+        float acmr = 0.0f;
+        /// Среднее кол-во обработок на используемую вершину (Average Transformed Vertex Ratio, от 1 и выше)
+        float atvr = 0.0f;
+    };
+
+    /**
+     * Оценить эффективность кэша пост-трансформации для списка треугольников
+     * @param indices Массив индексов (по 3 на треугольник)
+     * @param vertexCount Кол-во вершин
+     * @param cacheSize Размер моделируемого кэша (FIFO)
+     * @return Статистика кэша
+     */
+    inline VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16)
+    {
+        VertexCacheStatistics statistics{};
+        if(indices.size() < 3 || vertexCount == 0) return statistics;
+
+        // Момент (номер промаха) последней загрузки вершины в кэш - вершина в кэше, если загружена не раньше cacheSize промахов назад
+        std::vector<size_t> loadedAt(vertexCount, 0);
+        std::vector<bool> used(vertexCount, false);
+        size_t misses = 0;
+        size_t usedCount = 0;
+
+        for(const uint32_t index : indices)
+        {
+            if(!used[index]){
+                used[index] = true;
+                usedCount++;
+            }
+
+            if(loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize){
+                misses++;
+                loadedAt[index] = misses;
+            }
+        }
+
+        statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        statistics.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+        return statistics;
+    }
+
+    /**
+     * Переупорядочить треугольники для эффективного использования кэша пост-трансформации
+     * @param pIndices Указатель на массив индексов (по 3 на треугольник)
+     * @param vertexCount Кол-во вершин
+     *
+     * @details Алгоритм Forsyth (Linear-Speed Vertex Cache Optimisation). Каждой вершине назначается вес, зависящий
+     * от ее позиции в моделируемом LRU кэше и кол-ва оставшихся неиспользованными треугольников (вершины, у которых
+     * осталось мало треугольников, выгоднее "закрыть" сразу). Жадно выбирается треугольник с максимальной суммой весов
+     * вершин, кандидаты ищутся только среди треугольников вершин, находящихся в кэше
+     */
+    inline void OptimizeVertexCache(std::vector<uint32_t>* pIndices, size_t vertexCount)
+    {
+        const size_t triangleCount = pIndices->size() / 3;
+        if(triangleCount == 0 || vertexCount == 0) return;
+
+        // Параметры модели (значения из оригинальной статьи)
+        const int cacheSize = 32;
+        const float cacheDecayPower = 1.5f;
+        const float lastTriangleScore = 0.75f;
+        const float valenceBoostScale = 2.0f;
+        const float valenceBoostPower = 0.5f;
+
+        const std::vector<uint32_t>& indices = *pIndices;
+
+        // Списки треугольников каждой вершины (смещения в общем массиве и кол-во еще не добавленных)
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        std::vector<uint32_t> remainingValence(vertexCount, 0);
+        for(const uint32_t index : indices) remainingValence[index]++;
+        for(size_t i = 0; i < vertexCount; i++) adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingValence[i];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); i++){
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // Вес вершины по позиции в кэше и кол-ву оставшихся треугольников
+        auto vertexScore = [&](int cachePosition, uint32_t valence) -> float
+        {
+            if(valence == 0) return -1.0f;
+
+            float score = 0.0f;
+            if(cachePosition >= 0)
+            {
+                // Вершины последнего треугольника получают фиксированный вес, чтобы не выбирать его соседа по тем же 2 вершинам слишком охотно
+                if(cachePosition < 3){
+                    score = lastTriangleScore;
+                }else{
+                    const float scaler = 1.0f / static_cast<float>(cacheSize - 3);
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, cacheDecayPower);
+                }
+            }
+
+            return score + valenceBoostScale * std::pow(static_cast<float>(valence), -valenceBoostPower);
+        };
+
+        std::vector<float> vertexScores(vertexCount);
+        for(size_t i = 0; i < vertexCount; i++) vertexScores[i] = vertexScore(-1, remainingValence[i]);
+
+        std::vector<bool> triangleAdded(triangleCount, false);
+
+        // Кэш (с запасом на 3 вершины добавляемого треугольника)
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> cacheNew;
+        cache.reserve(cacheSize + 3);
+        cacheNew.reserve(cacheSize + 3);
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        size_t nextUnaddedTriangle = 0;
+        int64_t bestTriangle = -1;
+
+        for(size_t added = 0; added < triangleCount; added++)
+        {
+            // Нет кандидатов среди вершин кэша - взять первый еще не добавленный треугольник
+            if(bestTriangle < 0){
+                while(triangleAdded[nextUnaddedTriangle]) nextUnaddedTriangle++;
+                bestTriangle = static_cast<int64_t>(nextUnaddedTriangle);
+            }
+
+            const size_t triangle = static_cast<size_t>(bestTriangle);
+            const uint32_t* triangleIndices = &indices[triangle * 3];
+            triangleAdded[triangle] = true;
+
+            // Добавить треугольник и убрать его из списков смежности вершин
+            for(size_t k = 0; k < 3; k++)
+            {
+                const uint32_t vertex = triangleIndices[k];
+                result.push_back(vertex);
+
+                uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                uint32_t* end = begin + remainingValence[vertex];
+                uint32_t* found = std::find(begin, end, static_cast<uint32_t>(triangle));
+                if(found != end){
+                    std::swap(*found, *(end - 1));
+                    remainingValence[vertex]--;
+                }
+            }
+
+            // Новое состояние кэша - вершины треугольника в начале, затем прежнее содержимое
+            cacheNew.clear();
+            for(size_t k = 0; k < 3; k++){
+                if(std::find(cacheNew.begin(), cacheNew.end(), triangleIndices[k]) == cacheNew.end()) cacheNew.push_back(triangleIndices[k]);
+            }
+            for(const uint32_t vertex : cache){
+                if(vertex != triangleIndices[0] && vertex != triangleIndices[1] && vertex != triangleIndices[2]){
+                    cacheNew.push_back(vertex);
+                }
+            }
+
+            // Вытесненные вершины
+            for(size_t i = cacheSize; i < cacheNew.size(); i++){
+                vertexScores[cacheNew[i]] = vertexScore(-1, remainingValence[cacheNew[i]]);
+            }
+            if(cacheNew.size() > static_cast<size_t>(cacheSize)) cacheNew.resize(cacheSize);
+            cache.swap(cacheNew);
+
+            // Обновить веса вершин кэша
+            for(size_t i = 0; i < cache.size(); i++){
+                vertexScores[cache[i]] = vertexScore(static_cast<int>(i), remainingValence[cache[i]]);
+            }
+
+            // Найти лучший треугольник среди оставшихся треугольников вершин кэша
+            bestTriangle = -1;
+            float bestScore = -1.0f;
+            for(const uint32_t vertex : cache)
+            {
+                for(uint32_t i = 0; i < remainingValence[vertex]; i++)
+                {
+                    const uint32_t candidate = adjacency[adjacencyOffsets[vertex] + i];
+                    const float score =
+                            vertexScores[indices[candidate * 3]] +
+                            vertexScores[indices[candidate * 3 + 1]] +
+                            vertexScores[indices[candidate * 3 + 2]];
+
+                    if(score > bestScore){
+                        bestScore = score;
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+        }
+
+        pIndices->swap(result);
+    }
+
+    /**
+     * Переупорядочить группы треугольников для уменьшения перерисовки (overdraw)
+     * @param pIndices Указатель на массив индексов (уже оптимизированный для кэша)
+     * @param positions Положения вершин
+     * @param cacheSize Размер моделируемого кэша (FIFO)
+     *
+     * @details Последовательность треугольников делится на группы по "жестким" границам - треугольникам, все вершины
+     * которых промахиваются мимо кэша. На таких границах кэш и так пуст, поэтому перестановка групп почти не ухудшает
+     * ACMR. Группы сортируются по удаленности от центра меша вдоль своей средней нормали (по убыванию) - внешние,
+     * смотрящие наружу части рисуются первыми и заслоняют внутренние. Знак нормалей определяется по знаку объема меша,
+     * поэтому направление обхода вершин значения не имеет
+     */
+    inline void OptimizeOverdraw(std::vector<uint32_t>* pIndices, const std::vector<glm::vec3>& positions, size_t cacheSize = 16)
+    {
+        const std::vector<uint32_t>& indices = *pIndices;
+        const size_t triangleCount = indices.size() / 3;
+        if(triangleCount < 2 || positions.empty()) return;
+
+        // Границы групп (по моделированию FIFO кэша)
+        std::vector<size_t> clusterStarts;
+        {
+            std::vector<size_t> loadedAt(positions.size(), 0);
+            size_t misses = 0;
+            for(size_t t = 0; t < triangleCount; t++)
+            {
+                size_t triangleMisses = 0;
+                for(size_t k = 0; k < 3; k++){
+                    const uint32_t index = indices[t * 3 + k];
+                    if(loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize){
+                        misses++;
+                        loadedAt[index] = misses;
+                        triangleMisses++;
+                    }
+                }
+                if(t == 0 || triangleMisses == 3) clusterStarts.push_back(t);
+            }
+        }
+        if(clusterStarts.size() < 2) return;
+        clusterStarts.push_back(triangleCount);
+
+        // Центр меша (средневзвешенный по площадям треугольников) и знак объема
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        for(size_t t = 0; t < triangleCount; t++){
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& c = positions[indices[t * 3 + 2]];
+            const float area = glm::length(glm::cross(b - a, c - a));
+            meshCenter += (a + b + c) * (area / 3.0f);
+            meshArea += area;
+        }
+        if(meshArea <= 0.0f) return;
+        meshCenter /= meshArea;
+
+        float volume = 0.0f;
+        for(size_t t = 0; t < triangleCount; t++){
+            const glm::vec3 a = positions[indices[t * 3]] - meshCenter;
+            const glm::vec3 b = positions[indices[t * 3 + 1]] - meshCenter;
+            const glm::vec3 c = positions[indices[t * 3 + 2]] - meshCenter;
+            volume += glm::dot(a, glm::cross(b, c));
+        }
+        const float orientation = volume < 0.0f ? -1.0f : 1.0f;
+
+        // Ключ сортировки каждой группы
+        const size_t clusterCount = clusterStarts.size() - 1;
+        std::vector<float> clusterKeys(clusterCount);
+        for(size_t i = 0; i < clusterCount; i++)
+        {
+            glm::vec3 center(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+
+            for(size_t t = clusterStarts[i]; t < clusterStarts[i + 1]; t++){
+                const glm::vec3& a = positions[indices[t * 3]];
+                const glm::vec3& b = positions[indices[t * 3 + 1]];
+                const glm::vec3& c = positions[indices[t * 3 + 2]];
+                const glm::vec3 areaNormal = glm::cross(b - a, c - a);
+                const float triangleArea = glm::length(areaNormal);
+                center += (a + b + c) * (triangleArea / 3.0f);
+                normal += areaNormal;
+                area += triangleArea;
+            }
+
+            const float normalLength = glm::length(normal);
+            clusterKeys[i] = (area > 0.0f && normalLength > 0.0f) ?
+                    glm::dot(center / area - meshCenter, normal / normalLength) * orientation :
+                    0.0f;
+        }
+
+        // Порядок групп (устойчивая сортировка - равные группы сохраняют порядок)
+        std::vector<size_t> clusterOrder(clusterCount);
+        for(size_t i = 0; i < clusterCount; i++) clusterOrder[i] = i;
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t lhs, size_t rhs){
+            return clusterKeys[lhs] > clusterKeys[rhs];
+        });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for(const size_t cluster : clusterOrder){
+            result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+        }
+
+        pIndices->swap(result);
+    }
+
+    /**
+     * Переупорядочить вершины в порядке первого обращения к ним (для локальности выборки вершин)
+     * @param pIndices Указатель на массив индексов (переписывается новыми номерами вершин)
+     * @param vertexCount Кол-во вершин
+     * @return Таблица перенумерации (новый номер для каждой старой вершины, UINT32_MAX для неиспользуемых)
+     *
+     * @details Сами вершины не переставляются - для этого используется RemapVertices
+     */
+    inline std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>* pIndices, size_t vertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        uint32_t next = 0;
+
+        for(uint32_t& index : *pIndices){
+            if(remap[index] == UINT32_MAX) remap[index] = next++;
+            index = remap[index];
+        }
+
+        return remap;
+    }
+
+    /**
+     * Переставить вершины согласно таблице перенумерации (неиспользуемые вершины удаляются)
+     * @tparam T Тип вершины
+     * @param pVertices Указатель на массив вершин
+     * @param remap Таблица перенумерации (результат OptimizeVertexFetch)
+     */
+    template <typename T>
+    inline void RemapVertices(std::vector<T>* pVertices, const std::vector<uint32_t>& remap)
+    {
+        size_t usedCount = 0;
+        for(const uint32_t newIndex : remap){
+            if(newIndex != UINT32_MAX) usedCount++;
+        }
+
+        std::vector<T> result(usedCount);
+        for(size_t i = 0; i < remap.size() && i < pVertices->size(); i++){
+            if(remap[i] != UINT32_MAX) result[remap[i]] = (*pVertices)[i];
+        }
+
+        pVertices->swap(result);
+    }
+
+    /**
+     * Квадрика ошибки (сумма квадратов расстояний до набора плоскостей, Garland-Heckbert)
+     */
+    struct MeshQuadric
+    {
+        /// Симметричная матрица 3x3 (a00, a01, a02, a11, a12, a22), вектор b и константа c
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+
+        /**
+         * Добавить плоскость
+         * @param normal Единичная нормаль плоскости
+         * @param distance Расстояние плоскости (dot(normal, p) + distance = 0)
+         * @param weight Вес плоскости
+         */
+        void addPlane(const glm::dvec3& normal, double distance, double weight)
+        {
+            a00 += weight * normal.x * normal.x; a01 += weight * normal.x * normal.y; a02 += weight * normal.x * normal.z;
+            a11 += weight * normal.y * normal.y; a12 += weight * normal.y * normal.z; a22 += weight * normal.z * normal.z;
+            b0 += weight * normal.x * distance; b1 += weight * normal.y * distance; b2 += weight * normal.z * distance;
+            c += weight * distance * distance;
+        }
+
+        /**
+         * Прибавить другую квадрику
+         * @param other Квадрика
+         */
+        void add(const MeshQuadric& other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+        }
+
+        /**
+         * Значение ошибки в точке
+         * @param p Точка
+         * @return Сумма квадратов расстояний (с весами)
+         */
+        double evaluate(const glm::dvec3& p) const
+        {
+            const double result =
+                    a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z +
+                    a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + a22 * p.z * p.z +
+                    2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+            return (std::max)(result, 0.0);
+        }
+    };
+
+    /**
+     * Построить цепочку уровней детализации (LOD) упрощением меша
+     * @param indices Массив индексов исходного меша (по 3 на треугольник)
+     * @param positions Положения вершин
+     * @param lodCount Максимальное кол-во уровней (не считая исходного)
+     * @param reduction Доля треугольников каждого уровня от предыдущего (например 0.5)
+     * @param pLodIndices Указатель на массив индексов уровней (от подробного к грубому)
+     * @param pLodErrors Указатель на массив геометрических ошибок уровней (в единицах положений вершин)
+     *
+     * @details Последовательное стягивание ребер с минимальной квадрикой ошибки. Вершина стягивается в одну из
+     * существующих вершин, поэтому уровни используют общий с исходным мешем массив вершин (отличаются только индексы).
+     * Топология строится по совпадающим положениям, поэтому швы текстурных координат и нормалей не разрываются:
+     * треугольник, потерявший вершину, получает вершину цели с теми же атрибутами, что и у соседнего треугольника.
+     * Открытые границы удерживаются дополнительными перпендикулярными плоскостями, стягивания, переворачивающие
+     * треугольники, отклоняются. Если упрощение перестает уменьшать кол-во треугольников, цепочка обрывается
+     */
+    inline void GenerateLods(const std::vector<uint32_t>& indices,
+            const std::vector<glm::vec3>& positions,
+            size_t lodCount,
+            float reduction,
+            std::vector<std::vector<uint32_t>>* pLodIndices,
+            std::vector<float>* pLodErrors)
+    {
+        pLodIndices->clear();
+        pLodErrors->clear();
+
+        const size_t triangleCount = indices.size() / 3;
+        if(triangleCount < 8 || positions.empty() || lodCount == 0) return;
+
+        // Сварить вершины по положению (сортировкой) - группы совпадающих вершин
+        std::vector<uint32_t> sorted(positions.size());
+        for(size_t i = 0; i < sorted.size(); i++) sorted[i] = static_cast<uint32_t>(i);
+        auto lessPosition = [&](uint32_t lhs, uint32_t rhs){
+            const glm::vec3& a = positions[lhs];
+            const glm::vec3& b = positions[rhs];
+            if(a.x != b.x) return a.x < b.x;
+            if(a.y != b.y) return a.y < b.y;
+            return a.z < b.z;
+        };
+        std::sort(sorted.begin(), sorted.end(), lessPosition);
+
+        std::vector<uint32_t> group(positions.size());
+        std::vector<glm::dvec3> groupPositions;
+        for(size_t i = 0; i < sorted.size(); i++){
+            if(i == 0 || positions[sorted[i]] != positions[sorted[i - 1]]) groupPositions.emplace_back(positions[sorted[i]]);
+            group[sorted[i]] = static_cast<uint32_t>(groupPositions.size() - 1);
+        }
+        const size_t groupCount = groupPositions.size();
+
+        // Треугольники (исходные номера вершин) и треугольники каждой группы
+        std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+        std::vector<bool> triangleAlive(triangleCount, true);
+        std::vector<std::vector<uint32_t>> groupTriangles(groupCount);
+        size_t aliveCount = 0;
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            const uint32_t g0 = group[triangles[t * 3]], g1 = group[triangles[t * 3 + 1]], g2 = group[triangles[t * 3 + 2]];
+            if(g0 == g1 || g1 == g2 || g0 == g2){
+                triangleAlive[t] = false;
+                continue;
+            }
+            groupTriangles[g0].push_back(static_cast<uint32_t>(t));
+            groupTriangles[g1].push_back(static_cast<uint32_t>(t));
+            groupTriangles[g2].push_back(static_cast<uint32_t>(t));
+            aliveCount++;
+        }
+
+        // Квадрики - плоскости треугольников
+        std::vector<MeshQuadric> quadrics(groupCount);
+        std::vector<std::pair<uint64_t, uint32_t>> edges;
+        edges.reserve(triangleCount * 3);
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            if(!triangleAlive[t]) continue;
+
+            const uint32_t g[3] = {group[triangles[t * 3]], group[triangles[t * 3 + 1]], group[triangles[t * 3 + 2]]};
+            const glm::dvec3 normal = glm::cross(groupPositions[g[1]] - groupPositions[g[0]], groupPositions[g[2]] - groupPositions[g[0]]);
+            const double length = glm::length(normal);
+            if(length <= 0.0) continue;
+
+            const glm::dvec3 unitNormal = normal / length;
+            for(const uint32_t k : g){
+                quadrics[k].addPlane(unitNormal, -glm::dot(unitNormal, groupPositions[g[0]]), 1.0);
+            }
+
+            for(size_t k = 0; k < 3; k++){
+                const uint64_t lo = (std::min)(g[k], g[(k + 1) % 3]);
+                const uint64_t hi = (std::max)(g[k], g[(k + 1) % 3]);
+                edges.emplace_back((lo << 32u) | hi, static_cast<uint32_t>(t));
+            }
+        }
+
+        // Открытые границы (ребра одного треугольника) - перпендикулярные плоскости с большим весом
+        const double boundaryWeight = 10.0;
+        std::sort(edges.begin(), edges.end());
+        for(size_t i = 0; i < edges.size(); i++)
+        {
+            const bool shared = (i > 0 && edges[i - 1].first == edges[i].first) || (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+            if(shared) continue;
+
+            const uint32_t ga = static_cast<uint32_t>(edges[i].first >> 32u);
+            const uint32_t gb = static_cast<uint32_t>(edges[i].first & 0xFFFFFFFFu);
+            const size_t t = edges[i].second;
+            const glm::dvec3 triangleNormal = glm::cross(
+                    groupPositions[group[triangles[t * 3 + 1]]] - groupPositions[group[triangles[t * 3]]],
+                    groupPositions[group[triangles[t * 3 + 2]]] - groupPositions[group[triangles[t * 3]]]);
+            const glm::dvec3 normal = glm::cross(groupPositions[gb] - groupPositions[ga], triangleNormal);
+            const double length = glm::length(normal);
+            if(length <= 0.0) continue;
+
+            const glm::dvec3 unitNormal = normal / length;
+            const double distance = -glm::dot(unitNormal, groupPositions[ga]);
+            quadrics[ga].addPlane(unitNormal, distance, boundaryWeight);
+            quadrics[gb].addPlane(unitNormal, distance, boundaryWeight);
+        }
+
+        // Кандидаты на стягивание (группа from стягивается в группу to), устаревшие отбрасываются по версиям групп
+        struct Collapse
+        {
+            double cost;
+            uint32_t from, to;
+            uint32_t fromVersion, toVersion;
+            bool operator>(const Collapse& other) const { return cost > other.cost; }
+        };
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+        std::vector<uint32_t> versions(groupCount, 0);
+        std::vector<bool> groupRemoved(groupCount, false);
+
+        auto pushEdge = [&](uint32_t from, uint32_t to)
+        {
+            MeshQuadric quadric = quadrics[from];
+            quadric.add(quadrics[to]);
+            collapses.push({quadric.evaluate(groupPositions[to]), from, to, versions[from], versions[to]});
+        };
+
+        for(size_t i = 0; i < edges.size(); i++){
+            if(i > 0 && edges[i - 1].first == edges[i].first) continue;
+            const uint32_t ga = static_cast<uint32_t>(edges[i].first >> 32u);
+            const uint32_t gb = static_cast<uint32_t>(edges[i].first & 0xFFFFFFFFu);
+            pushEdge(ga, gb);
+            pushEdge(gb, ga);
+        }
+        edges.clear();
+        edges.shrink_to_fit();
+
+        // Содержит ли треугольник вершину группы
+        auto triangleHasGroup = [&](uint32_t t, uint32_t g){
+            return group[triangles[t * 3]] == g || group[triangles[t * 3 + 1]] == g || group[triangles[t * 3 + 2]] == g;
+        };
+
+        std::vector<std::pair<uint32_t, uint32_t>> vertexTargets;
+        double maxCost = 0.0;
+        size_t previousCount = aliveCount;
+        float target = static_cast<float>(aliveCount);
+
+        for(size_t lod = 0; lod < lodCount; lod++)
+        {
+            target *= reduction;
+
+            while(aliveCount > static_cast<size_t>(target) && !collapses.empty())
+            {
+                const Collapse collapse = collapses.top();
+                collapses.pop();
+
+                const uint32_t from = collapse.from;
+                const uint32_t to = collapse.to;
+                if(groupRemoved[from] || groupRemoved[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion) continue;
+
+                // Убрать удаленные треугольники из списка группы
+                auto& fromTriangles = groupTriangles[from];
+                fromTriangles.erase(std::remove_if(fromTriangles.begin(), fromTriangles.end(), [&](uint32_t t){ return !triangleAlive[t]; }), fromTriangles.end());
+
+                // Стягивание не должно переворачивать оставшиеся треугольники
+                bool flips = false;
+                vertexTargets.clear();
+                for(const uint32_t t : fromTriangles)
+                {
+                    if(triangleHasGroup(t, to))
+                    {
+                        // Соответствие вершин (атрибутов) группы from вершинам группы to по общему треугольнику
+                        uint32_t fromVertex = 0, toVertex = 0;
+                        for(size_t k = 0; k < 3; k++){
+                            if(group[triangles[t * 3 + k]] == from) fromVertex = triangles[t * 3 + k];
+                            if(group[triangles[t * 3 + k]] == to) toVertex = triangles[t * 3 + k];
+                        }
+                        vertexTargets.emplace_back(fromVertex, toVertex);
+                        continue;
+                    }
+
+                    glm::dvec3 corners[3];
+                    for(size_t k = 0; k < 3; k++) corners[k] = groupPositions[group[triangles[t * 3 + k]]];
+                    const glm::dvec3 normalBefore = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                    for(size_t k = 0; k < 3; k++){
+                        if(group[triangles[t * 3 + k]] == from) corners[k] = groupPositions[to];
+                    }
+                    const glm::dvec3 normalAfter = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+                    if(glm::dot(normalBefore, normalAfter) <= 0.0){
+                        flips = true;
+                        break;
+                    }
+                }
+                if(flips || vertexTargets.empty()) continue;
+
+                // Применить - треугольники с обеими группами вырождаются, остальные переходят к группе to
+                for(const uint32_t t : fromTriangles)
+                {
+                    if(triangleHasGroup(t, to)){
+                        triangleAlive[t] = false;
+                        aliveCount--;
+                        continue;
+                    }
+
+                    for(size_t k = 0; k < 3; k++)
+                    {
+                        uint32_t& vertex = triangles[t * 3 + k];
+                        if(group[vertex] != from) continue;
+
+                        uint32_t replacement = vertexTargets[0].second;
+                        for(const auto& pair : vertexTargets){
+                            if(pair.first == vertex){
+                                replacement = pair.second;
+                                break;
+                            }
+                        }
+                        vertex = replacement;
+                    }
+                    groupTriangles[to].push_back(t);
+                }
+
+                fromTriangles.clear();
+                groupRemoved[from] = true;
+                quadrics[to].add(quadrics[from]);
+                versions[to]++;
+                maxCost = (std::max)(maxCost, collapse.cost);
+
+                // Новые кандидаты для соседей группы to
+                auto& toTriangles = groupTriangles[to];
+                toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t){ return !triangleAlive[t]; }), toTriangles.end());
+                for(const uint32_t t : toTriangles){
+                    for(size_t k = 0; k < 3; k++){
+                        const uint32_t neighbor = group[triangles[t * 3 + k]];
+                        if(neighbor == to) continue;
+                        pushEdge(to, neighbor);
+                        pushEdge(neighbor, to);
+                    }
+                }
+            }
+
+            // Упрощение почти не уменьшило меш - дальнейшие уровни не нужны
+            if(static_cast<float>(aliveCount) > static_cast<float>(previousCount) * 0.9f) break;
+            previousCount = aliveCount;
+
+            std::vector<uint32_t> lodIndices;
+            lodIndices.reserve(aliveCount * 3);
+            for(size_t t = 0; t < triangleCount; t++){
+                if(triangleAlive[t]) lodIndices.insert(lodIndices.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+            }
+
+            pLodIndices->push_back(std::move(lodIndices));
+            pLodErrors->push_back(static_cast<float>(std::sqrt(maxCost)));
+        }
+    }
+}
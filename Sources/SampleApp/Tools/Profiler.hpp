@@ -0,0 +1,274 @@
+#pragma once
+
+/**
+ * Профилировщик участков кода CPU (зоны)
+ *
+ * Использование:
+ *   PROFILE_SCOPE("Name")   - зона до конца текущей области видимости (имя - строковый литерал)
+ *   PROFILE_FUNCTION()      - зона с именем текущей функции
+ *
+ * Если CPU_PROFILER_ENABLED не определен (сборки кроме debug без опции CMake CPU_PROFILER), макросы раскрываются в пустоту
+ * и профилировщик не компилируется
+ */
+
+#ifdef CPU_PROFILER_ENABLED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tools
+{
+    namespace profiler
+    {
+        /// Кол-во событий в кольцевом буфере потока (старые события перезаписываются)
+        const size_t RING_BUFFER_CAPACITY = 1u << 16u;
+
+        /**
+         * Событие (завершенная зона)
+         */
+        struct Event
+        {
+            /// Имя зоны (строковый литерал, хранится только указатель)
+            const char* name;
+            /// Начало зоны (нс)
+            uint64_t startNs;
+            /// Длительность зоны (нс)
+            uint64_t durationNs;
+        };
+
+        /**
+         * Кольцевой буфер событий потока
+         *
+         * @details Пишет только поток-владелец, поэтому запись не требует блокировок. Индекс записи публикуется
+         * с release-семантикой, экспорт читает его с acquire-семантикой
+         */
+        struct ThreadBuffer
+        {
+            /// Идентификатор потока (порядковый номер регистрации)
+            uint32_t threadId = 0;
+            /// Кол-во записанных событий за все время
+            std::atomic<uint64_t> writeIndex{0};
+            /// События
+            std::vector<Event> events = std::vector<Event>(RING_BUFFER_CAPACITY);
+        };
+
+        /**
+         * Общее состояние профилировщика
+         */
+        struct State
+        {
+            /// Включена ли запись
+            std::atomic<bool> enabled{true};
+            /// Защищает список буферов (используется только при регистрации потока и экспорте)
+            std::mutex mutex;
+            /// Буферы всех потоков (живут дольше потоков, чтобы события можно было экспортировать после их завершения)
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            /// Начало отсчета времени
+            std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        };
+
+        /**
+         * Получить общее состояние
+         * @return Ссылка на объект состояния
+         */
+        inline State& GetState()
+        {
+            static State state;
+            return state;
+        }
+
+        /**
+         * Текущее время в наносекундах (от начала отсчета)
+         * @return Время (нс)
+         */
+        inline uint64_t NowNs()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - GetState().origin).count());
+        }
+
+        /**
+         * Получить буфер текущего потока (при первом обращении буфер регистрируется)
+         * @return Ссылка на буфер потока
+         */
+        inline ThreadBuffer& GetThreadBuffer()
+        {
+            static thread_local ThreadBuffer* pBuffer = nullptr;
+
+            if(pBuffer == nullptr)
+            {
+                auto& state = GetState();
+                auto buffer = std::make_shared<ThreadBuffer>();
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                buffer->threadId = static_cast<uint32_t>(state.buffers.size());
+                state.buffers.push_back(buffer);
+                pBuffer = buffer.get();
+            }
+
+            return *pBuffer;
+        }
+
+        /**
+         * Включить или выключить запись событий
+         * @param enabled Включена ли запись
+         */
+        inline void SetEnabled(bool enabled)
+        {
+            GetState().enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        /**
+         * Очистить записанные события всех потоков
+         * @details Следует вызывать, когда профилируемые потоки не выполняют зон (например, между кадрами)
+         */
+        inline void Clear()
+        {
+            auto& state = GetState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            for(auto& buffer : state.buffers){
+                buffer->writeIndex.store(0, std::memory_order_release);
+            }
+        }
+
+        /**
+         * Записать строку в JSON с экранированием (кавычки, обратная косая черта, управляющие символы)
+         * @param stream Поток вывода
+         * @param str Строка (нуль-терминированная)
+         */
+        inline void WriteJsonString(std::ostream& stream, const char* str)
+        {
+            static const char hexDigits[] = "0123456789abcdef";
+
+            stream << '"';
+            for(const char* p = str; *p != '\0'; p++)
+            {
+                const auto c = static_cast<unsigned char>(*p);
+                switch(c)
+                {
+                    case '"':  stream << "\\\""; break;
+                    case '\\': stream << "\\\\"; break;
+                    case '\n': stream << "\\n"; break;
+                    case '\r': stream << "\\r"; break;
+                    case '\t': stream << "\\t"; break;
+                    default:
+                        if(c < 0x20u) stream << "\\u00" << hexDigits[c >> 4u] << hexDigits[c & 0xFu];
+                        else stream << *p;
+                }
+            }
+            stream << '"';
+        }
+
+        /**
+         * Экспорт событий в формате Chrome trace (chrome://tracing, Perfetto)
+         * @param path Путь к JSON файлу
+         * @return Удалось ли записать файл
+         *
+         * @details Экспортируются последние RING_BUFFER_CAPACITY событий каждого потока. Следует вызывать,
+         * когда профилируемые потоки не выполняют зон, иначе события, перезаписываемые во время экспорта, могут быть искажены
+         */
+        inline bool ExportChromeTrace(const std::string& path)
+        {
+            std::ofstream file(path, std::ios::out | std::ios::trunc);
+            if(!file.is_open()) return false;
+
+            // Время в микросекундах с дробной частью до наносекунд (по умолчанию поток округлил бы ts до 6 значащих цифр)
+            file << std::fixed << std::setprecision(3);
+
+            auto& state = GetState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+
+            file << "{\"traceEvents\":[";
+            bool first = true;
+
+            for(const auto& buffer : state.buffers)
+            {
+                const uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+                const uint64_t begin = end > RING_BUFFER_CAPACITY ? end - RING_BUFFER_CAPACITY : 0;
+
+                for(uint64_t i = begin; i < end; i++)
+                {
+                    const Event& event = buffer->events[i % RING_BUFFER_CAPACITY];
+
+                    file << (first ? "" : ",") << "\n" << "{\"name\":";
+                    WriteJsonString(file, event.name);
+                    file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                         << ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+                         << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << "}";
+                    first = false;
+                }
+            }
+
+            file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+            return true;
+        }
+
+        /**
+         * Зона профилирования (RAII)
+         * @details Время начала фиксируется при создании, событие записывается в буфер потока при уничтожении
+         */
+        class ScopedZone
+        {
+        private:
+            /// Имя зоны
+            const char* name_;
+            /// Начало зоны (нс), 0 если запись выключена
+            uint64_t startNs_;
+
+        public:
+            /**
+             * Конструктор
+             * @param name Имя зоны (строковый литерал)
+             */
+            explicit ScopedZone(const char* name):
+                    name_(name),
+                    startNs_(GetState().enabled.load(std::memory_order_relaxed) ? NowNs() : 0){}
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            ScopedZone(const ScopedZone& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            ScopedZone& operator=(const ScopedZone& other) = delete;
+
+            /**
+             * Деструктор
+             */
+            ~ScopedZone()
+            {
+                if(startNs_ == 0) return;
+
+                ThreadBuffer& buffer = GetThreadBuffer();
+                const uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+                buffer.events[index % RING_BUFFER_CAPACITY] = {name_, startNs_, NowNs() - startNs_};
+                buffer.writeIndex.store(index + 1, std::memory_order_release);
+            }
+        };
+    }
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ::tools::profiler::ScopedZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace tools
+{
+    /**
+     * Поразрядная сортировка (LSD radix sort) пар "64-битный ключ - 32-битное значение"
+     *
+     * @details Ключи сортируются по возрастанию, по 8 бит за проход (не больше 8 проходов). Сортировка устойчива -
+     * значения с равными ключами сохраняют исходный порядок. Проходы, в которых у всех ключей одинаковый байт,
+     * пропускаются (гистограммы всех байтов строятся за один предварительный проход). Временные массивы хранятся
+     * в объекте и переиспользуются между вызовами. Не потокобезопасен
+     */
+    class RadixSorter
+    {
+    private:
+        /// Временный массив ключей
+        std::vector<uint64_t> keysTemp_;
+        /// Временный массив значений
+        std::vector<uint32_t> valuesTemp_;
+
+    public:
+        /**
+         * Отсортировать пары по ключам
+         * @param pKeys Указатель на массив ключей
+         * @param pValues Указатель на массив значений (того же размера, что и массив ключей)
+         */
+        void sort(std::vector<uint64_t>* pKeys, std::vector<uint32_t>* pValues)
+        {
+            const size_t count = pKeys->size();
+            if(count < 2) return;
+
+            // Гистограммы всех 8 байтов за один проход
+            size_t histograms[8][256] = {};
+            for(const uint64_t key : *pKeys){
+                for(size_t byte = 0; byte < 8; byte++){
+                    histograms[byte][(key >> (byte * 8u)) & 0xFFu]++;
+                }
+            }
+
+            keysTemp_.resize(count);
+            valuesTemp_.resize(count);
+
+            for(size_t byte = 0; byte < 8; byte++)
+            {
+                size_t* histogram = histograms[byte];
+
+                // Все ключи с одинаковым байтом - проход ничего не меняет
+                const uint8_t firstByte = static_cast<uint8_t>(((*pKeys)[0] >> (byte * 8u)) & 0xFFu);
+                if(histogram[firstByte] == count) continue;
+
+                // Смещения корзин (префиксные суммы)
+                size_t offset = 0;
+                for(size_t bucket = 0; bucket < 256; bucket++){
+                    const size_t bucketSize = histogram[bucket];
+                    histogram[bucket] = offset;
+                    offset += bucketSize;
+                }
+
+                // Разложить по корзинам (с сохранением порядка внутри корзины)
+                for(size_t i = 0; i < count; i++){
+                    const uint64_t key = (*pKeys)[i];
+                    const size_t destination = histogram[(key >> (byte * 8u)) & 0xFFu]++;
+                    keysTemp_[destination] = key;
+                    valuesTemp_[destination] = (*pValues)[i];
+                }
+
+                pKeys->swap(keysTemp_);
+                pValues->swap(valuesTemp_);
+            }
+        }
+    };
+}
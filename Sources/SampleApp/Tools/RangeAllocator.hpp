@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+
+namespace tools
+{
+    /**
+     * Распределитель диапазонов (суб-аллокация внутри одного большого ресурса)
+     *
+     * @details Хранит список свободных диапазонов, упорядоченный по смещению. Выделение - первый подходящий
+     * диапазон (с учетом выравнивания), при освобождении соседние свободные диапазоны объединяются.
+     * Сам ресурс не выделяет - оперирует только смещениями. Не потокобезопасен
+     */
+    class RangeAllocator
+    {
+    private:
+        /// Общий размер
+        size_t size_;
+        /// Свободный объем
+        size_t freeSize_;
+        /// Свободные диапазоны (смещение - размер)
+        std::map<size_t, size_t> freeRanges_;
+
+    public:
+        /**
+         * Конструктор по умолчанию
+         */
+        RangeAllocator():size_(0),freeSize_(0){};
+
+        /**
+         * Основной конструктор
+         * @param size Общий размер (в любых единицах - байтах, вершинах и т.д.)
+         */
+        explicit RangeAllocator(size_t size):size_(size),freeSize_(size)
+        {
+            if(size_ > 0) freeRanges_[0] = size_;
+        }
+
+        /**
+         * Выделить диапазон
+         * @param size Размер
+         * @param alignment Выравнивание смещения (степень двойки не обязательна)
+         * @param pOffset Указатель на смещение выделенного диапазона (заполняется при успехе)
+         * @return Удалось ли выделить
+         */
+        bool allocate(size_t size, size_t alignment, size_t* pOffset)
+        {
+            if(size == 0 || alignment == 0) return false;
+
+            for(auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it)
+            {
+                const size_t rangeOffset = it->first;
+                const size_t rangeEnd = it->first + it->second;
+                const size_t alignedOffset = ((rangeOffset + alignment - 1) / alignment) * alignment;
+
+                if(alignedOffset + size > rangeEnd) continue;
+
+                // Разделить свободный диапазон на остатки до и после выделенного
+                freeRanges_.erase(it);
+                if(alignedOffset > rangeOffset) freeRanges_[rangeOffset] = alignedOffset - rangeOffset;
+                if(alignedOffset + size < rangeEnd) freeRanges_[alignedOffset + size] = rangeEnd - (alignedOffset + size);
+
+                freeSize_ -= size;
+                *pOffset = alignedOffset;
+                return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * Освободить диапазон
+         * @param offset Смещение (полученное при выделении)
+         * @param size Размер (тот же, что при выделении)
+         */
+        void free(size_t offset, size_t size)
+        {
+            if(size == 0) return;
+
+            size_t rangeOffset = offset;
+            size_t rangeSize = size;
+
+            // Объединить со следующим свободным диапазоном
+            auto next = freeRanges_.lower_bound(offset);
+            if(next != freeRanges_.end() && next->first == offset + size){
+                rangeSize += next->second;
+                next = freeRanges_.erase(next);
+            }
+
+            // Объединить с предыдущим свободным диапазоном
+            if(next != freeRanges_.begin()){
+                auto prev = std::prev(next);
+                if(prev->first + prev->second == offset){
+                    rangeOffset = prev->first;
+                    rangeSize += prev->second;
+                    freeRanges_.erase(prev);
+                }
+            }
+
+            freeRanges_[rangeOffset] = rangeSize;
+            freeSize_ += size;
+        }
+
+        /**
+         * Получить общий размер
+         * @return Размер
+         */
+        size_t getSize() const
+        {
+            return size_;
+        }
+
+        /**
+         * Получить свободный объем (может быть фрагментирован)
+         * @return Размер
+         */
+        size_t getFreeSize() const
+        {
+            return freeSize_;
+        }
+    };
+}
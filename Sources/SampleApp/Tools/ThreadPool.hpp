@@ -0,0 +1,139 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+namespace tools
+{
+    /**
+     * Пул рабочих потоков
+     *
+     * @details Потоки создаются один раз и ожидают задачи из общей очереди. Каждая задача возвращает std::future,
+     * по которому можно дождаться ее завершения (исключения, брошенные в задаче, передаются через future)
+     */
+    class ThreadPool
+    {
+    private:
+        /// Рабочие потоки
+        std::vector<std::thread> workers_;
+        /// Очередь задач
+        std::queue<std::function<void()>> tasks_;
+        /// Мьютекс для доступа к очереди
+        std::mutex mutex_;
+        /// Условная переменная для пробуждения потоков
+        std::condition_variable condition_;
+        /// Остановлен ли пул
+        bool stopped_;
+
+        /**
+         * Цикл рабочего потока
+         */
+        void workerLoop()
+        {
+            while(true)
+            {
+                std::function<void()> task;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    condition_.wait(lock,[this]{ return stopped_ || !tasks_.empty(); });
+
+                    // Пул остановлен и задач больше нет - завершить поток
+                    if(stopped_ && tasks_.empty()) return;
+
+                    task = std::move(tasks_.front());
+                    tasks_.pop();
+                }
+
+                task();
+            }
+        }
+
+    public:
+        /**
+         * Основной конструктор
+         * @param threadCount Кол-во рабочих потоков (0 - по кол-ву аппаратных потоков)
+         */
+        explicit ThreadPool(size_t threadCount = 0):stopped_(false)
+        {
+            if(threadCount == 0){
+                threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+
+            for(size_t i = 0; i < threadCount; i++){
+                workers_.emplace_back(&ThreadPool::workerLoop, this);
+            }
+        }
+
+        /**
+         * Запрет копирования через инициализацию
+         * @param other Ссылка на копируемый объекта
+         */
+        ThreadPool(const ThreadPool& other) = delete;
+
+        /**
+         * Запрет копирования через присваивание
+         * @param other Ссылка на копируемый объекта
+         * @return Ссылка на текущий объект
+         */
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        /**
+         * Деструктор
+         * @details Дожидается выполнения всех поставленных задач
+         */
+        ~ThreadPool()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+
+            condition_.notify_all();
+
+            for(auto& worker : workers_){
+                if(worker.joinable()) worker.join();
+            }
+        }
+
+        /**
+         * Поставить задачу в очередь
+         * @tparam F Тип вызываемого объекта
+         * @param task Вызываемый объект (без параметров)
+         * @return Future результата задачи
+         */
+        template <typename F>
+        auto submit(F&& task) -> std::future<decltype(task())>
+        {
+            using ResultType = decltype(task());
+
+            // Упакованная задача не копируемая, поэтому хранится в shared pointer
+            auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+            auto future = packagedTask->get_future();
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                tasks_.emplace([packagedTask](){ (*packagedTask)(); });
+            }
+
+            condition_.notify_one();
+            return future;
+        }
+
+        /**
+         * Получить кол-во рабочих потоков
+         * @return Кол-во потоков
+         */
+        size_t getThreadCount() const
+        {
+            return workers_.size();
+        }
+    };
+}
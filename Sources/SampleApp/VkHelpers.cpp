@@ -1,5 +1,7 @@
 #include "VkHelpers.h"
 #include "Tools/Tools.hpp"
+#include "Tools/Profiler.hpp"
+#include "Tools/MeshOptimizer.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <STB/stb_image.h>
@@ -12,6 +14,7 @@
 #include <assimp/postprocess.h>
 
 #include <unordered_map>
+#include <iostream>
 
 namespace vk
 {
@@ -27,6 +30,8 @@ namespace vk
          */
         vk::resources::TextureBufferPtr LoadVulkanTexture(VkRenderer *pRenderer, const std::string &filename, bool mip, bool sRgb)
         {
+            PROFILE_SCOPE("vk::helpers::LoadVulkanTexture");
+
             // Полный путь к файлу
             auto path = ::tools::ExeDir().append("..\\Textures\\").append(filename);
 
@@ -69,6 +74,8 @@ namespace vk
          */
         vk::resources::GeometryBufferPtr GenerateQuadGeometry(VkRenderer *pRenderer, float size)
         {
+            PROFILE_SCOPE("vk::helpers::GenerateQuadGeometry");
+
             // Вершины
             std::vector<vk::tools::Vertex> vertices = {
                     { { (size / 2),(size / 2),0.0f },{ 1.0f,1.0f,1.0f },{ 1.0f,1.0f }, {0.0f,0.0f,1.0f} },
@@ -82,6 +89,9 @@ namespace vk
                     0,1,2, 0,2,3,
             };
 
+            // Касательные (для карт нормалей и параллакса)
+            vk::tools::ComputeTangents(vertices,indices);
+
             // Отдать smart-pointer объекта ресурса геометрического буфера
             return pRenderer->createGeometryBuffer(vertices,indices);
         }
@@ -94,6 +104,8 @@ namespace vk
          */
         vk::resources::GeometryBufferPtr GenerateCubeGeometry(VkRenderer *pRenderer, float size)
         {
+            PROFILE_SCOPE("vk::helpers::GenerateCubeGeometry");
+
             // Вершины
             std::vector<vk::tools::Vertex> vertices = {
                     { { (size / 2),(size / 2),(size / 2) },{ 1.0f,1.0f,1.0f },{ 1.0f,1.0f }, {0.0f,0.0f,1.0f} },
@@ -137,10 +149,77 @@ namespace vk
                     20,21,22, 20,22,23,
             };
 
+            // Касательные (для карт нормалей и параллакса)
+            vk::tools::ComputeTangents(vertices,indices);
+
             // Отдать smart-pointer объекта ресурса геометрического буфера
             return pRenderer->createGeometryBuffer(vertices,indices);
         }
 
+        /**
+         * Оптимизация порядка индексов и вершин геометрии (кэш пост-трансформации, перерисовка, выборка вершин)
+         * @param name Имя геометрии (для вывода статистики)
+         * @param pVertices Указатель на массив вершин (переставляется, неиспользуемые вершины удаляются)
+         * @param pIndices Указатель на массив индексов
+         *
+         * @details Выводит ACMR/ATVR до и после оптимизации (для FIFO кэша на 16 вершин)
+         */
+        static void OptimizeGeometry(const std::string& name, std::vector<vk::tools::Vertex>* pVertices, std::vector<uint32_t>* pIndices)
+        {
+            PROFILE_SCOPE("vk::helpers::OptimizeGeometry");
+
+            // Статистика до оптимизации
+            const auto before = ::tools::AnalyzeVertexCache(*pIndices, pVertices->size());
+
+            // Порядок треугольников для кэша, затем порядок групп треугольников для перерисовки
+            ::tools::OptimizeVertexCache(pIndices, pVertices->size());
+
+            std::vector<glm::vec3> positions(pVertices->size());
+            for(size_t i = 0; i < pVertices->size(); i++) positions[i] = (*pVertices)[i].position;
+            ::tools::OptimizeOverdraw(pIndices, positions);
+
+            // Порядок вершин в порядке обращения к ним
+            ::tools::RemapVertices(pVertices, ::tools::OptimizeVertexFetch(pIndices, pVertices->size()));
+
+            // Статистика после оптимизации
+            const auto after = ::tools::AnalyzeVertexCache(*pIndices, pVertices->size());
+
+            std::cout << "Geometry (" << name << ") optimized. "
+                      << "ACMR: " << before.acmr << " -> " << after.acmr << ", "
+                      << "ATVR: " << before.atvr << " -> " << after.atvr << std::endl;
+        }
+
+        /**
+         * Построение уровней детализации (LOD) геометрии
+         * @param name Имя геометрии (для вывода статистики)
+         * @param vertices Массив вершин (общий для всех уровней)
+         * @param indices Массив индексов исходной геометрии
+         * @param pLodIndices Указатель на массив индексов упрощенных уровней
+         * @param pLodErrors Указатель на массив геометрических ошибок упрощенных уровней
+         *
+         * @details До 3 упрощенных уровней, каждый вдвое грубее предыдущего. Индексы уровней также оптимизируются для кэша
+         */
+        static void BuildGeometryLods(const std::string& name,
+                const std::vector<vk::tools::Vertex>& vertices,
+                const std::vector<uint32_t>& indices,
+                std::vector<std::vector<uint32_t>>* pLodIndices,
+                std::vector<float>* pLodErrors)
+        {
+            PROFILE_SCOPE("vk::helpers::BuildGeometryLods");
+
+            std::vector<glm::vec3> positions(vertices.size());
+            for(size_t i = 0; i < vertices.size(); i++) positions[i] = vertices[i].position;
+
+            ::tools::GenerateLods(indices, positions, 3, 0.5f, pLodIndices, pLodErrors);
+
+            std::cout << "Geometry (" << name << ") LODs: " << indices.size() / 3;
+            for(size_t i = 0; i < pLodIndices->size(); i++){
+                ::tools::OptimizeVertexCache(&(*pLodIndices)[i], vertices.size());
+                std::cout << " -> " << (*pLodIndices)[i].size() / 3 << " (error " << (*pLodErrors)[i] << ")";
+            }
+            std::cout << " triangles." << std::endl;
+        }
+
         /**
          * Генерация геометрии сферы
          * @param pRenderer Указатель на рендерер
@@ -150,6 +229,8 @@ namespace vk
          */
         vk::resources::GeometryBufferPtr GenerateSphereGeometry(VkRenderer *pRenderer, unsigned segments, float radius)
         {
+            PROFILE_SCOPE("vk::helpers::GenerateSphereGeometry");
+
             const float pi = 3.14159265359f;
 
             std::vector<vk::tools::Vertex> vertices = {};
@@ -195,8 +276,19 @@ namespace vk
                 }
             }
 
+            // Касательные (для карт нормалей и параллакса)
+            vk::tools::ComputeTangents(vertices,indices);
+
+            // Оптимизация порядка индексов и вершин
+            OptimizeGeometry(std::string("sphere ").append(std::to_string(segments)), &vertices, &indices);
+
+            // Уровни детализации
+            std::vector<std::vector<uint32_t>> lodIndices;
+            std::vector<float> lodErrors;
+            BuildGeometryLods(std::string("sphere ").append(std::to_string(segments)), vertices, indices, &lodIndices, &lodErrors);
+
             // Отдать smart-pointer объекта ресурса геометрического буфера
-            return pRenderer->createGeometryBuffer(vertices,indices);
+            return pRenderer->createGeometryBuffer(vertices,indices,true,lodIndices,lodErrors);
         }
 
         /**
@@ -208,6 +300,8 @@ namespace vk
          */
         vk::resources::GeometryBufferPtr LoadVulkanGeometryMesh(VkRenderer *pRenderer, const std::string &filename, bool loadWeightInformation)
         {
+            PROFILE_SCOPE("vk::helpers::LoadVulkanGeometryMesh");
+
             // Полный путь к файлу
             auto path = ::tools::ExeDir().append("..\\Models\\").append(filename);
 
@@ -323,8 +417,19 @@ namespace vk
                 }
             }
 
+            // Касательные (для карт нормалей и параллакса)
+            vk::tools::ComputeTangents(vertices,indices);
+
+            // Оптимизация порядка индексов и вершин
+            OptimizeGeometry(filename, &vertices, &indices);
+
+            // Уровни детализации
+            std::vector<std::vector<uint32_t>> lodIndices;
+            std::vector<float> lodErrors;
+            BuildGeometryLods(filename, vertices, indices, &lodIndices, &lodErrors);
+
             // Отдать smart-pointer объекта ресурса геометрического буфера
-            return pRenderer->createGeometryBuffer(vertices,indices);
+            return pRenderer->createGeometryBuffer(vertices,indices,true,lodIndices,lodErrors);
         }
 
         // Методы для конвертирования векторов, матриц и кватернионов из Assimp в GLM
@@ -382,6 +487,8 @@ namespace vk
          */
         vk::scene::UniqueMeshSkeleton LoadVulkanMeshSkeleton(const std::string &filename)
         {
+            PROFILE_SCOPE("vk::helpers::LoadVulkanMeshSkeleton");
+
             // Итоговый скелет
             vk::scene::UniqueMeshSkeleton skeleton = std::make_unique<vk::scene::MeshSkeleton>();
 
@@ -450,6 +557,8 @@ namespace vk
          */
         std::vector<vk::scene::MeshSkeletonAnimationPtr> LoadVulkanMeshSkeletonAnimations(const std::string &filename)
         {
+            PROFILE_SCOPE("vk::helpers::LoadVulkanMeshSkeletonAnimations");
+
             // Итоговый массив анимаций
             std::vector<vk::scene::MeshSkeletonAnimationPtr> animations;
 
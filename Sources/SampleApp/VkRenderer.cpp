@@ -1,5 +1,52 @@
 #include "VkRenderer.h"
 #include "VkExtensionLoader/ExtensionLoader.h"
+#include "Tools/Profiler.hpp"
+
+#include <unordered_set>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+/**
+ * Минимальное кол-во мешей в части, записываемой отдельным потоком
+ * При меньшем кол-ве затраты на передачу задачи потоку превышают выигрыш от параллельной записи
+ */
+const size_t MIN_MESHES_PER_RECORDING_CHUNK = 64;
+
+// Номер привязки потока экземпляров (после потоков вершин основного прохода: основной, скелет, цвет)
+const uint32_t INSTANCE_STREAM_BINDING = 3;
+
+// Номер набора дескрипторов данных объектов (динамический UBO кольцевого буфера)
+const uint32_t OBJECT_UNIFORM_SET = 3;
+
+// Размер рабочей группы шейдера отсечения (должен совпадать с WORKGROUP_SIZE в Shaders/cull.comp)
+const size_t GPU_CULLING_WORKGROUP_SIZE = 64;
+
+/**
+ * Максимальное кол-во изображений swap-chain
+ * От него зависит размер пула дескрипторов, передающих изображения основного прохода в проход пост-обработки
+ */
+const uint32_t MAX_SWAP_CHAIN_IMAGES = 8;
+
+/**
+ * Размер блока пула геометрии по умолчанию (кол-во вершин и размер буфера индексов в байтах)
+ * Геометрия, не помещающаяся в блок такого размера, получает отдельный блок
+ */
+const size_t GEOMETRY_POOL_BLOCK_VERTICES = 1u << 18u;
+const size_t GEOMETRY_POOL_BLOCK_INDEX_SIZE = 1u << 22u;
+
+/**
+ * Флаг варианта основного конвейера, рисующего после пред-прохода глубины (тест глубины EQUAL без записи глубины)
+ * Объединяется с ключом перестановки шейдеров, поэтому вариантов основного конвейера вдвое больше, чем перестановок
+ */
+const uint32_t PIPELINE_PRIMARY_DEPTH_EQUAL = vk::scene::SHADER_PERMUTATION_COUNT;
+const uint32_t PIPELINE_PRIMARY_VARIANT_COUNT = vk::scene::SHADER_PERMUTATION_COUNT * 2;
+
+/**
+ * Индексы под-проходов основного прохода
+ */
+const uint32_t SUBPASS_DEPTH_PRE_PASS = 0;
+const uint32_t SUBPASS_PRIMARY = 1;
 
 /**
  * Инициализация проходов рендеринга
@@ -14,8 +61,8 @@ void VkRenderer::initRenderPassPrimary(const vk::Format &colorAttachmentFormat,
     if(!device_.isReady()){
         throw vk::InitializationFailedError("Can't initialize render pass. Device not ready");
     }
-    // Проверяем готовность поверхности
-    if(!surface_.get()){
+    // Проверяем готовность поверхности (если рендеринг не внеэкранный)
+    if(!isHeadless_ && !surface_.get()){
         throw vk::InitializationFailedError("Can't initialize render pass. Surface not ready");
     }
     // Проверяем поддержку формата вложений глубины
@@ -60,8 +107,15 @@ void VkRenderer::initRenderPassPrimary(const vk::Format &colorAttachmentFormat,
     vk::AttachmentReference colorAttachmentReferences[1] = {{0,vk::ImageLayout::eColorAttachmentOptimal}};
     vk::AttachmentReference depthAttachmentReference{1,vk::ImageLayout::eDepthStencilAttachmentOptimal};
 
-    // Описываем под-проход
-    // Проход должен содержать в себе как минимум один под-проход
+    // Описываем под-проходы
+    // Первый под-проход - пред-проход глубины (только вложение глубины). Если пред-проход выключен, под-проход пуст
+    vk::SubpassDescription depthPrePassDescription{};
+    depthPrePassDescription.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    depthPrePassDescription.colorAttachmentCount = 0;
+    depthPrePassDescription.pColorAttachments = nullptr;
+    depthPrePassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+
+    // Второй под-проход - основной (цвет и глубина)
     vk::SubpassDescription subPassDescription{};
     subPassDescription.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;   // Тип конвейера - графический
     subPassDescription.colorAttachmentCount = 1;                               // Кол-во цветовых вложений
@@ -74,13 +128,35 @@ void VkRenderer::initRenderPassPrimary(const vk::Format &colorAttachmentFormat,
     subPassDescription.pResolveAttachments = nullptr;                          // Вложения для мульти-семплированной картинки (кол-во совпадает с кол-вом цветовых)
 
     // Описываем зависимости (порядок) под-проходов
-    // Хоть в проходе использован только один под-проход, существует также еще и неявный (внешний) под-проход
+    // Помимо под-проходов прохода, существует также еще и неявный (внешний) под-проход
     std::vector<vk::SubpassDependency> subPassDependencies;
 
-    // Переход от внешнего (неявного) под-прохода к первому (нулевому)
+    // Переход от внешнего (неявного) под-прохода к пред-проходу глубины
+    vk::SubpassDependency externalToDepthPrePass;
+    externalToDepthPrePass.srcSubpass = VK_SUBPASS_EXTERNAL;
+    externalToDepthPrePass.dstSubpass = SUBPASS_DEPTH_PRE_PASS;
+    externalToDepthPrePass.srcStageMask = vk::PipelineStageFlagBits::eLateFragmentTests;
+    externalToDepthPrePass.dstStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests;
+    externalToDepthPrePass.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    externalToDepthPrePass.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    externalToDepthPrePass.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+    subPassDependencies.push_back(externalToDepthPrePass);
+
+    // Переход от пред-прохода глубины к основному под-проходу (основной под-проход читает записанную глубину)
+    vk::SubpassDependency depthPrePassToPrimary;
+    depthPrePassToPrimary.srcSubpass = SUBPASS_DEPTH_PRE_PASS;
+    depthPrePassToPrimary.dstSubpass = SUBPASS_PRIMARY;
+    depthPrePassToPrimary.srcStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+    depthPrePassToPrimary.dstStageMask = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+    depthPrePassToPrimary.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    depthPrePassToPrimary.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    depthPrePassToPrimary.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+    subPassDependencies.push_back(depthPrePassToPrimary);
+
+    // Переход от внешнего (неявного) под-прохода к основному (цветовое вложение используется только в нем)
     vk::SubpassDependency externalToFirst;
     externalToFirst.srcSubpass = VK_SUBPASS_EXTERNAL;
-    externalToFirst.dstSubpass = 0;
+    externalToFirst.dstSubpass = SUBPASS_PRIMARY;
     externalToFirst.srcStageMask = vk::PipelineStageFlagBits::eBottomOfPipe;
     externalToFirst.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
     externalToFirst.srcAccessMask = vk::AccessFlagBits::eMemoryRead;
@@ -88,9 +164,9 @@ void VkRenderer::initRenderPassPrimary(const vk::Format &colorAttachmentFormat,
     externalToFirst.dependencyFlags = vk::DependencyFlagBits::eByRegion;
     subPassDependencies.push_back(externalToFirst);
 
-    // Переход от первого (нулевого) ко внешнему (неявному) под-проходу
+    // Переход от основного ко внешнему (неявному) под-проходу
     vk::SubpassDependency firstToExternal;
-    firstToExternal.srcSubpass = 0;
+    firstToExternal.srcSubpass = SUBPASS_PRIMARY;
     firstToExternal.dstSubpass = VK_SUBPASS_EXTERNAL;
     firstToExternal.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
     firstToExternal.dstStageMask = vk::PipelineStageFlagBits::eBottomOfPipe;
@@ -103,8 +179,9 @@ void VkRenderer::initRenderPassPrimary(const vk::Format &colorAttachmentFormat,
     vk::RenderPassCreateInfo renderPassCreateInfo{};
     renderPassCreateInfo.attachmentCount = attachmentDescriptions.size();
     renderPassCreateInfo.pAttachments = attachmentDescriptions.data();
-    renderPassCreateInfo.subpassCount = 1;
-    renderPassCreateInfo.pSubpasses = &subPassDescription;
+    vk::SubpassDescription subPassDescriptions[2] = {depthPrePassDescription, subPassDescription};
+    renderPassCreateInfo.subpassCount = 2;
+    renderPassCreateInfo.pSubpasses = subPassDescriptions;
     renderPassCreateInfo.dependencyCount = subPassDependencies.size();
     renderPassCreateInfo.pDependencies = subPassDependencies.data();
 
@@ -136,8 +213,8 @@ void VkRenderer::initRenderPassPostProcess(const vk::Format &colorAttachmentForm
     if(!device_.isReady()){
         throw vk::InitializationFailedError("Can't initialize render pass. Device not ready");
     }
-    // Проверяем готовность поверхности
-    if(!surface_.get()){
+    // Проверяем готовность поверхности (если рендеринг не внеэкранный)
+    if(!isHeadless_ && !surface_.get()){
         throw vk::InitializationFailedError("Can't initialize render pass. Surface not ready");
     }
     // Проверяем поддержку формата цветового вложения
@@ -162,6 +239,11 @@ void VkRenderer::initRenderPassPostProcess(const vk::Format &colorAttachmentForm
     colorAttDesc.finalLayout = vk::ImageLayout::ePresentSrcKHR;          // Макет памяти изображения в конце - показ
     attachmentDescriptions.push_back(colorAttDesc);
 
+    // Во внеэкранном режиме показа нет, изображение остается в макете для копирования (чтения результата)
+    if(isHeadless_){
+        attachmentDescriptions.back().finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+    }
+
     // Ссылки на вложения
     // Они содержат индексы описаний вложений, они также совместимы с порядком вложений в кадровом буфере, который привязывается во время начала прохода
     // Также ссылка определяет макет памяти вложения, который используется во время под-прохода
@@ -236,9 +318,9 @@ void VkRenderer::deInitRenderPassPostProcess() noexcept
  * Инициализация swap-chain (цепочки показа)
  * Цепочка показа - набор сменяющихся изображений показываемых на поверхности отображения
  * @param surfaceFormat Формат поверхности
- * @param bufferCount Желаемое кол-во буферов изображений (0 для авто-определения)
+ * @param presentPolicy Параметры показа (режим и кол-во изображений)
  */
-void VkRenderer::initSwapChain(const vk::SurfaceFormatKHR &surfaceFormat, uint32_t bufferCount)
+void VkRenderer::initSwapChain(const vk::SurfaceFormatKHR &surfaceFormat, const VkRendererPresentPolicy& presentPolicy)
 {
     // Проверяем готовность устройства
     if(!device_.isReady()){
@@ -256,31 +338,59 @@ void VkRenderer::initSwapChain(const vk::SurfaceFormatKHR &surfaceFormat, uint32
     // Получить возможности устройства для поверхности
     auto capabilities = device_.getPhysicalDevice().getSurfaceCapabilitiesKHR(surface_.get());
 
-    // Если задано кол-во буферов
-    if(bufferCount > 0){
-        if(bufferCount < capabilities.minImageCount || bufferCount > capabilities.maxImageCount){
-            throw vk::InitializationFailedError("Can't initialize swap-chain. Unsupported buffer count required. Please change it");
-        }
-    }
-    // Если нет - определить оптимальное кол-во
-    else{
-        bufferCount = (capabilities.minImageCount + 1) > capabilities.maxImageCount ? capabilities.maxImageCount : (capabilities.minImageCount + 1);
-    }
+    // Максимальное кол-во изображений (0 у поверхности означает отсутствие ограничения)
+    const uint32_t maxImageCount = capabilities.maxImageCount > 0 ?
+            (std::min<uint32_t>)(capabilities.maxImageCount, MAX_SWAP_CHAIN_IMAGES) :
+            MAX_SWAP_CHAIN_IMAGES;
+
+    // Режимы представления поддерживаемые поверхностью
+    auto presentModes = device_.getPhysicalDevice().getSurfacePresentModesKHR(surface_.get());
+    auto isPresentModeSupported = [&](vk::PresentModeKHR mode){
+        return std::find(presentModes.begin(), presentModes.end(), mode) != presentModes.end();
+    };
 
     // Режим представления
     // Отвечает за синхронизацию с оконной (если показ на окне) системой и скоростью отображения новых кадров на поверхности
-    // Режим FIFO один из простых
+    // Режим FIFO поддерживается всегда, поэтому используется если предпочтительный недоступен
     vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
 
-    // Если кол-во буферов больше единицы, есть смысл выбрать более сложный режим (если его поддерживает поверхность)
-    if(bufferCount > 1){
-        auto presentModes = device_.getPhysicalDevice().getSurfacePresentModesKHR(surface_.get());
-        for(const auto& presentModeEntry : presentModes){
-            if(presentModeEntry == vk::PresentModeKHR::eMailbox){
-                presentMode = presentModeEntry;
-                break;
+    // Кол-во изображений в зависимости от режима
+    uint32_t bufferCount = capabilities.minImageCount;
+
+    switch(presentPolicy.mode)
+    {
+        // Минимальная задержка - новый кадр заменяет ожидающий показа (MAILBOX) либо показывается сразу (IMMEDIATE)
+        // MAILBOX нужно одно изображение сверх минимума, чтобы было что заменять, не блокируя рендеринг
+        case VkRendererPresentMode::eLowLatency:
+            if(isPresentModeSupported(vk::PresentModeKHR::eMailbox)){
+                presentMode = vk::PresentModeKHR::eMailbox;
+                bufferCount = capabilities.minImageCount + 1;
+            }
+            else if(isPresentModeSupported(vk::PresentModeKHR::eImmediate)){
+                presentMode = vk::PresentModeKHR::eImmediate;
             }
+            break;
+
+        // Пропускная способность - очередь FIFO, дополнительные изображения сглаживают неравномерность кадров
+        case VkRendererPresentMode::eThroughput:
+            bufferCount = capabilities.minImageCount + 2;
+            break;
+
+        // Экономия энергии - очередь FIFO, минимум изображений (частота кадров ограничивается при рендеринге)
+        case VkRendererPresentMode::ePowerSaving:
+            break;
+    }
+
+    // Если кол-во буферов задано явно - используется оно
+    if(presentPolicy.swapChainImageCount > 0){
+        if(presentPolicy.swapChainImageCount < capabilities.minImageCount || presentPolicy.swapChainImageCount > maxImageCount){
+            throw vk::InitializationFailedError("Can't initialize swap-chain. Unsupported buffer count required. Please change it");
         }
+        bufferCount = presentPolicy.swapChainImageCount;
+    }
+    // Если нет - ограничить возможностями поверхности
+    else{
+        bufferCount = (std::min<uint32_t>)(bufferCount, maxImageCount);
     }
 
     // Старый swap-chain
@@ -318,6 +428,10 @@ void VkRenderer::initSwapChain(const vk::SurfaceFormatKHR &surfaceFormat, uint32
     if(oldSwapChain){
         device_.getLogicalDevice()->destroySwapchainKHR(oldSwapChain);
     }
+
+    // Запомнить фактический режим, swap-chain соответствует поверхности
+    swapChainPresentMode_ = presentMode;
+    swapChainOutdated_ = false;
 }
 
 /**
@@ -344,27 +458,36 @@ void VkRenderer::initFrameBuffersPrimary(const vk::Format &colorAttachmentFormat
     if(!device_.isReady()){
         throw vk::InitializationFailedError("Can't initialize frame buffers. Device not ready");
     }
-    // Проверяем готовность поверхности
-    if(!surface_.get()){
-        throw vk::InitializationFailedError("Can't initialize frame buffers. Surface not ready");
-    }
-    // Проверяем готовность swap-chain'а
-    if(!swapChainKhr_.get()){
-        throw vk::InitializationFailedError("Can't initialize frame-buffers. Swap-chain not ready");
-    }
     // Проверяем готовность прохода для которого создаются буферы
     if(!renderPassPrimary_.get()){
         throw vk::InitializationFailedError("Can't initialize frame-buffers. Required render pass not ready");
     }
 
-    // Получить изображения swap-chain'а
-    auto swapChainImages = device_.getLogicalDevice()->getSwapchainImagesKHR(swapChainKhr_.get());
+    // Кол-во кадровых буферов и их разрешение
+    // Во внеэкранном режиме кадровый буфер свой у каждого кадра в полете, разрешение задано при создании рендерера
+    size_t frameBufferCount = maxFramesInFlight_;
+    vk::Extent2D extent = offscreenExtent_;
 
-    // Получить возможности устройства для поверхности
-    auto capabilities = device_.getPhysicalDevice().getSurfaceCapabilitiesKHR(surface_.get());
+    if(!isHeadless_)
+    {
+        // Проверяем готовность поверхности
+        if(!surface_.get()){
+            throw vk::InitializationFailedError("Can't initialize frame buffers. Surface not ready");
+        }
+        // Проверяем готовность swap-chain'а
+        if(!swapChainKhr_.get()){
+            throw vk::InitializationFailedError("Can't initialize frame-buffers. Swap-chain not ready");
+        }
 
-    // Пройтись по всем изображениям и создать кадровый буфер для каждого
-    for(const auto& swapChainImage : swapChainImages)
+        // По одному кадровому буферу на каждое изображение swap-chain'а
+        frameBufferCount = device_.getLogicalDevice()->getSwapchainImagesKHR(swapChainKhr_.get()).size();
+
+        // Получить возможности устройства для поверхности
+        extent = device_.getPhysicalDevice().getSurfaceCapabilitiesKHR(surface_.get()).currentExtent;
+    }
+
+    // Создать кадровый буфер для каждого изображения
+    for(size_t i = 0; i < frameBufferCount; i++)
     {
         // Описываем вложения кадрового буфера
         // Порядок вложений должен совпадать с порядком вложений в описании прохода рендеринга
@@ -393,7 +516,7 @@ void VkRenderer::initFrameBuffersPrimary(const vk::Format &colorAttachmentFormat
         frameBuffersPrimary_.emplace_back(vk::resources::FrameBuffer(
                 &device_,
                 renderPassPrimary_,
-                {capabilities.currentExtent.width,capabilities.currentExtent.height,1},
+                {extent.width,extent.height,1},
                 attachmentsInfo));
     }
 }
@@ -421,6 +544,37 @@ void VkRenderer::initFrameBuffersPostProcess(const vk::Format &colorAttachmentFo
     if(!device_.isReady()){
         throw vk::InitializationFailedError("Can't initialize frame buffers. Device not ready");
     }
+    // Проверяем готовность прохода для которого создаются буферы
+    if(!renderPassPostProcess_.get()){
+        throw vk::InitializationFailedError("Can't initialize frame-buffers. Required render pass not ready");
+    }
+
+    // Во внеэкранном режиме изображения создаются самими кадровыми буферами (по одному на кадр в полете)
+    // Помимо записи в них, из них можно копировать (для чтения результата)
+    if(isHeadless_)
+    {
+        for(size_t i = 0; i < maxFramesInFlight_; i++)
+        {
+            std::vector<vk::resources::FrameBufferAttachmentInfo> attachmentsInfo = {
+                    {
+                            nullptr,
+                            vk::ImageType::e2D,
+                            colorAttachmentFormat,
+                            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                            vk::ImageAspectFlagBits::eColor
+                    },
+            };
+
+            frameBuffersPostProcess_.emplace_back(vk::resources::FrameBuffer(
+                    &device_,
+                    renderPassPostProcess_,
+                    {offscreenExtent_.width,offscreenExtent_.height,1},
+                    attachmentsInfo));
+        }
+
+        return;
+    }
+
     // Проверяем готовность поверхности
     if(!surface_.get()){
         throw vk::InitializationFailedError("Can't initialize frame buffers. Surface not ready");
@@ -429,10 +583,6 @@ void VkRenderer::initFrameBuffersPostProcess(const vk::Format &colorAttachmentFo
     if(!swapChainKhr_.get()){
         throw vk::InitializationFailedError("Can't initialize frame-buffers. Swap-chain not ready");
     }
-    // Проверяем готовность прохода для которого создаются буферы
-    if(!renderPassPostProcess_.get()){
-        throw vk::InitializationFailedError("Can't initialize frame-buffers. Required render pass not ready");
-    }
 
     // Получить изображения swap-chain'а
     auto swapChainImages = device_.getLogicalDevice()->getSwapchainImagesKHR(swapChainKhr_.get());
@@ -479,10 +629,10 @@ void VkRenderer::deInitFrameBuffersPostProcess() noexcept
 
 /**
  * Инициализация дескрипторов (наборов дескрипторов)
- * @param maxMeshes Максимальное кол-во одновременно отображающихся мешей (влияет на максимальное кол-во наборов для материала меша и прочего)
  * @param frameBufferCount Кол-во кадровых буферов (от него зависит кол-во дескрипторных наборов передаваемых на этап пост-обработки)
+ * @param framesInFlight Кол-во кадров в полете (у камеры и источников отдельный набор на каждый кадр)
  */
-void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBufferCount)
+void VkRenderer::initDescriptorPoolsAndLayouts(size_t frameBufferCount, size_t framesInFlight)
 {
     // Проверяем готовность устройства
     if(!device_.isReady()){
@@ -498,45 +648,32 @@ void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBuf
         // Размеры пула для наборов типа "UBO"
         std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
                 // Один дескриптор в наборе отвечает за обычный UBO буфер (привязывается единожды за кадр)
-                {vk::DescriptorType::eUniformBuffer, 1},
+                {vk::DescriptorType::eUniformBuffer, static_cast<uint32_t>(framesInFlight)},
         };
 
-        // Нам нужен один набор данного типа, он будет привязываться единожды за кадр (камера, вид, проекция)
+        // Нужен один набор данного типа на каждый кадр в полете, он будет привязываться единожды за кадр (камера, вид, проекция)
         vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo{};
         descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
         descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-        descriptorPoolCreateInfo.maxSets = 1;
+        descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(framesInFlight);
         descriptorPoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
         descriptorPoolCamera_ = device_.getLogicalDevice()->createDescriptorPoolUnique(descriptorPoolCreateInfo);
     }
 
-    // Создать пул для наборов мешей
+    // Создать пул для набора данных объектов
     {
-        // Размеры пула для наборов типа "материал меша"
+        // Один динамический UBO - кольцевой буфер кадров (блок объекта задается смещением при привязке)
         std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
-                // Дескриптор матрицы модели
-                {vk::DescriptorType::eUniformBuffer,1},
-                // Дескриптор параметров отображения текстуры
-                {vk::DescriptorType::eUniformBuffer,1},
-                // Дескриптор для параметров материала
-                {vk::DescriptorType::eUniformBuffer,1},
-                // Дескриптор для текстуры/семплера
-                {vk::DescriptorType::eCombinedImageSampler, 5},
-                // Дескриптор для параметров использования текстур
-                {vk::DescriptorType::eUniformBuffer, 1},
-                // Дескриптор для буфера кол-ва костей скелетной анимации
-                {vk::DescriptorType::eUniformBuffer, 1},
-                // Дескриптор для буфера трансформаций костей скелетной анимации
-                {vk::DescriptorType::eUniformBuffer, 1}
+                {vk::DescriptorType::eUniformBufferDynamic, 1}
         };
 
-        // Поскольку у каждого меша есть свой набор, то кол-во таких наборов ограничено кол-вом мешей
+        // Набор общий для всех мешей и кадров
         vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo{};
         descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
         descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-        descriptorPoolCreateInfo.maxSets = maxMeshes;
+        descriptorPoolCreateInfo.maxSets = 1;
         descriptorPoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
-        descriptorPoolMeshes_ = device_.getLogicalDevice()->createDescriptorPoolUnique(descriptorPoolCreateInfo);
+        descriptorPoolObjects_ = device_.getLogicalDevice()->createDescriptorPoolUnique(descriptorPoolCreateInfo);
     }
 
     // Создать пул для набора описывающего источники света сцены
@@ -544,16 +681,16 @@ void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBuf
         // Размеры пула для наборов типа "материал меша"
         std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
                 // Дескриптор кол-ва источников
-                {vk::DescriptorType::eUniformBuffer,1},
+                {vk::DescriptorType::eUniformBuffer,static_cast<uint32_t>(framesInFlight)},
                 // Дескриптор массива источников
-                {vk::DescriptorType::eUniformBuffer,1},
+                {vk::DescriptorType::eUniformBuffer,static_cast<uint32_t>(framesInFlight)},
         };
 
-        // Нам нужен один набор данного типа, он будет привязываться единожды за кадр (кол-во источников и массив источников)
+        // Нужен один набор данного типа на каждый кадр в полете, он будет привязываться единожды за кадр (кол-во источников и массив источников)
         vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo{};
         descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
         descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-        descriptorPoolCreateInfo.maxSets = 1;
+        descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(framesInFlight);
         descriptorPoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
         descriptorPoolLightSources_ = device_.getLogicalDevice()->createDescriptorPoolUnique(descriptorPoolCreateInfo);
     }
@@ -563,7 +700,7 @@ void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBuf
         // Размеры пула для наборов типа "материал меша"
         std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
                 // Дескриптор для текстуры/семплера
-                {vk::DescriptorType::eCombinedImageSampler, 1}
+                {vk::DescriptorType::eCombinedImageSampler, static_cast<uint32_t>(frameBufferCount)}
         };
 
         // Поскольку у каждого меша есть свой набор, то кол-во таких наборов ограничено кол-вом мешей
@@ -600,65 +737,17 @@ void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBuf
         descriptorSetLayoutCamera_ = device_.getLogicalDevice()->createDescriptorSetLayoutUnique(descriptorSetLayoutCreateInfo);
     }
 
-    // Макет размещения материала меша
+    // Макет размещения набора данных объектов
     {
         // Описание привязок
         std::vector<vk::DescriptorSetLayoutBinding> bindings = {
-                // UBO буфер для матриц
+                // Динамический UBO буфер (параметры отображения текстуры, кол-во и матрицы костей)
                 {
                         0,
-                        vk::DescriptorType::eUniformBuffer,
-                        1,
-                        vk::ShaderStageFlagBits::eVertex,
-                        nullptr,
-                },
-                // UBO буфер для параметров отображения текстуры
-                {
-                        1,
-                        vk::DescriptorType::eUniformBuffer,
+                        vk::DescriptorType::eUniformBufferDynamic,
                         1,
                         vk::ShaderStageFlagBits::eVertex,
                         nullptr,
-                },
-                // UBO буфер для параметров материала
-                {
-                        2,
-                        vk::DescriptorType::eUniformBuffer,
-                        1,
-                        vk::ShaderStageFlagBits::eFragment,
-                        nullptr,
-                },
-                // Текстурный семплер
-                {
-                        3,
-                        vk::DescriptorType::eCombinedImageSampler,
-                        5,
-                        vk::ShaderStageFlagBits::eFragment,
-                        nullptr,
-                },
-                // UBO буфер для параметров использования текстур
-                {
-                        4,
-                        vk::DescriptorType::eUniformBuffer,
-                        1,
-                        vk::ShaderStageFlagBits::eFragment,
-                        nullptr,
-                },
-                // UBO буфер для кол-ва костей скелетной анимации
-                {
-                    5,
-                    vk::DescriptorType::eUniformBuffer,
-                    1,
-                    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eGeometry,
-                    nullptr
-                },
-                // UBO буфер для матриц трансформаций костей скелетной анимации
-                {
-                    6,
-                    vk::DescriptorType::eUniformBuffer,
-                    1,
-                    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eGeometry,
-                    nullptr
                 }
         };
 
@@ -666,7 +755,7 @@ void VkRenderer::initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBuf
         vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
         descriptorSetLayoutCreateInfo.bindingCount = bindings.size();
         descriptorSetLayoutCreateInfo.pBindings = bindings.data();
-        descriptorSetLayoutMeshes_ = device_.getLogicalDevice()->createDescriptorSetLayoutUnique(descriptorSetLayoutCreateInfo);
+        descriptorSetLayoutObjects_ = device_.getLogicalDevice()->createDescriptorSetLayoutUnique(descriptorSetLayoutCreateInfo);
     }
 
     // Макет размещения набора описывающего источники света сцены
@@ -732,7 +821,7 @@ void VkRenderer::deInitDescriptorPoolsAndLayouts() noexcept
     // Поскольку функция может быть вызвана в деструкторе важно гарантировать отсутствие исключений
     try{
         device_.getLogicalDevice()->resetDescriptorPool(descriptorPoolCamera_.get());
-        device_.getLogicalDevice()->resetDescriptorPool(descriptorPoolMeshes_.get());
+        device_.getLogicalDevice()->resetDescriptorPool(descriptorPoolObjects_.get());
         device_.getLogicalDevice()->resetDescriptorPool(descriptorPoolLightSources_.get());
         device_.getLogicalDevice()->resetDescriptorPool(descriptorPoolImagesToPostProcess_.get());
     }
@@ -740,21 +829,21 @@ void VkRenderer::deInitDescriptorPoolsAndLayouts() noexcept
 
     // Уничтожить размещения дескрипторов
     device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutCamera_.get());
-    device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutMeshes_.get());
+    device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutObjects_.get());
     device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutLightSources_.get());
     device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutImagesToPostProcess_.get());
     descriptorSetLayoutCamera_.release();
-    descriptorSetLayoutMeshes_.release();
+    descriptorSetLayoutObjects_.release();
     descriptorSetLayoutLightSources_.release();
     descriptorSetLayoutImagesToPostProcess_.release();
 
     // Уничтожить пулы дескрипторов
     device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolCamera_.get());
-    device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolMeshes_.get());
+    device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolObjects_.get());
     device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolLightSources_.get());
     device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolImagesToPostProcess_.get());
     descriptorPoolCamera_.release();
-    descriptorPoolMeshes_.release();
+    descriptorPoolObjects_.release();
     descriptorPoolLightSources_.release();
     descriptorPoolImagesToPostProcess_.release();
 }
@@ -826,15 +915,18 @@ void VkRenderer::updateFrameBuffersPrimaryDescriptorSets()
 
 
 /**
- * Инициализация графического конвейера
+ * Инициализация основного графического конвейера (макет размещения и шейдерные модули)
  * @param vertexShaderCodeBytes Код вершинного шейдера
- * @param geometryShaderCodeBytes Код геометрического шейдера
  * @param fragmentShaderCodeBytes Код фрагментного шейдера
+ * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины
+ *
+ * @details Сами конвейеры создаются по мере необходимости - отдельный вариант на каждую перестановку шейдеров
+ * (см. requestPipelinePrimaryVariant), поэтому шейдерные модули живут до де-инициализации
  */
 void VkRenderer::initPipelinePrimary(
         const std::vector<unsigned char>& vertexShaderCodeBytes,
-        const std::vector<unsigned char>& geometryShaderCodeBytes,
-        const std::vector<unsigned char>& fragmentShaderCodeBytes)
+        const std::vector<unsigned char>& fragmentShaderCodeBytes,
+        const std::vector<unsigned char>& vertexShaderCodeBytesDepth)
 {
     // Проверяем готовность устройства
     if(!device_.isReady()){
@@ -853,7 +945,8 @@ void VkRenderer::initPipelinePrimary(
     std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
             descriptorSetLayoutCamera_.get(),
             descriptorSetLayoutLightSources_.get(),
-            descriptorSetLayoutMeshes_.get()
+            device_.getTextureTable()->getDescriptorSetLayout(),
+            descriptorSetLayoutObjects_.get()
     };
 
     // Создать макет размещения конвейера
@@ -863,14 +956,84 @@ void VkRenderer::initPipelinePrimary(
         descriptorSetLayouts.data()
     });
 
+    // Ш Е Й Д Е Р Н Ы Е  М О Д У Л И
+
+    // Убеждаемся что шейдерный код был предоставлен
+    if(vertexShaderCodeBytes.empty() || fragmentShaderCodeBytes.empty() || vertexShaderCodeBytesDepth.empty()){
+        throw vk::InitializationFailedError("No shader code provided");
+    }
+
+    // Вершинный шейдер
+    shaderModulePrimaryVs_ = device_.getLogicalDevice()->createShaderModuleUnique({
+            {},
+            vertexShaderCodeBytes.size(),
+            reinterpret_cast<const uint32_t*>(vertexShaderCodeBytes.data())});
+
+    // Фрагментный шейдер
+    shaderModulePrimaryFs_ = device_.getLogicalDevice()->createShaderModuleUnique({
+            {},
+            fragmentShaderCodeBytes.size(),
+            reinterpret_cast<const uint32_t*>(fragmentShaderCodeBytes.data())});
+
+    // Вершинный шейдер пред-прохода глубины
+    shaderModuleDepthPrePassVs_ = device_.getLogicalDevice()->createShaderModuleUnique({
+            {},
+            vertexShaderCodeBytesDepth.size(),
+            reinterpret_cast<const uint32_t*>(vertexShaderCodeBytesDepth.data())});
+
+    // Место под все варианты конвейера (создаются по запросу)
+    pipelinesPrimary_.resize(PIPELINE_PRIMARY_VARIANT_COUNT);
+    pipelinesPrimaryReady_.resize(PIPELINE_PRIMARY_VARIANT_COUNT);
+    pipelinesPrimaryRequested_.assign(PIPELINE_PRIMARY_VARIANT_COUNT, false);
+
+    // Варианты конвейера пред-прохода глубины (без скелета и со скелетом)
+    pipelinesDepthPrePass_.resize(2);
+    pipelinesDepthPrePassReady_.resize(2);
+}
+
+/**
+ * Создание варианта основного графического конвейера
+ * @param variant Ключ варианта (ключ перестановки шейдеров, см. vk::scene::SHADER_PERMUTATION_*, и флаг PIPELINE_PRIMARY_DEPTH_EQUAL)
+ * @param viewPortExtent Разрешение области вида (для статической настройки)
+ *
+ * @details Варианты отличаются значениями специализационных констант шейдеров, поэтому драйвер исключает
+ * из каждого варианта неиспользуемые ветви (скелетную анимацию, выборки из отсутствующих текстур, параллакс).
+ * Варианты для рисования после пред-прохода глубины только проверяют глубину на равенство и не пишут ее.
+ * Может вызываться из потоков пула - пишет только свой элемент массива вариантов
+ */
+void VkRenderer::createPipelinePrimaryVariant(uint32_t variant, const vk::Extent2D& viewPortExtent)
+{
+    const uint32_t permutation = variant & (vk::scene::SHADER_PERMUTATION_COUNT - 1);
+    const bool depthEqual = (variant & PIPELINE_PRIMARY_DEPTH_EQUAL) != 0;
+
     // Э Т А П  В В О Д А  Д А Н Н Ы Х
 
-    // Описываем первый привязываемый вершинный буфер
+    // Описываем привязываемые вершинные буферы (потоки)
+    // Необязательные потоки (скелет, цвет) у вариантов, которым они не нужны, описываются с нулевым шагом - все вершины
+    // читают значение по умолчанию из нулевой вершины блока пула геометрии (см. vk::resources::GeometryPoolBlock)
+    const bool skinned = (permutation & vk::scene::SHADER_PERMUTATION_SKINNED) != 0;
+    const bool colored = (permutation & vk::scene::SHADER_PERMUTATION_VERTEX_COLOR) != 0;
+
     std::vector<vk::VertexInputBindingDescription> vertexInputBindingDescriptions = {
             {
                     0,
-                    sizeof(vk::tools::Vertex),
+                    sizeof(vk::tools::VertexPacked),
+                    vk::VertexInputRate::eVertex
+            },
+            {
+                    1,
+                    skinned ? static_cast<uint32_t>(sizeof(vk::tools::VertexSkinPacked)) : 0,
+                    vk::VertexInputRate::eVertex
+            },
+            {
+                    2,
+                    colored ? static_cast<uint32_t>(sizeof(vk::tools::VertexColorPacked)) : 0,
                     vk::VertexInputRate::eVertex
+            },
+            {
+                    INSTANCE_STREAM_BINDING,
+                    sizeof(vk::tools::InstanceData),
+                    vk::VertexInputRate::eInstance
             }
     };
 
@@ -880,40 +1043,60 @@ void VkRenderer::initPipelinePrimary(
                     0,
                     0,
                     vk::Format::eR32G32B32Sfloat,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, position))
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexPacked, position))
             },
             {
                     1,
-                    0,
-                    vk::Format::eR32G32B32Sfloat,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, color))
+                    2,
+                    vk::Format::eR8G8B8A8Unorm,
+                    0
             },
             {
                     2,
                     0,
-                    vk::Format::eR32G32Sfloat,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, uv))
+                    vk::Format::eR16G16Sfloat,
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexPacked, uv))
             },
             {
                     3,
                     0,
-                    vk::Format::eR32G32B32Sfloat,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, normal))
+                    vk::Format::eR16G16Snorm,
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexPacked, normal))
             },
             {
                     4,
-                    0,
-                    vk::Format::eR32G32B32A32Sint,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, boneIndices))
+                    1,
+                    vk::Format::eR8G8B8A8Uint,
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexSkinPacked, boneIndices))
             },
             {
                     5,
+                    1,
+                    vk::Format::eR8G8B8A8Unorm,
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexSkinPacked, weights))
+            },
+            {
+                    6,
                     0,
-                    vk::Format::eR32G32B32A32Sfloat,
-                    static_cast<uint32_t>(offsetof(vk::tools::Vertex, weights))
+                    vk::Format::eR8G8B8A8Snorm,
+                    static_cast<uint32_t>(offsetof(vk::tools::VertexPacked, tangent))
             }
     };
 
+    // Атрибуты потока экземпляров (матрицы передаются по столбцам, каждый столбец - отдельный атрибут)
+    for(uint32_t column = 0; column < 4; column++){
+        vertexInputAttributeDescriptions.emplace_back(7 + column, INSTANCE_STREAM_BINDING, vk::Format::eR32G32B32A32Sfloat,
+                static_cast<uint32_t>(offsetof(vk::tools::InstanceData, model) + sizeof(glm::vec4) * column));
+    }
+    for(uint32_t column = 0; column < 3; column++){
+        vertexInputAttributeDescriptions.emplace_back(11 + column, INSTANCE_STREAM_BINDING, vk::Format::eR32G32B32Sfloat,
+                static_cast<uint32_t>(offsetof(vk::tools::InstanceData, normalMatrix) + sizeof(glm::vec4) * column));
+    }
+    vertexInputAttributeDescriptions.emplace_back(14, INSTANCE_STREAM_BINDING, vk::Format::eR32G32B32A32Sfloat,
+            static_cast<uint32_t>(offsetof(vk::tools::InstanceData, material)));
+    vertexInputAttributeDescriptions.emplace_back(15, INSTANCE_STREAM_BINDING, vk::Format::eR32G32B32A32Uint,
+            static_cast<uint32_t>(offsetof(vk::tools::InstanceData, metallic)));
+
     vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{};
     pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = vertexInputBindingDescriptions.size();
     pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = vertexInputBindingDescriptions.data();
@@ -928,41 +1111,39 @@ void VkRenderer::initPipelinePrimary(
 
     // Ш Е Й Д Е Р Ы ( П Р О Г Р А М И Р У Е М Ы Е  С Т А Д И И)
 
-    // Убеждаемся что шейдерный код был предоставлен
-    if(vertexShaderCodeBytes.empty() || fragmentShaderCodeBytes.empty() || geometryShaderCodeBytes.empty()){
-        throw vk::InitializationFailedError("No shader code provided");
-    }
-
-    // Вершинный шейдер
-    vk::ShaderModule shaderModuleVs = device_.getLogicalDevice()->createShaderModule({
-            {},
-            vertexShaderCodeBytes.size(),
-            reinterpret_cast<const uint32_t*>(vertexShaderCodeBytes.data())});
-
-    // Геометрический шейдер
-    vk::ShaderModule shaderModuleGs = device_.getLogicalDevice()->createShaderModule({
-            {},
-            geometryShaderCodeBytes.size(),
-            reinterpret_cast<const uint32_t*>(geometryShaderCodeBytes.data())});
+    // Значения специализационных констант (bool константы передаются как VkBool32)
+    struct
+    {
+        VkBool32 skinned;
+        uint32_t textureMask;
+        VkBool32 parallax;
+    } specializationData{};
+    specializationData.skinned = (permutation & vk::scene::SHADER_PERMUTATION_SKINNED) ? VK_TRUE : VK_FALSE;
+    specializationData.textureMask = (permutation >> vk::scene::SHADER_PERMUTATION_TEXTURE_SHIFT) & vk::scene::SHADER_PERMUTATION_TEXTURE_MASK;
+    specializationData.parallax = (permutation & vk::scene::SHADER_PERMUTATION_PARALLAX) ? VK_TRUE : VK_FALSE;
+
+    // Связь идентификаторов констант (constant_id в шейдерах) с данными
+    std::vector<vk::SpecializationMapEntry> specializationMapEntries = {
+            {0, static_cast<uint32_t>(offsetof(decltype(specializationData), skinned)), sizeof(VkBool32)},
+            {1, static_cast<uint32_t>(offsetof(decltype(specializationData), textureMask)), sizeof(uint32_t)},
+            {2, static_cast<uint32_t>(offsetof(decltype(specializationData), parallax)), sizeof(VkBool32)}
+    };
 
-    // Фрагментный шейдер
-    vk::ShaderModule shaderModuleFs = device_.getLogicalDevice()->createShaderModule({
-            {},
-            fragmentShaderCodeBytes.size(),
-            reinterpret_cast<const uint32_t*>(fragmentShaderCodeBytes.data())});
+    // Константы, отсутствующие в шейдере стадии, игнорируются, поэтому у всех стадий общее описание
+    vk::SpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size());
+    specializationInfo.pMapEntries = specializationMapEntries.data();
+    specializationInfo.dataSize = sizeof(specializationData);
+    specializationInfo.pData = &specializationData;
 
     // Описываем стадии
     std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
-            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eVertex,shaderModuleVs,"main"),
-            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eGeometry,shaderModuleGs,"main"),
-            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eFragment,shaderModuleFs,"main")
+            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eVertex,shaderModulePrimaryVs_.get(),"main",&specializationInfo),
+            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eFragment,shaderModulePrimaryFs_.get(),"main",&specializationInfo)
     };
 
     // V I E W  P O R T  &  S C I S S O R S
 
-    // Получить разрешение view-port'а
-    auto viewPortExtent = frameBuffersPrimary_[0].getExtent();
-
     // Настройки области отображения (статическая настройка, на случай отключения динамического состояния)
     vk::Viewport viewport{};
     viewport.setX(0.0f);
@@ -1004,8 +1185,9 @@ void VkRenderer::initPipelinePrimary(
     // Параметры теста глубины
     vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo{};
     pipelineDepthStencilStateCreateInfo.depthTestEnable = true;                        // Тест глубины включен
-    pipelineDepthStencilStateCreateInfo.depthWriteEnable = true;                       // Запись в тест глубины включена
-    pipelineDepthStencilStateCreateInfo.depthCompareOp = vk::CompareOp::eLessOrEqual;  // Функция сравнения (меньше или равно)
+    pipelineDepthStencilStateCreateInfo.depthWriteEnable = !depthEqual;                // Запись глубины (после пред-прохода глубина уже записана)
+    pipelineDepthStencilStateCreateInfo.depthCompareOp = depthEqual ?                  // Функция сравнения (после пред-прохода - равенство,
+            vk::CompareOp::eEqual : vk::CompareOp::eLessOrEqual;                       // иначе меньше или равно)
     pipelineDepthStencilStateCreateInfo.depthBoundsTestEnable = false;                 // Тест границ глубины отключен
     pipelineDepthStencilStateCreateInfo.stencilTestEnable = false;                     // Тест трафарета отключен
     pipelineDepthStencilStateCreateInfo.back.failOp = vk::StencilOp::eKeep;            // В случае провала теста трафарета для задних граней
@@ -1073,64 +1255,281 @@ void VkRenderer::initPipelinePrimary(
     graphicsPipelineCreateInfo.pDynamicState = &pipelineDynamicStateCreateInfo;
     graphicsPipelineCreateInfo.layout = pipelineLayoutPrimary_.get();
     graphicsPipelineCreateInfo.renderPass = renderPassPrimary_.get();
-    graphicsPipelineCreateInfo.subpass = 0;
-    auto pipeline = device_.getLogicalDevice()->createGraphicsPipeline(nullptr,graphicsPipelineCreateInfo);
-
-    // Уничтожить шейдерные модули (конвейер создан, они не нужны)
-    device_.getLogicalDevice()->destroyShaderModule(shaderModuleVs);
-    device_.getLogicalDevice()->destroyShaderModule(shaderModuleFs);
-    device_.getLogicalDevice()->destroyShaderModule(shaderModuleGs);
+    graphicsPipelineCreateInfo.subpass = SUBPASS_PRIMARY;
+    auto pipeline = device_.getLogicalDevice()->createGraphicsPipeline(pipelineCache_.getVulkanPipelineCache().get(),graphicsPipelineCreateInfo);
 
     // Вернуть unique smart pointer
-    pipelinePrimary_ = vk::UniquePipeline(pipeline.value);
+    pipelinesPrimary_[variant] = vk::UniquePipeline(pipeline.value);
 }
 
 /**
- * Де-инициализация графического конвейера
+ * Создание варианта конвейера пред-прохода глубины
+ * @param skinned Вариант для мешей со скелетной анимацией
+ * @param viewPortExtent Разрешение области вида (для статической настройки)
+ *
+ * @details Конвейер без фрагментного шейдера и цветовых вложений - только запись глубины. Положения читаются из
+ * отдельного плотного потока геометрии (см. GeometryBuffer::getPositionBuffer), данные скелета - из потока скелета.
+ * Может вызываться из потоков пула - пишет только свой элемент массива вариантов
  */
-void VkRenderer::deInitPipelinePrimary() noexcept
+void VkRenderer::createPipelineDepthPrePassVariant(bool skinned, const vk::Extent2D& viewPortExtent)
 {
-    // Проверяем готовность устройства
-    assert(device_.isReady());
+    // Э Т А П  В В О Д А  Д А Н Н Ы Х
 
-    // Уничтожить конвейер
-    device_.getLogicalDevice()->destroyPipeline(pipelinePrimary_.get());
-    pipelinePrimary_.release();
+    // Поток положений, поток скелета (у варианта без скелета - с нулевым шагом, см. vk::resources::GeometryPoolBlock)
+    // и поток экземпляров
+    std::vector<vk::VertexInputBindingDescription> vertexInputBindingDescriptions = {
+            {0, sizeof(glm::vec3), vk::VertexInputRate::eVertex},
+            {1, skinned ? static_cast<uint32_t>(sizeof(vk::tools::VertexSkinPacked)) : 0, vk::VertexInputRate::eVertex},
+            {INSTANCE_STREAM_BINDING, sizeof(vk::tools::InstanceData), vk::VertexInputRate::eInstance}
+    };
 
-    // Уничтожить размещение конвейера
-    device_.getLogicalDevice()->destroyPipelineLayout(pipelineLayoutPrimary_.get());
-    pipelineLayoutPrimary_.release();
-}
+    // Атрибуты (номера совпадают с номерами атрибутов основного вершинного шейдера)
+    std::vector<vk::VertexInputAttributeDescription> vertexInputAttributeDescriptions = {
+            {0, 0, vk::Format::eR32G32B32Sfloat, 0},
+            {4, 1, vk::Format::eR8G8B8A8Uint, static_cast<uint32_t>(offsetof(vk::tools::VertexSkinPacked, boneIndices))},
+            {5, 1, vk::Format::eR8G8B8A8Unorm, static_cast<uint32_t>(offsetof(vk::tools::VertexSkinPacked, weights))}
+    };
 
-/**
- * Инициализация конвейера пост-обработки
- * @param vertexShaderCodeBytes
- * @param fragmentShaderCodeBytes
- */
-void VkRenderer::initPipelinePostProcess(const std::vector<unsigned char> &vertexShaderCodeBytes,
-                                         const std::vector<unsigned char> &fragmentShaderCodeBytes)
-{
-    // Проверяем готовность устройства
-    if(!device_.isReady()){
-        throw vk::InitializationFailedError("Can't initialize pipeline. Device not ready");
-    }
-    // Проверяем готовность основного прохода рендеринга
-    if(!renderPassPostProcess_.get()){
-        throw vk::InitializationFailedError("Can't initialize pipeline. Render pass not ready");
+    // Матрица модели из потока экземпляров (по столбцам)
+    for(uint32_t column = 0; column < 4; column++){
+        vertexInputAttributeDescriptions.emplace_back(7 + column, INSTANCE_STREAM_BINDING, vk::Format::eR32G32B32A32Sfloat,
+                static_cast<uint32_t>(offsetof(vk::tools::InstanceData, model) + sizeof(glm::vec4) * column));
     }
 
-    // М А К Е Т  Р А З М Е Щ Е Н И Я  К О Н В Е Й Е Р А
+    vk::PipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{};
+    pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = vertexInputBindingDescriptions.size();
+    pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = vertexInputBindingDescriptions.data();
+    pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = vertexInputAttributeDescriptions.size();
+    pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = vertexInputAttributeDescriptions.data();
 
-    // Массив макетов размещения дескрипторов
-    // ВНИМАНИЕ! Порядок следования наборов в шейдере (индексы дескрипторных наборов) зависит от порядка указания
-    // макетов размещения в данном массиве.
-    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
-            descriptorSetLayoutImagesToPostProcess_.get(),
-    };
+    // Э Т А П  С Б О Р К И  П Р И М И Т И В О В
 
-    // Создать макет размещения конвейера
-    pipelineLayoutPostProcess_ = device_.getLogicalDevice()->createPipelineLayoutUnique({
-        {},
+    vk::PipelineInputAssemblyStateCreateInfo pipelineInputAssemblyStateCreateInfo{};
+    pipelineInputAssemblyStateCreateInfo.topology = vk::PrimitiveTopology::eTriangleList;
+    pipelineInputAssemblyStateCreateInfo.primitiveRestartEnable = false;
+
+    // Ш Е Й Д Е Р Ы ( П Р О Г Р А М И Р У Е М Ы Е  С Т А Д И И)
+
+    // Специализационная константа SKINNED (constant_id = 0, как и в основном вершинном шейдере)
+    const VkBool32 skinnedValue = skinned ? VK_TRUE : VK_FALSE;
+    vk::SpecializationMapEntry specializationMapEntry{0, 0, sizeof(VkBool32)};
+    vk::SpecializationInfo specializationInfo{1, &specializationMapEntry, sizeof(VkBool32), &skinnedValue};
+
+    // Только вершинный шейдер
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
+            vk::PipelineShaderStageCreateInfo({},vk::ShaderStageFlagBits::eVertex,shaderModuleDepthPrePassVs_.get(),"main",&specializationInfo)
+    };
+
+    // V I E W  P O R T  &  S C I S S O R S
+
+    // Настройки области отображения (статическая настройка, фактическая задается динамически)
+    vk::Viewport viewport{};
+    viewport.setX(0.0f);
+    viewport.setWidth(static_cast<float>(viewPortExtent.width));
+    viewport.setY(inputDataInOpenGlStyle_ ? static_cast<float>(viewPortExtent.height) : 0.0f);
+    viewport.setHeight(inputDataInOpenGlStyle_ ? -static_cast<float>(viewPortExtent.height) : static_cast<float>(viewPortExtent.height));
+    viewport.setMinDepth(0.0f);
+    viewport.setMaxDepth(1.0f);
+
+    vk::Rect2D scissors{};
+    scissors.extent = viewPortExtent;
+
+    vk::PipelineViewportStateCreateInfo pipelineViewportStateCreateInfo{};
+    pipelineViewportStateCreateInfo.viewportCount = 1;
+    pipelineViewportStateCreateInfo.pViewports = &viewport;
+    pipelineViewportStateCreateInfo.scissorCount = 1;
+    pipelineViewportStateCreateInfo.pScissors = &scissors;
+
+    // Р А С Т Е Р И З А Ц И Я
+
+    // Параметры должны совпадать с основным конвейером, иначе глубина фрагментов не совпадет при проверке на равенство
+    vk::PipelineRasterizationStateCreateInfo pipelineRasterizationStateCreateInfo{};
+    pipelineRasterizationStateCreateInfo.depthClampEnable = false;
+    pipelineRasterizationStateCreateInfo.rasterizerDiscardEnable = false;
+    pipelineRasterizationStateCreateInfo.polygonMode = vk::PolygonMode::eFill;
+    pipelineRasterizationStateCreateInfo.lineWidth = 1.0f;
+    pipelineRasterizationStateCreateInfo.cullMode = vk::CullModeFlagBits::eBack;
+    pipelineRasterizationStateCreateInfo.frontFace = vk::FrontFace::eClockwise;
+    pipelineRasterizationStateCreateInfo.depthBiasEnable = false;
+
+    // Параметры теста глубины (запись глубины, сравнение "меньше")
+    vk::PipelineDepthStencilStateCreateInfo pipelineDepthStencilStateCreateInfo{};
+    pipelineDepthStencilStateCreateInfo.depthTestEnable = true;
+    pipelineDepthStencilStateCreateInfo.depthWriteEnable = true;
+    pipelineDepthStencilStateCreateInfo.depthCompareOp = vk::CompareOp::eLess;
+    pipelineDepthStencilStateCreateInfo.depthBoundsTestEnable = false;
+    pipelineDepthStencilStateCreateInfo.stencilTestEnable = false;
+
+    // Мульти-семплинг не используется
+    vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateCreateInfo{};
+    pipelineMultisampleStateCreateInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+    pipelineMultisampleStateCreateInfo.minSampleShading = 1.0f;
+
+    // Цветовых вложений в под-проходе нет
+    vk::PipelineColorBlendStateCreateInfo pipelineColorBlendStateCreateInfo{};
+    pipelineColorBlendStateCreateInfo.attachmentCount = 0;
+
+    // Д И Н А М И Ч. С О С Т О Я Н И Я
+
+    std::vector<vk::DynamicState> dynamicStates = {
+            vk::DynamicState::eViewport,
+            vk::DynamicState::eScissor
+    };
+
+    vk::PipelineDynamicStateCreateInfo pipelineDynamicStateCreateInfo{};
+    pipelineDynamicStateCreateInfo.dynamicStateCount = dynamicStates.size();
+    pipelineDynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+    // К О Н В Е Й Е Р
+
+    // Макет размещения общий с основным конвейером (используются те же наборы дескрипторов камеры и меша)
+    vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
+    graphicsPipelineCreateInfo.stageCount = shaderStages.size();
+    graphicsPipelineCreateInfo.pStages = shaderStages.data();
+    graphicsPipelineCreateInfo.pVertexInputState = &pipelineVertexInputStateCreateInfo;
+    graphicsPipelineCreateInfo.pInputAssemblyState = &pipelineInputAssemblyStateCreateInfo;
+    graphicsPipelineCreateInfo.pViewportState = &pipelineViewportStateCreateInfo;
+    graphicsPipelineCreateInfo.pRasterizationState = &pipelineRasterizationStateCreateInfo;
+    graphicsPipelineCreateInfo.pDepthStencilState = &pipelineDepthStencilStateCreateInfo;
+    graphicsPipelineCreateInfo.pMultisampleState = &pipelineMultisampleStateCreateInfo;
+    graphicsPipelineCreateInfo.pColorBlendState = &pipelineColorBlendStateCreateInfo;
+    graphicsPipelineCreateInfo.pDynamicState = &pipelineDynamicStateCreateInfo;
+    graphicsPipelineCreateInfo.layout = pipelineLayoutPrimary_.get();
+    graphicsPipelineCreateInfo.renderPass = renderPassPrimary_.get();
+    graphicsPipelineCreateInfo.subpass = SUBPASS_DEPTH_PRE_PASS;
+    auto pipeline = device_.getLogicalDevice()->createGraphicsPipeline(pipelineCache_.getVulkanPipelineCache().get(),graphicsPipelineCreateInfo);
+
+    // Вернуть unique smart pointer
+    pipelinesDepthPrePass_[skinned ? 1 : 0] = vk::UniquePipeline(pipeline.value);
+}
+
+/**
+ * Запросить создание варианта основного конвейера
+ * @param variant Ключ варианта (см. getPipelinePrimaryVariant)
+ *
+ * @details Вариант создается потоком пула, повторные запросы игнорируются. Перед использованием варианта следует
+ * дождаться его создания (см. waitForPipeline)
+ */
+void VkRenderer::requestPipelinePrimaryVariant(uint32_t variant)
+{
+    if(pipelinesPrimaryRequested_[variant]) return;
+    pipelinesPrimaryRequested_[variant] = true;
+
+    // Разрешение для статической настройки области вида (фактическая область задается динамически)
+    const vk::Extent2D viewPortExtent = frameBuffersPrimary_[0].getExtent();
+    const auto requestTime = std::chrono::high_resolution_clock::now();
+
+    pipelinesPrimaryReady_[variant] = pipelineThreadPool_->submit([=](){
+        PROFILE_SCOPE("VkRenderer::createPipelinePrimaryVariant");
+        this->createPipelinePrimaryVariant(variant, viewPortExtent);
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - requestTime).count();
+    });
+}
+
+/**
+ * Получить ключ варианта основного конвейера, которым рисуется меш
+ * @param mesh Меш
+ * @return Ключ перестановки шейдеров меша (с флагом PIPELINE_PRIMARY_DEPTH_EQUAL, если меш участвует в пред-проходе глубины)
+ *
+ * @details В пред-проходе глубины участвуют только меши с потоком положений, остальные рисуются с обычным тестом глубины
+ */
+uint32_t VkRenderer::getPipelinePrimaryVariant(const vk::scene::MeshPtr& mesh) const
+{
+    const bool depthEqual = depthPrePassEnabled_ && mesh->getGeometryBuffer()->hasPositionStream();
+    return mesh->getShaderPermutation() | (depthEqual ? PIPELINE_PRIMARY_DEPTH_EQUAL : 0);
+}
+
+/**
+ * Дождаться создания вариантов основного конвейера, используемых мешами сцены
+ *
+ * @details Недостающие варианты запрашиваются (например, если мешу был установлен скелет после добавления на сцену,
+ * или был включен пред-проход глубины). Используемые сценой варианты известны по счетчикам, которые обновляются
+ * при изменениях сцены (см. applySceneChanges), поэтому меши сцены здесь не перебираются. При включенном пред-проходе
+ * также ожидаются его конвейеры
+ */
+void VkRenderer::waitForScenePipelines()
+{
+    for(uint32_t variant = 0; variant < PIPELINE_PRIMARY_VARIANT_COUNT; variant++){
+        if(pipelineVariantUsage_[variant] > 0) this->requestPipelinePrimaryVariant(variant);
+    }
+
+    for(uint32_t variant = 0; variant < PIPELINE_PRIMARY_VARIANT_COUNT; variant++){
+        if(pipelineVariantUsage_[variant] > 0){
+            this->waitForPipeline(pipelinesPrimaryReady_[variant], "Main graphics pipeline (variant " + std::to_string(variant) + ")");
+        }
+    }
+
+    if(depthPrePassEnabled_){
+        this->waitForPipeline(pipelinesDepthPrePassReady_[0], "Depth pre-pass pipeline");
+        this->waitForPipeline(pipelinesDepthPrePassReady_[1], "Depth pre-pass pipeline (skinned)");
+    }
+}
+
+/**
+ * Де-инициализация графического конвейера
+ */
+void VkRenderer::deInitPipelinePrimary() noexcept
+{
+    // Проверяем готовность устройства
+    assert(device_.isReady());
+
+    // Уничтожить варианты конвейера
+    for(auto& pipeline : pipelinesPrimary_){
+        device_.getLogicalDevice()->destroyPipeline(pipeline.get());
+        pipeline.release();
+    }
+    pipelinesPrimary_.clear();
+    pipelinesPrimaryReady_.clear();
+    pipelinesPrimaryRequested_.clear();
+
+    // Уничтожить варианты конвейера пред-прохода глубины
+    for(auto& pipeline : pipelinesDepthPrePass_){
+        device_.getLogicalDevice()->destroyPipeline(pipeline.get());
+        pipeline.release();
+    }
+    pipelinesDepthPrePass_.clear();
+    pipelinesDepthPrePassReady_.clear();
+
+    // Уничтожить шейдерные модули
+    for(auto* shaderModule : {&shaderModulePrimaryVs_, &shaderModulePrimaryFs_, &shaderModuleDepthPrePassVs_}){
+        device_.getLogicalDevice()->destroyShaderModule(shaderModule->get());
+        shaderModule->release();
+    }
+
+    // Уничтожить размещение конвейера
+    device_.getLogicalDevice()->destroyPipelineLayout(pipelineLayoutPrimary_.get());
+    pipelineLayoutPrimary_.release();
+}
+
+/**
+ * Инициализация конвейера пост-обработки
+ * @param vertexShaderCodeBytes
+ * @param fragmentShaderCodeBytes
+ */
+void VkRenderer::initPipelinePostProcess(const std::vector<unsigned char> &vertexShaderCodeBytes,
+                                         const std::vector<unsigned char> &fragmentShaderCodeBytes)
+{
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize pipeline. Device not ready");
+    }
+    // Проверяем готовность основного прохода рендеринга
+    if(!renderPassPostProcess_.get()){
+        throw vk::InitializationFailedError("Can't initialize pipeline. Render pass not ready");
+    }
+
+    // М А К Е Т  Р А З М Е Щ Е Н И Я  К О Н В Е Й Е Р А
+
+    // Массив макетов размещения дескрипторов
+    // ВНИМАНИЕ! Порядок следования наборов в шейдере (индексы дескрипторных наборов) зависит от порядка указания
+    // макетов размещения в данном массиве.
+    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
+            descriptorSetLayoutImagesToPostProcess_.get(),
+    };
+
+    // Создать макет размещения конвейера
+    pipelineLayoutPostProcess_ = device_.getLogicalDevice()->createPipelineLayoutUnique({
+        {},
         static_cast<uint32_t>(descriptorSetLayouts.size()),
         descriptorSetLayouts.data()
     });
@@ -1277,7 +1676,7 @@ void VkRenderer::initPipelinePostProcess(const std::vector<unsigned char> &verte
     graphicsPipelineCreateInfo.layout = pipelineLayoutPostProcess_.get();
     graphicsPipelineCreateInfo.renderPass = renderPassPostProcess_.get();
     graphicsPipelineCreateInfo.subpass = 0;
-    auto pipeline = device_.getLogicalDevice()->createGraphicsPipeline(nullptr,graphicsPipelineCreateInfo);
+    auto pipeline = device_.getLogicalDevice()->createGraphicsPipeline(pipelineCache_.getVulkanPipelineCache().get(),graphicsPipelineCreateInfo);
 
     // Уничтожить шейдерные модули (конвейер создан, они не нужны)
     device_.getLogicalDevice()->destroyShaderModule(shaderModuleVs);
@@ -1306,128 +1705,1666 @@ void VkRenderer::deInitPipelinePostProcess() noexcept
 
 
 /**
- * Освобождение геометрических буферов
+ * Инициализация примитивов синхронизации кадров в полете (семафоры, барьеры)
+ * @param framesInFlight Кол-во кадров в полете
  */
-void VkRenderer::freeGeometryBuffers()
+void VkRenderer::initSyncPrimitives(size_t framesInFlight)
 {
-    // Пройтись по всем буферам и уничтожить выделенные ресурсы
-    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
-    for(const auto& bufferPtrEntry : geometryBuffers_)
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize synchronization primitives. Device not ready");
+    }
+
+    // Барьеры создаются взведенными (кадры еще не отправлялись, ждать нечего)
+    vk::FenceCreateInfo fenceCreateInfo{};
+    fenceCreateInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+
+    for(size_t i = 0; i < framesInFlight; i++)
     {
-        bufferPtrEntry->destroyVulkanResources();
+        semaphoresReadyToRender_.push_back(device_.getLogicalDevice()->createSemaphoreUnique({}));
+        semaphoresReadyToPresent_.push_back(device_.getLogicalDevice()->createSemaphoreUnique({}));
+        frameFences_.push_back(device_.getLogicalDevice()->createFenceUnique(fenceCreateInfo));
+        semaphoresCullingDone_.push_back(device_.getLogicalDevice()->createSemaphoreUnique({}));
     }
 }
 
 /**
- * Освобождение текстурных буферов
- *
- * @details Перед де-инициализацией объекта рендерера, перед уничтожением устройства, будет правильным очистить все
- * текстурные буферы которые когда либо выделялись.
+ * Де-инициализация примитивов синхронизации
  */
-void VkRenderer::freeTextureBuffers()
+void VkRenderer::deInitSyncPrimitives() noexcept
 {
-    // Пройтись по всем буферам и уничтожить выделенные ресурсы
-    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
-    for(const auto& bufferPtrEntry : textureBuffers_)
-    {
-        bufferPtrEntry->destroyVulkanResources();
+    // Семафоры
+    for(auto& semaphore : semaphoresReadyToRender_){
+        device_.getLogicalDevice()->destroySemaphore(semaphore.get());
+        semaphore.release();
+    }
+
+    for(auto& semaphore : semaphoresReadyToPresent_){
+        device_.getLogicalDevice()->destroySemaphore(semaphore.get());
+        semaphore.release();
     }
+
+    for(auto& semaphore : semaphoresCullingDone_){
+        device_.getLogicalDevice()->destroySemaphore(semaphore.get());
+        semaphore.release();
+    }
+
+    // Барьеры
+    for(auto& fence : frameFences_){
+        device_.getLogicalDevice()->destroyFence(fence.get());
+        fence.release();
+    }
+
+    semaphoresReadyToRender_.clear();
+    semaphoresReadyToPresent_.clear();
+    semaphoresCullingDone_.clear();
+    frameFences_.clear();
+    swapChainImageFences_.clear();
 }
 
 /**
- * Очистка ресурсов мешей
+ * Инициализация командных пулов и вторичных командных буферов для параллельной записи
+ * @param framesInFlight Кол-во кадров в полете
+ * @param slotCount Кол-во частей (потоков записи)
  */
-void VkRenderer::freeMeshes()
+void VkRenderer::initSecondaryCommandBuffers(size_t framesInFlight, size_t slotCount)
 {
-    // Пройтись по всем мешам и уничтожить выделенные ресурсы
-    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
-    for(const auto& meshPtrEntry : sceneMeshes_)
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize secondary command buffers. Device not ready");
+    }
+
+    recordingCommandPools_.resize(framesInFlight);
+    secondaryCommandBuffers_.resize(framesInFlight);
+    depthPrePassCommandBuffers_.resize(framesInFlight);
+
+    for(size_t frame = 0; frame < framesInFlight; frame++)
     {
-        meshPtrEntry->destroyVulkanResources();
+        for(size_t slot = 0; slot < slotCount; slot++)
+        {
+            // Пул сбрасывается целиком перед каждой записью, поэтому сброс отдельных буферов не нужен
+            recordingCommandPools_[frame].push_back(device_.createCommandGfxPool(vk::CommandPoolCreateFlagBits::eTransient));
+
+            // Два вторичных буфера из пула (основной проход и пред-проход глубины)
+            auto allocInfo = vk::CommandBufferAllocateInfo(recordingCommandPools_[frame][slot].get(), vk::CommandBufferLevel::eSecondary, 2);
+            auto commandBuffers = device_.getLogicalDevice()->allocateCommandBuffers(allocInfo);
+            secondaryCommandBuffers_[frame].push_back(commandBuffers[0]);
+            depthPrePassCommandBuffers_[frame].push_back(commandBuffers[1]);
+        }
     }
 }
 
-/** C O N S T R U C T O R - D E S T R U C T O R **/
-
 /**
- * Конструктор
- * @param hInstance Экземпляр WinApi приложения
- * @param hWnd Дескриптор окна WinApi
- * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
- * @param geometryShaderCodeBytes Код геометрического шейдера (байты)
- * @param fragmentShaderCodeBytes Rод фрагментного шейдера (байты)
- * @param maxMeshes Максимальное кол-во мешей
+ * Де-инициализация командных пулов и вторичных командных буферов
  */
-VkRenderer::VkRenderer(HINSTANCE hInstance,
-        HWND hWnd,
-        const std::vector<unsigned char>& vertexShaderCodeBytes,
-        const std::vector<unsigned char>& geometryShaderCodeBytes,
-        const std::vector<unsigned char>& fragmentShaderCodeBytes,
-        const std::vector<unsigned char>& vertexShaderCodeBytesPp,
-        const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
-        size_t maxMeshes):
-isEnabled_(true),
-isCommandsReady_(false),
-inputDataInOpenGlStyle_(true),
-useValidation_(true)
+void VkRenderer::deInitSecondaryCommandBuffers() noexcept
 {
-    // Инициализация экземпляра Vulkan
-    std::vector<const char*> instanceExtensionNames = {
-            VK_KHR_SURFACE_EXTENSION_NAME,
-            VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-    };
-    std::vector<const char*> instanceValidationLayerNames = {};
-
-    if(useValidation_){
-        instanceExtensionNames.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
-        instanceValidationLayerNames.push_back("VK_LAYER_KHRONOS_validation");
+    // Уничтожение пула освобождает и выделенные из него буферы
+    for(auto& framePools : recordingCommandPools_){
+        for(auto& pool : framePools){
+            device_.getLogicalDevice()->destroyCommandPool(pool.get());
+            pool.release();
+        }
     }
 
-    this->vulkanInstance_ = vk::tools::CreateVulkanInstance("My Application",
-            "My engine",
-            1,1,
-            instanceExtensionNames,
-            instanceValidationLayerNames);
-    std::cout << "Vulkan instance created." << std::endl;
-
-    // Загрузка функций расширений (получение адресов)
-    vkExtInitInstance(static_cast<VkInstance>(vulkanInstance_.get()));
+    recordingCommandPools_.clear();
+    secondaryCommandBuffers_.clear();
+    depthPrePassCommandBuffers_.clear();
+}
 
-    // Создание debug report callback'а (создается только в том случае, если расширение VK_EXT_DEBUG_REPORT_EXTENSION_NAME использовано)
-    if(useValidation_){
-        debugReportCallbackExt_ = vulkanInstance_->createDebugReportCallbackEXTUnique(vk::DebugReportCallbackCreateInfoEXT({vk::DebugReportFlagBitsEXT::eError|vk::DebugReportFlagBitsEXT::eWarning},vk::tools::DebugVulkanCallback));
-        std::cout << "Report callback object created." << std::endl;
+/**
+ * Инициализация отсечения на GPU (вычислительный конвейер, буферы объектов и аргументов рисования)
+ * @param computeShaderCodeBytes Код вычислительного шейдера отсечения
+ * @param maxMeshes Максимальное кол-во мешей (размер буферов)
+ * @param framesInFlight Кол-во кадров в полете
+ */
+void VkRenderer::initGpuCulling(const std::vector<unsigned char>& computeShaderCodeBytes, size_t maxMeshes, size_t framesInFlight)
+{
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize GPU culling. Device not ready");
     }
 
-    // Создание поверхности отображения на окне
-    this->surface_ = vulkanInstance_->createWin32SurfaceKHRUnique(vk::Win32SurfaceCreateInfoKHR({},hInstance,hWnd));
-    std::cout << "Surface created." << std::endl;
+    // Шейдер отсечения собирается вместе с остальными шейдерами, поэтому его отсутствие - ошибка сборки или установки
+    if(computeShaderCodeBytes.empty()){
+        throw vk::InitializationFailedError("Can't initialize GPU culling. No compute shader code provided");
+    }
 
-    // Создание устройства
-    std::vector<const char*> deviceExtensionNames = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-            VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME
-    };
+    // Шейдер пишет аргументы рисования с ненулевым первым экземпляром - без этой возможности отсечение на GPU недоступно
+    const vk::PhysicalDeviceFeatures features = device_.getPhysicalDevice().getFeatures();
+    if(!features.drawIndirectFirstInstance){
+        std::cout << "GPU culling unavailable (drawIndirectFirstInstance not supported), meshes are culled on CPU." << std::endl;
+        return;
+    }
 
-    std::vector<const char*> deviceValidationLayerNames = {};
+    // Без нескольких вызовов за команду непрямого рисования аргументы пакета рисуются по одному
+    gpuCullingMaxDrawCount_ = features.multiDrawIndirect ? device_.getPhysicalDevice().getProperties().limits.maxDrawIndirectCount : 1;
+    if(!features.multiDrawIndirect){
+        std::cout << "GPU culling: multiDrawIndirect not supported, indirect batches are drawn one argument per call." << std::endl;
+    }
 
-    if(useValidation_){
-        deviceValidationLayerNames.push_back("VK_LAYER_KHRONOS_validation");
+    // Сжатие аргументов - если кол-во вызовов можно брать из буфера, а в один вызов помещаются аргументы всех мешей
+    gpuCullingCompact_ = device_.isDrawIndirectCountSupported() && gpuCullingMaxDrawCount_ >= maxMeshes;
+    if(!gpuCullingCompact_){
+        std::cout << "GPU culling: draw arguments are not compacted ("
+                  << (device_.isDrawIndirectCountSupported() ? "maxDrawIndirectCount too small" : "VK_KHR_draw_indirect_count not supported")
+                  << "), culled meshes are drawn with zero instances." << std::endl;
     }
 
-    device_ = vk::tools::Device(vulkanInstance_,surface_,deviceExtensionNames,deviceValidationLayerNames, false);
-    std::cout << "Device initialized (" << device_.getPhysicalDevice().getProperties().deviceName << ")" << std::endl;
+    // Д Е С К Р И П Т О Р Ы
 
-    // Инициализация прохода/проходов рендеринга
-    this->initRenderPassPrimary(vk::Format::eR16G16B16A16Sfloat, vk::Format::eD32SfloatS8Uint);
-    this->initRenderPassPostProcess(vk::Format::eB8G8R8A8Unorm);
-    std::cout << "Render passes initialized." << std::endl;
+    // Макет размещения: буфер объектов (заголовок с плоскостями и массив объектов по слотам мешей), буфер аргументов
+    // рисования, буфер счетчиков пакетов и буфер объектов пакетов
+    {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+                {0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+                {1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+                {2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+                {3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr},
+        };
 
-    // Инициализация цепочки показа (swap-chain)
-    this->initSwapChain({vk::Format::eB8G8R8A8Unorm,vk::ColorSpaceKHR::eSrgbNonlinear});
-    std::cout << "Swap-chain created." << std::endl;
+        vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+        descriptorSetLayoutCreateInfo.bindingCount = bindings.size();
+        descriptorSetLayoutCreateInfo.pBindings = bindings.data();
+        descriptorSetLayoutGpuCulling_ = device_.getLogicalDevice()->createDescriptorSetLayoutUnique(descriptorSetLayoutCreateInfo);
+    }
 
-    // Создание основных кадровых буферов
+    // Пул (один набор на каждый кадр в полете)
+    {
+        std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
+                {vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(framesInFlight * 4)},
+        };
+
+        vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+        descriptorPoolCreateInfo.poolSizeCount = descriptorPoolSizes.size();
+        descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
+        descriptorPoolCreateInfo.maxSets = static_cast<uint32_t>(framesInFlight);
+        descriptorPoolGpuCulling_ = device_.getLogicalDevice()->createDescriptorPoolUnique(descriptorPoolCreateInfo);
+    }
+
+    // К О Н В Е Й Е Р
+
+    pipelineLayoutGpuCulling_ = device_.getLogicalDevice()->createPipelineLayoutUnique({
+        {},
+        1,
+        &(descriptorSetLayoutGpuCulling_.get())
+    });
+
+    vk::ShaderModule shaderModuleCs = device_.getLogicalDevice()->createShaderModule({
+            {},
+            computeShaderCodeBytes.size(),
+            reinterpret_cast<const uint32_t*>(computeShaderCodeBytes.data())});
+
+    vk::ComputePipelineCreateInfo computePipelineCreateInfo{};
+    computePipelineCreateInfo.stage = vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModuleCs, "main");
+    computePipelineCreateInfo.layout = pipelineLayoutGpuCulling_.get();
+    auto pipeline = device_.getLogicalDevice()->createComputePipeline(pipelineCache_.getVulkanPipelineCache().get(), computePipelineCreateInfo);
+    pipelineGpuCulling_ = vk::UniquePipeline(pipeline.value);
+
+    // Шейдерный модуль после создания конвейера не нужен
+    device_.getLogicalDevice()->destroyShaderModule(shaderModuleCs);
+
+    // Б У Ф Е Р Ы  И  Н А Б О Р Ы
+
+    // Аргументы рисования пишет очередь вычислений, а читает графическая (без передачи владения, если семейства различаются)
+    std::vector<uint32_t> drawBufferQueueFamilies = {device_.getQueueFamilyGraphicsIndex()};
+    if(!device_.isComputeAndGfxQueueFamilySame()){
+        drawBufferQueueFamilies.push_back(device_.getQueueFamilyComputeIndex());
+    }
+
+    const vk::DeviceSize objectBufferSize = sizeof(vk::tools::GpuCullingHeader) + sizeof(vk::tools::GpuCullingObject) * maxMeshes;
+    const vk::DeviceSize drawBufferSize = sizeof(vk::DrawIndexedIndirectCommand) * maxMeshes;
+    const vk::DeviceSize countBufferSize = sizeof(uint32_t) * maxMeshes;
+    const vk::DeviceSize batchObjectBufferSize = sizeof(vk::tools::GpuCullingBatchObject) * maxMeshes;
+
+    std::vector<vk::DescriptorSetLayout> layouts(framesInFlight, descriptorSetLayoutGpuCulling_.get());
+    gpuCullingDescriptorSets_ = device_.getLogicalDevice()->allocateDescriptorSets({descriptorPoolGpuCulling_.get(), static_cast<uint32_t>(layouts.size()), layouts.data()});
+
+    for(size_t frame = 0; frame < framesInFlight; frame++)
+    {
+        // Буферы объектов и объектов пакетов обновляются CPU (только изменившиеся данные), поэтому размечаются один раз
+        // на все время жизни
+        gpuCullingObjectBuffers_.emplace_back(vk::tools::Buffer(&device_,
+                objectBufferSize,
+                vk::BufferUsageFlagBits::eStorageBuffer,
+                vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
+        gpuCullingObjectsMapped_.push_back(reinterpret_cast<unsigned char*>(gpuCullingObjectBuffers_.back().mapMemory()));
+        memset(gpuCullingObjectsMapped_.back(), 0, static_cast<size_t>(objectBufferSize));
+
+        gpuCullingBatchObjectBuffers_.emplace_back(vk::tools::Buffer(&device_,
+                batchObjectBufferSize,
+                vk::BufferUsageFlagBits::eStorageBuffer,
+                vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
+        gpuCullingBatchObjectsMapped_.push_back(reinterpret_cast<vk::tools::GpuCullingBatchObject*>(gpuCullingBatchObjectBuffers_.back().mapMemory()));
+
+        gpuCullingDrawBuffers_.emplace_back(vk::tools::Buffer(&device_,
+                drawBufferSize,
+                vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                nullptr,
+                drawBufferQueueFamilies));
+
+        // Счетчики пакетов обнуляются очередью вычислений перед отсечением, а читаются как кол-во вызовов рисования
+        gpuCullingCountBuffers_.emplace_back(vk::tools::Buffer(&device_,
+                countBufferSize,
+                vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer|vk::BufferUsageFlagBits::eTransferDst,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                nullptr,
+                drawBufferQueueFamilies));
+
+        // Связать набор кадра с буферами
+        vk::DescriptorBufferInfo bufferInfos[4] = {
+                {gpuCullingObjectBuffers_.back().getBuffer().get(), 0, VK_WHOLE_SIZE},
+                {gpuCullingDrawBuffers_.back().getBuffer().get(), 0, VK_WHOLE_SIZE},
+                {gpuCullingCountBuffers_.back().getBuffer().get(), 0, VK_WHOLE_SIZE},
+                {gpuCullingBatchObjectBuffers_.back().getBuffer().get(), 0, VK_WHOLE_SIZE}
+        };
+        std::vector<vk::WriteDescriptorSet> writes = {
+                {gpuCullingDescriptorSets_[frame], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[0], nullptr},
+                {gpuCullingDescriptorSets_[frame], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[1], nullptr},
+                {gpuCullingDescriptorSets_[frame], 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[2], nullptr},
+                {gpuCullingDescriptorSets_[frame], 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[3], nullptr}
+        };
+        device_.getLogicalDevice()->updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+    }
+
+    // Командные буферы очереди вычислений (перезаписываются каждый кадр)
+    auto allocInfo = vk::CommandBufferAllocateInfo(device_.getCommandComputePool().get(), vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(framesInFlight));
+    gpuCullingCommandBuffers_ = device_.getLogicalDevice()->allocateCommandBuffers(allocInfo);
+    gpuCullingSubmittedObjects_.assign(framesInFlight, 0);
+
+    // Буферы кадров заполняются целиком при первом использовании, пакеты строятся при первой подготовке кадра
+    gpuCullingDirtySlots_.assign(framesInFlight, {});
+    gpuCullingFrameStale_.assign(framesInFlight, true);
+    gpuCullingBatchObjectsStale_.assign(framesInFlight, true);
+    gpuCullingBatchesDirty_ = true;
+}
+
+/**
+ * Де-инициализация отсечения на GPU
+ */
+void VkRenderer::deInitGpuCulling() noexcept
+{
+    // Проверяем готовность устройства
+    assert(device_.isReady());
+
+    // Командные буферы
+    if(!gpuCullingCommandBuffers_.empty()){
+        device_.getLogicalDevice()->freeCommandBuffers(device_.getCommandComputePool().get(), gpuCullingCommandBuffers_);
+        gpuCullingCommandBuffers_.clear();
+    }
+    gpuCullingSubmittedObjects_.clear();
+    gpuCullingDirtySlots_.clear();
+    gpuCullingFrameStale_.clear();
+    gpuCullingBatchObjectsStale_.clear();
+    gpuCullingBatchObjects_.clear();
+    gpuCullingBatches_.clear();
+
+    // Буферы (наборы дескрипторов освобождаются вместе с пулом)
+    for(auto& buffer : gpuCullingObjectBuffers_){
+        buffer.unmapMemory();
+        buffer.destroyVulkanResources();
+    }
+    gpuCullingObjectBuffers_.clear();
+    gpuCullingObjectsMapped_.clear();
+    for(auto& buffer : gpuCullingBatchObjectBuffers_){
+        buffer.unmapMemory();
+        buffer.destroyVulkanResources();
+    }
+    gpuCullingBatchObjectBuffers_.clear();
+    gpuCullingBatchObjectsMapped_.clear();
+    gpuCullingDrawBuffers_.clear();
+    gpuCullingCountBuffers_.clear();
+    gpuCullingDescriptorSets_.clear();
+
+    // Конвейер и макеты
+    device_.getLogicalDevice()->destroyPipeline(pipelineGpuCulling_.get());
+    pipelineGpuCulling_.release();
+    device_.getLogicalDevice()->destroyPipelineLayout(pipelineLayoutGpuCulling_.get());
+    pipelineLayoutGpuCulling_.release();
+    device_.getLogicalDevice()->destroyDescriptorSetLayout(descriptorSetLayoutGpuCulling_.get());
+    descriptorSetLayoutGpuCulling_.release();
+    device_.getLogicalDevice()->destroyDescriptorPool(descriptorPoolGpuCulling_.get());
+    descriptorPoolGpuCulling_.release();
+}
+
+/**
+ * Инициализация буферов потока экземпляров
+ * @param maxMeshes Максимальное кол-во мешей (экземпляров в кадре)
+ * @param framesInFlight Кол-во кадров в полете
+ */
+void VkRenderer::initInstanceBuffers(size_t maxMeshes, size_t framesInFlight)
+{
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize instance buffers. Device not ready");
+    }
+
+    // Данные экземпляров пишутся CPU каждый кадр, поэтому память размечается один раз на все время жизни
+    for(size_t frame = 0; frame < framesInFlight; frame++)
+    {
+        instanceBuffers_.emplace_back(vk::tools::Buffer(&device_,
+                sizeof(vk::tools::InstanceData) * maxMeshes,
+                vk::BufferUsageFlagBits::eVertexBuffer,
+                vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
+        instanceDataMapped_.push_back(reinterpret_cast<vk::tools::InstanceData*>(instanceBuffers_.back().mapMemory()));
+    }
+}
+
+/**
+ * Де-инициализация буферов потока экземпляров
+ */
+void VkRenderer::deInitInstanceBuffers() noexcept
+{
+    for(auto& buffer : instanceBuffers_){
+        buffer.unmapMemory();
+        buffer.destroyVulkanResources();
+    }
+    instanceBuffers_.clear();
+    instanceDataMapped_.clear();
+}
+
+/**
+ * Инициализация кольцевого UBO буфера данных объектов и его набора дескрипторов
+ * @param frameCapacity Размер участка одного кадра в байтах
+ * @param framesInFlight Кол-во кадров в полете
+ */
+void VkRenderer::initObjectUniforms(vk::DeviceSize frameCapacity, size_t framesInFlight)
+{
+    // Проверяем готовность устройства
+    if(!device_.isReady()){
+        throw vk::InitializationFailedError("Can't initialize object uniforms. Device not ready");
+    }
+
+    // Участки всех кадров в одном буфере, поэтому набор (и дескриптор) один - кадр и объект задаются смещением
+    objectUniformRing_ = vk::tools::UniformRing(&device_, frameCapacity, vk::scene::MESH_UNIFORM_SIZE, framesInFlight);
+
+    if(!objectUniformSet_){
+        vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+        descriptorSetAllocateInfo.descriptorPool = descriptorPoolObjects_.get();
+        descriptorSetAllocateInfo.pSetLayouts = &(descriptorSetLayoutObjects_.get());
+        descriptorSetAllocateInfo.descriptorSetCount = 1;
+        objectUniformSet_ = device_.getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo)[0];
+    }
+
+    // Диапазон дескриптора - полный блок данных меша (с матрицами костей)
+    const vk::DescriptorBufferInfo bufferInfo = objectUniformRing_.getDescriptorBufferInfo(vk::scene::MESH_UNIFORM_SIZE);
+    const vk::WriteDescriptorSet write(objectUniformSet_, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &bufferInfo, nullptr);
+    device_.getLogicalDevice()->updateDescriptorSets(1, &write, 0, nullptr);
+}
+
+/**
+ * Де-инициализация кольцевого UBO буфера данных объектов
+ */
+void VkRenderer::deInitObjectUniforms() noexcept
+{
+    // Набор дескрипторов освобождается вместе с пулом
+    objectUniformSet_ = nullptr;
+    objectUniformRing_.destroyVulkanResources();
+}
+
+/**
+ * Запись части мешей сцены во вторичный командный буфер основного прохода
+ * @param commandBuffer Вторичный командный буфер
+ * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+ * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+ * @param groupFrom Индекс первой группы экземпляров части
+ * @param groupTo Индекс группы, следующей за последней группой части
+ * @param viewport Область вида
+ * @param scissors Параметры ножниц
+ */
+void VkRenderer::recordMeshesSecondary(const vk::CommandBuffer& commandBuffer,
+        uint32_t imageIndex,
+        size_t frameIndex,
+        size_t groupFrom,
+        size_t groupTo,
+        const vk::Viewport& viewport,
+        const vk::Rect2D& scissors)
+{
+    PROFILE_SCOPE("VkRenderer::recordMeshesSecondary");
+
+    // Вторичный буфер выполняется внутри основного прохода (проход и кадровый буфер наследуются)
+    vk::CommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.renderPass = renderPassPrimary_.get();
+    inheritanceInfo.subpass = SUBPASS_PRIMARY;
+    inheritanceInfo.framebuffer = frameBuffersPrimary_[imageIndex].getVulkanFrameBuffer().get();
+    inheritanceInfo.pipelineStatistics = gpuProfiler_.getInheritedPipelineStatistics();
+
+    vk::CommandBufferBeginInfo commandBufferBeginInfo{};
+    commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+    commandBuffer.begin(commandBufferBeginInfo);
+
+    // Пустая часть (видимых мешей нет) - конвейер не привязывается, поскольку он мог быть еще не создан
+    if(groupFrom == groupTo){
+        commandBuffer.end();
+        return;
+    }
+
+    // Состояние не наследуется между командными буферами, поэтому каждый вторичный буфер задает его сам
+
+    // Установка view-port'а и ножниц
+    commandBuffer.setViewport(0,1,&viewport);
+    commandBuffer.setScissor(0,1,&scissors);
+
+    // Привязанное состояние (варианты конвейера совместимы по макету размещения, поэтому наборы дескрипторов
+    // сохраняются при смене конвейера, а буферы геометрии общие для всех мешей блока пула геометрии)
+    vk::tools::CommandStateTracker state;
+
+    // Поток экземпляров кадра (общий для всех групп)
+    const vk::Buffer instanceBuffer = instanceBuffers_[frameIndex].getBuffer().get();
+    state.bindVertexBuffers(commandBuffer, INSTANCE_STREAM_BINDING, 1, &instanceBuffer);
+
+    // Привязать наборы дескрипторов камеры (матрицы вида и проекции) и источников света текущего кадра
+    state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), 0, camera_.getDescriptorSet(frameIndex));
+    state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), 1, lightSourceSet_.getDescriptorSet(frameIndex));
+
+    // Привязать глобальную таблицу текстур (текстура выбирается шейдером по индексу из потока экземпляров)
+    state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), 2, device_.getTextureTable()->getDescriptorSet());
+
+    for(size_t i = groupFrom; i < groupTo; i++)
+    {
+        const VkRendererDrawGroup& group = drawGroups_[i];
+        const auto& meshPtr = sceneMeshes_[group.mesh];
+
+        if(meshPtr->isReady() && meshPtr->getGeometryBuffer()->isReady())
+        {
+            // Привязать вариант конвейера, соответствующий мешу
+            state.bindPipeline(commandBuffer, pipelinesPrimary_[this->getPipelinePrimaryVariant(meshPtr)].get());
+
+            // Привязать блок данных группы (параметры отображения текстур, скелет)
+            state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), OBJECT_UNIFORM_SET, objectUniformSet_, group.uniformOffset);
+
+            // Буферы вершин (основной поток, скелет, цвет) и индексов блока пула геометрии
+            const auto& geometry = meshPtr->getGeometryBuffer();
+            const vk::Buffer vertexBuffers[3] = {
+                    geometry->getVertexBuffer().getBuffer().get(),
+                    geometry->getSkinBuffer().getBuffer().get(),
+                    geometry->getColorBuffer().getBuffer().get()
+            };
+            state.bindVertexBuffers(commandBuffer, 0, 3, vertexBuffers);
+
+            if(geometry->isIndexed()){
+                state.bindIndexBuffer(commandBuffer, geometry->getIndexBuffer().getBuffer().get(), geometry->getIndexType());
+            }
+
+            // Временная метка начала отрисовки (если профилируются отдельные вызовы)
+            gpuProfiler_.writeDrawTimestamp(commandBuffer, frameIndex, i, false);
+
+            // Участок геометрии в буферах блока задается первым индексом и смещением вершин, экземпляры группы -
+            // первым экземпляром в потоке экземпляров (при отсечении на GPU пакет рисуется по аргументам, записанным
+            // вычислительным шейдером)
+            if(gpuCullingActive_) {
+                this->recordIndirectBatch(commandBuffer, frameIndex, group, geometry->isIndexed());
+            } else if(geometry->isIndexed()) {
+                commandBuffer.drawIndexed(geometry->getLodIndexCount(meshPtr->getLod()),group.instanceCount,geometry->getLodFirstIndex(meshPtr->getLod()),static_cast<int32_t>(geometry->getFirstVertex()),group.firstInstance);
+            } else {
+                commandBuffer.draw(geometry->getVertexCount(),group.instanceCount,geometry->getFirstVertex(),group.firstInstance);
+            }
+
+            // Временная метка конца отрисовки
+            gpuProfiler_.writeDrawTimestamp(commandBuffer, frameIndex, i, true);
+        }
+    }
+
+    commandBuffer.end();
+
+    statStateBinds_ += state.getBindCount();
+    statStateBindsSkipped_ += state.getSkippedCount();
+}
+
+/**
+ * Запись части мешей сцены во вторичный командный буфер пред-прохода глубины
+ * @param commandBuffer Вторичный командный буфер
+ * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+ * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+ * @param groupFrom Индекс первой группы экземпляров части
+ * @param groupTo Индекс группы, следующей за последней группой части
+ * @param viewport Область вида
+ * @param scissors Параметры ножниц
+ *
+ * @details Блоки данных групп в кольцевом буфере кадра записываются заранее, при построении списка отрисовки
+ */
+void VkRenderer::recordMeshesDepthPrePassSecondary(const vk::CommandBuffer& commandBuffer,
+        uint32_t imageIndex,
+        size_t frameIndex,
+        size_t groupFrom,
+        size_t groupTo,
+        const vk::Viewport& viewport,
+        const vk::Rect2D& scissors)
+{
+    PROFILE_SCOPE("VkRenderer::recordMeshesDepthPrePassSecondary");
+
+    // Вторичный буфер выполняется в под-проходе пред-прохода глубины
+    vk::CommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.renderPass = renderPassPrimary_.get();
+    inheritanceInfo.subpass = SUBPASS_DEPTH_PRE_PASS;
+    inheritanceInfo.framebuffer = frameBuffersPrimary_[imageIndex].getVulkanFrameBuffer().get();
+    inheritanceInfo.pipelineStatistics = gpuProfiler_.getInheritedPipelineStatistics();
+
+    vk::CommandBufferBeginInfo commandBufferBeginInfo{};
+    commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+    commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+    commandBuffer.begin(commandBufferBeginInfo);
+
+    if(groupFrom == groupTo){
+        commandBuffer.end();
+        return;
+    }
+
+    // Установка view-port'а и ножниц
+    commandBuffer.setViewport(0,1,&viewport);
+    commandBuffer.setScissor(0,1,&scissors);
+
+    // Привязанное состояние
+    vk::tools::CommandStateTracker state;
+
+    // Поток экземпляров кадра (общий для всех групп)
+    const vk::Buffer instanceBuffer = instanceBuffers_[frameIndex].getBuffer().get();
+    state.bindVertexBuffers(commandBuffer, INSTANCE_STREAM_BINDING, 1, &instanceBuffer);
+
+    // Привязать набор дескрипторов камеры (источники света в пред-проходе не нужны)
+    state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), 0, camera_.getDescriptorSet(frameIndex));
+
+    for(size_t i = groupFrom; i < groupTo; i++)
+    {
+        const VkRendererDrawGroup& group = drawGroups_[i];
+        const auto& meshPtr = sceneMeshes_[group.mesh];
+        if(!meshPtr->isReady() || !meshPtr->getGeometryBuffer()->isReady()) continue;
+
+        // Меши без потока положений рисуются только в основном под-проходе
+        const auto& geometry = meshPtr->getGeometryBuffer();
+        if(!geometry->hasPositionStream()) continue;
+
+        // Вариант конвейера (со скелетом или без)
+        const bool skinned = (meshPtr->getShaderPermutation() & vk::scene::SHADER_PERMUTATION_SKINNED) != 0;
+        state.bindPipeline(commandBuffer, pipelinesDepthPrePass_[skinned ? 1 : 0].get());
+
+        // Блок данных группы (матрицы костей)
+        state.bindDescriptorSet(commandBuffer, pipelineLayoutPrimary_.get(), OBJECT_UNIFORM_SET, objectUniformSet_, group.uniformOffset);
+
+        // Буферы вершин (положения, скелет) и индексов блока пула геометрии
+        const vk::Buffer vertexBuffers[2] = {geometry->getPositionBuffer().getBuffer().get(), geometry->getSkinBuffer().getBuffer().get()};
+        state.bindVertexBuffers(commandBuffer, 0, 2, vertexBuffers);
+
+        if(geometry->isIndexed()){
+            state.bindIndexBuffer(commandBuffer, geometry->getIndexBuffer().getBuffer().get(), geometry->getIndexType());
+        }
+
+        if(gpuCullingActive_) {
+            this->recordIndirectBatch(commandBuffer, frameIndex, group, geometry->isIndexed());
+        } else if(geometry->isIndexed()) {
+            commandBuffer.drawIndexed(geometry->getLodIndexCount(meshPtr->getLod()),group.instanceCount,geometry->getLodFirstIndex(meshPtr->getLod()),static_cast<int32_t>(geometry->getFirstVertex()),group.firstInstance);
+        } else {
+            commandBuffer.draw(geometry->getVertexCount(),group.instanceCount,geometry->getFirstVertex(),group.firstInstance);
+        }
+    }
+
+    commandBuffer.end();
+
+    statStateBinds_ += state.getBindCount();
+    statStateBindsSkipped_ += state.getSkippedCount();
+}
+
+/**
+ * Записать непрямое рисование пакета (аргументы записаны шейдером отсечения на GPU)
+ * @param commandBuffer Командный буфер
+ * @param frameIndex Индекс кадра в полете
+ * @param group Пакет непрямого рисования
+ * @param indexed Индексированная ли геометрия пакета
+ *
+ * @details Со сжатием рисуются только видимые меши пакета (кол-во берется из счетчика пакета), без сжатия - все меши
+ * пакета (у отсеченных кол-во экземпляров 0), не более gpuCullingMaxDrawCount_ аргументов за вызов
+ */
+void VkRenderer::recordIndirectBatch(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const VkRendererDrawGroup& group, bool indexed) const
+{
+    const vk::Buffer drawBuffer = gpuCullingDrawBuffers_[frameIndex].getBuffer().get();
+    const vk::DeviceSize drawOffset = sizeof(vk::DrawIndexedIndirectCommand) * group.firstInstance;
+    const uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+    if(gpuCullingCompact_)
+    {
+        const vk::Buffer countBuffer = gpuCullingCountBuffers_[frameIndex].getBuffer().get();
+        const vk::DeviceSize countOffset = sizeof(uint32_t) * group.firstInstance;
+        if(indexed) commandBuffer.drawIndexedIndirectCountKHR(drawBuffer,drawOffset,countBuffer,countOffset,group.instanceCount,stride);
+        else commandBuffer.drawIndirectCountKHR(drawBuffer,drawOffset,countBuffer,countOffset,group.instanceCount,stride);
+        return;
+    }
+
+    for(uint32_t first = 0; first < group.instanceCount; first += gpuCullingMaxDrawCount_)
+    {
+        const uint32_t drawCount = (std::min)(group.instanceCount - first, gpuCullingMaxDrawCount_);
+        if(indexed) commandBuffer.drawIndexedIndirect(drawBuffer,drawOffset + stride * first,drawCount,stride);
+        else commandBuffer.drawIndirect(drawBuffer,drawOffset + stride * first,drawCount,stride);
+    }
+}
+
+/**
+ * Параллельная запись вторичных командных буферов основного прохода
+ * @param imageIndex Индекс изображения swap-chain
+ * @param frameIndex Индекс кадра в полете
+ * @param viewport Область вида
+ * @param scissors Параметры ножниц
+ * @return Кол-во записанных вторичных буферов (первые N буферов кадра)
+ *
+ * @details Список мешей делится на части, каждая часть записывается в свой вторичный буфер из своего командного пула.
+ * Первая часть записывается вызывающим потоком, остальные - потоками пула. При включенном пред-проходе глубины
+ * каждая часть также записывает буфер пред-прохода (из того же пула)
+ */
+size_t VkRenderer::recordPrimaryPassSecondaryBuffers(uint32_t imageIndex, size_t frameIndex, const vk::Viewport& viewport, const vk::Rect2D& scissors)
+{
+    PROFILE_SCOPE("VkRenderer::recordPrimaryPassSecondaryBuffers");
+
+    // Кол-во частей (не больше кол-ва потоков, при этом в каждой части не меньше MIN_MESHES_PER_RECORDING_CHUNK групп)
+    const size_t meshCount = drawGroups_.size();
+    size_t chunkCount = (meshCount + MIN_MESHES_PER_RECORDING_CHUNK - 1) / MIN_MESHES_PER_RECORDING_CHUNK;
+    chunkCount = std::max<size_t>(1, std::min<size_t>(chunkCount, recordingSlotCount_));
+    const size_t chunkSize = (meshCount + chunkCount - 1) / chunkCount;
+
+    // Запись одной части (сброс пула части и запись буфера)
+    auto recordChunk = [=](size_t chunk)
+    {
+        device_.getLogicalDevice()->resetCommandPool(recordingCommandPools_[frameIndex][chunk].get(), {});
+        this->recordMeshesSecondary(
+                secondaryCommandBuffers_[frameIndex][chunk],
+                imageIndex,
+                frameIndex,
+                std::min<size_t>(chunk * chunkSize, meshCount),
+                std::min<size_t>((chunk + 1) * chunkSize, meshCount),
+                viewport,
+                scissors);
+
+        if(depthPrePassEnabled_){
+            this->recordMeshesDepthPrePassSecondary(
+                    depthPrePassCommandBuffers_[frameIndex][chunk],
+                    imageIndex,
+                    frameIndex,
+                    std::min<size_t>(chunk * chunkSize, meshCount),
+                    std::min<size_t>((chunk + 1) * chunkSize, meshCount),
+                    viewport,
+                    scissors);
+        }
+    };
+
+    // Части кроме первой отдаются потокам пула, первая часть записывается текущим потоком
+    std::vector<std::future<void>> futures;
+    try{
+        for(size_t chunk = 1; chunk < chunkCount; chunk++){
+            futures.push_back(recordingThreadPool_->submit([=](){ recordChunk(chunk); }));
+        }
+
+        recordChunk(0);
+    }
+    catch(...){
+        // Потоки пула пишут в командные пулы и буферы кадра, которые после выхода могут быть сброшены или уничтожены
+        for(auto& future : futures) future.wait();
+        throw;
+    }
+
+    // Дождаться всех потоков, и только затем получить результат (get() пробросит исключение потока)
+    {
+        PROFILE_SCOPE("VkRenderer::recordPrimaryPassSecondaryBuffers/wait");
+        for(auto& future : futures) future.wait();
+    }
+    for(auto& future : futures) future.get();
+
+    return chunkCount;
+}
+
+/**
+ * Отсечь меши сцены по пирамиде видимости камеры и выбрать их уровни детализации (заполняет visibleMeshes_)
+ * @param viewPortExtent Разрешение области вида (для оценки размера мешей на экране)
+ *
+ * @details Ограничивающие объемы мешей собираются в структуру массивов отсекателя и проверяются по 4 за раз (SSE).
+ * Порядок мешей сохраняется, поэтому привязки конвейеров и буферов при записи не меняются
+ */
+void VkRenderer::cullSceneMeshes(const vk::Extent2D& viewPortExtent)
+{
+    PROFILE_SCOPE("VkRenderer::cullSceneMeshes");
+
+    const size_t meshCount = sceneMeshes_.size();
+
+    // Масштаб проекции - размер в пикселях (по вертикали) объекта единичного размера на единичном расстоянии
+    const float projectionScale = std::fabs(camera_.getProjectionMatrix()[1][1]) * 0.5f * static_cast<float>(viewPortExtent.height);
+
+    // Отсечение на GPU возможно, если есть конвейер (меши объединены в пакеты непрямого рисования, статистику
+    // учитывает prepareGpuCulling, когда результат станет известен)
+    gpuCullingActive_ = gpuCullingEnabled_ && pipelineGpuCulling_ && meshCount > 0;
+    if(gpuCullingActive_){
+        this->prepareGpuCulling(currentFrame_, projectionScale);
+        return;
+    }
+
+    // Поток экземпляров кадра заполняется группами экземпляров - при возврате к отсечению на GPU слоты кадра
+    // записываются заново
+    if(pipelineGpuCulling_){
+        gpuCullingFrameStale_[currentFrame_] = true;
+        gpuCullingDirtySlots_[currentFrame_].clear();
+    }
+
+    // Без отсечения записываются все меши
+    if(!frustumCullingEnabled_)
+    {
+        visibleMeshes_.resize(meshCount);
+        for(size_t i = 0; i < meshCount; i++) visibleMeshes_[i] = static_cast<uint32_t>(i);
+    }
+    else
+    {
+        frustumCuller_.clear();
+        frustumCuller_.reserve(meshCount);
+        for(const auto& meshPtr : sceneMeshes_)
+        {
+            // Скелетная анимация может вывести вершины за пределы объемов позы по умолчанию
+            if((meshPtr->getShaderPermutation() & vk::scene::SHADER_PERMUTATION_SKINNED) != 0){
+                frustumCuller_.addAlwaysVisible();
+                continue;
+            }
+
+            const auto& bounds = meshPtr->getWorldBounds();
+            frustumCuller_.add(bounds.center, bounds.extent, bounds.radius);
+        }
+
+        frustumCuller_.setFrustum(camera_.getProjectionMatrix() * camera_.getViewMatrix());
+        frustumCuller_.cull(&visibleMeshes_);
+    }
+
+    // Уровни детализации видимых мешей (слишком мелкие меши и меши с незавершенной загрузкой исключаются)
+    size_t drawnCount = 0;
+    for(const uint32_t meshIndex : visibleMeshes_){
+        if(this->isMeshUploaded(sceneMeshes_[meshIndex]) && this->selectMeshLod(sceneMeshes_[meshIndex], projectionScale)){
+            visibleMeshes_[drawnCount++] = meshIndex;
+        }
+    }
+    visibleMeshes_.resize(drawnCount);
+
+    statSceneMeshes_ += meshCount;
+    statVisibleMeshes_ += visibleMeshes_.size();
+}
+
+/**
+ * Выбрать уровень детализации меша по размеру его ограничивающей сферы на экране
+ * @param meshPtr Меш
+ * @param projectionScale Масштаб проекции (размер в пикселях объекта единичного размера на единичном расстоянии)
+ * @return Рисовать ли меш (нет - если его диаметр на экране меньше порога)
+ *
+ * @details Ошибки уровней хранятся в локальном пространстве геометрии, поэтому переводятся в доли радиуса
+ * ограничивающей сферы - так учитывается масштаб меша
+ */
+bool VkRenderer::selectMeshLod(const vk::scene::MeshPtr& meshPtr, float projectionScale)
+{
+    const auto& geometry = meshPtr->getGeometryBuffer();
+    if(!lodEnabled_ || geometry == nullptr || !geometry->isReady()){
+        meshPtr->setLod(0);
+        return true;
+    }
+
+    // Радиус ограничивающей сферы на экране (камера внутри сферы - меш заведомо крупный)
+    const auto& bounds = meshPtr->getWorldBounds();
+    float projectedRadius = bounds.radius * projectionScale;
+    if(camera_.getProjectionType() == vk::scene::CameraProjectionType::ePerspective)
+    {
+        const float distance = glm::length(bounds.center - camera_.getPosition());
+        if(distance <= bounds.radius){
+            meshPtr->setLod(0);
+            return true;
+        }
+        projectedRadius /= distance;
+    }
+
+    // Меш меньше порога не рисуется
+    if(projectedRadius * 2.0f < lodSettings_.minPixelSize) return false;
+
+    // Ошибка уровня на экране (пикселей)
+    const float localRadius = geometry->getBounds().sphereRadius;
+    auto pixelError = [&](size_t lod){
+        return localRadius > 0.0f ? geometry->getLod(lod).error / localRadius * projectedRadius : 0.0f;
+    };
+
+    // Самый грубый уровень с допустимой ошибкой
+    size_t lod = 0;
+    while(lod + 1 < geometry->getLodCount() && pixelError(lod + 1) <= lodSettings_.maxPixelError) lod++;
+
+    // Переход на более грубый уровень - только если ошибка меньше допустимой с запасом
+    const size_t current = meshPtr->getLod();
+    if(lod > current)
+    {
+        const float threshold = lodSettings_.maxPixelError * (1.0f - lodSettings_.hysteresis);
+        size_t coarser = current;
+        while(coarser < lod && pixelError(coarser + 1) <= threshold) coarser++;
+        lod = coarser;
+    }
+
+    meshPtr->setLod(lod);
+    return true;
+}
+
+/**
+ * Загружены ли ресурсы меша (видны ли данные его геометрии и текстур командам кадра)
+ * @param meshPtr Меш
+ * @return Да или нет
+ *
+ * @details При загрузке через выделенную очередь передачи ресурсы становятся доступны графической очереди через
+ * несколько кадров после создания - до этого меш не рисуется
+ */
+bool VkRenderer::isMeshUploaded(const vk::scene::MeshPtr& meshPtr) const
+{
+    return meshPtr->getUploadTicket() <= uploadsReadyTicket_;
+}
+
+/**
+ * Получить ключ пакета непрямого рисования меша
+ * @param mesh Меш
+ * @return Ключ пакета (меши с равными ключами рисуются одним пакетом, если у них нет скелета)
+ */
+VkRendererIndirectBatchKey VkRenderer::getIndirectBatchKey(const vk::scene::MeshPtr& mesh) const
+{
+    const auto& geometry = mesh->getGeometryBuffer();
+
+    VkRendererIndirectBatchKey key{};
+    key.pipelineVariant = this->getPipelinePrimaryVariant(mesh);
+    key.poolBlock = geometry->getPoolBlockIndex();
+    key.indexing = !geometry->isIndexed() ? 0 : (geometry->getIndexType() == vk::IndexType::eUint16 ? 1 : 2);
+    key.textureMapping = mesh->getTextureMapping();
+    return key;
+}
+
+/**
+ * Обновить ключ пакета меша в слоте (и счетчики использования вариантов основного конвейера)
+ * @param slot Слот меша
+ * @return Изменился ли ключ
+ */
+bool VkRenderer::updateMeshSlotKey(uint32_t slot)
+{
+    const VkRendererIndirectBatchKey key = this->getIndirectBatchKey(meshSlots_[slot]);
+    VkRendererIndirectBatchKey& current = meshSlotKeys_[slot];
+    if(key == current) return false;
+
+    pipelineVariantUsage_[current.pipelineVariant]--;
+    pipelineVariantUsage_[key.pipelineVariant]++;
+    current = key;
+    return true;
+}
+
+/**
+ * Перестроить пакеты непрямого рисования и объекты пакетов (отсечение на GPU)
+ *
+ * @details Пакеты нумеруются в порядке первого появления среди мешей сцены, после чего объекты раскладываются
+ * по пакетам (сортировка подсчетом) - объекты, а значит и аргументы рисования каждого пакета лежат подряд
+ */
+void VkRenderer::rebuildGpuCullingBatches()
+{
+    PROFILE_SCOPE("VkRenderer::rebuildGpuCullingBatches");
+
+    const size_t meshCount = sceneMeshes_.size();
+    gpuCullingBatches_.clear();
+    indirectBatchLookup_.clear();
+    sceneMeshBatches_.resize(meshCount);
+
+    // Назначить пакеты (скелетная анимация - всегда отдельный пакет, матрицы костей у меша свои)
+    for(size_t i = 0; i < meshCount; i++)
+    {
+        const auto& meshPtr = sceneMeshes_[i];
+        if((meshPtr->getShaderPermutation() & vk::scene::SHADER_PERMUTATION_SKINNED) == 0)
+        {
+            auto inserted = indirectBatchLookup_.emplace(meshSlotKeys_[meshPtr->getSceneSlot()], static_cast<uint32_t>(gpuCullingBatches_.size()));
+            if(!inserted.second){
+                sceneMeshBatches_[i] = inserted.first->second;
+                gpuCullingBatches_[inserted.first->second].instanceCount++;
+                continue;
+            }
+        }
+
+        VkRendererDrawGroup batch{};
+        batch.mesh = static_cast<uint32_t>(i);
+        batch.instanceCount = 1;
+        sceneMeshBatches_[i] = static_cast<uint32_t>(gpuCullingBatches_.size());
+        gpuCullingBatches_.push_back(batch);
+    }
+
+    // Первые объекты пакетов (кол-во объектов пакета восстанавливается по мере раскладки)
+    uint32_t objectCount = 0;
+    for(auto& batch : gpuCullingBatches_){
+        batch.firstInstance = objectCount;
+        objectCount += batch.instanceCount;
+        batch.instanceCount = 0;
+    }
+
+    gpuCullingBatchObjects_.resize(meshCount);
+    for(size_t i = 0; i < meshCount; i++)
+    {
+        VkRendererDrawGroup& batch = gpuCullingBatches_[sceneMeshBatches_[i]];
+        vk::tools::GpuCullingBatchObject& object = gpuCullingBatchObjects_[batch.firstInstance + batch.instanceCount++];
+        object.slot = sceneMeshes_[i]->getSceneSlot();
+        object.drawFirst = batch.firstInstance;
+    }
+
+    // Буферы объектов пакетов всех кадров должны быть обновлены
+    std::fill(gpuCullingBatchObjectsStale_.begin(), gpuCullingBatchObjectsStale_.end(), true);
+    gpuCullingBatchesDirty_ = false;
+}
+
+/**
+ * Записать объект отсечения и данные экземпляра меша в слот буферов кадра (отсечение на GPU)
+ * @param frameIndex Индекс кадра в полете
+ * @param slot Слот меша
+ *
+ * @details Уровни детализации сверх GPU_CULLING_MAX_LODS не используются. Меш, ресурсы которого не готовы,
+ * записывается без уровней - шейдер его не рисует
+ */
+void VkRenderer::writeGpuCullingSlot(size_t frameIndex, uint32_t slot)
+{
+    const auto& meshPtr = meshSlots_[slot];
+    const auto& geometry = meshPtr->getGeometryBuffer();
+    const auto& bounds = meshPtr->getWorldBounds();
+    const vk::tools::UploadTicket uploadTicket = meshPtr->getUploadTicket();
+
+    vk::tools::GpuCullingObject object{};
+    object.centerRadius = glm::vec4(bounds.center, bounds.radius);
+    object.extent = bounds.extent;
+    object.flags = (meshPtr->getShaderPermutation() & vk::scene::SHADER_PERMUTATION_SKINNED) != 0 ? vk::tools::GPU_CULLING_OBJECT_ALWAYS_VISIBLE : 0;
+    object.uploadTicket[0] = static_cast<uint32_t>(uploadTicket & 0xFFFFFFFFu);
+    object.uploadTicket[1] = static_cast<uint32_t>(uploadTicket >> 32u);
+
+    if(meshPtr->isReady() && geometry != nullptr && geometry->isReady())
+    {
+        object.localRadius = geometry->getBounds().sphereRadius;
+        if(geometry->isIndexed())
+        {
+            object.flags |= vk::tools::GPU_CULLING_OBJECT_INDEXED;
+            object.lodCount = static_cast<uint32_t>((std::min)(geometry->getLodCount(), static_cast<size_t>(vk::tools::GPU_CULLING_MAX_LODS)));
+            object.vertexOffset = static_cast<int32_t>(geometry->getFirstVertex());
+            for(uint32_t lod = 0; lod < object.lodCount; lod++){
+                object.lodFirst[lod] = geometry->getLodFirstIndex(lod);
+                object.lodElementCount[lod] = static_cast<uint32_t>(geometry->getLodIndexCount(lod));
+                object.lodError[lod] = geometry->getLod(lod).error;
+            }
+        }
+        else
+        {
+            object.lodCount = 1;
+            object.lodFirst[0] = geometry->getFirstVertex();
+            object.lodElementCount[0] = static_cast<uint32_t>(geometry->getVertexCount());
+        }
+    }
+
+    // Выбранный шейдером уровень (последнее поле) сохраняется
+    unsigned char* objects = gpuCullingObjectsMapped_[frameIndex] + sizeof(vk::tools::GpuCullingHeader);
+    memcpy(objects + sizeof(vk::tools::GpuCullingObject) * slot, &object, offsetof(vk::tools::GpuCullingObject, lod));
+
+    this->writeInstanceData(meshPtr, instanceDataMapped_[frameIndex][slot]);
+}
+
+/**
+ * Подготовить отсечение на GPU для кадра (обновить буферы кадра и записать командный буфер вычислений)
+ * @param frameIndex Индекс кадра в полете
+ * @param projectionScale Масштаб проекции (для выбора уровней детализации шейдером, см. selectMeshLod)
+ *
+ * @details Работа CPU не зависит от кол-ва мешей сцены: перезаписываются только слоты изменившихся мешей, а данные
+ * пакетов (блоки данных и сортировка) обрабатываются по пакету. Выбранный уровень детализации шейдер хранит в буфере
+ * кадра, поэтому гистерезис учитывает уровень, выбранный maxFramesInFlight_ кадров назад
+ */
+void VkRenderer::prepareGpuCulling(size_t frameIndex, float projectionScale)
+{
+    PROFILE_SCOPE("VkRenderer::prepareGpuCulling");
+
+    auto* header = reinterpret_cast<vk::tools::GpuCullingHeader*>(gpuCullingObjectsMapped_[frameIndex]);
+
+    // Результат предыдущего использования буфера (барьер кадра уже пройден, запись счетчиков сделана видимой хосту)
+    if(gpuCullingSubmittedObjects_[frameIndex] > 0){
+        statSceneMeshes_ += gpuCullingSubmittedObjects_[frameIndex];
+        statVisibleMeshes_ += header->visibleCount;
+        statTriangles_ += header->triangleCount;
+    }
+
+    // Пакеты перестраиваются только после изменения их состава
+    if(gpuCullingBatchesDirty_){
+        this->rebuildGpuCullingBatches();
+    }
+
+    // Слоты мешей - все (буферы кадра еще не заполнялись или использовались отсечением на CPU) или только изменившиеся
+    auto& dirtySlots = gpuCullingDirtySlots_[frameIndex];
+    if(gpuCullingFrameStale_[frameIndex]){
+        for(const auto& meshPtr : sceneMeshes_){
+            this->writeGpuCullingSlot(frameIndex, meshPtr->getSceneSlot());
+        }
+        gpuCullingFrameStale_[frameIndex] = false;
+    }
+    else{
+        for(const uint32_t slot : dirtySlots){
+            if(meshSlots_[slot] != nullptr) this->writeGpuCullingSlot(frameIndex, slot);
+        }
+    }
+    dirtySlots.clear();
+
+    // Объекты пакетов
+    const size_t objectCount = gpuCullingBatchObjects_.size();
+    if(gpuCullingBatchObjectsStale_[frameIndex]){
+        memcpy(gpuCullingBatchObjectsMapped_[frameIndex], gpuCullingBatchObjects_.data(), sizeof(vk::tools::GpuCullingBatchObject) * objectCount);
+        gpuCullingBatchObjectsStale_[frameIndex] = false;
+    }
+
+    // Заголовок - плоскости пирамиды видимости, камера, параметры выбора уровней детализации и режим записи аргументов
+    frustumCuller_.setFrustum(camera_.getProjectionMatrix() * camera_.getViewMatrix());
+    for(size_t i = 0; i < 6; i++){
+        header->planes[i] = frustumCuller_.getPlanes()[i];
+    }
+    header->cameraPositionScale = glm::vec4(camera_.getPosition(), projectionScale);
+    header->objectCount = static_cast<uint32_t>(objectCount);
+    header->visibleCount = 0;
+    header->triangleCount = 0;
+    header->compact = gpuCullingCompact_ ? 1 : 0;
+    header->lodEnabled = lodEnabled_ ? 1 : 0;
+    header->perspective = camera_.getProjectionType() == vk::scene::CameraProjectionType::ePerspective ? 1 : 0;
+    header->minPixelSize = lodSettings_.minPixelSize;
+    header->maxPixelError = lodSettings_.maxPixelError;
+    header->lodHysteresis = lodSettings_.hysteresis;
+    header->uploadsReadyTicket[0] = static_cast<uint32_t>(uploadsReadyTicket_ & 0xFFFFFFFFu);
+    header->uploadsReadyTicket[1] = static_cast<uint32_t>(uploadsReadyTicket_ >> 32u);
+
+    // Пакеты кадра (блоки данных пакетов - данные первого меша пакета)
+    drawGroups_ = gpuCullingBatches_;
+    this->writeDrawGroupUniforms(frameIndex);
+
+    gpuCullingSubmittedObjects_[frameIndex] = objectCount;
+    statDrawCalls_ += drawGroups_.size();
+
+    // Командный буфер вычислений (по потоку на объект)
+    const vk::CommandBuffer& commandBuffer = gpuCullingCommandBuffers_[frameIndex];
+    commandBuffer.reset({});
+    commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    // Счетчики пакетов обнуляются перед отсечением (только при сжатии)
+    if(gpuCullingCompact_){
+        commandBuffer.fillBuffer(gpuCullingCountBuffers_[frameIndex].getBuffer().get(), 0, sizeof(uint32_t) * objectCount, 0);
+        vk::MemoryBarrier clearBarrier{vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead|vk::AccessFlagBits::eShaderWrite};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, {clearBarrier}, {}, {});
+    }
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipelineGpuCulling_.get());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayoutGpuCulling_.get(), 0, {gpuCullingDescriptorSets_[frameIndex]}, {});
+    commandBuffer.dispatch(static_cast<uint32_t>((objectCount + GPU_CULLING_WORKGROUP_SIZE - 1) / GPU_CULLING_WORKGROUP_SIZE), 1, 1);
+
+    // Счетчики видимых объектов и треугольников читаются хостом при следующем использовании буфера
+    vk::MemoryBarrier memoryBarrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead};
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, {memoryBarrier}, {}, {});
+    commandBuffer.end();
+}
+
+/**
+ * Объединить видимые меши в группы экземпляров и записать данные экземпляров кадра (заполняет drawGroups_)
+ * @param frameIndex Индекс кадра в полете
+ *
+ * @details Группы нумеруются в порядке первого появления среди видимых мешей, после чего данные экземпляров
+ * раскладываются по группам (сортировка подсчетом) - экземпляры каждой группы лежат в потоке подряд
+ */
+void VkRenderer::buildDrawGroups(size_t frameIndex)
+{
+    PROFILE_SCOPE("VkRenderer::buildDrawGroups");
+
+    drawGroups_.clear();
+    drawGroupLookup_.clear();
+    visibleMeshGroups_.resize(visibleMeshes_.size());
+
+    // Назначить группы (скелетная анимация - всегда отдельная группа, матрицы костей у меша свои)
+    for(size_t i = 0; i < visibleMeshes_.size(); i++)
+    {
+        const auto& meshPtr = sceneMeshes_[visibleMeshes_[i]];
+        const bool skinned = (meshPtr->getShaderPermutation() & vk::scene::SHADER_PERMUTATION_SKINNED) != 0;
+
+        if(instancingEnabled_ && !skinned)
+        {
+            auto inserted = drawGroupLookup_.emplace(meshPtr->getInstancingKey(), static_cast<uint32_t>(drawGroups_.size()));
+            if(!inserted.second){
+                visibleMeshGroups_[i] = inserted.first->second;
+                drawGroups_[inserted.first->second].instanceCount++;
+                continue;
+            }
+        }
+
+        VkRendererDrawGroup group{};
+        group.mesh = visibleMeshes_[i];
+        group.instanceCount = 1;
+        visibleMeshGroups_[i] = static_cast<uint32_t>(drawGroups_.size());
+        drawGroups_.push_back(group);
+    }
+
+    // Первые экземпляры групп
+    uint32_t instanceCount = 0;
+    for(auto& group : drawGroups_){
+        group.firstInstance = instanceCount;
+        instanceCount += group.instanceCount;
+        group.instanceCount = 0;
+    }
+
+    this->writeDrawGroupUniforms(frameIndex);
+
+    // Данные экземпляров (счетчик экземпляров группы восстанавливается по мере записи)
+    vk::tools::InstanceData* instances = instanceDataMapped_[frameIndex];
+    for(size_t i = 0; i < visibleMeshes_.size(); i++)
+    {
+        VkRendererDrawGroup& group = drawGroups_[visibleMeshGroups_[i]];
+        this->writeInstanceData(sceneMeshes_[visibleMeshes_[i]], instances[group.firstInstance + group.instanceCount++]);
+    }
+
+    // Треугольники кадра
+    for(const auto& group : drawGroups_){
+        const auto& geometry = sceneMeshes_[group.mesh]->getGeometryBuffer();
+        const size_t count = geometry->isIndexed() ? geometry->getLodIndexCount(sceneMeshes_[group.mesh]->getLod()) : geometry->getVertexCount();
+        statTriangles_ += (count / 3) * group.instanceCount;
+    }
+
+    statDrawCalls_ += drawGroups_.size();
+}
+
+/**
+ * Записать блоки данных групп кадра в кольцевой UBO буфер (по одному на группу, данные первого меша группы)
+ * @param frameIndex Индекс кадра в полете
+ *
+ * @details У мешей группы параметры отображения текстур общие, а меши со скелетом всегда в отдельной группе
+ */
+void VkRenderer::writeDrawGroupUniforms(size_t frameIndex)
+{
+    objectUniformRing_.begin(frameIndex);
+    for(auto& group : drawGroups_){
+        const auto& meshPtr = sceneMeshes_[group.mesh];
+        unsigned char* pData = objectUniformRing_.allocate(meshPtr->getUniformDataSize(), &group.uniformOffset);
+        if(pData == nullptr){
+            throw vk::OutOfDeviceMemoryError("Can't write object uniforms. Not enough space in object uniform ring");
+        }
+        meshPtr->writeUniforms(pData);
+    }
+}
+
+/**
+ * Записать данные экземпляра меша (поток экземпляров)
+ * @param meshPtr Меш
+ * @param instance Данные экземпляра в размеченной памяти буфера экземпляров
+ */
+void VkRenderer::writeInstanceData(const vk::scene::MeshPtr& meshPtr, vk::tools::InstanceData& instance) const
+{
+    const vk::scene::MeshMaterialSettings material = meshPtr->getMaterialSettings();
+    const glm::mat4& normalMatrix = meshPtr->getNormalMatrix();
+
+    instance.model = meshPtr->getModelMatrix();
+    instance.normalMatrix[0] = normalMatrix[0];
+    instance.normalMatrix[1] = normalMatrix[1];
+    instance.normalMatrix[2] = normalMatrix[2];
+    instance.material = glm::vec4(material.albedo, material.roughness);
+    instance.metallic = material.metallic;
+    vk::tools::PackTextureIndices(meshPtr->getTextureIndices(), instance.textures);
+}
+
+/**
+ * Отсортировать группы экземпляров кадра по 64-битным ключам (поразрядной сортировкой)
+ *
+ * @details Порядок полей ключа - по убыванию стоимости смены состояния. Выше всего вариант конвейера (смена
+ * конвейера самая дорогая), затем блок пула геометрии и тип индексов - подряд идущие группы одного блока не
+ * перепривязывают буферы вершин и индексов. Наборы дескрипторов общие (текстуры в глобальной таблице, данные объектов
+ * задаются динамическим смещением), поэтому материал - индекс основной текстуры - влияет только на локальность кеша
+ * текстур. Внутри одинакового состояния группы идут от ближних к дальним (раннее отсечение по глубине)
+ */
+void VkRenderer::sortDrawGroups()
+{
+    PROFILE_SCOPE("VkRenderer::sortDrawGroups");
+
+    const size_t groupCount = drawGroups_.size();
+    if(!drawSortingEnabled_ || groupCount < 2) return;
+
+    const glm::mat4& viewMatrix = camera_.getViewMatrix();
+    const float depthScale = 1.0f / (std::max)(camera_.getZFar(), 0.001f);
+
+    drawSortKeys_.resize(groupCount);
+    drawSortOrder_.resize(groupCount);
+
+    for(size_t i = 0; i < groupCount; i++)
+    {
+        const auto& meshPtr = sceneMeshes_[drawGroups_[i].mesh];
+        const auto& geometry = meshPtr->getGeometryBuffer();
+
+        // Вариант конвейера
+        const uint64_t pipelineBits = this->getPipelinePrimaryVariant(meshPtr) & 0xFFu;
+
+        // Блок пула геометрии и тип индексов (буферы вершин и индексов)
+        const uint64_t geometryBits = ((static_cast<uint64_t>(geometry->getPoolBlockIndex()) << 1u) |
+                (geometry->getIndexType() == vk::IndexType::eUint16 ? 1u : 0u)) & 0xFFFFu;
+
+        // Материал - индекс основной текстуры в глобальной таблице (наборы дескрипторов при смене текстур не меняются,
+        // но меши с одинаковыми текстурами рядом лучше используют кеш текстур)
+        const uint64_t materialBits = meshPtr->getTextureIndices()[vk::scene::TEXTURE_TYPE_ALBEDO] & 0xFFFFu;
+
+        // Глубина центра ограничивающих объемов в пространстве камеры (доля дальней плоскости)
+        const float viewDepth = -(viewMatrix * glm::vec4(meshPtr->getWorldBounds().center, 1.0f)).z * depthScale;
+        const uint64_t depthBits = static_cast<uint64_t>(glm::clamp(viewDepth, 0.0f, 1.0f) * 16777215.0f);
+
+        drawSortKeys_[i] = (pipelineBits << 56u) | (geometryBits << 40u) | (materialBits << 24u) | depthBits;
+        drawSortOrder_[i] = static_cast<uint32_t>(i);
+    }
+
+    drawSorter_.sort(&drawSortKeys_, &drawSortOrder_);
+
+    // Переставить группы в отсортированном порядке
+    drawGroupsSorted_.resize(groupCount);
+    for(size_t i = 0; i < groupCount; i++){
+        drawGroupsSorted_[i] = drawGroups_[drawSortOrder_[i]];
+        drawGroupsSorted_[i].sortKey = drawSortKeys_[i];
+    }
+    drawGroups_.swap(drawGroupsSorted_);
+}
+
+/**
+ * Запись команд кадра в командный буфер
+ * @param commandBuffer Командный буфер кадра
+ * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+ * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+ */
+void VkRenderer::recordCommandBuffer(const vk::CommandBuffer& commandBuffer, uint32_t imageIndex, size_t frameIndex)
+{
+    PROFILE_SCOPE("VkRenderer::recordCommandBuffer");
+
+    // Описываем очистку вложений
+    std::vector<vk::ClearValue> clearValues(2);
+    clearValues[0].color = vk::ClearColorValue( std::array<float, 4>({ 0.0f, 0.0f, 0.0f, 1.0f }));
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue( 1.0f, 0 );
+
+    // Описываем начало прохода
+    vk::RenderPassBeginInfo renderPassBeginInfo{};
+    renderPassBeginInfo.pNext = nullptr;
+    renderPassBeginInfo.renderArea.offset.x = 0;
+    renderPassBeginInfo.renderArea.offset.y = 0;
+    renderPassBeginInfo.renderArea.extent.width = frameBuffersPrimary_[imageIndex].getExtent().width;
+    renderPassBeginInfo.renderArea.extent.height = frameBuffersPrimary_[imageIndex].getExtent().height;
+    renderPassBeginInfo.clearValueCount = clearValues.size();
+    renderPassBeginInfo.pClearValues = clearValues.data();
+
+    // Размеры области вида
+    auto viewPortExtent = frameBuffersPrimary_[imageIndex].getExtent();
+
+    // Область вида - динамическое состояние
+    vk::Viewport viewport{};
+    viewport.setX(0.0f);
+    viewport.setWidth(static_cast<float>(viewPortExtent.width));
+    viewport.setY(inputDataInOpenGlStyle_ ? static_cast<float>(viewPortExtent.height) : 0.0f);
+    viewport.setHeight(inputDataInOpenGlStyle_ ? -static_cast<float>(viewPortExtent.height) : static_cast<float>(viewPortExtent.height));
+    viewport.setMinDepth(0.0f);
+    viewport.setMaxDepth(1.0f);
+
+    // Параметры ножниц (динамическое состояние)
+    vk::Rect2D scissors{};
+    scissors.offset.x = 0;
+    scissors.offset.y = 0;
+    scissors.extent.width = viewPortExtent.width;
+    scissors.extent.height = viewPortExtent.height;
+
+    // Отсечь меши, не попадающие в пирамиду видимости, и выбрать уровни детализации
+    this->cullSceneMeshes(viewPortExtent);
+
+    // Объединить видимые меши в группы экземпляров (при отсечении на GPU меши уже объединены в пакеты непрямого
+    // рисования) и отсортировать их по состоянию и глубине
+    if(!gpuCullingActive_) this->buildDrawGroups(frameIndex);
+    this->sortDrawGroups();
+
+    // Кол-во вызовов отрисовки с временными метками (должно быть известно до записи вторичных буферов)
+    gpuProfiler_.setDrawCount(frameIndex, drawGroups_.size());
+
+    // Записать команды основного прохода во вторичные буферы (параллельно)
+    auto secondaryCount = this->recordPrimaryPassSecondaryBuffers(imageIndex, frameIndex, viewport, scissors);
+
+    // Начинаем работу с командным буфером (запись команд)
+    // Буфер перезаписывается каждый кадр, поэтому используется однократно
+    vk::CommandBufferBeginInfo commandBufferBeginInfo{};
+    commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBufferBeginInfo.pNext = nullptr;
+    commandBuffer.begin(commandBufferBeginInfo);
+
+    // Прочитать результаты профилирования предыдущего использования ресурсов кадра и сбросить запросы
+    gpuProfiler_.beginFrame(commandBuffer, frameIndex, frameNumber_);
+
+    /// Основной проход
+
+    gpuProfiler_.beginPass(commandBuffer, frameIndex, vk::tools::GpuProfilerPass::ePrimary);
+
+    // Сменить целевой кадровый буфер и начать работу с проходом (это очистит вложения)
+    // Команды прохода находятся во вторичных буферах, записанных заранее
+    renderPassBeginInfo.renderPass = renderPassPrimary_.get();
+    renderPassBeginInfo.framebuffer = frameBuffersPrimary_[imageIndex].getVulkanFrameBuffer().get();
+    commandBuffer.beginRenderPass(renderPassBeginInfo,vk::SubpassContents::eSecondaryCommandBuffers);
+
+    // Пред-проход глубины (под-проход пуст, если пред-проход выключен)
+    if(depthPrePassEnabled_){
+        commandBuffer.executeCommands(static_cast<uint32_t>(secondaryCount), depthPrePassCommandBuffers_[frameIndex].data());
+    }
+
+    // Основной под-проход
+    commandBuffer.nextSubpass(vk::SubpassContents::eSecondaryCommandBuffers);
+
+    // Выполнить вторичные командные буферы
+    commandBuffer.executeCommands(static_cast<uint32_t>(secondaryCount), secondaryCommandBuffers_[frameIndex].data());
+
+    // Завершение прохода добавит неявное преобразование памяти кадрового буфера в VK_IMAGE_LAYOUT_PRESENT_SRC_KHR для представления содержимого
+    commandBuffer.endRenderPass();
+
+    gpuProfiler_.endPass(commandBuffer, frameIndex, vk::tools::GpuProfilerPass::ePrimary);
+
+    /// Пост-обработка
+
+    gpuProfiler_.beginPass(commandBuffer, frameIndex, vk::tools::GpuProfilerPass::ePostProcess);
+
+    // Сменить целевой кадровый буфер и начать работу с проходом (это очистит вложения)
+    renderPassBeginInfo.renderPass = renderPassPostProcess_.get();
+    renderPassBeginInfo.framebuffer = frameBuffersPostProcess_[imageIndex].getVulkanFrameBuffer().get();
+    commandBuffer.beginRenderPass(renderPassBeginInfo,vk::SubpassContents::eInline);
+
+    // Привязать графический конвейер
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelinePostProcess_.get());
+
+    // Установка view-port'а и ножниц
+    commandBuffer.setViewport(0,1,&viewport);
+    commandBuffer.setScissor(0,1,&scissors);
+
+    // Привязать дескрипторные набор с изображением сформированным в предыдущем проходе
+    commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics,
+            pipelineLayoutPostProcess_.get(),
+            0,
+            {frameBuffersPrimaryDescriptorSets_[imageIndex]},{});
+
+    // Отрисовка треугольника
+    commandBuffer.draw(6,1,0,0);
+
+    // Завершаем работать с потоком
+    commandBuffer.endRenderPass();
+
+    gpuProfiler_.endPass(commandBuffer, frameIndex, vk::tools::GpuProfilerPass::ePostProcess);
+
+    // Завершаем работу с командным буфером
+    commandBuffer.end();
+}
+
+/**
+ * Освобождение геометрических буферов
+ */
+void VkRenderer::freeGeometryBuffers()
+{
+    // Пройтись по всем буферам и уничтожить выделенные ресурсы
+    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
+    for(const auto& bufferPtrEntry : geometryBuffers_)
+    {
+        bufferPtrEntry->destroyVulkanResources();
+    }
+}
+
+/**
+ * Освобождение текстурных буферов
+ *
+ * @details Перед де-инициализацией объекта рендерера, перед уничтожением устройства, будет правильным очистить все
+ * текстурные буферы которые когда либо выделялись.
+ */
+void VkRenderer::freeTextureBuffers()
+{
+    // Пройтись по всем буферам и уничтожить выделенные ресурсы
+    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
+    for(const auto& bufferPtrEntry : textureBuffers_)
+    {
+        bufferPtrEntry->destroyVulkanResources();
+    }
+}
+
+/**
+ * Очистка ресурсов мешей
+ */
+void VkRenderer::freeMeshes()
+{
+    // Пройтись по всем мешам и уничтожить выделенные ресурсы
+    // Объекты без ресурсов Vulkan могут быть корректно уничтожены
+    for(const auto& meshPtrEntry : sceneMeshes_)
+    {
+        meshPtrEntry->destroyVulkanResources();
+    }
+
+    // Меши, так и не попавшие на сцену
+    for(const auto& meshPtrEntry : pendingMeshesToAdd_)
+    {
+        meshPtrEntry->destroyVulkanResources();
+    }
+
+    // Удаленные меши, ожидающие освобождения
+    this->releaseRetiredMeshes(true);
+
+    // Меши перестают сообщать об изменениях (они могут пережить рендерер)
+    for(const auto& meshPtrEntry : sceneMeshes_)
+    {
+        meshPtrEntry->trackChanges(nullptr, 0);
+    }
+
+    sceneMeshes_.clear();
+    pendingMeshesToAdd_.clear();
+    pendingMeshesToRemove_.clear();
+
+    meshSlots_.clear();
+    freeMeshSlots_.clear();
+    changedMeshSlots_.clear();
+    meshSlotKeys_.clear();
+    std::fill(pipelineVariantUsage_.begin(), pipelineVariantUsage_.end(), 0);
+    gpuCullingBatchesDirty_ = true;
+}
+
+/**
+ * Находится ли меш на сцене (занимает ли он слот)
+ * @param meshPtr Меш
+ * @return Да или нет (меши, ожидающие добавления, еще не на сцене)
+ */
+bool VkRenderer::isMeshOnScene(const vk::scene::MeshPtr& meshPtr) const
+{
+    const uint32_t slot = meshPtr->getSceneSlot();
+    return slot < meshSlots_.size() && meshSlots_[slot] == meshPtr;
+}
+
+/**
+ * Применить накопленные изменения сцены (добавление и удаление мешей, изменения мешей сцены)
+ *
+ * @details Меш на сцене занимает слот (его данные лежат в буферах отсечения на GPU и потоке экземпляров по номеру
+ * слота) и сам сообщает об изменениях, поэтому обрабатываются только добавленные, удаленные и изменившиеся меши
+ */
+void VkRenderer::applySceneChanges()
+{
+    // Удалить меши (за один проход по списку, сколько бы мешей ни было удалено). Слоты освобождаются раньше добавления
+    // новых мешей, поэтому номера слотов всегда меньше maxMeshes_
+    if(!pendingMeshesToRemove_.empty())
+    {
+        std::unordered_set<const vk::scene::Mesh*> removed;
+        for(const auto& meshPtr : pendingMeshesToRemove_){
+            removed.insert(meshPtr.get());
+
+            if(this->isMeshOnScene(meshPtr)){
+                const uint32_t slot = meshPtr->getSceneSlot();
+                pipelineVariantUsage_[meshSlotKeys_[slot].pipelineVariant]--;
+                meshSlots_[slot] = nullptr;
+                freeMeshSlots_.push_back(slot);
+                meshPtr->trackChanges(nullptr, 0);
+            }
+        }
+
+        sceneMeshes_.erase(std::remove_if(sceneMeshes_.begin(), sceneMeshes_.end(), [&](const vk::scene::MeshPtr& meshEntryPtr){
+            return removed.count(meshEntryPtr.get()) > 0;
+        }), sceneMeshes_.end());
+
+        // Последний кадр, который мог использовать меш - предыдущий. Он гарантированно завершен, когда
+        // будет дождан барьер кадра с номером на maxFramesInFlight_ больше
+        for(const auto& meshPtr : pendingMeshesToRemove_){
+            meshesToRelease_.emplace_back(meshPtr, frameNumber_ + maxFramesInFlight_);
+        }
+
+        pendingMeshesToRemove_.clear();
+        gpuCullingBatchesDirty_ = true;
+    }
+
+    // Добавить новые меши (занять слоты, меш сразу отмечается как изменившийся)
+    if(!pendingMeshesToAdd_.empty())
+    {
+        for(const auto& meshPtr : pendingMeshesToAdd_)
+        {
+            uint32_t slot = static_cast<uint32_t>(meshSlots_.size());
+            if(!freeMeshSlots_.empty()){
+                slot = freeMeshSlots_.back();
+                freeMeshSlots_.pop_back();
+            }
+            else{
+                meshSlots_.emplace_back();
+                meshSlotKeys_.emplace_back();
+            }
+
+            meshSlots_[slot] = meshPtr;
+            meshSlotKeys_[slot] = this->getIndirectBatchKey(meshPtr);
+            pipelineVariantUsage_[meshSlotKeys_[slot].pipelineVariant]++;
+            meshPtr->trackChanges(&changedMeshSlots_, slot);
+        }
+
+        sceneMeshes_.insert(sceneMeshes_.end(), pendingMeshesToAdd_.begin(), pendingMeshesToAdd_.end());
+        pendingMeshesToAdd_.clear();
+        gpuCullingBatchesDirty_ = true;
+    }
+
+    // Смена пред-прохода глубины меняет варианты конвейера (а значит и ключи пакетов) всех мешей
+    if(meshSlotKeysDepthPrePass_ != depthPrePassEnabled_)
+    {
+        for(uint32_t slot = 0; slot < meshSlots_.size(); slot++){
+            if(meshSlots_[slot] != nullptr) this->updateMeshSlotKey(slot);
+        }
+        meshSlotKeysDepthPrePass_ = depthPrePassEnabled_;
+        gpuCullingBatchesDirty_ = true;
+    }
+
+    // Изменившиеся меши - обновить ключи пакетов и отметить слоты для перезаписи в буферах всех кадров
+    for(const uint32_t slot : changedMeshSlots_)
+    {
+        if(meshSlots_[slot] == nullptr) continue;
+        meshSlots_[slot]->resetChanged();
+
+        if(this->updateMeshSlotKey(slot)){
+            gpuCullingBatchesDirty_ = true;
+        }
+
+        for(auto& dirtySlots : gpuCullingDirtySlots_){
+            dirtySlots.push_back(slot);
+        }
+    }
+    changedMeshSlots_.clear();
+}
+
+/**
+ * Освободить ресурсы удаленных мешей, кадры использовавшие которые уже завершены
+ * @param force Освободить все (когда гарантированно известно что GPU не выполняет команд)
+ */
+void VkRenderer::releaseRetiredMeshes(bool force)
+{
+    meshesToRelease_.erase(std::remove_if(meshesToRelease_.begin(), meshesToRelease_.end(), [&](const std::pair<vk::scene::MeshPtr, uint64_t>& entry){
+        if(force || entry.second <= frameNumber_){
+            entry.first->destroyVulkanResources();
+            return true;
+        }
+        return false;
+    }), meshesToRelease_.end());
+}
+
+/** C O N S T R U C T O R - D E S T R U C T O R **/
+
+/**
+ * Инициализация экземпляра Vulkan (и debug-callback'а при использовании validation-слоев)
+ */
+void VkRenderer::initInstance()
+{
+    // Расширения поверхности нужны только для показа на окне
+    std::vector<const char*> instanceExtensionNames = {};
+    std::vector<const char*> instanceValidationLayerNames = {};
+
+    if(!isHeadless_){
+        instanceExtensionNames.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+        instanceExtensionNames.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+    }
+
+    if(useValidation_){
+        instanceExtensionNames.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+        instanceValidationLayerNames.push_back("VK_LAYER_KHRONOS_validation");
+    }
+
+    this->vulkanInstance_ = vk::tools::CreateVulkanInstance("My Application",
+            "My engine",
+            1,1,
+            instanceExtensionNames,
+            instanceValidationLayerNames);
+    std::cout << "Vulkan instance created." << std::endl;
+
+    // Загрузка функций расширений (получение адресов)
+    vkExtInitInstance(static_cast<VkInstance>(vulkanInstance_.get()));
+
+    // Создание debug report callback'а (создается только в том случае, если расширение VK_EXT_DEBUG_REPORT_EXTENSION_NAME использовано)
+    if(useValidation_){
+        debugReportCallbackExt_ = vulkanInstance_->createDebugReportCallbackEXTUnique(vk::DebugReportCallbackCreateInfoEXT({vk::DebugReportFlagBitsEXT::eError|vk::DebugReportFlagBitsEXT::eWarning},vk::tools::DebugVulkanCallback));
+        std::cout << "Report callback object created." << std::endl;
+    }
+}
+
+/**
+ * Инициализация устройства
+ */
+void VkRenderer::initDevice()
+{
+    // Расширение swap-chain нужно только для показа на окне
+    std::vector<const char*> deviceExtensionNames = {
+            VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME,
+            VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+    };
+
+    if(!isHeadless_){
+        deviceExtensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    std::vector<const char*> deviceValidationLayerNames = {};
+
+    if(useValidation_){
+        deviceValidationLayerNames.push_back("VK_LAYER_KHRONOS_validation");
+    }
+
+    // Во внеэкранном режиме поверхность пуста, допускаются не только дискретные устройства (например, программная реализация)
+    device_ = vk::tools::Device(vulkanInstance_,surface_,deviceExtensionNames,deviceValidationLayerNames, isHeadless_);
+    std::cout << "Device initialized (" << device_.getPhysicalDevice().getProperties().deviceName << ")" << std::endl;
+}
+
+/**
+ * Инициализация всех ресурсов рендеринга, общих для оконного и внеэкранного режимов
+ * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
+ * @param fragmentShaderCodeBytes Код фрагментного шейдера (байты)
+ * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+ * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
+ * @param vertexShaderCodeBytesPp Код вершинного шейдера пост-обработки (байты)
+ * @param fragmentShaderCodeBytesPp Код фрагментного шейдера пост-обработки (байты)
+ * @param maxMeshes Максимальное кол-во мешей
+ * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
+ */
+void VkRenderer::initRenderingResources(
+        const std::vector<unsigned char>& vertexShaderCodeBytes,
+        const std::vector<unsigned char>& fragmentShaderCodeBytes,
+        const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+        const std::vector<unsigned char>& computeShaderCodeBytesCulling,
+        const std::vector<unsigned char>& vertexShaderCodeBytesPp,
+        const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
+        size_t maxMeshes,
+        const std::string& pipelineCachePath)
+{
+    // Инициализация прохода/проходов рендеринга
+    this->initRenderPassPrimary(vk::Format::eR16G16B16A16Sfloat, vk::Format::eD32SfloatS8Uint);
+    this->initRenderPassPostProcess(vk::Format::eB8G8R8A8Unorm);
+    std::cout << "Render passes initialized." << std::endl;
+
+    // Инициализация цепочки показа (swap-chain)
+    if(!isHeadless_){
+        this->initSwapChain({vk::Format::eB8G8R8A8Unorm,vk::ColorSpaceKHR::eSrgbNonlinear}, presentPolicy_);
+        std::cout << "Swap-chain created (" << vk::to_string(swapChainPresentMode_) << ")." << std::endl;
+    }
+
+    // Создание основных кадровых буферов
     this->initFrameBuffersPrimary(vk::Format::eR16G16B16A16Sfloat, vk::Format::eD32SfloatS8Uint);
     std::cout << "Primary frame-buffers initialized (" << frameBuffersPrimary_.size() << ") [" << frameBuffersPrimary_[0].getExtent().width << " x " << frameBuffersPrimary_[0].getExtent().height << "]" << std::endl;
 
@@ -1437,18 +3374,24 @@ useValidation_(true)
 
     // Выделение командных буферов
     // Командный буфер может быть и один, но в таком случае придется ожидать его выполнения перед тем, как начинать запись
-    // в очередное изображение swap-chain'а (что не есть оптимально). Поэтому лучше использовать отдельные буферы, для каждого
-    // изображения swap-chain'а (по сути это копии одного и того же буфера)
-    auto allocInfo = vk::CommandBufferAllocateInfo(device_.getCommandGfxPool().get(), vk::CommandBufferLevel::ePrimary, frameBuffersPrimary_.size());
+    // следующего кадра (что не есть оптимально). Поэтому у каждого кадра в полете свой буфер, который перезаписывается
+    // каждый кадр. Их кол-во не зависит от кол-ва изображений swap-chain
+    auto allocInfo = vk::CommandBufferAllocateInfo(device_.getCommandGfxPool().get(), vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(maxFramesInFlight_));
     commandBuffers_ = device_.getLogicalDevice()->allocateCommandBuffers(allocInfo);
     std::cout << "Command-buffers allocated (" << commandBuffers_.size() << ")." << std::endl;
 
+    // Выделение командных пулов и вторичных буферов для параллельной записи основного прохода
+    // Первая часть мешей записывается основным потоком, поэтому в пуле на один поток меньше
+    this->initSecondaryCommandBuffers(maxFramesInFlight_, recordingSlotCount_);
+    if(recordingSlotCount_ > 1) recordingThreadPool_.reset(new tools::ThreadPool(recordingSlotCount_ - 1));
+    std::cout << "Secondary command-buffers allocated (recording threads: " << recordingSlotCount_ << ")." << std::endl;
+
     // Создать текстурный семплер по умолчанию
     textureSamplerDefault_ = vk::tools::CreateImageSampler(device_.getLogicalDevice().get(), vk::Filter::eLinear,vk::SamplerAddressMode::eRepeat, 2);
     std::cout << "Default texture sampler created." << std::endl;
 
     // Инициализация дескрипторных пулов и наборов
-    this->initDescriptorPoolsAndLayouts(maxMeshes,static_cast<uint32_t>(frameBuffersPrimary_.size()));
+    this->initDescriptorPoolsAndLayouts((std::max<size_t>)(frameBuffersPrimary_.size(), MAX_SWAP_CHAIN_IMAGES),maxFramesInFlight_);
     std::cout << "Descriptor pool and layouts initialized." << std::endl;
 
     // Создание камеры (UBO буферов и дескрипторных наборов)
@@ -1457,6 +3400,7 @@ useValidation_(true)
             &device_,
             descriptorPoolCamera_,
             descriptorSetLayoutCamera_,
+            maxFramesInFlight_,
             glm::vec3(0.0f,0.0f,0.0f),
             glm::vec3(0.0f,0.0f,0.0f),
             aspectRatio,
@@ -1464,25 +3408,67 @@ useValidation_(true)
     std::cout << "Camera created." << std::endl;
 
     // Создание объекта набора источников света сцены (UBO буферов и дескрипторных наборов)
-    lightSourceSet_ = vk::scene::LightSourceSet(&device_,descriptorPoolLightSources_,descriptorSetLayoutLightSources_,100);
+    lightSourceSet_ = vk::scene::LightSourceSet(&device_,descriptorPoolLightSources_,descriptorSetLayoutLightSources_,maxFramesInFlight_,100);
     std::cout << "Light source set created." << std::endl;
 
-    // Создать основной проход рендеринга
-    this->initPipelinePrimary(vertexShaderCodeBytes, geometryShaderCodeBytes, fragmentShaderCodeBytes);
-    std::cout << "Main graphics pipeline created." << std::endl;
+    // Создать кэш конвейеров (данные предыдущего запуска избавляют драйвер от повторной компиляции шейдеров)
+    pipelineCache_ = vk::tools::PipelineCache(&device_, pipelineCachePath);
+    std::cout << "Pipeline cache created (" << (pipelineCache_.isWarm() ? "warm, " + std::to_string(pipelineCache_.getLoadedDataSize()) + " bytes loaded" : "cold") << ")." << std::endl;
+
+    // Конвейеры создаются параллельно потоками пула, пока основной поток продолжает работу.
+    // Каждая задача возвращает момент своего завершения относительно начала создания конвейера
+    pipelineThreadPool_.reset(new tools::ThreadPool());
+    const auto pipelinesStartTime = std::chrono::high_resolution_clock::now();
+    auto pipelineFinishTimeMs = [pipelinesStartTime](){
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelinesStartTime).count();
+    };
+
+    // Подготовить основной конвейер (варианты для перестановок шейдеров создаются по мере появления мешей на сцене)
+    this->initPipelinePrimary(vertexShaderCodeBytes, fragmentShaderCodeBytes, vertexShaderCodeBytesDepth);
+
+    // Конвейеры пред-прохода глубины (всего два варианта, поэтому создаются сразу)
+    for(size_t skinned = 0; skinned < 2; skinned++){
+        const vk::Extent2D viewPortExtent = frameBuffersPrimary_[0].getExtent();
+        pipelinesDepthPrePassReady_[skinned] = pipelineThreadPool_->submit([=](){
+            PROFILE_SCOPE("VkRenderer::createPipelineDepthPrePassVariant");
+            this->createPipelineDepthPrePassVariant(skinned != 0, viewPortExtent);
+            return pipelineFinishTimeMs();
+        });
+    }
 
     // Создать проход рендеринга для пост-обраюотки
-    this->initPipelinePostProcess(vertexShaderCodeBytesPp,fragmentShaderCodeBytesPp);
-    std::cout << "Post-process graphics pipeline created." << std::endl;
+    pipelinePostProcessReady_ = pipelineThreadPool_->submit([=](){
+        PROFILE_SCOPE("VkRenderer::initPipelinePostProcess");
+        this->initPipelinePostProcess(vertexShaderCodeBytesPp, fragmentShaderCodeBytesPp);
+        return pipelineFinishTimeMs();
+    });
+    std::cout << "Graphics pipelines creation started (threads: " << pipelineThreadPool_->getThreadCount() << ")." << std::endl;
+
+    // Создать примитивы синхронизации (семафоры и барьеры кадров в полете)
+    this->initSyncPrimitives(maxFramesInFlight_);
+    swapChainImageFences_.resize(frameBuffersPrimary_.size(), nullptr);
+    std::cout << "Synchronization primitives created (frames in flight: " << maxFramesInFlight_ << ")." << std::endl;
 
-    // Создать примитивы синхронизации (семафоры)
-    semaphoreReadyToPresent_ = device_.getLogicalDevice()->createSemaphoreUnique({});
-    semaphoreReadyToRender_ = device_.getLogicalDevice()->createSemaphoreUnique({});
-    std::cout << "Synchronization semaphores created." << std::endl;
+    // Подготовить отсечение на GPU (вычислительный конвейер и буферы кадров)
+    this->initGpuCulling(computeShaderCodeBytesCulling, maxMeshes, maxFramesInFlight_);
+    if(pipelineGpuCulling_) std::cout << "GPU culling initialized." << std::endl;
+
+    // Буферы потока экземпляров
+    this->initInstanceBuffers(maxMeshes, maxFramesInFlight_);
+    std::cout << "Instance buffers created." << std::endl;
+
+    // Кольцевой буфер данных объектов (групп не больше, чем мешей - места хватит, даже если у всех мешей есть скелет)
+    this->initObjectUniforms(device_.getAlignedUboBlockSize(vk::scene::MESH_UNIFORM_SIZE) * maxMeshes, maxFramesInFlight_);
+    std::cout << "Object uniform ring created (" << objectUniformRing_.getFrameCapacity() << " bytes per frame)." << std::endl;
+
+    // Создать пул геометрии (общие буферы вершин и индексов, из которых выделяются геометрические буферы)
+    geometryPool_ = vk::resources::GeometryPool(&device_, GEOMETRY_POOL_BLOCK_VERTICES, GEOMETRY_POOL_BLOCK_INDEX_SIZE);
+    std::cout << "Geometry pool created." << std::endl;
 
     // Создать ресурсы по умолчанию
     unsigned char blackPixel[4] = {0,0,0,255};
     blackPixelTexture_ = this->createTextureBuffer(blackPixel,1,1,4,false,false);
+
     std::cout << "Default resources created." << std::endl;
 
     // Аллоцировать дескрипторный набор для передачи кадровых изображений в проход пост-обработки
@@ -1491,6 +3477,185 @@ useValidation_(true)
     std::cout << "Descriptor sets for passing frame-buffers to other render-pass shader initialized." << std::endl;
 }
 
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+/**
+ * Конструктор
+ * @param hInstance Экземпляр WinApi приложения
+ * @param hWnd Дескриптор окна WinApi
+ * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
+ * @param fragmentShaderCodeBytes Rод фрагментного шейдера (байты)
+ * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+ * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
+ * @param maxMeshes Максимальное кол-во мешей
+ * @param maxFramesInFlight Максимальное кол-во кадров, обрабатываемых одновременно (CPU готовит следующий кадр пока GPU рисует текущий)
+ * @param recordingThreads Кол-во потоков записи команд (0 - по кол-ву аппаратных потоков)
+ * @param presentPolicy Параметры показа кадров (режим, кол-во изображений swap-chain)
+ * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
+ */
+VkRenderer::VkRenderer(HINSTANCE hInstance,
+        HWND hWnd,
+        const std::vector<unsigned char>& vertexShaderCodeBytes,
+        const std::vector<unsigned char>& fragmentShaderCodeBytes,
+        const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+        const std::vector<unsigned char>& computeShaderCodeBytesCulling,
+        const std::vector<unsigned char>& vertexShaderCodeBytesPp,
+        const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
+        size_t maxMeshes,
+        size_t maxFramesInFlight,
+        size_t recordingThreads,
+        const VkRendererPresentPolicy& presentPolicy,
+        const std::string& pipelineCachePath):
+isEnabled_(true),
+inputDataInOpenGlStyle_(true),
+useValidation_(true),
+isHeadless_(false),
+presentPolicy_(presentPolicy),
+swapChainPresentMode_(vk::PresentModeKHR::eFifo),
+swapChainOutdated_(false),
+maxMeshes_(maxMeshes),
+maxFramesInFlight_(maxFramesInFlight),
+currentFrame_(0),
+recordingSlotCount_(recordingThreads > 0 ? recordingThreads : std::max<size_t>(1, std::thread::hardware_concurrency())),
+gpuCullingCompact_(false),
+gpuCullingMaxDrawCount_(1),
+gpuCullingBatchesDirty_(false),
+depthPrePassEnabled_(false),
+frustumCullingEnabled_(true),
+gpuCullingEnabled_(false),
+gpuCullingActive_(false),
+uploadsReadyTicket_(0),
+instancingEnabled_(true),
+drawSortingEnabled_(true),
+lodEnabled_(true),
+lodSettings_(),
+statFramesRendered_(0),
+statCpuFrameTimeUs_(0),
+statFenceWaitTimeUs_(0),
+statLatencySamples_(0),
+statLatencyTotalUs_(0),
+statLatencyMaxUs_(0),
+statSceneMeshes_(0),
+statVisibleMeshes_(0),
+statDrawCalls_(0),
+statTriangles_(0),
+statStateBinds_(0),
+statStateBindsSkipped_(0),
+inputPending_(false),
+pipelineCreationTimeMs_(0.0),
+pipelineVariantUsage_(PIPELINE_PRIMARY_VARIANT_COUNT, 0),
+meshSlotKeysDepthPrePass_(false),
+frameNumber_(0),
+lastFrameBufferIndex_(0)
+{
+    // Хотя бы один кадр должен обрабатываться
+    if(maxFramesInFlight_ == 0){
+        throw vk::InitializationFailedError("Can't initialize renderer. Frames in flight count can't be zero");
+    }
+
+    // Инициализация экземпляра Vulkan
+    this->initInstance();
+
+    // Создание поверхности отображения на окне
+    this->surface_ = vulkanInstance_->createWin32SurfaceKHRUnique(vk::Win32SurfaceCreateInfoKHR({},hInstance,hWnd));
+    std::cout << "Surface created." << std::endl;
+
+    // Создание устройства
+    this->initDevice();
+
+    // Создание всех остальных ресурсов
+    this->initRenderingResources(vertexShaderCodeBytes, fragmentShaderCodeBytes, vertexShaderCodeBytesDepth,
+            computeShaderCodeBytesCulling, vertexShaderCodeBytesPp, fragmentShaderCodeBytesPp, maxMeshes, pipelineCachePath);
+}
+#endif
+
+/**
+ * Конструктор внеэкранного рендерера (без окна, поверхности и swap-chain)
+ * @param width Ширина кадра
+ * @param height Высота кадра
+ * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
+ * @param fragmentShaderCodeBytes Rод фрагментного шейдера (байты)
+ * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+ * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
+ * @param maxMeshes Максимальное кол-во мешей
+ * @param maxFramesInFlight Максимальное кол-во кадров, обрабатываемых одновременно (равно кол-ву внеэкранных кадровых буферов)
+ * @param recordingThreads Кол-во потоков записи команд (0 - по кол-ву аппаратных потоков)
+ * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
+ */
+VkRenderer::VkRenderer(uint32_t width,
+        uint32_t height,
+        const std::vector<unsigned char>& vertexShaderCodeBytes,
+        const std::vector<unsigned char>& fragmentShaderCodeBytes,
+        const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+        const std::vector<unsigned char>& computeShaderCodeBytesCulling,
+        const std::vector<unsigned char>& vertexShaderCodeBytesPp,
+        const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
+        size_t maxMeshes,
+        size_t maxFramesInFlight,
+        size_t recordingThreads,
+        const std::string& pipelineCachePath):
+isEnabled_(true),
+inputDataInOpenGlStyle_(true),
+useValidation_(false),
+isHeadless_(true),
+offscreenExtent_(width, height),
+swapChainPresentMode_(vk::PresentModeKHR::eFifo),
+swapChainOutdated_(false),
+maxMeshes_(maxMeshes),
+maxFramesInFlight_(maxFramesInFlight),
+currentFrame_(0),
+recordingSlotCount_(recordingThreads > 0 ? recordingThreads : std::max<size_t>(1, std::thread::hardware_concurrency())),
+gpuCullingCompact_(false),
+gpuCullingMaxDrawCount_(1),
+gpuCullingBatchesDirty_(false),
+depthPrePassEnabled_(false),
+frustumCullingEnabled_(true),
+gpuCullingEnabled_(false),
+gpuCullingActive_(false),
+uploadsReadyTicket_(0),
+instancingEnabled_(true),
+drawSortingEnabled_(true),
+lodEnabled_(true),
+lodSettings_(),
+statFramesRendered_(0),
+statCpuFrameTimeUs_(0),
+statFenceWaitTimeUs_(0),
+statLatencySamples_(0),
+statLatencyTotalUs_(0),
+statLatencyMaxUs_(0),
+statSceneMeshes_(0),
+statVisibleMeshes_(0),
+statDrawCalls_(0),
+statTriangles_(0),
+statStateBinds_(0),
+statStateBindsSkipped_(0),
+inputPending_(false),
+pipelineCreationTimeMs_(0.0),
+pipelineVariantUsage_(PIPELINE_PRIMARY_VARIANT_COUNT, 0),
+meshSlotKeysDepthPrePass_(false),
+frameNumber_(0),
+lastFrameBufferIndex_(0)
+{
+    // Хотя бы один кадр должен обрабатываться
+    if(maxFramesInFlight_ == 0){
+        throw vk::InitializationFailedError("Can't initialize renderer. Frames in flight count can't be zero");
+    }
+
+    // Разрешение кадра должно быть ненулевым
+    if(width == 0 || height == 0){
+        throw vk::InitializationFailedError("Can't initialize renderer. Offscreen frame size can't be zero");
+    }
+
+    // Инициализация экземпляра Vulkan (без расширений поверхности)
+    this->initInstance();
+
+    // Создание устройства (поверхности нет)
+    this->initDevice();
+
+    // Создание всех остальных ресурсов
+    this->initRenderingResources(vertexShaderCodeBytes, fragmentShaderCodeBytes, vertexShaderCodeBytesDepth,
+            computeShaderCodeBytesCulling, vertexShaderCodeBytesPp, fragmentShaderCodeBytesPp, maxMeshes, pipelineCachePath);
+}
+
 /**
  * Деструктор
  */
@@ -1506,12 +3671,24 @@ VkRenderer::~VkRenderer()
     blackPixelTexture_->destroyVulkanResources();
     std::cout << "Default resources destroyed." << std::endl;
 
+    // Уничтожение профилировщика GPU (пулов запросов)
+    gpuProfiler_.destroyVulkanResources();
+
+    // Уничтожение буферов потока экземпляров
+    this->deInitInstanceBuffers();
+
+    // Уничтожение кольцевого буфера данных объектов
+    this->deInitObjectUniforms();
+
+    // Уничтожение ресурсов отсечения на GPU
+    this->deInitGpuCulling();
+
     // Удалить примитивы синхронизации
-    device_.getLogicalDevice()->destroySemaphore(semaphoreReadyToRender_.get());
-    device_.getLogicalDevice()->destroySemaphore(semaphoreReadyToPresent_.get());
-    semaphoreReadyToRender_.release();
-    semaphoreReadyToPresent_.release();
-    std::cout << "Synchronization semaphores destroyed." << std::endl;
+    this->deInitSyncPrimitives();
+    std::cout << "Synchronization primitives destroyed." << std::endl;
+
+    // Дождаться завершения задач создания конвейеров (если конвейеры так и не были использованы)
+    pipelineThreadPool_.reset();
 
     // Уничтожение конвейера пост-обоаботки
     this->deInitPipelinePostProcess();
@@ -1521,6 +3698,11 @@ VkRenderer::~VkRenderer()
     this->deInitPipelinePrimary();
     std::cout << "Main graphics pipeline destroyed." << std::endl;
 
+    // Сохранить данные кэша конвейеров для следующего запуска и уничтожить кэш
+    if(pipelineCache_.save()) std::cout << "Pipeline cache saved." << std::endl;
+    pipelineCache_.destroyVulkanResources();
+    std::cout << "Pipeline cache destroyed." << std::endl;
+
     // Очистить все ресурсы мешей
     this->freeMeshes();
     std::cout << "All allocated meshes data freed." << std::endl;
@@ -1547,6 +3729,11 @@ VkRenderer::~VkRenderer()
     commandBuffers_.clear();
     std::cout << "Command-buffers freed." << std::endl;
 
+    // Остановка потоков записи и освобождение вторичных командных буферов
+    recordingThreadPool_.reset();
+    this->deInitSecondaryCommandBuffers();
+    std::cout << "Secondary command-buffers freed." << std::endl;
+
     // Де-инициализация кадровых буферов для пост-процессинга
     this->deInitFrameBuffersPostProcess();
     std::cout << "Post-process frame-buffers destroyed." << std::endl;
@@ -1556,8 +3743,10 @@ VkRenderer::~VkRenderer()
     std::cout << "Primary frame-buffers destroyed." << std::endl;
 
     // Уничтожение цепочки показа (swap-chain)
-    this->deInitSwapChain();
-    std::cout << "Swap-chain destroyed." << std::endl;
+    if(swapChainKhr_){
+        this->deInitSwapChain();
+        std::cout << "Swap-chain destroyed." << std::endl;
+    }
 
     // Де-инициализация прохода
     this->deInitRenderPassPrimary();
@@ -1567,18 +3756,22 @@ VkRenderer::~VkRenderer()
     this->freeTextureBuffers();
     std::cout << "All allocated texture buffers freed." << std::endl;
 
-    // Очистить все выделенные буферы геометрии
+    // Очистить все выделенные буферы геометрии (вернуть участки пулу) и сам пул
     this->freeGeometryBuffers();
     std::cout << "All allocated geometry buffers freed." << std::endl;
+    geometryPool_.destroyVulkanResources();
+    std::cout << "Geometry pool destroyed." << std::endl;
 
     // Уничтожение устройства
     device_.destroyVulkanResources();
     std::cout << "Device destroyed." << std::endl;
 
     // Уничтожение поверхности
-    vulkanInstance_->destroySurfaceKHR(surface_.get());
-    surface_.release();
-    std::cout << "Surface destroyed." << std::endl;
+    if(surface_){
+        vulkanInstance_->destroySurfaceKHR(surface_.get());
+        surface_.release();
+        std::cout << "Surface destroyed." << std::endl;
+    }
 
     // Уничтожение debug report callback'а (если был создан)
     if(useValidation_){
@@ -1618,15 +3811,14 @@ void VkRenderer::setRenderingStatus(bool isEnabled) noexcept
  */
 void VkRenderer::onSurfaceChanged()
 {
+    // Во внеэкранном режиме поверхности нет
+    if(isHeadless_){
+        return;
+    }
+
     // Приостановить рендеринг
     this->setRenderingStatus(false);
 
-    // Командные буферы чисто логически не зависят от swap-chain, но их кол-во определяется кол-вом изображений swap-chain
-    // Кол-во изображений swap-chain может зависеть от особенностей поверхности
-    device_.getLogicalDevice()->freeCommandBuffers(device_.getCommandGfxPool().get(),commandBuffers_);
-    commandBuffers_.clear();
-    std::cout << "Command-buffers freed." << std::endl;
-
     // Де-инициализация кадровых буферов для пост-процессинга
     this->deInitFrameBuffersPostProcess();
     std::cout << "Post-process frame-buffers destroyed." << std::endl;
@@ -1636,13 +3828,19 @@ void VkRenderer::onSurfaceChanged()
     std::cout << "Primary frame-buffers destroyed." << std::endl;
 
     // Ре-инициализация swap-chain (старый swap-chain уничтожается)
-    this->initSwapChain({vk::Format::eB8G8R8A8Unorm,vk::ColorSpaceKHR::eSrgbNonlinear});
-    std::cout << "Swap-chain re-created." << std::endl;
+    this->initSwapChain({vk::Format::eB8G8R8A8Unorm,vk::ColorSpaceKHR::eSrgbNonlinear}, presentPolicy_);
+    std::cout << "Swap-chain re-created (" << vk::to_string(swapChainPresentMode_) << ")." << std::endl;
 
     // Создание основных кадровых буферов
     this->initFrameBuffersPrimary(vk::Format::eR16G16B16A16Sfloat, vk::Format::eD32SfloatS8Uint);
     std::cout << "Primary frame-buffers initialized (" << frameBuffersPrimary_.size() << ") [" << frameBuffersPrimary_[0].getExtent().width << " x " << frameBuffersPrimary_[0].getExtent().height << "]" << std::endl;
 
+    // Если кол-во изображений изменилось (например, сменились параметры показа) - выделить наборы заново
+    if(frameBuffersPrimaryDescriptorSets_.size() != frameBuffersPrimary_.size()){
+        device_.getLogicalDevice()->freeDescriptorSets(descriptorPoolImagesToPostProcess_.get(), frameBuffersPrimaryDescriptorSets_);
+        this->allocateFrameBuffersPrimaryDescriptorSets(descriptorPoolImagesToPostProcess_, descriptorSetLayoutImagesToPostProcess_);
+    }
+
     // Обновить дескрипторные наборы кадровых буферов (используемые при пост-процессинге)
     this->updateFrameBuffersPrimaryDescriptorSets();
     std::cout << "Primary frame-buffers descriptor sets updated" << std::endl;
@@ -1654,13 +3852,9 @@ void VkRenderer::onSurfaceChanged()
     // Изменить пропорции камеры
     camera_.setAspectRatio(static_cast<glm::float32>(frameBuffersPrimary_[0].getExtent().width) / static_cast<glm::float32>(frameBuffersPrimary_[0].getExtent().height));
 
-    // Инициализация командных буферов
-    auto allocInfo = vk::CommandBufferAllocateInfo(device_.getCommandGfxPool().get(), vk::CommandBufferLevel::ePrimary, frameBuffersPrimary_.size());
-    commandBuffers_ = device_.getLogicalDevice()->allocateCommandBuffers(allocInfo);
-    std::cout << "Command-buffers allocated (" << commandBuffers_.size() << ")." << std::endl;
-
-    // Командные буферы нужно обновить
-    isCommandsReady_ = false;
+    // Кол-во изображений swap-chain может зависеть от особенностей поверхности (командные буферы от него не зависят,
+    // но отслеживание использования изображений нужно начать заново - все кадры завершены)
+    swapChainImageFences_.assign(frameBuffersPrimary_.size(), nullptr);
 
     // Возобновить рендеринг
     this->setRenderingStatus(true);
@@ -1670,11 +3864,18 @@ void VkRenderer::onSurfaceChanged()
  * Создание геометрического буфера
  * @param vertices Массив вершин
  * @param indices Массив индексов
+ * @param positionStream Создать отдельный поток положений (нужен для участия в пред-проходе глубины)
+ * @param lodIndices Массивы индексов упрощенных уровней детализации (от подробного к грубому)
+ * @param lodErrors Геометрические ошибки упрощенных уровней детализации
  * @return Shared smart pointer на объект буфера
  */
-vk::resources::GeometryBufferPtr VkRenderer::createGeometryBuffer(const std::vector<vk::tools::Vertex> &vertices, const std::vector<uint32_t> &indices)
+vk::resources::GeometryBufferPtr VkRenderer::createGeometryBuffer(const std::vector<vk::tools::Vertex> &vertices,
+        const std::vector<uint32_t> &indices,
+        bool positionStream,
+        const std::vector<std::vector<uint32_t>> &lodIndices,
+        const std::vector<float> &lodErrors)
 {
-    auto buffer = std::make_shared<vk::resources::GeometryBuffer>(&device_,vertices,indices);
+    auto buffer = std::make_shared<vk::resources::GeometryBuffer>(&geometryPool_,vertices,indices,positionStream,lodIndices,lodErrors);
     geometryBuffers_.push_back(buffer);
     return buffer;
 }
@@ -1708,30 +3909,26 @@ vk::scene::MeshPtr VkRenderer::addMeshToScene(
         const vk::resources::GeometryBufferPtr& geometryBuffer,
         const vk::scene::MeshTextureSet& textureSet,
         const vk::scene::MeshMaterialSettings& materialSettings,
-        const vk::scene::MeshTextureMapping& textureMapping)
-{
-    // Создание меша
-    auto mesh = std::make_shared<vk::scene::Mesh>(&device_,descriptorPoolMeshes_,descriptorSetLayoutMeshes_,geometryBuffer, blackPixelTexture_, textureSet, materialSettings, textureMapping);
-
-    // Добавляем в список мешей сцены
-    sceneMeshes_.push_back(mesh);
-
-    // Необходимо обновить командные буферы (изменились отображаемые меши)
-    // Для этого ставим рендеринг на паузу и дожидаемся исполнения всех команд в очередях
-    this->isEnabled_ = false;
-    device_.getGraphicsQueue().waitIdle();
-    device_.getPresentQueue().waitIdle();
-
-    // Очищаем командные буферы от старых команд
-    for(auto& cmdBuffer : commandBuffers_){
-        cmdBuffer.reset({});
+        const vk::scene::MeshTextureMapping& textureMapping)
+{
+    // Буферы экземпляров и данных отсечения рассчитаны на maxMeshes_ мешей (учитываются изменения следующей границы кадра).
+    // Удаление уменьшает кол-во, только если меш действительно на сцене (повторно в очередь удаления меш не попадает)
+    size_t removedCount = 0;
+    for(const auto& meshPtr : pendingMeshesToRemove_){
+        if(this->isMeshOnScene(meshPtr)) removedCount++;
     }
+    if(sceneMeshes_.size() + pendingMeshesToAdd_.size() - removedCount >= maxMeshes_){
+        throw vk::TooManyObjectsError("Can't add mesh to scene. Maximum mesh count reached");
+    }
+
+    // Создание меша
+    auto mesh = std::make_shared<vk::scene::Mesh>(&device_,geometryBuffer, blackPixelTexture_, textureSet, materialSettings, textureMapping);
 
-    // Даем знать что командные буферы нужно обновить при следующем вызове draw
-    isCommandsReady_ = false;
+    // Начать создание варианта конвейера для меша заранее (к моменту первой отрисовки он, скорее всего, будет готов)
+    this->requestPipelinePrimaryVariant(this->getPipelinePrimaryVariant(mesh));
 
-    // Возобновляем рендеринг
-    this->isEnabled_ = true;
+    // Меш будет добавлен в список мешей сцены на границе кадра (без ожидания GPU)
+    pendingMeshesToAdd_.push_back(mesh);
 
     return mesh;
 }
@@ -1742,29 +3939,25 @@ vk::scene::MeshPtr VkRenderer::addMeshToScene(
  */
 void VkRenderer::removeMeshFromScene(const vk::scene::MeshPtr& meshPtr)
 {
-    // Приостановить рендеринг
-    this->isEnabled_ = false;
-    device_.getGraphicsQueue().waitIdle();
-    device_.getPresentQueue().waitIdle();
+    if(meshPtr == nullptr) return;
 
-    // Удаляем меш из списка
-    sceneMeshes_.erase(std::remove_if(sceneMeshes_.begin(), sceneMeshes_.end(), [&](const vk::scene::MeshPtr& meshEntryPtr){
-        return meshPtr.get() == meshEntryPtr.get();
-    }), sceneMeshes_.end());
-
-    // Очищаем командные буферы от старых команд
-    for(auto& cmdBuffer : commandBuffers_){
-        cmdBuffer.reset({});
+    // Если меш еще не попал на сцену - достаточно убрать его из очереди добавления
+    auto pendingIt = std::find(pendingMeshesToAdd_.begin(), pendingMeshesToAdd_.end(), meshPtr);
+    if(pendingIt != pendingMeshesToAdd_.end()){
+        pendingMeshesToAdd_.erase(pendingIt);
+        meshesToRelease_.emplace_back(meshPtr, frameNumber_);
+        return;
     }
 
-    // Даем знать что командные буферы нужно обновить при следующем вызове draw
-    isCommandsReady_ = false;
-
-    // Возобновляем рендеринг
-    this->isEnabled_ = true;
+    // Меш не на сцене или уже ожидает удаления - удалять нечего (иначе его ресурсы были бы освобождены повторно)
+    if(!this->isMeshOnScene(meshPtr) ||
+       std::find(pendingMeshesToRemove_.begin(), pendingMeshesToRemove_.end(), meshPtr) != pendingMeshesToRemove_.end()){
+        return;
+    }
 
-    // Очищаем выделенные ресурсы меша
-    meshPtr->destroyVulkanResources();
+    // Меш будет удален из списка мешей сцены на границе кадра, а его ресурсы освобождены после завершения
+    // использовавших его кадров
+    pendingMeshesToRemove_.push_back(meshPtr);
 }
 
 /**
@@ -1812,191 +4005,595 @@ vk::scene::Camera* VkRenderer::getCameraPtr(){
     return &camera_;
 }
 
+/**
+ * Получить статистику кадров (с момента последнего сброса)
+ * @return Структура статистики
+ */
+VkRendererFrameStatistics VkRenderer::getFrameStatistics() const
+{
+    VkRendererFrameStatistics statistics{};
+    statistics.framesRendered = statFramesRendered_;
+    statistics.framesInFlight = maxFramesInFlight_;
+
+    if(statFramesRendered_ > 0){
+        statistics.avgCpuFrameTimeMs = (static_cast<double>(statCpuFrameTimeUs_) / static_cast<double>(statFramesRendered_)) / 1000.0;
+        statistics.avgFenceWaitTimeMs = (static_cast<double>(statFenceWaitTimeUs_) / static_cast<double>(statFramesRendered_)) / 1000.0;
+        statistics.avgSceneMeshes = static_cast<double>(statSceneMeshes_) / static_cast<double>(statFramesRendered_);
+        statistics.avgVisibleMeshes = static_cast<double>(statVisibleMeshes_) / static_cast<double>(statFramesRendered_);
+        statistics.avgDrawCalls = static_cast<double>(statDrawCalls_) / static_cast<double>(statFramesRendered_);
+        statistics.avgTriangles = static_cast<double>(statTriangles_) / static_cast<double>(statFramesRendered_);
+        statistics.avgStateBinds = static_cast<double>(statStateBinds_.load()) / static_cast<double>(statFramesRendered_);
+        statistics.avgStateBindsSkipped = static_cast<double>(statStateBindsSkipped_.load()) / static_cast<double>(statFramesRendered_);
+    }
+
+    statistics.latencySamples = statLatencySamples_;
+    if(statLatencySamples_ > 0){
+        statistics.avgInputToPresentLatencyMs = (static_cast<double>(statLatencyTotalUs_) / static_cast<double>(statLatencySamples_)) / 1000.0;
+        statistics.maxInputToPresentLatencyMs = static_cast<double>(statLatencyMaxUs_) / 1000.0;
+    }
+
+    return statistics;
+}
+
+/**
+ * Сбросить накопленную статистику кадров
+ */
+void VkRenderer::resetFrameStatistics()
+{
+    statFramesRendered_ = 0;
+    statCpuFrameTimeUs_ = 0;
+    statFenceWaitTimeUs_ = 0;
+    statLatencySamples_ = 0;
+    statLatencyTotalUs_ = 0;
+    statLatencyMaxUs_ = 0;
+    statSceneMeshes_ = 0;
+    statVisibleMeshes_ = 0;
+    statDrawCalls_ = 0;
+    statTriangles_ = 0;
+    statStateBinds_ = 0;
+    statStateBindsSkipped_ = 0;
+}
+
+/**
+ * Включить профилирование GPU (время и статистика конвейера проходов)
+ * @param perDrawTimestamps Записывать временные метки отдельных вызовов отрисовки основного прохода
+ * @param csvPath Путь к CSV файлу для записи результатов каждого кадра (пустая строка - без записи)
+ */
+void VkRenderer::enableGpuProfiler(bool perDrawTimestamps, const std::string& csvPath)
+{
+    // Пулы запросов могут использоваться незавершенными кадрами - дождаться их
+    bool wasEnabled = isEnabled_;
+    this->setRenderingStatus(false);
+
+    gpuProfiler_ = vk::tools::GpuProfiler(&device_, maxFramesInFlight_, perDrawTimestamps ? static_cast<uint32_t>(maxMeshes_) : 0, csvPath);
+    std::cout << "GPU profiler enabled (pipeline statistics: " << (gpuProfiler_.isPipelineStatisticsEnabled() ? "yes" : "no") << ")." << std::endl;
+
+    this->setRenderingStatus(wasEnabled);
+}
+
+/**
+ * Выключить профилирование GPU
+ */
+void VkRenderer::disableGpuProfiler()
+{
+    bool wasEnabled = isEnabled_;
+    this->setRenderingStatus(false);
+
+    gpuProfiler_.destroyVulkanResources();
+
+    this->setRenderingStatus(wasEnabled);
+}
+
+/**
+ * Получить последние результаты профилирования GPU
+ * @return Константная ссылка на результаты кадра
+ */
+const vk::tools::GpuFrameProfile& VkRenderer::getGpuProfile() const
+{
+    return gpuProfiler_.getLatestProfile();
+}
+
+/**
+ * Дождаться завершения задачи создания конвейера
+ * @param pipelineReady Future задачи (после ожидания становится пустым, повторные вызовы ничего не делают)
+ * @param name Название конвейера (для вывода)
+ *
+ * @details Исключение, возникшее при создании конвейера в потоке пула, пробрасывается в вызывающий поток
+ */
+void VkRenderer::waitForPipeline(std::future<double>& pipelineReady, const std::string& name)
+{
+    if(!pipelineReady.valid()) return;
+
+    PROFILE_SCOPE("VkRenderer::waitForPipeline");
+
+    const double finishTimeMs = pipelineReady.get();
+    pipelineCreationTimeMs_ = (std::max)(pipelineCreationTimeMs_, finishTimeMs);
+    std::cout << name << " created in " << finishTimeMs << " ms (" << (pipelineCache_.isWarm() ? "warm" : "cold") << " start)." << std::endl;
+}
+
+/**
+ * Получить время создания графических конвейеров при инициализации
+ * @return Время (мс)
+ */
+double VkRenderer::getPipelineCreationTimeMs() const
+{
+    return pipelineCreationTimeMs_;
+}
+
+/**
+ * Дождаться создания всех графических конвейеров
+ */
+void VkRenderer::waitForPipelines()
+{
+    for(uint32_t variant = 0; variant < pipelinesPrimaryReady_.size(); variant++){
+        this->waitForPipeline(pipelinesPrimaryReady_[variant], "Main graphics pipeline (variant " + std::to_string(variant) + ")");
+    }
+    for(auto& pipelineReady : pipelinesDepthPrePassReady_){
+        this->waitForPipeline(pipelineReady, "Depth pre-pass pipeline");
+    }
+    this->waitForPipeline(pipelinePostProcessReady_, "Post-process graphics pipeline");
+}
+
+/**
+ * Отправить записанные загрузки ресурсов и дождаться их завершения
+ */
+void VkRenderer::waitForUploads()
+{
+    device_.getUploadManager()->waitIdle();
+}
+
+/**
+ * Был ли кэш конвейеров загружен из файла при инициализации ("теплый" запуск)
+ * @return Да или нет
+ */
+bool VkRenderer::isPipelineCacheWarm() const
+{
+    return pipelineCache_.isWarm();
+}
+
+/**
+ * Включить или выключить пред-проход глубины
+ * @param enabled Включен ли пред-проход
+ *
+ * @details Нужные варианты основного конвейера запрашиваются при подготовке следующего кадра (см. waitForScenePipelines)
+ */
+void VkRenderer::setDepthPrePassEnabled(bool enabled)
+{
+    depthPrePassEnabled_ = enabled;
+}
+
+/**
+ * Включен ли пред-проход глубины
+ * @return Да или нет
+ */
+bool VkRenderer::isDepthPrePassEnabled() const
+{
+    return depthPrePassEnabled_;
+}
+
+/**
+ * Включить или выключить отсечение мешей по пирамиде видимости
+ * @param enabled Включено ли отсечение
+ */
+void VkRenderer::setFrustumCullingEnabled(bool enabled)
+{
+    frustumCullingEnabled_ = enabled;
+}
+
+/**
+ * Включено ли отсечение мешей по пирамиде видимости
+ * @return Да или нет
+ */
+bool VkRenderer::isFrustumCullingEnabled() const
+{
+    return frustumCullingEnabled_;
+}
+
+/**
+ * Включить или выключить отсечение на GPU
+ * @param enabled Включено ли отсечение
+ */
+void VkRenderer::setGpuCullingEnabled(bool enabled)
+{
+    gpuCullingEnabled_ = enabled;
+}
+
+/**
+ * Включено ли отсечение на GPU
+ * @return Да или нет
+ */
+bool VkRenderer::isGpuCullingEnabled() const
+{
+    return gpuCullingEnabled_;
+}
+
+/**
+ * Доступно ли отсечение на GPU (поддерживает ли устройство непрямое рисование с ненулевым первым экземпляром)
+ * @return Да или нет
+ */
+bool VkRenderer::isGpuCullingAvailable() const
+{
+    return static_cast<bool>(pipelineGpuCulling_);
+}
+
+/**
+ * Включить или выключить инстансинг
+ * @param enabled Включен ли инстансинг
+ */
+void VkRenderer::setInstancingEnabled(bool enabled)
+{
+    instancingEnabled_ = enabled;
+}
+
+/**
+ * Включен ли инстансинг
+ * @return Да или нет
+ */
+bool VkRenderer::isInstancingEnabled() const
+{
+    return instancingEnabled_;
+}
+
+/**
+ * Включить или выключить сортировку списка отрисовки
+ * @param enabled Включена ли сортировка
+ */
+void VkRenderer::setDrawSortingEnabled(bool enabled)
+{
+    drawSortingEnabled_ = enabled;
+}
+
+/**
+ * Включена ли сортировка списка отрисовки
+ * @return Да или нет
+ */
+bool VkRenderer::isDrawSortingEnabled() const
+{
+    return drawSortingEnabled_;
+}
+
+/**
+ * Включить или выключить выбор уровней детализации мешей
+ * @param enabled Включен ли выбор уровней
+ */
+void VkRenderer::setLodEnabled(bool enabled)
+{
+    lodEnabled_ = enabled;
+}
+
+/**
+ * Включен ли выбор уровней детализации мешей
+ * @return Да или нет
+ */
+bool VkRenderer::isLodEnabled() const
+{
+    return lodEnabled_;
+}
+
+/**
+ * Установить параметры выбора уровней детализации
+ * @param settings Параметры
+ */
+void VkRenderer::setLodSettings(const VkRendererLodSettings& settings)
+{
+    lodSettings_ = settings;
+}
+
+/**
+ * Получить параметры выбора уровней детализации
+ * @return Константная ссылка на структуру
+ */
+const VkRendererLodSettings& VkRenderer::getLodSettings() const
+{
+    return lodSettings_;
+}
+
+/**
+ * Сменить параметры показа кадров
+ * @param presentPolicy Параметры показа
+ */
+void VkRenderer::setPresentPolicy(const VkRendererPresentPolicy& presentPolicy)
+{
+    presentPolicy_ = presentPolicy;
+    nextFrameTime_ = std::chrono::high_resolution_clock::time_point();
+
+    // Пересоздать swap-chain с новыми параметрами (во внеэкранном режиме действует только ограничение частоты кадров)
+    this->onSurfaceChanged();
+}
+
+/**
+ * Получить параметры показа кадров
+ * @return Константная ссылка на структуру параметров
+ */
+const VkRendererPresentPolicy& VkRenderer::getPresentPolicy() const
+{
+    return presentPolicy_;
+}
+
+/**
+ * Сообщить о событии ввода (для замера задержки от ввода до показа)
+ */
+void VkRenderer::notifyInputEvent()
+{
+    // Учитывается самое раннее событие, еще не отраженное ни в одном кадре
+    if(!inputPending_){
+        inputPending_ = true;
+        inputPendingTime_ = std::chrono::high_resolution_clock::now();
+    }
+}
+
 /**
  * Рендеринг кадра
+ *
+ * @details Одновременно может обрабатываться до maxFramesInFlight_ кадров. Перед записью кадра ожидается барьер,
+ * взводимый по завершении его предыдущего использования, поэтому командный буфер и блоки UBO кадра можно безопасно перезаписать
  */
 void VkRenderer::draw()
 {
+    PROFILE_SCOPE("VkRenderer::draw");
+
     // Если рендеринг не включен - выход
     if(!isEnabled_){
         return;
     }
 
-    // П О Д Г О Т О В К А  К О М А Н Д
+    // Ограничение частоты кадров (режим экономии энергии) - дождаться момента начала кадра
+    if(presentPolicy_.mode == VkRendererPresentMode::ePowerSaving && presentPolicy_.frameRateLimit > 0){
+        auto now = std::chrono::high_resolution_clock::now();
+        if(now < nextFrameTime_){
+            std::this_thread::sleep_until(nextFrameTime_);
+        }
+        nextFrameTime_ = (std::max)(now, nextFrameTime_) + std::chrono::microseconds(1000000 / presentPolicy_.frameRateLimit);
+    }
+
+    // Время начала работы над кадром
+    auto frameStartTime = std::chrono::high_resolution_clock::now();
+
+    // О Ж И Д А Н И Е  К А Д Р А
 
-    // Если командные буферы не готовы - заполнить их командами
-    if(!isCommandsReady_)
+    // Дождаться завершения команд, ранее отправленных для этого кадра (ресурсы кадра освобождаются)
+    const vk::Fence frameFence = frameFences_[currentFrame_].get();
     {
-        // Описываем очистку вложений
-        std::vector<vk::ClearValue> clearValues(2);
-        clearValues[0].color = vk::ClearColorValue( std::array<float, 4>({ 0.0f, 0.0f, 0.0f, 1.0f }));
-        clearValues[1].depthStencil = vk::ClearDepthStencilValue( 1.0f, 0 );
-
-        // Описываем начало прохода
-        vk::RenderPassBeginInfo renderPassBeginInfo{};
-        renderPassBeginInfo.pNext = nullptr;
-        renderPassBeginInfo.renderArea.offset.x = 0;
-        renderPassBeginInfo.renderArea.offset.y = 0;
-        renderPassBeginInfo.renderArea.extent.width = frameBuffersPrimary_[0].getExtent().width;
-        renderPassBeginInfo.renderArea.extent.height = frameBuffersPrimary_[0].getExtent().height;
-        renderPassBeginInfo.clearValueCount = clearValues.size();
-        renderPassBeginInfo.pClearValues = clearValues.data();
-
-        // Размеры области вида
-        auto viewPortExtent = frameBuffersPrimary_[0].getExtent();
-
-        // Область вида - динамическое состояние
-        vk::Viewport viewport{};
-        viewport.setX(0.0f);
-        viewport.setWidth(static_cast<float>(viewPortExtent.width));
-        viewport.setY(inputDataInOpenGlStyle_ ? static_cast<float>(viewPortExtent.height) : 0.0f);
-        viewport.setHeight(inputDataInOpenGlStyle_ ? -static_cast<float>(viewPortExtent.height) : static_cast<float>(viewPortExtent.height));
-        viewport.setMinDepth(0.0f);
-        viewport.setMaxDepth(1.0f);
-
-        // Параметры ножниц (динамическое состояние)
-        vk::Rect2D scissors{};
-        scissors.offset.x = 0;
-        scissors.offset.y = 0;
-        scissors.extent.width = viewPortExtent.width;
-        scissors.extent.height = viewPortExtent.height;
-
-
-        // Подготовка команд (запись в командные буферы)
-        for(size_t i = 0; i < commandBuffers_.size(); ++i)
-        {
-            // Начинаем работу с командным буфером (запись команд)
-            vk::CommandBufferBeginInfo commandBufferBeginInfo{};
-            commandBufferBeginInfo.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse;
-            commandBufferBeginInfo.pNext = nullptr;
-            commandBuffers_[i].begin(commandBufferBeginInfo);
+        PROFILE_SCOPE("VkRenderer::draw/waitForFence");
+        (void)device_.getLogicalDevice()->waitForFences({frameFence}, VK_TRUE, UINT64_MAX);
+    }
+    auto fenceWaitEndTime = std::chrono::high_resolution_clock::now();
 
-            /// Основной проход
+    // Индекс доступного изображения (во внеэкранном режиме у каждого кадра в полете свой кадровый буфер)
+    auto availableImageIndex = static_cast<uint32_t>(currentFrame_);
 
+    if(!isHeadless_)
+    {
+        PROFILE_SCOPE("VkRenderer::draw/acquire");
 
-            // Сменить целевой кадровый буфер и начать работу с проходом (это очистит вложения)
-            renderPassBeginInfo.renderPass = renderPassPrimary_.get();
-            renderPassBeginInfo.framebuffer = frameBuffersPrimary_[i].getVulkanFrameBuffer().get();
-            commandBuffers_[i].beginRenderPass(renderPassBeginInfo,vk::SubpassContents::eInline);
+        // Получить индекс доступного для рендеринга изображения и взвести семафор готовности к рендерингу
+        vk::Result acquireResult = device_.getLogicalDevice()->acquireNextImageKHR(
+                swapChainKhr_.get(),
+                presentPolicy_.acquireTimeoutNs,
+                semaphoresReadyToRender_[currentFrame_].get(),
+                {},
+                &availableImageIndex);
 
-            // Привязать графический конвейер
-            commandBuffers_[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelinePrimary_.get());
+        switch(acquireResult)
+        {
+            // Изображение получено
+            case vk::Result::eSuccess:
+                break;
 
-            // Установка view-port'а и ножниц
-            commandBuffers_[i].setViewport(0,1,&viewport);
-            commandBuffers_[i].setScissor(0,1,&scissors);
+            // Изображение получено, но swap-chain уже не полностью соответствует поверхности - пересоздать после показа
+            case vk::Result::eSuboptimalKHR:
+                swapChainOutdated_ = true;
+                break;
 
-            // Привязать набор дескрипторов камеры (матрицы вида и проекции)
-            commandBuffers_[i].bindDescriptorSets(
-                    vk::PipelineBindPoint::eGraphics,
-                    pipelineLayoutPrimary_.get(),
-                    0,
-                    {camera_.getDescriptorSet(),lightSourceSet_.getDescriptorSet()},{});
+            // Swap-chain не соответствует поверхности - пересоздать, кадр пропускается (барьер кадра остается взведенным)
+            case vk::Result::eErrorOutOfDateKHR:
+                this->onSurfaceChanged();
+                return;
 
-            for(const auto& meshPtr : sceneMeshes_)
-            {
-                if(meshPtr->isReady() && meshPtr->getGeometryBuffer()->isReady())
-                {
-                    // Привязать наборы дескрипторов меша (матрица модели, свойства материала, текстуры и прочее)
-                    commandBuffers_[i].bindDescriptorSets(
-                            vk::PipelineBindPoint::eGraphics,
-                            pipelineLayoutPrimary_.get(),
-                            2,
-                            {meshPtr->getDescriptorSet()},{});
-
-                    // Буферы вершин и индексов
-                    vk::DeviceSize offsets[1] = {0};
-                    auto vBuffer = meshPtr->getGeometryBuffer()->getVertexBuffer().getBuffer().get();
-                    auto iBuffer = meshPtr->getGeometryBuffer()->getIndexBuffer().getBuffer().get();
-
-                    if(meshPtr->getGeometryBuffer()->isIndexed()) {
-                        commandBuffers_[i].bindVertexBuffers(0,1,&vBuffer,offsets);
-                        commandBuffers_[i].bindIndexBuffer(iBuffer,{},vk::IndexType::eUint32);
-                        commandBuffers_[i].drawIndexed(meshPtr->getGeometryBuffer()->getIndexCount(),1,0,0,0);
-                    } else {
-                        commandBuffers_[i].bindVertexBuffers(0,1,&vBuffer,offsets);
-                        commandBuffers_[i].draw(meshPtr->getGeometryBuffer()->getVertexCount(),1,0,0);
-                    }
-                }
-            }
+            // Изображение не получено за отведенное время - пропустить кадр
+            case vk::Result::eTimeout:
+            case vk::Result::eNotReady:
+                return;
 
-            // Завершение прохода добавит неявное преобразование памяти кадрового буфера в VK_IMAGE_LAYOUT_PRESENT_SRC_KHR для представления содержимого
-            commandBuffers_[i].endRenderPass();
+            case vk::Result::eErrorSurfaceLostKHR:
+                throw vk::SurfaceLostKHRError("Can't acquire swap-chain image. Surface lost");
 
-            /// Пост-обработка
+            default:
+                throw vk::DeviceLostError("Can't acquire swap-chain image. Device is not available");
+        }
 
-            // Сменить целевой кадровый буфер и начать работу с проходом (это очистит вложения)
-            renderPassBeginInfo.renderPass = renderPassPostProcess_.get();
-            renderPassBeginInfo.framebuffer = frameBuffersPostProcess_[i].getVulkanFrameBuffer().get();
-            commandBuffers_[i].beginRenderPass(renderPassBeginInfo,vk::SubpassContents::eInline);
+        // Если изображение все еще используется другим кадром (кол-во кадров в полете больше кол-ва изображений) - дождаться
+        if(swapChainImageFences_[availableImageIndex]){
+            (void)device_.getLogicalDevice()->waitForFences({swapChainImageFences_[availableImageIndex]}, VK_TRUE, UINT64_MAX);
+        }
+        swapChainImageFences_[availableImageIndex] = frameFence;
+    }
 
-            // Привязать графический конвейер
-            commandBuffers_[i].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelinePostProcess_.get());
+    // Барьер будет взведен снова по завершении команд этого кадра
+    device_.getLogicalDevice()->resetFences({frameFence});
 
-            // Установка view-port'а и ножниц
-            commandBuffers_[i].setViewport(0,1,&viewport);
-            commandBuffers_[i].setScissor(0,1,&scissors);
+    // И З М Е Н Е Н И Я  С Ц Е Н Ы
 
-            // Привязать дескрипторные набор с изображением сформированным в предыдущем проходе
-            commandBuffers_[i].bindDescriptorSets(
-                    vk::PipelineBindPoint::eGraphics,
-                    pipelineLayoutPostProcess_.get(),
-                    0,
-                    {frameBuffersPrimaryDescriptorSets_[i]},{});
+    // Освободить ресурсы мешей, удаленных в завершенных кадрах, и применить накопленные добавления/удаления
+    {
+        PROFILE_SCOPE("VkRenderer::draw/sceneChanges");
+        this->releaseRetiredMeshes();
+        this->applySceneChanges();
+    }
 
-            // Отрисовка треугольника
-            commandBuffers_[i].draw(6,1,0,0);
+    // П О Д Г О Т О В К А  К О М А Н Д
 
-            // Завершаем работать с потоком
-            commandBuffers_[i].endRenderPass();
+    // Ввод, произошедший до этого момента, будет отражен в данном кадре
+    const bool frameHasInput = inputPending_;
+    const auto frameInputTime = inputPendingTime_;
+    inputPending_ = false;
 
-            // Завершаем работу с командным буфером
-            commandBuffers_[i].end();
-        }
+    // Скопировать актуальные данные в блоки UBO текущего кадра (блоки мешей обновляются при записи их команд)
+    camera_.updateUniforms(currentFrame_);
+    lightSourceSet_.updateUniforms(currentFrame_);
 
-        // Командные буфер готовы
-        isCommandsReady_ = true;
-    }
+    // Дождаться создания конвейеров, используемых кадром (только вариантов основного конвейера, нужных мешам сцены)
+    this->waitForScenePipelines();
+    this->waitForPipeline(pipelinePostProcessReady_, "Post-process graphics pipeline");
 
-    // О Т П Р А В К А  К О М А Н Д  И  П О К А З
+    // Отправить загрузки ресурсов, записанные после предыдущего кадра. Копирование идет в очереди передачи, захват
+    // владения ресурсами с завершенным копированием - в графической очереди раньше команд кадра. Кадр рисует только
+    // меши, загрузка которых уже видна графической очереди
+    {
+        PROFILE_SCOPE("VkRenderer::draw/flushUploads");
+        uploadsReadyTicket_ = device_.getUploadManager()->flush();
+    }
 
-    // Индекс доступного изображения
-    uint32_t availableImageIndex = 0;
+    // Записать команды кадра
+    const vk::CommandBuffer& commandBuffer = commandBuffers_[currentFrame_];
+    {
+        PROFILE_SCOPE("VkRenderer::draw/record");
+        commandBuffer.reset({});
+        this->recordCommandBuffer(commandBuffer, availableImageIndex, currentFrame_);
+    }
 
-    // Получить индекс доступного для рендеринга изображения и взвести семафор готовности к рендерингу
-    device_.getLogicalDevice()->acquireNextImageKHR(
-            swapChainKhr_.get(),
-            10000,
-            semaphoreReadyToRender_.get(),
-            {},
-            &availableImageIndex);
+    // О Т П Р А В К А  К О М А Н Д  И  П О К А З
 
     // Семафоры, которые будут ожидаться конвейером
-    std::vector<vk::Semaphore> waitSemaphores = {semaphoreReadyToRender_.get()};
-
-    // Семафоры, которые будут взводиться конвейером после прохождения конвейера
-    std::vector<vk::Semaphore> signalSemaphores = {semaphoreReadyToPresent_.get()};
+    std::vector<vk::Semaphore> waitSemaphores = {semaphoresReadyToRender_[currentFrame_].get()};
 
     // Стадии, на которых конвейер будет приостанавливаться, чтобы ожидать своего семафора
     std::vector<vk::PipelineStageFlags> waitStages = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
 
+    // Семафоры, которые будут взводиться конвейером после прохождения конвейера
+    std::vector<vk::Semaphore> signalSemaphores = {semaphoresReadyToPresent_[currentFrame_].get()};
+
+    // Во внеэкранном режиме изображение не получается из swap-chain и не показывается - семафоры не нужны
+    if(isHeadless_){
+        waitSemaphores.clear();
+        waitStages.clear();
+        signalSemaphores.clear();
+    }
+
+    // Отсечение на GPU выполняется очередью вычислений, аргументы рисования читаются после его завершения
+    if(gpuCullingActive_){
+        PROFILE_SCOPE("VkRenderer::draw/submitCulling");
+
+        vk::SubmitInfo cullingSubmitInfo{};
+        cullingSubmitInfo.commandBufferCount = 1;
+        cullingSubmitInfo.pCommandBuffers = &(gpuCullingCommandBuffers_[currentFrame_]);
+        cullingSubmitInfo.signalSemaphoreCount = 1;
+        cullingSubmitInfo.pSignalSemaphores = &(semaphoresCullingDone_[currentFrame_].get());
+        device_.getComputeQueue().submit({cullingSubmitInfo}, nullptr);
+
+        waitSemaphores.push_back(semaphoresCullingDone_[currentFrame_].get());
+        waitStages.push_back(vk::PipelineStageFlagBits::eDrawIndirect);
+    }
+
     // Отправить команды на выполнение
     vk::SubmitInfo submitInfo{};
     submitInfo.commandBufferCount = 1;                                       // Кол-во командных буферов
-    submitInfo.pCommandBuffers = &(commandBuffers_[availableImageIndex]);    // Командные буферы
+    submitInfo.pCommandBuffers = &commandBuffer;                             // Командные буферы
     submitInfo.waitSemaphoreCount = waitSemaphores.size();                   // Кол-во семафоров, которые будет ожидать конвейер
     submitInfo.pWaitSemaphores = waitSemaphores.data();                      // Семафоры ожидания
     submitInfo.pWaitDstStageMask = waitStages.data();                        // Этапы конвейера, на которых будет ожидание
     submitInfo.signalSemaphoreCount = signalSemaphores.size();               // Кол-во семафоров, которые будут взведены после выполнения
     submitInfo.pSignalSemaphores = signalSemaphores.data();                  // Семафоры взведения
-    device_.getGraphicsQueue().submit({submitInfo}, nullptr);   // Отправка командного буфера на выполнение
+    {
+        PROFILE_SCOPE("VkRenderer::draw/submit");
+        device_.getGraphicsQueue().submit({submitInfo}, frameFence);         // Отправка командного буфера на выполнение (барьер взведется по завершении)
+    }
 
     // Инициировать показ (когда картинка будет готова)
-    vk::PresentInfoKHR presentInfoKhr{};
-    presentInfoKhr.waitSemaphoreCount = signalSemaphores.size();             // Кол-во семафоров, которые будут ожидаться
-    presentInfoKhr.pWaitSemaphores = signalSemaphores.data();                // Семафоры, которые ожидаются
-    presentInfoKhr.swapchainCount = 1;                                       // Кол-во цепочек показа
-    presentInfoKhr.pSwapchains = &(swapChainKhr_.get());                     // Цепочка показа
-    presentInfoKhr.pImageIndices = &availableImageIndex;                     // Индекс показываемого изображения
-    (void)device_.getPresentQueue().presentKHR(presentInfoKhr);              // Осуществить показ
+    if(!isHeadless_){
+        PROFILE_SCOPE("VkRenderer::draw/present");
+
+        vk::PresentInfoKHR presentInfoKhr{};
+        presentInfoKhr.waitSemaphoreCount = signalSemaphores.size();             // Кол-во семафоров, которые будут ожидаться
+        presentInfoKhr.pWaitSemaphores = signalSemaphores.data();                // Семафоры, которые ожидаются
+        presentInfoKhr.swapchainCount = 1;                                       // Кол-во цепочек показа
+        presentInfoKhr.pSwapchains = &(swapChainKhr_.get());                     // Цепочка показа
+        presentInfoKhr.pImageIndices = &availableImageIndex;                     // Индекс показываемого изображения
+
+        // Осуществить показ (если swap-chain не соответствует поверхности - пересоздать его после показа)
+        try{
+            if(device_.getPresentQueue().presentKHR(presentInfoKhr) == vk::Result::eSuboptimalKHR){
+                swapChainOutdated_ = true;
+            }
+        }
+        catch(vk::OutOfDateKHRError&){
+            swapChainOutdated_ = true;
+        }
+    }
+
+    // Задержка от ввода до постановки кадра в очередь показа
+    if(frameHasInput){
+        auto latencyUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - frameInputTime).count());
+        statLatencySamples_++;
+        statLatencyTotalUs_ += latencyUs;
+        statLatencyMaxUs_ = (std::max)(statLatencyMaxUs_, latencyUs);
+    }
+
+    // Перейти к следующему кадру
+    lastFrameBufferIndex_ = availableImageIndex;
+    currentFrame_ = (currentFrame_ + 1) % maxFramesInFlight_;
+    frameNumber_++;
+
+    // Обновить статистику
+    auto frameEndTime = std::chrono::high_resolution_clock::now();
+    statFramesRendered_++;
+    statFenceWaitTimeUs_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(fenceWaitEndTime - frameStartTime).count());
+    statCpuFrameTimeUs_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(frameEndTime - frameStartTime).count());
+
+    // Пересоздать swap-chain, если он перестал соответствовать поверхности
+    if(swapChainOutdated_){
+        this->onSurfaceChanged();
+    }
+}
+
+/**
+ * Рендеринг заданного кол-ва кадров с ожиданием их завершения
+ * @param frameCount Кол-во кадров
+ */
+void VkRenderer::renderFrames(size_t frameCount)
+{
+    // Если рендеринг не включен - выход
+    if(!isEnabled_){
+        return;
+    }
+
+    // Отправить кадры (каждый кадр ожидает лишь завершения своего предыдущего использования)
+    for(size_t i = 0; i < frameCount; i++){
+        this->draw();
+    }
+
+    // Дождаться завершения всех отправленных кадров
+    std::vector<vk::Fence> fences;
+    for(const auto& fence : frameFences_){
+        fences.push_back(fence.get());
+    }
+    (void)device_.getLogicalDevice()->waitForFences(fences, VK_TRUE, UINT64_MAX);
+}
+
+/**
+ * Используется ли внеэкранный режим
+ * @return Да или нет
+ */
+bool VkRenderer::isHeadless() const
+{
+    return isHeadless_;
+}
+
+/**
+ * Получить итоговый кадровый буфер (кадровый буфер пост-обработки)
+ * @param index Индекс кадрового буфера (во внеэкранном режиме совпадает с индексом кадра в полете)
+ * @return Константная ссылка на объект кадрового буфера
+ */
+const vk::resources::FrameBuffer& VkRenderer::getOutputFrameBuffer(size_t index) const
+{
+    return frameBuffersPostProcess_[index];
+}
+
+/**
+ * Индекс кадрового буфера, в который был отрисован последний отправленный кадр
+ * @return Индекс кадрового буфера
+ */
+uint32_t VkRenderer::getLastFrameBufferIndex() const
+{
+    return lastFrameBufferIndex_;
 }
@@ -3,25 +3,170 @@
 #include "VkTools/Tools.h"
 #include "VkTools/Device.hpp"
 #include "VkTools/Buffer.hpp"
+#include "VkTools/GpuProfiler.hpp"
+#include "VkTools/PipelineCache.hpp"
+#include "VkTools/CommandStateTracker.hpp"
+#include "VkTools/UniformRing.hpp"
 
 #include "VkResources/FrameBuffer.hpp"
+#include "VkResources/GeometryPool.hpp"
 #include "VkResources/GeometryBuffer.hpp"
 
 #include "VkScene/Mesh.h"
 #include "VkScene/Camera.h"
+#include "VkScene/FrustumCuller.h"
 #include "VkScene/LightSourceSet.hpp"
 
+#include "Tools/ThreadPool.hpp"
+#include "Tools/RadixSort.hpp"
+
+#include <chrono>
+#include <atomic>
+#include <unordered_map>
+
+/**
+ * Статистика кадров рендерера (накапливается с момента последнего сброса)
+ */
+struct VkRendererFrameStatistics
+{
+    /// Кол-во отрисованных кадров
+    uint64_t framesRendered = 0;
+    /// Кол-во кадров "в полете"
+    size_t framesInFlight = 0;
+    /// Среднее время работы CPU на кадр (мс), включая ожидание
+    double avgCpuFrameTimeMs = 0.0;
+    /// Среднее время ожидания барьера (fence) кадра (мс)
+    double avgFenceWaitTimeMs = 0.0;
+    /// Кол-во кадров, учтенных при замере задержки ввода (кадров, перед которыми был ввод)
+    uint64_t latencySamples = 0;
+    /// Средняя задержка от ввода до постановки кадра в очередь показа (мс)
+    double avgInputToPresentLatencyMs = 0.0;
+    /// Максимальная задержка от ввода до постановки кадра в очередь показа (мс)
+    double maxInputToPresentLatencyMs = 0.0;
+    /// Среднее кол-во мешей сцены на кадр
+    double avgSceneMeshes = 0.0;
+    /// Среднее кол-во мешей, прошедших отсечение по пирамиде видимости (рисуемых), на кадр
+    double avgVisibleMeshes = 0.0;
+    /// Среднее кол-во вызовов отрисовки основного прохода на кадр (группа экземпляров - один вызов)
+    double avgDrawCalls = 0.0;
+    /// Среднее кол-во треугольников основного прохода на кадр (с учетом уровней детализации и экземпляров)
+    double avgTriangles = 0.0;
+    /// Среднее кол-во записанных команд привязки состояния (конвейеры, наборы дескрипторов, буферы) на кадр
+    double avgStateBinds = 0.0;
+    /// Среднее кол-во пропущенных избыточных привязок состояния на кадр
+    double avgStateBindsSkipped = 0.0;
+};
+
+/**
+ * Группа экземпляров - меши, рисуемые одним вызовом отрисовки (элемент списка отрисовки кадра)
+ * @details Блок данных объекта (параметры отображения текстур, скелет) берется у первого меша группы, данные экземпляров
+ * (матрицы, материал, индексы текстур) лежат в потоке экземпляров кадра подряд, начиная с firstInstance.
+ * При отсечении на GPU группа - пакет непрямого рисования: firstInstance - первый объект пакета (и первые аргументы
+ * рисования), instanceCount - кол-во объектов пакета
+ */
+struct VkRendererDrawGroup
+{
+    /// Ключ сортировки (см. VkRenderer::sortDrawGroups)
+    uint64_t sortKey = 0;
+    /// Индекс первого меша группы в списке мешей сцены
+    uint32_t mesh = 0;
+    /// Первый экземпляр в потоке экземпляров
+    uint32_t firstInstance = 0;
+    /// Кол-во экземпляров
+    uint32_t instanceCount = 0;
+    /// Смещение блока данных объекта в кольцевом UBO буфере (динамическое смещение набора данных объектов)
+    uint32_t uniformOffset = 0;
+};
+
+/**
+ * Ключ пакета непрямого рисования (отсечение на GPU)
+ * @details Меши пакета рисуются одним вызовом с несколькими аргументами рисования, поэтому у них должны совпадать
+ * вариант конвейера, буферы блока пула геометрии, тип индексов и блок данных объекта (параметры отображения текстур)
+ */
+struct VkRendererIndirectBatchKey
+{
+    uint32_t pipelineVariant = 0;
+    size_t poolBlock = 0;
+    uint32_t indexing = 0;
+    vk::scene::MeshTextureMapping textureMapping;
+
+    bool operator==(const VkRendererIndirectBatchKey& other) const
+    {
+        return pipelineVariant == other.pipelineVariant &&
+               poolBlock == other.poolBlock &&
+               indexing == other.indexing &&
+               textureMapping.offset == other.textureMapping.offset &&
+               textureMapping.origin == other.textureMapping.origin &&
+               textureMapping.scale == other.textureMapping.scale &&
+               textureMapping.angle == other.textureMapping.angle;
+    }
+};
+
+/**
+ * Хеш ключа пакета непрямого рисования (параметры отображения текстур не учитываются - их сравнивает operator==)
+ */
+struct VkRendererIndirectBatchKeyHash
+{
+    size_t operator()(const VkRendererIndirectBatchKey& key) const
+    {
+        return std::hash<size_t>()(key.poolBlock) ^ (std::hash<uint32_t>()(key.pipelineVariant) << 1u) ^ (std::hash<uint32_t>()(key.indexing) << 9u);
+    }
+};
+
+/**
+ * Параметры выбора уровней детализации (LOD) мешей
+ */
+struct VkRendererLodSettings
+{
+    /// Допустимая геометрическая ошибка уровня на экране (пикселей)
+    float maxPixelError = 1.0f;
+    /// Гистерезис - доля допустимой ошибки, которую уровень должен "не добрать" для перехода на более грубый уровень
+    float hysteresis = 0.25f;
+    /// Минимальный диаметр ограничивающей сферы на экране (пикселей) - меньшие меши не рисуются
+    float minPixelSize = 1.0f;
+};
+
+/**
+ * Режим показа (политика представления кадров)
+ */
+enum class VkRendererPresentMode
+{
+    /// Минимальная задержка - MAILBOX (либо IMMEDIATE) с минимальным кол-вом изображений
+    eLowLatency,
+    /// Максимальная пропускная способность - FIFO с более глубокой буферизацией
+    eThroughput,
+    /// Экономия энергии - FIFO с ограничением частоты кадров
+    ePowerSaving
+};
+
+/**
+ * Параметры показа кадров
+ */
+struct VkRendererPresentPolicy
+{
+    /// Режим показа
+    VkRendererPresentMode mode = VkRendererPresentMode::eLowLatency;
+    /// Кол-во изображений swap-chain (0 - определить автоматически в зависимости от режима)
+    uint32_t swapChainImageCount = 0;
+    /// Ограничение частоты кадров для режима экономии энергии (кадров в секунду, 0 - без ограничения)
+    uint32_t frameRateLimit = 30;
+    /// Время ожидания получения изображения swap-chain (нс), по истечении кадр пропускается
+    uint64_t acquireTimeoutNs = UINT64_MAX;
+};
+
 class VkRenderer
 {
 private:
     /// Запущен ли рендеринг
     bool isEnabled_;
-    /// Готовы ли командные буферы
-    bool isCommandsReady_;
     /// Данные на вход (о вершинах) подаются в стиле OpenGL (считая что начало view-port'а в нижнем левом углу)
     bool inputDataInOpenGlStyle_;
     /// Использовать validation-слои и report callback
     bool useValidation_;
+    /// Внеэкранный режим (рендеринг в кадровые буферы без окна, поверхности и swap-chain)
+    bool isHeadless_;
+    /// Разрешение кадровых буферов во внеэкранном режиме
+    vk::Extent2D offscreenExtent_;
 
     /// Экземпляр Vulkan (smart pointer)
     vk::UniqueInstance vulkanInstance_;
@@ -37,6 +182,14 @@ private:
     vk::UniqueRenderPass renderPassPostProcess_;
     /// Объект очереди показа (swap-chain)
     vk::UniqueSwapchainKHR swapChainKhr_;
+    /// Параметры показа кадров
+    VkRendererPresentPolicy presentPolicy_;
+    /// Фактически используемый режим показа swap-chain
+    vk::PresentModeKHR swapChainPresentMode_;
+    /// Swap-chain не соответствует поверхности и должен быть пересоздан (после показа текущего кадра)
+    bool swapChainOutdated_;
+    /// Момент времени, раньше которого не начинается следующий кадр (при ограничении частоты кадров)
+    std::chrono::high_resolution_clock::time_point nextFrameTime_;
 
     /// Кадровые буферы - основные
     std::vector<vk::resources::FrameBuffer> frameBuffersPrimary_;
@@ -45,16 +198,34 @@ private:
     /// Кадровые буферы - дескрипторные наборы изображений (для передачи в шейдер другого этапа)
     std::vector<vk::DescriptorSet> frameBuffersPrimaryDescriptorSets_;
 
-    /// Командные буферы
+    /// Максимальное кол-во мешей
+    size_t maxMeshes_;
+    /// Максимальное кол-во кадров, обрабатываемых одновременно ("в полете")
+    size_t maxFramesInFlight_;
+    /// Индекс текущего кадра (в пределах maxFramesInFlight_)
+    size_t currentFrame_;
+
+    /// Командные буферы (по одному на каждый кадр в полете)
     std::vector<vk::CommandBuffer> commandBuffers_;
 
+    /// Пул потоков для параллельной записи команд (nullptr, если запись однопоточная)
+    std::unique_ptr<tools::ThreadPool> recordingThreadPool_;
+    /// Кол-во частей, на которые может делиться список мешей при записи (по одной на поток, включая основной)
+    size_t recordingSlotCount_;
+    /// Командные пулы потоков записи [кадр][часть] (пул не может использоваться несколькими потоками одновременно)
+    std::vector<std::vector<vk::UniqueCommandPool>> recordingCommandPools_;
+    /// Вторичные командные буферы основного прохода [кадр][часть]
+    std::vector<std::vector<vk::CommandBuffer>> secondaryCommandBuffers_;
+    /// Вторичные командные буферы пред-прохода глубины [кадр][часть]
+    std::vector<std::vector<vk::CommandBuffer>> depthPrePassCommandBuffers_;
+
     /// Текстурный семплер по умолчанию, используемый для всех создаваемых текстур
     vk::UniqueSampler textureSamplerDefault_;
 
     /// Объект дескрипторного пула для выделения набора для камеры (матрицы)
     vk::UniqueDescriptorPool descriptorPoolCamera_;
-    /// Объект дескрипторного пула для выделения наборов мешей (матрицы, материалы, текстуры)
-    vk::UniqueDescriptorPool descriptorPoolMeshes_;
+    /// Объект дескрипторного пула для выделения набора данных объектов (динамический UBO)
+    vk::UniqueDescriptorPool descriptorPoolObjects_;
     /// Объект дескрипторного пула для выделения набора для источников света
     vk::UniqueDescriptorPool descriptorPoolLightSources_;
     /// Объект дескрипторного пула для выделения набора использумого при пост-процессинге
@@ -62,8 +233,8 @@ private:
 
     /// Макет размещения дескрипторного набора для камеры (матрицы)
     vk::UniqueDescriptorSetLayout descriptorSetLayoutCamera_;
-    /// Макет размещения дескрипторного набора для меша (матрицы, материалы, текстуры)
-    vk::UniqueDescriptorSetLayout descriptorSetLayoutMeshes_;
+    /// Макет размещения дескрипторного набора данных объектов (динамический UBO кольцевого буфера)
+    vk::UniqueDescriptorSetLayout descriptorSetLayoutObjects_;
     /// Макет размещения дескрипторного набора для источников света (кол-во, массив источников)
     vk::UniqueDescriptorSetLayout descriptorSetLayoutLightSources_;
     /// Макет размещения дескрипторного набора использумого при пост-процессинге
@@ -73,22 +244,195 @@ private:
     vk::UniquePipelineLayout pipelineLayoutPrimary_;
     /// Макет размещения графического конвейера - пост-процессинг
     vk::UniquePipelineLayout pipelineLayoutPostProcess_;
-    /// Графический конвейер - основной
-    vk::UniquePipeline pipelinePrimary_;
+    /// Кэш графических конвейеров (сохраняется между запусками)
+    vk::tools::PipelineCache pipelineCache_;
+    /// Шейдерные модули основного конвейера (нужны, пока могут создаваться новые варианты конвейера)
+    vk::UniqueShaderModule shaderModulePrimaryVs_;
+    vk::UniqueShaderModule shaderModulePrimaryFs_;
+    /// Шейдерный модуль конвейера пред-прохода глубины
+    vk::UniqueShaderModule shaderModuleDepthPrePassVs_;
+    /// Графические конвейеры - основной (индекс - ключ варианта, см. getPipelinePrimaryVariant)
+    std::vector<vk::UniquePipeline> pipelinesPrimary_;
+    /// Графические конвейеры - пред-проход глубины (индекс 1 - вариант со скелетной анимацией)
+    std::vector<vk::UniquePipeline> pipelinesDepthPrePass_;
+
+    /// Отсечение на GPU - пул и макет размещения дескрипторов (буфер объектов, буферы аргументов рисования и счетчиков пакетов)
+    vk::UniqueDescriptorPool descriptorPoolGpuCulling_;
+    vk::UniqueDescriptorSetLayout descriptorSetLayoutGpuCulling_;
+    /// Отсечение на GPU - макет размещения и вычислительный конвейер (пусты, если устройство не поддерживает непрямое рисование с ненулевым первым экземпляром)
+    vk::UniquePipelineLayout pipelineLayoutGpuCulling_;
+    vk::UniquePipeline pipelineGpuCulling_;
+    /// Отсечение на GPU - наборы дескрипторов (по одному на кадр в полете)
+    std::vector<vk::DescriptorSet> gpuCullingDescriptorSets_;
+    /// Отсечение на GPU - буферы объектов (видимы хосту, заполняются CPU, по одному на кадр в полете)
+    std::vector<vk::tools::Buffer> gpuCullingObjectBuffers_;
+    /// Отсечение на GPU - указатели на размеченную память буферов объектов
+    std::vector<unsigned char*> gpuCullingObjectsMapped_;
+    /// Отсечение на GPU - буферы аргументов непрямого рисования (заполняются шейдером, по одному на кадр в полете)
+    std::vector<vk::tools::Buffer> gpuCullingDrawBuffers_;
+    /// Отсечение на GPU - буферы счетчиков видимых объектов пакетов (только при сжатии, по одному на кадр в полете)
+    std::vector<vk::tools::Buffer> gpuCullingCountBuffers_;
+    /// Отсечение на GPU - сжимаются ли аргументы рисования (рисование с кол-вом вызовов из буфера счетчиков)
+    bool gpuCullingCompact_;
+    /// Отсечение на GPU - максимальное кол-во аргументов в одном вызове непрямого рисования (без сжатия)
+    uint32_t gpuCullingMaxDrawCount_;
+    /// Отсечение на GPU - командные буферы очереди вычислений (по одному на кадр в полете)
+    std::vector<vk::CommandBuffer> gpuCullingCommandBuffers_;
+    /// Отсечение на GPU - кол-во объектов, отправленных на отсечение (по кадру в полете, для статистики)
+    std::vector<size_t> gpuCullingSubmittedObjects_;
+    /// Отсечение на GPU - буферы объектов пакетов (видимы хосту, по одному на кадр в полете)
+    std::vector<vk::tools::Buffer> gpuCullingBatchObjectBuffers_;
+    /// Отсечение на GPU - указатели на размеченную память буферов объектов пакетов
+    std::vector<vk::tools::GpuCullingBatchObject*> gpuCullingBatchObjectsMapped_;
+    /// Отсечение на GPU - слоты мешей, изменившихся после подготовки кадра (по кадру в полете)
+    std::vector<std::vector<uint32_t>> gpuCullingDirtySlots_;
+    /// Отсечение на GPU - нужно ли перезаписать все слоты кадра (буферы кадра еще не заполнялись или заняты отсечением на CPU)
+    std::vector<bool> gpuCullingFrameStale_;
+    /// Отсечение на GPU - нужно ли скопировать объекты пакетов в буфер кадра (пакеты перестроены)
+    std::vector<bool> gpuCullingBatchObjectsStale_;
+    /// Отсечение на GPU - объекты пакетов (пакеты подряд, перестраиваются только при изменении состава пакетов)
+    std::vector<vk::tools::GpuCullingBatchObject> gpuCullingBatchObjects_;
+    /// Отсечение на GPU - пакеты непрямого рисования (первый объект пакета и кол-во объектов)
+    std::vector<VkRendererDrawGroup> gpuCullingBatches_;
+    /// Отсечение на GPU - нужно ли перестроить пакеты (меши добавлены, удалены или сменили ключ пакета)
+    bool gpuCullingBatchesDirty_;
+    /// Буферы потока экземпляров (видимы хосту, по одному на кадр в полете)
+    std::vector<vk::tools::Buffer> instanceBuffers_;
+    /// Указатели на размеченную память буферов потока экземпляров
+    std::vector<vk::tools::InstanceData*> instanceDataMapped_;
+    /// Кольцевой UBO буфер кадров для данных объектов (параметры отображения текстур, матрицы костей)
+    vk::tools::UniformRing objectUniformRing_;
+    /// Набор дескрипторов данных объектов (общий для всех мешей и кадров, блок задается динамическим смещением)
+    vk::DescriptorSet objectUniformSet_;
     /// Графический конвейер - пост-процессинг
     vk::UniquePipeline pipelinePostProcess_;
+    /// Пул потоков для параллельного создания графических конвейеров
+    std::unique_ptr<tools::ThreadPool> pipelineThreadPool_;
+    /// Задачи создания вариантов основного конвейера (результат - время создания, мс; пуст после ожидания)
+    std::vector<std::future<double>> pipelinesPrimaryReady_;
+    /// Запрошенные варианты основного конвейера (индекс - ключ варианта)
+    std::vector<bool> pipelinesPrimaryRequested_;
+    /// Задачи создания конвейеров пред-прохода глубины
+    std::vector<std::future<double>> pipelinesDepthPrePassReady_;
+    /// Включен ли пред-проход глубины
+    bool depthPrePassEnabled_;
+    /// Включено ли отсечение мешей по пирамиде видимости
+    bool frustumCullingEnabled_;
+    /// Включено ли отсечение на GPU (вычислительный шейдер формирует аргументы непрямого рисования)
+    bool gpuCullingEnabled_;
+    /// Используется ли отсечение на GPU в записываемом кадре
+    bool gpuCullingActive_;
+    /// Номер последней партии загрузки, данные которой видны командам кадра (см. vk::tools::UploadManager::flush)
+    vk::tools::UploadTicket uploadsReadyTicket_;
+    /// Включено ли объединение мешей в группы экземпляров
+    bool instancingEnabled_;
+    /// Включена ли сортировка списка отрисовки по ключам состояния и глубины
+    bool drawSortingEnabled_;
+    /// Включен ли выбор уровней детализации мешей (и отсечение мешей меньше порога в пикселях)
+    bool lodEnabled_;
+    /// Параметры выбора уровней детализации
+    VkRendererLodSettings lodSettings_;
+    /// Задача создания конвейера пост-обработки (результат - момент завершения, мс; пуст после ожидания)
+    std::future<double> pipelinePostProcessReady_;
 
-    /// Примитивы синхронизации - семафор сигнализирующий о готовности к рендерингу
-    vk::UniqueSemaphore semaphoreReadyToRender_;
-    /// Примитивы синхронизации - семафор сигнализирующий о готовности к показу отрендереной картинки
-    vk::UniqueSemaphore semaphoreReadyToPresent_;
+    /// Примитивы синхронизации - семафоры сигнализирующие о готовности к рендерингу (по одному на кадр в полете)
+    std::vector<vk::UniqueSemaphore> semaphoresReadyToRender_;
+    /// Примитивы синхронизации - семафоры сигнализирующие о готовности к показу отрендереной картинки (по одному на кадр в полете)
+    std::vector<vk::UniqueSemaphore> semaphoresReadyToPresent_;
+    /// Примитивы синхронизации - барьеры, взводимые по завершении выполнения команд кадра (по одному на кадр в полете)
+    std::vector<vk::UniqueFence> frameFences_;
+    /// Примитивы синхронизации - семафоры завершения отсечения на GPU (по одному на кадр в полете)
+    std::vector<vk::UniqueSemaphore> semaphoresCullingDone_;
+    /// Барьеры кадров, использующих изображения swap-chain (по одному на изображение, пустой если изображение свободно)
+    std::vector<vk::Fence> swapChainImageFences_;
 
+    /// Статистика - кол-во кадров с момента сброса
+    uint64_t statFramesRendered_;
+    /// Статистика - суммарное время работы CPU над кадрами (мкс)
+    uint64_t statCpuFrameTimeUs_;
+    /// Статистика - суммарное время ожидания барьеров кадров (мкс)
+    uint64_t statFenceWaitTimeUs_;
+    /// Статистика - кол-во замеров задержки ввода
+    uint64_t statLatencySamples_;
+    /// Статистика - суммарная задержка от ввода до показа (мкс)
+    uint64_t statLatencyTotalUs_;
+    /// Статистика - максимальная задержка от ввода до показа (мкс)
+    uint64_t statLatencyMaxUs_;
+    /// Статистика - суммарное кол-во мешей сцены
+    uint64_t statSceneMeshes_;
+    /// Статистика - суммарное кол-во видимых (рисуемых) мешей
+    uint64_t statVisibleMeshes_;
+    /// Статистика - суммарное кол-во вызовов отрисовки основного прохода
+    uint64_t statDrawCalls_;
+    /// Статистика - суммарное кол-во треугольников основного прохода
+    uint64_t statTriangles_;
+    /// Статистика - суммарное кол-во записанных команд привязки состояния (пишется потоками записи)
+    std::atomic<uint64_t> statStateBinds_;
+    /// Статистика - суммарное кол-во пропущенных избыточных привязок (пишется потоками записи)
+    std::atomic<uint64_t> statStateBindsSkipped_;
+
+    /// Был ли ввод, еще не учтенный ни одним кадром
+    bool inputPending_;
+    /// Момент самого раннего неучтенного ввода
+    std::chrono::high_resolution_clock::time_point inputPendingTime_;
+
+    /// Профилировщик GPU (не инициализирован, если профилирование выключено)
+    vk::tools::GpuProfiler gpuProfiler_;
+    /// Время от начала создания графических конвейеров до завершения последнего из дожданных (мс)
+    double pipelineCreationTimeMs_;
+
+    /// Пул геометрии (геометрические буферы - участки его общих буферов)
+    vk::resources::GeometryPool geometryPool_;
     /// Массив указателей на выделенные геометрические буферы
     std::vector<vk::resources::GeometryBufferPtr> geometryBuffers_;
     /// Массив указателей на выделенные текстурные буферы
     std::vector<vk::resources::TextureBufferPtr> textureBuffers_;
     /// Массив указателей мешей сцены
     std::vector<vk::scene::MeshPtr> sceneMeshes_;
+    /// Отсечение мешей сцены по пирамиде видимости (ограничивающие объемы собираются каждый кадр)
+    vk::scene::FrustumCuller frustumCuller_;
+    /// Индексы видимых мешей сцены текущего кадра (по возрастанию, именно они записываются в командные буферы)
+    std::vector<uint32_t> visibleMeshes_;
+    /// Группы экземпляров текущего кадра (в порядке первого появления меша группы среди видимых мешей)
+    std::vector<VkRendererDrawGroup> drawGroups_;
+    /// Индексы групп по ключам инстансинга (переиспользуется между кадрами, чтобы не выделять память)
+    std::unordered_map<vk::scene::MeshInstancingKey, uint32_t, vk::scene::MeshInstancingKeyHash> drawGroupLookup_;
+    /// Индекс группы каждого видимого меша текущего кадра
+    std::vector<uint32_t> visibleMeshGroups_;
+    /// Меши сцены по слотам (пустой указатель - слот свободен). Слот закрепляется за мешем на все время на сцене
+    std::vector<vk::scene::MeshPtr> meshSlots_;
+    /// Свободные слоты мешей
+    std::vector<uint32_t> freeMeshSlots_;
+    /// Слоты изменившихся мешей (заполняют сами меши, см. vk::scene::Mesh::trackChanges)
+    std::vector<uint32_t> changedMeshSlots_;
+    /// Ключи пакетов непрямого рисования мешей по слотам
+    std::vector<VkRendererIndirectBatchKey> meshSlotKeys_;
+    /// Кол-во мешей сцены, использующих каждый вариант основного конвейера (индекс - ключ варианта)
+    std::vector<uint32_t> pipelineVariantUsage_;
+    /// Состояние пред-прохода глубины, с которым вычислены ключи мешей (от него зависит вариант конвейера)
+    bool meshSlotKeysDepthPrePass_;
+    /// Индексы пакетов непрямого рисования по ключам (отсечение на GPU, переиспользуется при перестроении пакетов)
+    std::unordered_map<VkRendererIndirectBatchKey, uint32_t, VkRendererIndirectBatchKeyHash> indirectBatchLookup_;
+    /// Индекс пакета непрямого рисования каждого меша сцены (отсечение на GPU, переиспользуется при перестроении пакетов)
+    std::vector<uint32_t> sceneMeshBatches_;
+    /// Сортировка списка отрисовки (временные массивы переиспользуются между кадрами)
+    tools::RadixSorter drawSorter_;
+    /// Ключи сортировки групп
+    std::vector<uint64_t> drawSortKeys_;
+    /// Порядок групп после сортировки (индексы в drawGroups_)
+    std::vector<uint32_t> drawSortOrder_;
+    /// Отсортированные группы (после сортировки обмениваются с drawGroups_)
+    std::vector<VkRendererDrawGroup> drawGroupsSorted_;
+    /// Меши, ожидающие добавления на сцену (применяются на границе кадра)
+    std::vector<vk::scene::MeshPtr> pendingMeshesToAdd_;
+    /// Меши, ожидающие удаления со сцены (применяются на границе кадра)
+    std::vector<vk::scene::MeshPtr> pendingMeshesToRemove_;
+    /// Удаленные со сцены меши и номера кадров, начиная с которых их ресурсы можно освободить
+    std::vector<std::pair<vk::scene::MeshPtr, uint64_t>> meshesToRelease_;
+    /// Номер текущего кадра (кол-во отправленных на выполнение кадров)
+    uint64_t frameNumber_;
+    /// Индекс кадрового буфера (изображения), использованного последним отправленным кадром
+    uint32_t lastFrameBufferIndex_;
     /// Камера (матрицы, UBO)
     vk::scene::Camera camera_;
     /// Источники освещения сцены
@@ -98,6 +442,79 @@ private:
     vk::resources::TextureBufferPtr blackPixelTexture_;
 
 
+    /**
+     * Инициализация экземпляра Vulkan (и debug-callback'а при использовании validation-слоев)
+     * @details Расширения поверхности запрашиваются только если рендеринг не внеэкранный
+     */
+    void initInstance();
+
+    /**
+     * Инициализация устройства
+     * @details Во внеэкранном режиме поверхность не используется, а допустимы любые устройства (в том числе программные)
+     */
+    void initDevice();
+
+    /**
+     * Инициализация всех ресурсов рендеринга, общих для оконного и внеэкранного режимов
+     * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
+     * @param fragmentShaderCodeBytes Код фрагментного шейдера (байты)
+     * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+     * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
+     * @param vertexShaderCodeBytesPp Код вершинного шейдера пост-обработки (байты)
+     * @param fragmentShaderCodeBytesPp Код фрагментного шейдера пост-обработки (байты)
+     * @param maxMeshes Максимальное кол-во мешей
+     * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
+     */
+    void initRenderingResources(
+            const std::vector<unsigned char>& vertexShaderCodeBytes,
+            const std::vector<unsigned char>& fragmentShaderCodeBytes,
+            const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+            const std::vector<unsigned char>& computeShaderCodeBytesCulling,
+            const std::vector<unsigned char>& vertexShaderCodeBytesPp,
+            const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
+            size_t maxMeshes,
+            const std::string& pipelineCachePath);
+
+    /**
+     * Инициализация отсечения на GPU (вычислительный конвейер, буферы объектов и аргументов рисования)
+     * @param computeShaderCodeBytes Код вычислительного шейдера отсечения
+     * @param maxMeshes Максимальное кол-во мешей (размер буферов)
+     * @param framesInFlight Кол-во кадров в полете
+     *
+     * @details Буфер аргументов пишется очередью вычислений и читается графической, поэтому если семейства
+     * очередей различаются, буфер создается с одновременным доступом обоих семейств
+     */
+    void initGpuCulling(const std::vector<unsigned char>& computeShaderCodeBytes, size_t maxMeshes, size_t framesInFlight);
+
+    /**
+     * Де-инициализация отсечения на GPU
+     */
+    void deInitGpuCulling() noexcept;
+
+    /**
+     * Инициализация буферов потока экземпляров
+     * @param maxMeshes Максимальное кол-во мешей (экземпляров в кадре)
+     * @param framesInFlight Кол-во кадров в полете
+     */
+    void initInstanceBuffers(size_t maxMeshes, size_t framesInFlight);
+
+    /**
+     * Де-инициализация буферов потока экземпляров
+     */
+    void deInitInstanceBuffers() noexcept;
+
+    /**
+     * Инициализация кольцевого UBO буфера данных объектов и его набора дескрипторов
+     * @param frameCapacity Размер участка одного кадра в байтах
+     * @param framesInFlight Кол-во кадров в полете
+     */
+    void initObjectUniforms(vk::DeviceSize frameCapacity, size_t framesInFlight);
+
+    /**
+     * Де-инициализация кольцевого UBO буфера данных объектов
+     */
+    void deInitObjectUniforms() noexcept;
+
     /**
      * Инициализация основного прохода рендеринга
      * @param colorAttachmentFormat Формат цветовых вложений
@@ -127,10 +544,11 @@ private:
     /**
      * Инициализация swap-chain (цепочки показа) - набор сменяющихся изображений показываемых на поверхности отображения
      * @param surfaceFormat Формат поверхности
-     * @param bufferCount Кол-ва запрашиваемых буферов (уровень желаемой буферизации, 0 - определить автоматически)
-     * @return Фактическое количество буферов (сколько будет использовано)
+     * @param presentPolicy Параметры показа (режим и кол-во изображений)
+     *
+     * @details Режим показа и кол-во изображений выбираются согласно политике показа с учетом возможностей поверхности
      */
-    void initSwapChain(const vk::SurfaceFormatKHR& surfaceFormat, uint32_t bufferCount = 0);
+    void initSwapChain(const vk::SurfaceFormatKHR& surfaceFormat, const VkRendererPresentPolicy& presentPolicy);
 
     /**
      * Де-инициализация swap-chain (цепочки показа)
@@ -160,6 +578,7 @@ private:
      * @param colorAttachmentFormat Формат цветовых вложений
      *
      * @details Это итоговые кадровые буферы, которые используются для показа.
+     * Во внеэкранном режиме изображения создаются самим кадровым буфером (по одному на кадр в полете)
      */
     void initFrameBuffersPostProcess(const vk::Format& colorAttachmentFormat);
 
@@ -171,14 +590,14 @@ private:
 
     /**
      * Инициализация дескрипторных пулов и макетов размещения дескрипторов
-     * @param maxMeshes Максимальное кол-во одновременно отображающихся мешей (влияет на максимальное кол-во наборов для материала меша и прочего)
      * @param frameBufferCount Кол-во кадровых буферов (от него зависит кол-во дескрипторных наборов передаваемых на этап пост-обработки)
+     * @param framesInFlight Кол-во кадров в полете (у камеры и источников отдельный набор на каждый кадр)
      *
      * @details Дескрипторы описывают правила доступа из шейдера к различным ресурсам (таким как UBO буферы, изображения, и прочее). Они объединены в наборы
      * Наборы дескрипторов выделяются из дескрипторных пулов, а у пулов есть свой макет размещения, который описывает сколько наборов можно будет выделить
      * из пула и какие конкретно дескрипторы в этих наборах (и сколько их) будут доступны
      */
-    void initDescriptorPoolsAndLayouts(size_t maxMeshes, size_t frameBufferCount);
+    void initDescriptorPoolsAndLayouts(size_t frameBufferCount, size_t framesInFlight);
 
     /**
      * Де-инициализация дескрипторов
@@ -206,15 +625,16 @@ private:
 
 
     /**
-     * Инициализация основного графического конвейера
+     * Инициализация основного графического конвейера (макет размещения и шейдерные модули)
      * @param vertexShaderCodeBytes Код вершинного шейдера
-     * @param geometryShaderCodeBytes Код геометрического шейдера
      * @param fragmentShaderCodeBytes Код фрагментного шейдера
+     * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины
+     * @details Варианты конвейера для перестановок шейдеров создаются по запросу (см. requestPipelinePrimaryVariant)
      */
     void initPipelinePrimary(
             const std::vector<unsigned char>& vertexShaderCodeBytes,
-            const std::vector<unsigned char>& geometryShaderCodeBytes,
-            const std::vector<unsigned char>& fragmentShaderCodeBytes);
+            const std::vector<unsigned char>& fragmentShaderCodeBytes,
+            const std::vector<unsigned char>& vertexShaderCodeBytesDepth);
 
     /**
      * Де-инициализация графического конвейера
@@ -236,6 +656,200 @@ private:
     void deInitPipelinePostProcess() noexcept;
 
 
+    /**
+     * Инициализация примитивов синхронизации кадров в полете (семафоры, барьеры)
+     * @param framesInFlight Кол-во кадров в полете
+     *
+     * @details Барьеры создаются во взведенном состоянии, чтобы первое ожидание каждого кадра не блокировало поток
+     */
+    void initSyncPrimitives(size_t framesInFlight);
+
+    /**
+     * Де-инициализация примитивов синхронизации
+     */
+    void deInitSyncPrimitives() noexcept;
+
+    /**
+     * Инициализация командных пулов и вторичных командных буферов для параллельной записи
+     * @param framesInFlight Кол-во кадров в полете
+     * @param slotCount Кол-во частей (потоков записи)
+     */
+    void initSecondaryCommandBuffers(size_t framesInFlight, size_t slotCount);
+
+    /**
+     * Де-инициализация командных пулов и вторичных командных буферов
+     */
+    void deInitSecondaryCommandBuffers() noexcept;
+
+    /**
+     * Запись части мешей сцены во вторичный командный буфер основного прохода
+     * @param commandBuffer Вторичный командный буфер
+     * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+     * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+     * @param groupFrom Индекс первой группы экземпляров части
+     * @param groupTo Индекс группы, следующей за последней группой части
+     * @param viewport Область вида
+     * @param scissors Параметры ножниц
+     *
+     * @details Может вызываться из рабочих потоков - использует только данные мешей своей части
+     */
+    void recordMeshesSecondary(const vk::CommandBuffer& commandBuffer,
+            uint32_t imageIndex,
+            size_t frameIndex,
+            size_t groupFrom,
+            size_t groupTo,
+            const vk::Viewport& viewport,
+            const vk::Rect2D& scissors);
+
+    /**
+     * Запись части мешей сцены во вторичный командный буфер пред-прохода глубины
+     * @param commandBuffer Вторичный командный буфер
+     * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+     * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+     * @param groupFrom Индекс первой группы экземпляров части
+     * @param groupTo Индекс группы, следующей за последней группой части
+     * @param viewport Область вида
+     * @param scissors Параметры ножниц
+     *
+     * @details Записываются только меши с потоком положений. Может вызываться из рабочих потоков
+     */
+    void recordMeshesDepthPrePassSecondary(const vk::CommandBuffer& commandBuffer,
+            uint32_t imageIndex,
+            size_t frameIndex,
+            size_t groupFrom,
+            size_t groupTo,
+            const vk::Viewport& viewport,
+            const vk::Rect2D& scissors);
+
+    /**
+     * Параллельная запись вторичных командных буферов основного прохода
+     * @param imageIndex Индекс изображения swap-chain
+     * @param frameIndex Индекс кадра в полете
+     * @param viewport Область вида
+     * @param scissors Параметры ножниц
+     * @return Кол-во записанных вторичных буферов (первые N буферов кадра)
+     */
+    size_t recordPrimaryPassSecondaryBuffers(uint32_t imageIndex, size_t frameIndex, const vk::Viewport& viewport, const vk::Rect2D& scissors);
+
+    /**
+     * Отсечь меши сцены по пирамиде видимости камеры и выбрать их уровни детализации (заполняет visibleMeshes_)
+     * @param viewPortExtent Разрешение области вида (для оценки размера мешей на экране)
+     *
+     * @details Меши со скелетной анимацией не отсекаются - их ограничивающие объемы вычислены для позы по умолчанию
+     */
+    void cullSceneMeshes(const vk::Extent2D& viewPortExtent);
+
+    /**
+     * Выбрать уровень детализации меша по размеру его ограничивающей сферы на экране
+     * @param meshPtr Меш
+     * @param projectionScale Масштаб проекции (размер в пикселях объекта единичного размера на единичном расстоянии)
+     * @return Рисовать ли меш (нет - если его диаметр на экране меньше порога)
+     *
+     * @details Выбирается самый грубый уровень, геометрическая ошибка которого на экране не превышает допустимую.
+     * Переход на более грубый уровень происходит только с запасом (гистерезис), на более подробный - сразу,
+     * поэтому меш на границе двух уровней не переключается между ними каждый кадр
+     */
+    bool selectMeshLod(const vk::scene::MeshPtr& meshPtr, float projectionScale);
+
+    /**
+     * Загружены ли ресурсы меша (видны ли данные его геометрии и текстур командам кадра)
+     * @param meshPtr Меш
+     * @return Да или нет
+     */
+    bool isMeshUploaded(const vk::scene::MeshPtr& meshPtr) const;
+
+    /**
+     * Получить ключ пакета непрямого рисования меша
+     * @param mesh Меш
+     * @return Ключ пакета (меши с равными ключами рисуются одним пакетом, если у них нет скелета)
+     */
+    VkRendererIndirectBatchKey getIndirectBatchKey(const vk::scene::MeshPtr& mesh) const;
+
+    /**
+     * Обновить ключ пакета меша в слоте (и счетчики использования вариантов основного конвейера)
+     * @param slot Слот меша
+     * @return Изменился ли ключ
+     */
+    bool updateMeshSlotKey(uint32_t slot);
+
+    /**
+     * Перестроить пакеты непрямого рисования и объекты пакетов (отсечение на GPU)
+     *
+     * @details Вызывается только при изменении состава пакетов (добавление и удаление мешей, смена ключа пакета),
+     * а не каждый кадр. Меши со скелетной анимацией - всегда отдельный пакет, матрицы костей у меша свои
+     */
+    void rebuildGpuCullingBatches();
+
+    /**
+     * Записать объект отсечения и данные экземпляра меша в слот буферов кадра (отсечение на GPU)
+     * @param frameIndex Индекс кадра в полете
+     * @param slot Слот меша
+     *
+     * @details Выбранный шейдером уровень детализации (последнее поле объекта) не перезаписывается
+     */
+    void writeGpuCullingSlot(size_t frameIndex, uint32_t slot);
+
+    /**
+     * Подготовить отсечение на GPU для кадра (обновить буферы кадра и записать командный буфер вычислений)
+     * @param frameIndex Индекс кадра в полете
+     * @param projectionScale Масштаб проекции (для выбора уровней детализации шейдером, см. selectMeshLod)
+     *
+     * @details Вызывается после ожидания барьера кадра, поэтому счетчики видимых объектов и треугольников предыдущего
+     * использования буфера уже записаны GPU и учитываются в статистике. Перезаписываются только слоты мешей,
+     * изменившихся после предыдущего использования буферов кадра, отсечение и выбор уровней детализации выполняет
+     * шейдер. Пакеты записываются в drawGroups_ (вместо групп экземпляров)
+     */
+    void prepareGpuCulling(size_t frameIndex, float projectionScale);
+
+    /**
+     * Объединить видимые меши в группы экземпляров и записать данные экземпляров кадра (заполняет drawGroups_)
+     * @param frameIndex Индекс кадра в полете
+     *
+     * @details Меши с равными ключами инстансинга попадают в одну группу. Меши со скелетной анимацией (свои матрицы
+     * костей в наборе дескрипторов) рисуются по одному
+     */
+    void buildDrawGroups(size_t frameIndex);
+
+    /**
+     * Записать блоки данных групп кадра в кольцевой UBO буфер (по одному на группу, данные первого меша группы)
+     * @param frameIndex Индекс кадра в полете
+     */
+    void writeDrawGroupUniforms(size_t frameIndex);
+
+    /**
+     * Записать данные экземпляра меша (поток экземпляров)
+     * @param meshPtr Меш
+     * @param instance Данные экземпляра в размеченной памяти буфера экземпляров
+     */
+    void writeInstanceData(const vk::scene::MeshPtr& meshPtr, vk::tools::InstanceData& instance) const;
+
+    /**
+     * Записать непрямое рисование пакета (аргументы записаны шейдером отсечения на GPU)
+     * @param commandBuffer Командный буфер
+     * @param frameIndex Индекс кадра в полете
+     * @param group Пакет непрямого рисования
+     * @param indexed Индексированная ли геометрия пакета
+     */
+    void recordIndirectBatch(const vk::CommandBuffer& commandBuffer, size_t frameIndex, const VkRendererDrawGroup& group, bool indexed) const;
+
+    /**
+     * Отсортировать группы экземпляров кадра по 64-битным ключам (поразрядной сортировкой)
+     *
+     * @details Ключ (от старших битов к младшим): вариант конвейера (8 бит), участок пула геометрии - блок и тип
+     * индексов (16 бит), материал - индекс основной текстуры в глобальной таблице (16 бит), глубина центра ограничивающих объемов в пространстве
+     * камеры (24 бита, ближние раньше). Так смены конвейера и буферов геометрии сводятся к минимуму, а внутри
+     * одинакового состояния меши рисуются спереди назад (больше фрагментов отбрасывается ранней проверкой глубины)
+     */
+    void sortDrawGroups();
+
+    /**
+     * Запись команд кадра в командный буфер
+     * @param commandBuffer Командный буфер кадра
+     * @param imageIndex Индекс изображения swap-chain (и соответствующих кадровых буферов)
+     * @param frameIndex Индекс кадра в полете (определяет используемые дескрипторные наборы)
+     */
+    void recordCommandBuffer(const vk::CommandBuffer& commandBuffer, uint32_t imageIndex, size_t frameIndex);
+
     /**
      * Освобождение геометрических буферов
      *
@@ -260,24 +874,126 @@ private:
      */
     void freeMeshes();
 
+    /**
+     * Применить накопленные изменения сцены (добавление и удаление мешей)
+     *
+     * @details Вызывается на границе кадра, до записи команд. Удаленные меши не уничтожаются сразу, поскольку
+     * их ресурсы могут использоваться еще не завершенными кадрами
+     */
+    void applySceneChanges();
+
+    /**
+     * Находится ли меш на сцене (занимает ли он слот)
+     * @param meshPtr Меш
+     * @return Да или нет (меши, ожидающие добавления, еще не на сцене)
+     */
+    bool isMeshOnScene(const vk::scene::MeshPtr& meshPtr) const;
+
+    /**
+     * Освободить ресурсы удаленных мешей, кадры использовавшие которые уже завершены
+     * @param force Освободить все (когда гарантированно известно что GPU не выполняет команд)
+     */
+    void releaseRetiredMeshes(bool force = false);
+
+    /**
+     * Дождаться завершения задачи создания конвейера
+     * @param pipelineReady Future задачи (после ожидания становится пустым, повторные вызовы ничего не делают)
+     * @param name Название конвейера (для вывода)
+     */
+    void waitForPipeline(std::future<double>& pipelineReady, const std::string& name);
+
+    /**
+     * Создание варианта основного графического конвейера
+     * @param variant Ключ варианта (см. getPipelinePrimaryVariant)
+     * @param viewPortExtent Разрешение области вида (для статической настройки)
+     */
+    void createPipelinePrimaryVariant(uint32_t variant, const vk::Extent2D& viewPortExtent);
+
+    /**
+     * Создание варианта конвейера пред-прохода глубины
+     * @param skinned Вариант для мешей со скелетной анимацией
+     * @param viewPortExtent Разрешение области вида (для статической настройки)
+     */
+    void createPipelineDepthPrePassVariant(bool skinned, const vk::Extent2D& viewPortExtent);
+
+    /**
+     * Запросить создание варианта основного конвейера
+     * @param variant Ключ варианта (см. getPipelinePrimaryVariant)
+     */
+    void requestPipelinePrimaryVariant(uint32_t variant);
+
+    /**
+     * Получить ключ варианта основного конвейера, которым рисуется меш
+     * @param mesh Меш
+     * @return Ключ варианта (ключ перестановки шейдеров и признак проверки глубины на равенство)
+     */
+    uint32_t getPipelinePrimaryVariant(const vk::scene::MeshPtr& mesh) const;
+
+    /**
+     * Дождаться создания вариантов основного конвейера, используемых мешами сцены
+     */
+    void waitForScenePipelines();
+
 public:
+#ifdef VK_USE_PLATFORM_WIN32_KHR
     /**
      * Конструктор
      * @param hInstance Экземпляр WinApi приложения
      * @param hWnd Дескриптор окна WinApi
      * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
-     * @param geometryShaderCodeBytes Код геометрического шейдера (байты)
      * @param fragmentShaderCodeBytes Rод фрагментного шейдера (байты)
+     * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+     * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
      * @param maxMeshes Максимальное кол-во мешей
+     * @param maxFramesInFlight Максимальное кол-во кадров, обрабатываемых одновременно (CPU готовит следующий кадр пока GPU рисует текущий)
+     * @param recordingThreads Кол-во потоков записи команд (0 - по кол-ву аппаратных потоков)
+     * @param presentPolicy Параметры показа кадров (режим, кол-во изображений swap-chain)
+     * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
      */
     VkRenderer(HINSTANCE hInstance,
             HWND hWnd,
             const std::vector<unsigned char>& vertexShaderCodeBytes,
-            const std::vector<unsigned char>& geometryShaderCodeBytes,
             const std::vector<unsigned char>& fragmentShaderCodeBytes,
+            const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+            const std::vector<unsigned char>& computeShaderCodeBytesCulling,
             const std::vector<unsigned char>& vertexShaderCodeBytesPp,
             const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
-            size_t maxMeshes = 1000);
+            size_t maxMeshes = 1000,
+            size_t maxFramesInFlight = 2,
+            size_t recordingThreads = 0,
+            const VkRendererPresentPolicy& presentPolicy = {},
+            const std::string& pipelineCachePath = "");
+#endif
+
+    /**
+     * Конструктор внеэкранного рендерера (без окна, поверхности и swap-chain)
+     * @param width Ширина кадра
+     * @param height Высота кадра
+     * @param vertexShaderCodeBytes Код вершинного шейдера (байты)
+     * @param fragmentShaderCodeBytes Rод фрагментного шейдера (байты)
+     * @param vertexShaderCodeBytesDepth Код вершинного шейдера пред-прохода глубины (байты)
+     * @param computeShaderCodeBytesCulling Код вычислительного шейдера отсечения на GPU (байты)
+     * @param maxMeshes Максимальное кол-во мешей
+     * @param maxFramesInFlight Максимальное кол-во кадров, обрабатываемых одновременно (равно кол-ву внеэкранных кадровых буферов)
+     * @param recordingThreads Кол-во потоков записи команд (0 - по кол-ву аппаратных потоков)
+     * @param pipelineCachePath Путь к файлу кэша конвейеров (пустая строка - кэш не сохраняется между запусками)
+     *
+     * @details Пригоден для пакетного рендеринга и замеров производительности на машинах без оконной системы
+     * (в том числе с программными реализациями Vulkan). Результат кадра остается в кадровом буфере пост-обработки
+     * в макете eTransferSrcOptimal, откуда может быть скопирован
+     */
+    VkRenderer(uint32_t width,
+            uint32_t height,
+            const std::vector<unsigned char>& vertexShaderCodeBytes,
+            const std::vector<unsigned char>& fragmentShaderCodeBytes,
+            const std::vector<unsigned char>& vertexShaderCodeBytesDepth,
+            const std::vector<unsigned char>& computeShaderCodeBytesCulling,
+            const std::vector<unsigned char>& vertexShaderCodeBytesPp,
+            const std::vector<unsigned char>& fragmentShaderCodeBytesPp,
+            size_t maxMeshes = 1000,
+            size_t maxFramesInFlight = 2,
+            size_t recordingThreads = 0,
+            const std::string& pipelineCachePath = "");
 
     /**
      * Деструктор
@@ -294,7 +1010,8 @@ public:
      * Вызывается когда поверхность отображения изменилась
      *
      * @details Например, если сменился размер поверхности отображения, нужно заново пересоздать swap-chain.
-     * Также необходимо пересоздать кадровые буферы и прочие компоненты которые зависят от swap-chain
+     * Также необходимо пересоздать кадровые буферы и прочие компоненты которые зависят от swap-chain.
+     * Во внеэкранном режиме поверхности нет, вызов ничего не делает
      */
     void onSurfaceChanged();
 
@@ -302,9 +1019,16 @@ public:
      * Создание геометрического буфера
      * @param vertices Массив вершин
      * @param indices Массив индексов
+     * @param positionStream Создать отдельный поток положений (нужен для участия в пред-проходе глубины)
+     * @param lodIndices Массивы индексов упрощенных уровней детализации (от подробного к грубому)
+     * @param lodErrors Геометрические ошибки упрощенных уровней детализации
      * @return Shared smart pointer на объект буфера
      */
-    vk::resources::GeometryBufferPtr createGeometryBuffer(const std::vector<vk::tools::Vertex>& vertices, const std::vector<uint32_t>& indices);
+    vk::resources::GeometryBufferPtr createGeometryBuffer(const std::vector<vk::tools::Vertex>& vertices,
+            const std::vector<uint32_t>& indices,
+            bool positionStream = true,
+            const std::vector<std::vector<uint32_t>>& lodIndices = {},
+            const std::vector<float>& lodErrors = {});
 
     /**
      * Создать текстурный буфер
@@ -320,6 +1044,8 @@ public:
 
     /**
      * Добавление меша на сцену
+     * @details Меш появится на сцене со следующего кадра (без ожидания GPU). Кол-во мешей на сцене не может
+     * превышать maxMeshes, указанное при создании рендерера
      * @param geometryBuffer Геометрический буфер
      * @param textureSet Текстурный набор
      * @param materialSettings Параметры материала меша
@@ -334,6 +1060,9 @@ public:
     /**
      * Удалить меш со сцены
      * @param meshPtr Shared smart pointer на объект меша
+     *
+     * @details Меш перестает рисоваться со следующего кадра, его ресурсы освобождаются после завершения кадров,
+     * которые могли его использовать (без ожидания GPU). Меши, которых нет на сцене, и повторные удаления игнорируются
      */
     void removeMeshFromScene(const vk::scene::MeshPtr& meshPtr);
 
@@ -368,8 +1097,229 @@ public:
      */
     vk::scene::Camera* getCameraPtr();
 
+    /**
+     * Получить статистику кадров (с момента последнего сброса)
+     * @return Структура статистики
+     */
+    VkRendererFrameStatistics getFrameStatistics() const;
+
+    /**
+     * Сбросить накопленную статистику кадров
+     */
+    void resetFrameStatistics();
+
+    /**
+     * Включить профилирование GPU (время и статистика конвейера проходов)
+     * @param perDrawTimestamps Записывать временные метки отдельных вызовов отрисовки основного прохода
+     * @param csvPath Путь к CSV файлу для записи результатов каждого кадра (пустая строка - без записи)
+     *
+     * @details Результаты кадра читаются без ожидания GPU, когда его ресурсы используются повторно
+     * (с задержкой в кол-во кадров в полете)
+     */
+    void enableGpuProfiler(bool perDrawTimestamps = false, const std::string& csvPath = "");
+
+    /**
+     * Выключить профилирование GPU
+     */
+    void disableGpuProfiler();
+
+    /**
+     * Получить последние результаты профилирования GPU
+     * @return Константная ссылка на результаты кадра
+     */
+    const vk::tools::GpuFrameProfile& getGpuProfile() const;
+
+    /**
+     * Получить время создания графических конвейеров при инициализации
+     * @return Время (мс)
+     *
+     * @details Позволяет сравнить "холодный" запуск (кэш конвейеров пуст) и "теплый" (кэш загружен из файла).
+     * Конвейеры создаются асинхронно, поэтому значение окончательно после waitForPipelines() или первого кадра с мешами
+     */
+    double getPipelineCreationTimeMs() const;
+
+    /**
+     * Дождаться создания всех графических конвейеров
+     * @details Обычно не требуется - draw() ожидает только конвейеры, нужные кадру
+     */
+    void waitForPipelines();
+
+    /**
+     * Отправить записанные загрузки ресурсов и дождаться их завершения
+     * @details Обычно не требуется - draw() рисует только меши с завершенной загрузкой. Нужно для замера времени
+     * загрузки сцены
+     */
+    void waitForUploads();
+
+    /**
+     * Был ли кэш конвейеров загружен из файла при инициализации ("теплый" запуск)
+     * @return Да или нет
+     */
+    bool isPipelineCacheWarm() const;
+
+    /**
+     * Включить или выключить пред-проход глубины
+     * @param enabled Включен ли пред-проход
+     *
+     * @details При включенном пред-проходе меши с потоком положений сначала записывают только глубину, а в основном
+     * под-проходе рисуются с проверкой глубины на равенство (каждый видимый пиксель затеняется один раз).
+     * Выгоден при большом перекрытии и дорогих фрагментных шейдерах, но удваивает вершинную нагрузку.
+     * Применяется со следующего кадра
+     */
+    void setDepthPrePassEnabled(bool enabled);
+
+    /**
+     * Включен ли пред-проход глубины
+     * @return Да или нет
+     */
+    bool isDepthPrePassEnabled() const;
+
+    /**
+     * Включить или выключить отсечение мешей по пирамиде видимости
+     * @param enabled Включено ли отсечение
+     *
+     * @details Меши, ограничивающие объемы которых целиком вне пирамиды видимости камеры, не записываются
+     * в командные буферы. Применяется со следующего кадра
+     */
+    void setFrustumCullingEnabled(bool enabled);
+
+    /**
+     * Включено ли отсечение мешей по пирамиде видимости
+     * @return Да или нет
+     */
+    bool isFrustumCullingEnabled() const;
+
+    /**
+     * Включить или выключить отсечение на GPU
+     * @param enabled Включено ли отсечение
+     *
+     * @details Ограничивающие объемы и аргументы рисования мешей передаются вычислительному шейдеру (очередь вычислений),
+     * который отсекает меши по пирамиде видимости и пишет аргументы непрямого рисования. Меши с общим состоянием
+     * объединяются в пакеты, каждый пакет рисуется одним непрямым вызовом: при поддержке VK_KHR_draw_indirect_count -
+     * только видимые меши (кол-во из буфера счетчиков), иначе - все меши пакета (отсеченные с нулевым кол-вом
+     * экземпляров). Отсечение на CPU при этом не выполняется. Применяется со следующего кадра
+     */
+    void setGpuCullingEnabled(bool enabled);
+
+    /**
+     * Включено ли отсечение на GPU
+     * @return Да или нет
+     */
+    bool isGpuCullingEnabled() const;
+
+    /**
+     * Доступно ли отсечение на GPU (поддерживает ли устройство непрямое рисование с ненулевым первым экземпляром)
+     * @return Да или нет
+     */
+    bool isGpuCullingAvailable() const;
+
+    /**
+     * Включить или выключить инстансинг
+     * @param enabled Включен ли инстансинг
+     *
+     * @details Видимые меши с общим участком геометрии, вариантом конвейера и параметрами отображения текстур рисуются одним вызовом
+     * с несколькими экземплярами. Применяется со следующего кадра
+     */
+    void setInstancingEnabled(bool enabled);
+
+    /**
+     * Включен ли инстансинг
+     * @return Да или нет
+     */
+    bool isInstancingEnabled() const;
+
+    /**
+     * Включить или выключить сортировку списка отрисовки
+     * @param enabled Включена ли сортировка
+     *
+     * @details Без сортировки группы рисуются в порядке добавления мешей на сцену. Применяется со следующего кадра
+     */
+    void setDrawSortingEnabled(bool enabled);
+
+    /**
+     * Включена ли сортировка списка отрисовки
+     * @return Да или нет
+     */
+    bool isDrawSortingEnabled() const;
+
+    /**
+     * Включить или выключить выбор уровней детализации мешей
+     * @param enabled Включен ли выбор уровней
+     *
+     * @details Без выбора уровней все меши рисуются с исходной геометрией и не отсекаются по размеру на экране
+     */
+    void setLodEnabled(bool enabled);
+
+    /**
+     * Включен ли выбор уровней детализации мешей
+     * @return Да или нет
+     */
+    bool isLodEnabled() const;
+
+    /**
+     * Установить параметры выбора уровней детализации
+     * @param settings Параметры
+     */
+    void setLodSettings(const VkRendererLodSettings& settings);
+
+    /**
+     * Получить параметры выбора уровней детализации
+     * @return Константная ссылка на структуру
+     */
+    const VkRendererLodSettings& getLodSettings() const;
+
+    /**
+     * Сменить параметры показа кадров
+     * @param presentPolicy Параметры показа
+     *
+     * @details Swap-chain пересоздается (с ожиданием завершения всех кадров)
+     */
+    void setPresentPolicy(const VkRendererPresentPolicy& presentPolicy);
+
+    /**
+     * Получить параметры показа кадров
+     * @return Константная ссылка на структуру параметров
+     */
+    const VkRendererPresentPolicy& getPresentPolicy() const;
+
+    /**
+     * Сообщить о событии ввода (для замера задержки от ввода до показа)
+     *
+     * @details Задержка отсчитывается от самого раннего события ввода, не учтенного предыдущими кадрами,
+     * до постановки следующего кадра в очередь показа
+     */
+    void notifyInputEvent();
+
     /**
      * Рендеринг кадра
      */
     void draw();
+
+    /**
+     * Рендеринг заданного кол-ва кадров с ожиданием их завершения
+     * @param frameCount Кол-во кадров
+     *
+     * @details Кадры отправляются без ожидания друг друга (в пределах кол-ва кадров в полете), ожидаются только
+     * в конце. Удобно для пакетного рендеринга и замеров пропускной способности во внеэкранном режиме
+     */
+    void renderFrames(size_t frameCount);
+
+    /**
+     * Используется ли внеэкранный режим
+     * @return Да или нет
+     */
+    bool isHeadless() const;
+
+    /**
+     * Получить итоговый кадровый буфер (кадровый буфер пост-обработки)
+     * @param index Индекс кадрового буфера (во внеэкранном режиме совпадает с индексом кадра в полете)
+     * @return Константная ссылка на объект кадрового буфера
+     */
+    const vk::resources::FrameBuffer& getOutputFrameBuffer(size_t index) const;
+
+    /**
+     * Индекс кадрового буфера, в который был отрисован последний отправленный кадр
+     * @return Индекс кадрового буфера
+     */
+    uint32_t getLastFrameBufferIndex() const;
 };
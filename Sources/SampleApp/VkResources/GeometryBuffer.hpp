@@ -2,11 +2,32 @@
 
 #include "../VkTools/Tools.h"
 #include "../VkTools/Buffer.hpp"
+#include "GeometryPool.hpp"
 
 namespace vk
 {
     namespace resources
     {
+        /**
+         * Уровень детализации (LOD) геометрии - участок индексов, ссылающийся на общие вершины
+         */
+        struct GeometryLod
+        {
+            /// Смещение первого индекса уровня относительно первого индекса участка
+            uint32_t indexOffset = 0;
+            /// Кол-во индексов уровня
+            uint32_t indexCount = 0;
+            /// Геометрическая ошибка упрощения (в единицах локального пространства, 0 для исходной геометрии)
+            float error = 0.0f;
+        };
+
+        /**
+         * Геометрический буфер - участок пула геометрии (см. GeometryPool)
+         *
+         * @details Собственных буферов не имеет: вершины и индексы размещаются в общих буферах блока пула,
+         * а объект хранит только смещения и кол-ва. Буферы, возвращаемые getter'ами, общие для всей геометрии блока,
+         * поэтому при рисовании следует использовать getFirstVertex()/getFirstIndex()
+         */
         class GeometryBuffer
         {
         private:
@@ -14,51 +35,28 @@ namespace vk
             bool isReady_;
             /// Индексированная геометрия
             bool isIndexed_;
-            /// Указатель на устройство владеющее буфером геометрии
-            const vk::tools::Device* pDevice_;
-            /// Буфер вершин
-            vk::tools::Buffer vertexBuffer_;
-            /// Буфер индексов
-            vk::tools::Buffer indexBuffer_;
+            /// Указатель на пул, в котором размещена геометрия
+            vk::resources::GeometryPool* pPool_;
+            /// Участок пула
+            vk::resources::GeometryPoolAllocation allocation_;
+            /// Загружен ли поток положений (для пред-прохода глубины)
+            bool hasPositionStream_;
+            /// Загружен ли поток данных скелета (только если у вершин есть веса)
+            bool hasSkinStream_;
+            /// Загружен ли поток цветов (только если цвета отличаются от белого)
+            bool hasColorStream_;
+            /// Тип индексов (16-битные, если кол-во вершин позволяет)
+            vk::IndexType indexType_;
             /// Кол-во вершин
             size_t vertexCount_;
-            /// Кол-во индексов
+            /// Кол-во индексов (исходной геометрии, без уровней детализации)
             size_t indexCount_;
-
-            /**
-             * Копирование содержимого из временного буфера в основной
-             * @param srcBuffer Исходный буфер
-             * @param dstBuffer Целевой буфер
-             * @param size Размер
-             *
-             * @details Функция использует команду копирования буфера. Для ее выполнения необходимо выделить командный буфер
-             * и отправить его в очередь. Очередь должна поддерживать команды копирования данных, благо семейство команд рисования
-             * по умолчанию поддерживает копирование данных, и нет нужны в отдельном семействе
-             */
-            void copyTmpToDst(const vk::Buffer& srcBuffer, const vk::Buffer& dstBuffer, vk::DeviceSize size)
-            {
-                // Выделить командный буфер для исполнения команды копирования
-                vk::CommandBufferAllocateInfo commandBufferAllocateInfo{};
-                commandBufferAllocateInfo.commandBufferCount = 1;
-                commandBufferAllocateInfo.commandPool = pDevice_->getCommandGfxPool().get();
-                commandBufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
-                auto cmdBuffers = pDevice_->getLogicalDevice()->allocateCommandBuffers(commandBufferAllocateInfo);
-
-                // Записать команду в буфер
-                cmdBuffers[0].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-                cmdBuffers[0].copyBuffer(srcBuffer,dstBuffer,vk::BufferCopy(0,0,size));
-                cmdBuffers[0].end();
-
-                // Отправить команду в очередь и подождать выполнения
-                vk::SubmitInfo submitInfo{};
-                submitInfo.commandBufferCount = cmdBuffers.size();
-                submitInfo.pCommandBuffers = cmdBuffers.data();
-                pDevice_->getGraphicsQueue().submit({submitInfo},{});
-                pDevice_->getGraphicsQueue().waitIdle();
-
-                // Очищаем буфер команд
-                pDevice_->getLogicalDevice()->free(pDevice_->getCommandGfxPool().get(),cmdBuffers.size(),cmdBuffers.data());
-            }
+            /// Ограничивающие объемы (в локальном пространстве)
+            vk::tools::Bounds bounds_;
+            /// Уровни детализации (0 - исходная геометрия)
+            std::vector<GeometryLod> lods_;
+            /// Номер партии загрузки данных в память устройства
+            vk::tools::UploadTicket uploadTicket_;
 
         public:
             /**
@@ -67,9 +65,16 @@ namespace vk
             GeometryBuffer():
                     isReady_(false),
                     isIndexed_(false),
-                    pDevice_(nullptr),
+                    pPool_(nullptr),
+                    hasPositionStream_(false),
+                    hasSkinStream_(false),
+                    hasColorStream_(false),
+                    indexType_(vk::IndexType::eUint32),
                     vertexCount_(0),
-                    indexCount_(0){};
+                    indexCount_(0),
+                    bounds_(),
+                    lods_(),
+                    uploadTicket_(0){};
 
             /**
              * Запрет копирования через инициализацию
@@ -93,12 +98,17 @@ namespace vk
             {
                 std::swap(isReady_,other.isReady_);
                 std::swap(isIndexed_,other.isIndexed_);
-                std::swap(pDevice_,other.pDevice_);
+                std::swap(pPool_,other.pPool_);
+                std::swap(allocation_,other.allocation_);
+                std::swap(hasPositionStream_,other.hasPositionStream_);
+                std::swap(hasSkinStream_,other.hasSkinStream_);
+                std::swap(hasColorStream_,other.hasColorStream_);
+                std::swap(indexType_,other.indexType_);
                 std::swap(vertexCount_,other.vertexCount_);
                 std::swap(indexCount_,other.indexCount_);
-
-                vertexBuffer_ = std::move(other.vertexBuffer_);
-                indexBuffer_ = std::move(other.indexBuffer_);
+                std::swap(bounds_,other.bounds_);
+                std::swap(lods_,other.lods_);
+                std::swap(uploadTicket_,other.uploadTicket_);
             }
 
             /**
@@ -111,125 +121,167 @@ namespace vk
                 if (this == &other) return *this;
 
                 this->destroyVulkanResources();
-                isReady_ = false;
-                isIndexed_ = false;
-                pDevice_ = nullptr;
-                vertexCount_ = 0;
-                indexCount_ = 0;
 
                 std::swap(isReady_,other.isReady_);
                 std::swap(isIndexed_,other.isIndexed_);
-                std::swap(pDevice_,other.pDevice_);
+                std::swap(pPool_,other.pPool_);
+                std::swap(allocation_,other.allocation_);
+                std::swap(hasPositionStream_,other.hasPositionStream_);
+                std::swap(hasSkinStream_,other.hasSkinStream_);
+                std::swap(hasColorStream_,other.hasColorStream_);
+                std::swap(indexType_,other.indexType_);
                 std::swap(vertexCount_,other.vertexCount_);
                 std::swap(indexCount_,other.indexCount_);
-
-                vertexBuffer_ = std::move(other.vertexBuffer_);
-                indexBuffer_ = std::move(other.indexBuffer_);
+                std::swap(bounds_,other.bounds_);
+                std::swap(lods_,other.lods_);
+                std::swap(uploadTicket_,other.uploadTicket_);
 
                 return *this;
             }
 
             /**
              * Основной конструктор геометрического буфера
-             * @param pDevice Указатель на устройство
+             * @param pPool Указатель на пул геометрии
              * @param vertices Массив вершин
              * @param indices Массив индексов
+             * @param positionStream Загрузить поток положений вершин (для пред-прохода глубины)
+             * @param lodIndices Массивы индексов упрощенных уровней детализации (от подробного к грубому)
+             * @param lodErrors Геометрические ошибки упрощенных уровней (по одной на уровень)
+             *
+             * @details Вершины упаковываются в компактный формат (см. vk::tools::VertexPacked). Данные скелета и цвета
+             * загружаются только если они отличаются от значений по умолчанию. Индексы отсчитываются от первой вершины
+             * участка, поэтому если кол-во вершин позволяет, они хранятся как 16-битные. Индексы уровней детализации
+             * размещаются в том же участке вслед за исходными (вершины у всех уровней общие)
              */
-            GeometryBuffer(const vk::tools::Device* pDevice, const std::vector<vk::tools::Vertex>& vertices, const std::vector<uint32_t>& indices):
+            GeometryBuffer(vk::resources::GeometryPool* pPool,
+                    const std::vector<vk::tools::Vertex>& vertices,
+                    const std::vector<uint32_t>& indices,
+                    bool positionStream = true,
+                    const std::vector<std::vector<uint32_t>>& lodIndices = {},
+                    const std::vector<float>& lodErrors = {}):
                     isReady_(false),
                     isIndexed_(!indices.empty()),
-                    pDevice_(pDevice),
+                    pPool_(pPool),
+                    hasPositionStream_(positionStream),
+                    hasSkinStream_(false),
+                    hasColorStream_(false),
+                    indexType_(vk::IndexType::eUint32),
                     vertexCount_(vertices.size()),
-                    indexCount_(indices.size())
+                    indexCount_(indices.size()),
+                    bounds_(vk::tools::ComputeBounds(vertices)),
+                    lods_(),
+                    uploadTicket_(0)
             {
-                // Проверить устройство
-                if(pDevice_ == nullptr || !pDevice_->isReady()){
-                    throw vk::DeviceLostError("Device is not available");
+                // Проверить пул
+                if(pPool_ == nullptr || !pPool_->isReady()){
+                    throw vk::InitializationFailedError("Geometry pool is not available");
                 }
                 // Проверить вершины
                 if(vertices.empty()){
                     throw vk::InitializationFailedError("No vertices provided");
                 }
 
-                // Данные о вершинах и индексах желательно располагать в памяти устройства, а не хоста,
-                // но мы не можем напрямую помещать данные в память устройства. Однако, можем копировать из
-                // буфера хоста (временного буфера) в буфер устройства.
+                // Упаковать вершины, попутно определив нужны ли потоки скелета и цвета
+                std::vector<vk::tools::VertexPacked> packedVertices(vertexCount_);
+                for(size_t i = 0; i < vertexCount_; i++)
+                {
+                    packedVertices[i] = vk::tools::PackVertex(vertices[i]);
+                    hasSkinStream_ = hasSkinStream_ || vertices[i].boneIndices != glm::ivec4(0,0,0,0) || vertices[i].weights != glm::vec4(1.0f,0.0f,0.0f,0.0f);
+                    hasColorStream_ = hasColorStream_ || vertices[i].color != glm::vec3(1.0f,1.0f,1.0f);
+                }
+
+                // Положения (пред-проход глубины читает только их, поэтому плотный поток экономит пропускную способность)
+                std::vector<glm::vec3> positions;
+                if(hasPositionStream_)
+                {
+                    positions.resize(vertexCount_);
+                    for(size_t i = 0; i < vertexCount_; i++){
+                        positions[i] = vertices[i].position;
+                    }
+                }
+
+                // Данные скелета
+                std::vector<vk::tools::VertexSkinPacked> packedSkin;
+                if(hasSkinStream_)
+                {
+                    packedSkin.resize(vertexCount_);
+                    for(size_t i = 0; i < vertexCount_; i++){
+                        packedSkin[i] = vk::tools::PackVertexSkin(vertices[i]);
+                    }
+                }
 
-                // Загрузка вершинного буфера в память устройства
+                // Цвета
+                std::vector<vk::tools::VertexColorPacked> packedColors;
+                if(hasColorStream_)
                 {
-                    // Создать временный буфер вершин (память хоста)
-                    vk::tools::Buffer stagingVertexBuffer = vk::tools::Buffer(pDevice_,
-                            sizeof(tools::Vertex) * vertexCount_,
-                            vk::BufferUsageFlagBits::eTransferSrc,
-                            vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-                    // Создать основной буфер вершин (память устройства)
-                    // Данный буфер может быть также использован при трассировке лучей, как часть BLAS (флаг eRayTracingKHR)
-                    vertexBuffer_ = vk::tools::Buffer(pDevice_,
-                            sizeof(tools::Vertex) * vertexCount_,
-                            vk::BufferUsageFlagBits::eTransferDst|vk::BufferUsageFlagBits::eVertexBuffer,
-                            vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-                    // Заполнить временный буфер вершин
-                    auto pStagingVertexBufferData = stagingVertexBuffer.mapMemory(0,sizeof(tools::Vertex) * vertexCount_);
-                    memcpy(pStagingVertexBufferData,vertices.data(),sizeof(tools::Vertex) * vertexCount_);
-                    stagingVertexBuffer.unmapMemory();
-
-                    // Копировать из временного буфера в основной
-                    this->copyTmpToDst(
-                            stagingVertexBuffer.getBuffer().get(),
-                            vertexBuffer_.getBuffer().get(),
-                            stagingVertexBuffer.getSize());
-
-                    // Очищаем временный буфер (не обязательно, все равно очистится, но можно для ясности)
-                    stagingVertexBuffer.destroyVulkanResources();
+                    packedColors.resize(vertexCount_);
+                    for(size_t i = 0; i < vertexCount_; i++){
+                        packedColors[i] = vk::tools::PackVertexColor(vertices[i]);
+                    }
                 }
 
-                // Загрузка буфера индексов в память (если индексы были переданы)
+                // Уровни детализации (исходная геометрия и упрощенные уровни, только для индексированной геометрии)
+                lods_.push_back({0, static_cast<uint32_t>(indexCount_), 0.0f});
+                std::vector<uint32_t> lodIndicesAll;
+                if(isIndexed_ && !lodIndices.empty())
+                {
+                    lodIndicesAll = indices;
+                    for(size_t i = 0; i < lodIndices.size(); i++)
+                    {
+                        if(lodIndices[i].empty()) continue;
+                        lods_.push_back({
+                                static_cast<uint32_t>(lodIndicesAll.size()),
+                                static_cast<uint32_t>(lodIndices[i].size()),
+                                i < lodErrors.size() ? lodErrors[i] : 0.0f});
+                        lodIndicesAll.insert(lodIndicesAll.end(), lodIndices[i].begin(), lodIndices[i].end());
+                    }
+                }
+                const std::vector<uint32_t>& indicesAll = lodIndicesAll.empty() ? indices : lodIndicesAll;
+
+                // Индексы (максимальный индекс 16-битного буфера - 65535)
+                std::vector<uint16_t> indices16;
+                const void* indexData = nullptr;
+                size_t indexSize = 0;
                 if(isIndexed_)
                 {
-                    // Создать временный буфер индексов (память хоста)
-                    vk::tools::Buffer stagingIndexBuffer = vk::tools::Buffer(pDevice_,
-                            sizeof(size_t) * indexCount_,
-                            vk::BufferUsageFlagBits::eTransferSrc,
-                            vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-                    // Создать основной буфер вершин (память устройства)
-                    // Данный буфер может быть также использован при трассировке лучей, как часть BLAS (флаг eRayTracingKHR)
-                    indexBuffer_ = vk::tools::Buffer(pDevice_,
-                            sizeof(size_t) * indexCount_,
-                            vk::BufferUsageFlagBits::eTransferDst|vk::BufferUsageFlagBits::eIndexBuffer,
-                            vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-                    // Заполнить временный буфер индексов
-                    auto pStagingIndexBufferData = stagingIndexBuffer.mapMemory();
-                    memcpy(pStagingIndexBufferData,indices.data(),sizeof(size_t) * indexCount_);
-                    stagingIndexBuffer.unmapMemory();
-
-                    // Копировать из временного буфера в основной
-                    this->copyTmpToDst(
-                            stagingIndexBuffer.getBuffer().get(),
-                            indexBuffer_.getBuffer().get(),
-                            stagingIndexBuffer.getSize());
-
-                    // Очищаем временный буфер (не обязательно, все равно очистится, но можно для ясности)
-                    stagingIndexBuffer.destroyVulkanResources();
+                    if(vertexCount_ <= 0x10000)
+                    {
+                        indices16.assign(indicesAll.begin(), indicesAll.end());
+                        indexType_ = vk::IndexType::eUint16;
+                        indexData = indices16.data();
+                        indexSize = sizeof(uint16_t) * indicesAll.size();
+                    }
+                    else
+                    {
+                        indexData = indicesAll.data();
+                        indexSize = sizeof(uint32_t) * indicesAll.size();
+                    }
                 }
 
+                // Выделить участок пула и загрузить данные в память устройства
+                allocation_ = pPool_->allocate(vertexCount_, indexSize);
+                uploadTicket_ = pPool_->upload(allocation_,
+                        packedVertices.data(),
+                        hasPositionStream_ ? positions.data() : nullptr,
+                        hasSkinStream_ ? packedSkin.data() : nullptr,
+                        hasColorStream_ ? packedColors.data() : nullptr,
+                        indexData);
+
                 // Объект готов
                 isReady_ = true;
             }
 
             /**
              * Де-инициализация ресурсов Vulkan
+             * @details Участок возвращается пулу (вызывающая сторона отвечает за то, что GPU его уже не использует)
              */
             void destroyVulkanResources()
             {
-                // Если объект инициализирован и устройство доступно
+                // Если объект инициализирован
                 if(isReady_)
                 {
-                    vertexBuffer_.destroyVulkanResources();
-                    indexBuffer_.destroyVulkanResources();
+                    pPool_->free(allocation_);
+                    allocation_ = {};
                     isReady_ = false;
                 }
             }
@@ -260,21 +312,111 @@ namespace vk
             }
 
             /**
-             * Получить буфер вершин
+             * Получить индекс блока пула, в котором размещена геометрия
+             * @return Индекс блока
+             */
+            size_t getPoolBlockIndex() const
+            {
+                return allocation_.blockIndex;
+            }
+
+            /**
+             * Получить буфер вершин (общий буфер блока пула)
              * @return Константная ссылка на объект-обертку буфера
              */
             const vk::tools::Buffer& getVertexBuffer() const
             {
-                return vertexBuffer_;
+                return pPool_->getBlock(allocation_.blockIndex).vertexBuffer;
+            }
+
+            /**
+             * Загружен ли поток положений вершин
+             * @return Да или нет
+             */
+            bool hasPositionStream() const
+            {
+                return hasPositionStream_;
+            }
+
+            /**
+             * Получить буфер положений вершин (общий буфер блока пула)
+             * @return Константная ссылка на объект-обертку буфера
+             */
+            const vk::tools::Buffer& getPositionBuffer() const
+            {
+                return pPool_->getBlock(allocation_.blockIndex).positionBuffer;
+            }
+
+            /**
+             * Загружен ли поток данных скелета
+             * @return Да или нет
+             */
+            bool hasSkinStream() const
+            {
+                return hasSkinStream_;
+            }
+
+            /**
+             * Получить буфер данных скелета (общий буфер блока пула)
+             * @return Константная ссылка на объект-обертку буфера
+             */
+            const vk::tools::Buffer& getSkinBuffer() const
+            {
+                return pPool_->getBlock(allocation_.blockIndex).skinBuffer;
+            }
+
+            /**
+             * Загружен ли поток цветов вершин
+             * @return Да или нет
+             */
+            bool hasColorStream() const
+            {
+                return hasColorStream_;
             }
 
             /**
-             * Получить буфер индексов
+             * Получить буфер цветов вершин (общий буфер блока пула)
+             * @return Константная ссылка на объект-обертку буфера
+             */
+            const vk::tools::Buffer& getColorBuffer() const
+            {
+                return pPool_->getBlock(allocation_.blockIndex).colorBuffer;
+            }
+
+            /**
+             * Получить буфер индексов (общий буфер блока пула)
              * @return Константная ссылка на объект обертку буфера
              */
             const vk::tools::Buffer& getIndexBuffer() const
             {
-                return indexBuffer_;
+                return pPool_->getBlock(allocation_.blockIndex).indexBuffer;
+            }
+
+            /**
+             * Получить тип индексов
+             * @return Тип индексов (eUint16 или eUint32)
+             */
+            vk::IndexType getIndexType() const
+            {
+                return indexType_;
+            }
+
+            /**
+             * Получить первую вершину участка (vertexOffset для индексированного рисования, firstVertex - для обычного)
+             * @return Номер вершины в буферах вершин блока
+             */
+            uint32_t getFirstVertex() const
+            {
+                return static_cast<uint32_t>(allocation_.firstVertex);
+            }
+
+            /**
+             * Получить первый индекс участка (firstIndex для индексированного рисования)
+             * @return Номер индекса в буфере индексов блока (в единицах типа индексов)
+             */
+            uint32_t getFirstIndex() const
+            {
+                return static_cast<uint32_t>(allocation_.indexOffset / (indexType_ == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)));
             }
 
             /**
@@ -287,7 +429,7 @@ namespace vk
             }
 
             /**
-             * Получить кол-во индексов
+             * Получить кол-во индексов (исходной геометрии, уровень детализации 0)
              * @return Целое положительное число
              */
             size_t getIndexCount() const
@@ -295,13 +437,70 @@ namespace vk
                 return indexCount_;
             }
 
+            /**
+             * Получить кол-во уровней детализации (не меньше 1 - исходная геометрия)
+             * @return Целое положительное число
+             */
+            size_t getLodCount() const
+            {
+                return lods_.size();
+            }
+
+            /**
+             * Получить уровень детализации
+             * @param lod Номер уровня (0 - исходная геометрия)
+             * @return Константная ссылка на структуру
+             */
+            const GeometryLod& getLod(size_t lod) const
+            {
+                return lods_[lod];
+            }
+
+            /**
+             * Получить первый индекс уровня детализации (firstIndex для индексированного рисования)
+             * @param lod Номер уровня (0 - исходная геометрия)
+             * @return Номер индекса в буфере индексов блока (в единицах типа индексов)
+             */
+            uint32_t getLodFirstIndex(size_t lod) const
+            {
+                return this->getFirstIndex() + lods_[lod].indexOffset;
+            }
+
+            /**
+             * Получить кол-во индексов уровня детализации
+             * @param lod Номер уровня (0 - исходная геометрия)
+             * @return Целое положительное число
+             */
+            uint32_t getLodIndexCount(size_t lod) const
+            {
+                return lods_[lod].indexCount;
+            }
+
+            /**
+             * Получить ограничивающие объемы геометрии (в локальном пространстве)
+             * @return Константная ссылка на структуру
+             */
+            const vk::tools::Bounds& getBounds() const
+            {
+                return bounds_;
+            }
+
+            /**
+             * Получить номер партии загрузки данных в память устройства
+             * @return Номер партии (геометрию можно рисовать, когда партия станет видимой графической очереди)
+             */
+            vk::tools::UploadTicket getUploadTicket() const
+            {
+                return uploadTicket_;
+            }
+
             /**
              * Получить указатель на владеющее устройство
              * @return Константный указатель
              */
             const vk::tools::Device* getOwnerDevice() const
             {
-                return pDevice_;
+                return pPool_ != nullptr ? pPool_->getOwnerDevice() : nullptr;
             }
         };
 
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "../VkTools/Tools.h"
+#include "../VkTools/Buffer.hpp"
+#include "../Tools/RangeAllocator.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vk
+{
+    namespace resources
+    {
+        /**
+         * Блок пула геометрии - набор больших буферов, общих для многих геометрических буферов
+         *
+         * @details Потоки вершин (основной, положения, скелет, цвет) параллельны - вершина с индексом i
+         * во всех потоках имеет одно и то же смещение, поэтому одно смещение вершин (vertexOffset при рисовании)
+         * подходит для всех потоков. Нулевая вершина блока зарезервирована под значения необязательных потоков
+         * по умолчанию (кость 0 с весом 1, белый цвет) - их читают конвейеры, описывающие эти потоки с нулевым шагом
+         */
+        struct GeometryPoolBlock
+        {
+            /// Буфер вершин (основной поток, vk::tools::VertexPacked)
+            vk::tools::Buffer vertexBuffer;
+            /// Буфер положений вершин (glm::vec3)
+            vk::tools::Buffer positionBuffer;
+            /// Буфер данных скелета (vk::tools::VertexSkinPacked)
+            vk::tools::Buffer skinBuffer;
+            /// Буфер цветов вершин (vk::tools::VertexColorPacked)
+            vk::tools::Buffer colorBuffer;
+            /// Буфер индексов (16 и 32-битные индексы вперемешку, смещения выровнены по 4 байта)
+            vk::tools::Buffer indexBuffer;
+            /// Распределитель вершин (в вершинах)
+            ::tools::RangeAllocator vertexAllocator;
+            /// Распределитель индексов (в байтах)
+            ::tools::RangeAllocator indexAllocator;
+        };
+
+        /**
+         * Участок пула геометрии, выделенный под один геометрический буфер
+         */
+        struct GeometryPoolAllocation
+        {
+            /// Индекс блока пула
+            size_t blockIndex = 0;
+            /// Первая вершина (в вершинах от начала буферов вершин блока)
+            size_t firstVertex = 0;
+            /// Кол-во вершин
+            size_t vertexCount = 0;
+            /// Смещение индексов (в байтах от начала буфера индексов блока)
+            size_t indexOffset = 0;
+            /// Размер индексов (в байтах)
+            size_t indexSize = 0;
+        };
+
+        /**
+         * Пул геометрии - суб-аллокация вершин и индексов из нескольких больших буферов памяти устройства
+         *
+         * @details Вместо отдельных буферов (и отдельных выделений памяти) на каждый геометрический буфер, геометрия
+         * размещается в общих блоках. Меши, геометрия которых находится в одном блоке, рисуются без перепривязки
+         * буферов - смещения задаются параметрами vertexOffset/firstIndex команд рисования. Новый блок создается,
+         * когда геометрия не помещается ни в один из существующих. Не потокобезопасен
+         */
+        class GeometryPool
+        {
+        private:
+            /// Выравнивание смещений индексов (подходит и для 16, и для 32-битных индексов)
+            static constexpr size_t INDEX_ALIGNMENT = 4;
+
+            /// Готов ли пул
+            bool isReady_;
+            /// Указатель на устройство
+            const vk::tools::Device* pDevice_;
+            /// Кол-во вершин в блоке (по умолчанию)
+            size_t blockVertexCount_;
+            /// Размер буфера индексов блока в байтах (по умолчанию)
+            size_t blockIndexSize_;
+            /// Блоки
+            std::vector<GeometryPoolBlock> blocks_;
+
+            /**
+             * Создать новый блок
+             * @param vertexCount Кол-во вершин (включая зарезервированную нулевую)
+             * @param indexSize Размер буфера индексов в байтах
+             */
+            void createBlock(size_t vertexCount, size_t indexSize)
+            {
+                const vk::BufferUsageFlags vertexUsage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+                const vk::BufferUsageFlags indexUsage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+
+                GeometryPoolBlock block{};
+                block.vertexBuffer = vk::tools::Buffer(pDevice_, sizeof(vk::tools::VertexPacked) * vertexCount, vertexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                block.positionBuffer = vk::tools::Buffer(pDevice_, sizeof(glm::vec3) * vertexCount, vertexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                block.skinBuffer = vk::tools::Buffer(pDevice_, sizeof(vk::tools::VertexSkinPacked) * vertexCount, vertexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                block.colorBuffer = vk::tools::Buffer(pDevice_, sizeof(vk::tools::VertexColorPacked) * vertexCount, vertexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                block.indexBuffer = vk::tools::Buffer(pDevice_, indexSize, indexUsage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+                block.vertexAllocator = ::tools::RangeAllocator(vertexCount);
+                block.indexAllocator = ::tools::RangeAllocator(indexSize);
+
+                // Зарезервировать нулевую вершину под значения по умолчанию
+                GeometryPoolAllocation defaults{};
+                defaults.blockIndex = blocks_.size();
+                defaults.vertexCount = 1;
+                block.vertexAllocator.allocate(1, 1, &defaults.firstVertex);
+                blocks_.push_back(std::move(block));
+
+                vk::tools::Vertex defaultVertex{};
+                defaultVertex.color = {1.0f,1.0f,1.0f};
+                const vk::tools::VertexSkinPacked defaultSkin = vk::tools::PackVertexSkin(defaultVertex);
+                const vk::tools::VertexColorPacked defaultColor = vk::tools::PackVertexColor(defaultVertex);
+                this->upload(defaults, nullptr, nullptr, &defaultSkin, &defaultColor, nullptr);
+            }
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            GeometryPool():
+                    isReady_(false),
+                    pDevice_(nullptr),
+                    blockVertexCount_(0),
+                    blockIndexSize_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            GeometryPool(const GeometryPool& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            GeometryPool& operator=(const GeometryPool& other) = delete;
+
+            /**
+             * Конструктор перемещения
+             * @param other R-value ссылка на другой объект
+             * @details Нельзя копировать объект, но можно обменяться с ним ресурсом
+             */
+            GeometryPool(GeometryPool&& other) noexcept:GeometryPool()
+            {
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(blockVertexCount_,other.blockVertexCount_);
+                std::swap(blockIndexSize_,other.blockIndexSize_);
+                std::swap(blocks_,other.blocks_);
+            }
+
+            /**
+             * Перемещение через присваивание
+             * @param other R-value ссылка на другой объект
+             * @return Ссылка на текущий объект
+             */
+            GeometryPool& operator=(GeometryPool&& other) noexcept
+            {
+                if (this == &other) return *this;
+
+                this->destroyVulkanResources();
+
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(blockVertexCount_,other.blockVertexCount_);
+                std::swap(blockIndexSize_,other.blockIndexSize_);
+                std::swap(blocks_,other.blocks_);
+
+                return *this;
+            }
+
+            /**
+             * Основной конструктор
+             * @param pDevice Указатель на устройство
+             * @param blockVertexCount Кол-во вершин в блоке
+             * @param blockIndexSize Размер буфера индексов блока в байтах
+             *
+             * @details Первый блок создается сразу. Геометрия, не помещающаяся в блок заданного размера,
+             * получает отдельный блок подходящего размера
+             */
+            GeometryPool(const vk::tools::Device* pDevice, size_t blockVertexCount, size_t blockIndexSize):
+                    isReady_(false),
+                    pDevice_(pDevice),
+                    blockVertexCount_(blockVertexCount),
+                    blockIndexSize_(blockIndexSize)
+            {
+                // Проверить устройство
+                if(pDevice_ == nullptr || !pDevice_->isReady()){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                this->createBlock(blockVertexCount_, blockIndexSize_);
+                isReady_ = true;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~GeometryPool()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Де-инициализация ресурсов Vulkan
+             */
+            void destroyVulkanResources()
+            {
+                if(isReady_)
+                {
+                    // Буферы блоков нельзя уничтожить, пока не выполнены команды загрузки в них
+                    if(pDevice_->getUploadManager() != nullptr){
+                        pDevice_->getUploadManager()->waitIdle();
+                    }
+
+                    blocks_.clear();
+                    pDevice_ = nullptr;
+                    isReady_ = false;
+                }
+            }
+
+            /**
+             * Выделить участок под геометрию
+             * @param vertexCount Кол-во вершин
+             * @param indexSize Размер индексов в байтах (0 - геометрия без индексов)
+             * @return Выделенный участок
+             *
+             * @details Если участок не помещается ни в один блок, создается новый блок. Если не удалось выделить участок
+             * и в новом блоке, бросается исключение
+             */
+            GeometryPoolAllocation allocate(size_t vertexCount, size_t indexSize)
+            {
+                GeometryPoolAllocation allocation{};
+                allocation.vertexCount = vertexCount;
+                allocation.indexSize = indexSize;
+
+                // Первый блок, в котором есть место и для вершин, и для индексов
+                for(size_t i = 0; i < blocks_.size(); i++)
+                {
+                    auto& block = blocks_[i];
+                    if(!block.vertexAllocator.allocate(vertexCount, 1, &allocation.firstVertex)) continue;
+
+                    if(indexSize > 0 && !block.indexAllocator.allocate(indexSize, INDEX_ALIGNMENT, &allocation.indexOffset)){
+                        block.vertexAllocator.free(allocation.firstVertex, vertexCount);
+                        continue;
+                    }
+
+                    allocation.blockIndex = i;
+                    return allocation;
+                }
+
+                // Новый блок (не меньше размера по умолчанию, с учетом зарезервированной вершины)
+                this->createBlock((std::max)(blockVertexCount_, vertexCount + 1), (std::max)(blockIndexSize_, indexSize));
+                allocation.blockIndex = blocks_.size() - 1;
+
+                // Блок создан под этот запрос, поэтому неудача означает ошибку в расчете его размера
+                auto& block = blocks_.back();
+                if(!block.vertexAllocator.allocate(vertexCount, 1, &allocation.firstVertex)){
+                    throw vk::OutOfDeviceMemoryError("Can't allocate geometry. Not enough vertex space in new pool block");
+                }
+
+                if(indexSize > 0 && !block.indexAllocator.allocate(indexSize, INDEX_ALIGNMENT, &allocation.indexOffset)){
+                    block.vertexAllocator.free(allocation.firstVertex, vertexCount);
+                    throw vk::OutOfDeviceMemoryError("Can't allocate geometry. Not enough index space in new pool block");
+                }
+
+                return allocation;
+            }
+
+            /**
+             * Освободить участок
+             * @param allocation Участок, полученный при выделении
+             *
+             * @details Вызывающая сторона отвечает за то, чтобы участок уже не использовался GPU
+             */
+            void free(const GeometryPoolAllocation& allocation)
+            {
+                if(!isReady_ || allocation.vertexCount == 0) return;
+
+                auto& block = blocks_[allocation.blockIndex];
+                block.vertexAllocator.free(allocation.firstVertex, allocation.vertexCount);
+                block.indexAllocator.free(allocation.indexOffset, allocation.indexSize);
+            }
+
+            /**
+             * Загрузить данные участка в память устройства
+             * @param allocation Участок
+             * @param vertices Основной поток вершин (nullptr - не загружать)
+             * @param positions Положения вершин (nullptr - не загружать)
+             * @param skin Данные скелета (nullptr - не загружать)
+             * @param colors Цвета вершин (nullptr - не загружать)
+             * @param indices Индексы (nullptr - не загружать)
+             * @return Номер партии загрузки (данные можно использовать, когда партия станет видимой графической очереди)
+             *
+             * @details Все потоки копируются через один участок промежуточного буфера менеджера загрузки. Записанные участки
+             * передаются графическому семейству (участки блока, используемые рендерингом, не затрагиваются)
+             */
+            vk::tools::UploadTicket upload(const GeometryPoolAllocation& allocation,
+                    const vk::tools::VertexPacked* vertices,
+                    const glm::vec3* positions,
+                    const vk::tools::VertexSkinPacked* skin,
+                    const vk::tools::VertexColorPacked* colors,
+                    const void* indices)
+            {
+                auto& block = blocks_[allocation.blockIndex];
+
+                // Источники данных и целевые участки потоков
+                struct StreamCopy { const void* data; const vk::tools::Buffer* dst; vk::DeviceSize dstOffset; size_t size; };
+                const size_t count = allocation.vertexCount;
+                const StreamCopy streams[5] = {
+                        {vertices, &block.vertexBuffer, sizeof(vk::tools::VertexPacked) * allocation.firstVertex, sizeof(vk::tools::VertexPacked) * count},
+                        {positions, &block.positionBuffer, sizeof(glm::vec3) * allocation.firstVertex, sizeof(glm::vec3) * count},
+                        {skin, &block.skinBuffer, sizeof(vk::tools::VertexSkinPacked) * allocation.firstVertex, sizeof(vk::tools::VertexSkinPacked) * count},
+                        {colors, &block.colorBuffer, sizeof(vk::tools::VertexColorPacked) * allocation.firstVertex, sizeof(vk::tools::VertexColorPacked) * count},
+                        {indices, &block.indexBuffer, allocation.indexOffset, allocation.indexSize}
+                };
+
+                // Общий размер временного буфера
+                size_t stagingSize = 0;
+                for(const auto& stream : streams){
+                    if(stream.data != nullptr) stagingSize += stream.size;
+                }
+                if(stagingSize == 0) return 0;
+
+                // Скопировать потоки в промежуточный буфер менеджера загрузки и записать команды копирования
+                // (по одной на поток) в общую партию - без ожидания выполнения
+                return pDevice_->getUploadManager()->record(stagingSize,[&](const vk::tools::UploadCommands& commands, const vk::Buffer& stagingBuffer, vk::DeviceSize stagingOffset, unsigned char* pStagingData){
+                    for(const auto& stream : streams){
+                        if(stream.data == nullptr || stream.size == 0) continue;
+                        memcpy(pStagingData, stream.data, stream.size);
+                        commands.getTransferCommandBuffer().copyBuffer(stagingBuffer, stream.dst->getBuffer().get(), vk::BufferCopy(stagingOffset, stream.dstOffset, stream.size));
+                        commands.transferBufferOwnership(stream.dst->getBuffer().get(), stream.dstOffset, stream.size);
+                        pStagingData += stream.size;
+                        stagingOffset += stream.size;
+                    }
+                });
+            }
+
+            /**
+             * Был ли объект инициализирован
+             * @return Да или нет
+             */
+            bool isReady() const
+            {
+                return isReady_;
+            }
+
+            /**
+             * Получить блок
+             * @param index Индекс блока
+             * @return Константная ссылка на блок
+             */
+            const GeometryPoolBlock& getBlock(size_t index) const
+            {
+                return blocks_[index];
+            }
+
+            /**
+             * Получить кол-во блоков
+             * @return Кол-во блоков
+             */
+            size_t getBlockCount() const
+            {
+                return blocks_.size();
+            }
+
+            /**
+             * Получить указатель на владеющее устройство
+             * @return Константный указатель
+             */
+            const vk::tools::Device* getOwnerDevice() const
+            {
+                return pDevice_;
+            }
+        };
+    }
+}
@@ -33,6 +33,10 @@ namespace vk
             uint32_t bpp_;
             /// Буфер изображения
             vk::tools::Image image_;
+            /// Индекс текстуры в глобальной таблице текстур устройства
+            uint32_t tableIndex_;
+            /// Номер загрузки данных изображения (см. vk::tools::UploadManager)
+            vk::tools::UploadTicket uploadTicket_;
 
             /**
              * Получить формат текстуры
@@ -57,7 +61,8 @@ namespace vk
             }
 
             /**
-             * Генерация мип-уровней изображения (не для промежуточного изображения)
+             * Запись команд генерации мип-уровней изображения (не для промежуточного изображения)
+             * @param commandBuffer Командный буфер (в состоянии записи)
              * @param image Изображение
              * @param mipLevelsCount Кол-во мип-уровней
              * @param extent Размер изображения
@@ -65,18 +70,8 @@ namespace vk
              * @details Изображение уже должно быть создано с mip-уровнями (пустыми), функция просто заполняет их
              * проходя по каждому уровню и копируя в него содержимое из предыдущего уменьшенное по размерам вдвое
              */
-            void generateMipLevels(const vk::Image& image, uint32_t mipLevelsCount, const vk::Extent3D& extent)
+            static void generateMipLevels(const vk::CommandBuffer& commandBuffer, const vk::Image& image, uint32_t mipLevelsCount, const vk::Extent3D& extent)
             {
-                // Выделить командный буфер для исполнения команд копирования измененного в размере изображения (blit)
-                vk::CommandBufferAllocateInfo commandBufferAllocateInfo{};
-                commandBufferAllocateInfo.commandBufferCount = 1;
-                commandBufferAllocateInfo.commandPool = pDevice_->getCommandGfxPool().get();
-                commandBufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
-                auto cmdBuffers = pDevice_->getLogicalDevice()->allocateCommandBuffers(commandBufferAllocateInfo);
-
-                // Начать запись в командный буфер
-                cmdBuffers[0].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-
                 // Изначальные размеры мип-уровня
                 int32_t mipWidth = extent.width;
                 int32_t mipHeight = extent.height;
@@ -107,8 +102,8 @@ namespace vk
                     imageBlit.dstSubresource = {vk::ImageAspectFlagBits::eColor,i,0,1};
 
                     // Запись команд в буфер
-                    cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierTransferPrev);
-                    cmdBuffers[0].blitImage(image,vk::ImageLayout::eTransferSrcOptimal,image,vk::ImageLayout::eTransferDstOptimal,{imageBlit},vk::Filter::eLinear);
+                    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierTransferPrev);
+                    commandBuffer.blitImage(image,vk::ImageLayout::eTransferSrcOptimal,image,vk::ImageLayout::eTransferDstOptimal,{imageBlit},vk::Filter::eLinear);
 
                     // Уменьшить размер мип-уровня в 2 раза
                     if (mipWidth > 1) mipWidth /= 2;
@@ -137,71 +132,50 @@ namespace vk
                 imageMemoryBarrierFinalize.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
                 imageMemoryBarrierFinalize.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-                // Записать команду смены размещения и завершить работу с буфером
-                cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierTransferLast);
-                cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eFragmentShader,{},{},{},imageMemoryBarrierFinalize);
-                cmdBuffers[0].end();
-
-                // Отправить команду в очередь и подождать выполнения, затем очистить буфер
-                pDevice_->getGraphicsQueue().submit({vk::SubmitInfo(0, nullptr, nullptr,cmdBuffers.size(),cmdBuffers.data())},{});
-                pDevice_->getGraphicsQueue().waitIdle();
-                pDevice_->getLogicalDevice()->freeCommandBuffers(pDevice_->getCommandGfxPool().get(),cmdBuffers);
+                // Записать команды смены размещения
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierTransferLast);
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eFragmentShader,{},{},{},imageMemoryBarrierFinalize);
             }
 
             /**
-             * Копировать изображение из временного в основное
-             * @param srcImage Исходное изображение (временное)
+             * Запись команд копирования данных изображения из промежуточного буфера в основное изображение
+             * @param commandBuffer Командный буфер (в состоянии записи)
+             * @param stagingBuffer Промежуточный буфер (строки изображения упакованы без промежутков)
+             * @param stagingOffset Смещение данных в промежуточном буфере
              * @param dstImage Целевое изображение (основное)
              * @param extent Разрешение изображения
              * @param prepareForShaderSampling Перевести макет размещения в состояние оптимальное для чтения из шейдера
              *
              * @details Как и в случае с копированием буферов, копирование данных изображения также производится
-             * через команды устройству. Но перед копированием важно также привести изображения к необходимому макету
+             * через команды устройству. Но перед копированием важно также привести изображение к необходимому макету
              * размещения, что тоже делается при помощи команд
              */
-            void copyTmpToDst(const vk::Image& srcImage, const vk::Image& dstImage, const vk::Extent3D& extent, bool prepareForShaderSampling = true)
+            static void copyStagingToImage(const vk::CommandBuffer& commandBuffer,
+                    const vk::Buffer& stagingBuffer,
+                    vk::DeviceSize stagingOffset,
+                    const vk::Image& dstImage,
+                    const vk::Extent3D& extent,
+                    bool prepareForShaderSampling = true)
             {
-                // Выделить командный буфер для исполнения команды копирования
-                vk::CommandBufferAllocateInfo commandBufferAllocateInfo{};
-                commandBufferAllocateInfo.commandBufferCount = 1;
-                commandBufferAllocateInfo.commandPool = pDevice_->getCommandGfxPool().get();
-                commandBufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
-                auto cmdBuffers = pDevice_->getLogicalDevice()->allocateCommandBuffers(commandBufferAllocateInfo);
-
-                // Барьер памяти для смены размещения исходного (временного) изображения
-                vk::ImageMemoryBarrier imageMemoryBarrierSrc{};
-                imageMemoryBarrierSrc.image = srcImage;
-                imageMemoryBarrierSrc.subresourceRange = {vk::ImageAspectFlagBits::eColor,0,1,0,1};
-                imageMemoryBarrierSrc.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                imageMemoryBarrierSrc.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                imageMemoryBarrierSrc.oldLayout = vk::ImageLayout::ePreinitialized;
-                imageMemoryBarrierSrc.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-                imageMemoryBarrierSrc.srcAccessMask = vk::AccessFlagBits::eHostWrite;
-                imageMemoryBarrierSrc.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-                // Барьер памяти для смены размещения целевого изображения
+                // Барьер памяти для смены размещения целевого изображения (прежнее содержимое не нужно)
                 vk::ImageMemoryBarrier imageMemoryBarrierDst{};
                 imageMemoryBarrierDst.image = dstImage;
                 imageMemoryBarrierDst.subresourceRange = {vk::ImageAspectFlagBits::eColor,0,VK_REMAINING_MIP_LEVELS,0,1};
                 imageMemoryBarrierDst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
                 imageMemoryBarrierDst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                imageMemoryBarrierDst.oldLayout = vk::ImageLayout::ePreinitialized;
+                imageMemoryBarrierDst.oldLayout = vk::ImageLayout::eUndefined;
                 imageMemoryBarrierDst.newLayout = vk::ImageLayout::eTransferDstOptimal;
-                imageMemoryBarrierDst.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+                imageMemoryBarrierDst.srcAccessMask = {};
                 imageMemoryBarrierDst.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
 
-                // Области копирования текстуры
-                // Каждый элемент массива описывает из какой области исходного изображения в какую область целевого копировать
-                // На данный момент используем только одну основную область
-                std::vector<vk::ImageCopy> copyRegions = {
-                        {
-                                {vk::ImageAspectFlagBits::eColor,0,0,1},
-                                vk::Offset3D(0,0,0),
-                                {vk::ImageAspectFlagBits::eColor,0,0,1},
-                                vk::Offset3D(0,0,0),
-                                extent
-                        }
-                };
+                // Область копирования (нулевая длина строки - строки упакованы плотно, по ширине изображения)
+                vk::BufferImageCopy copyRegion{};
+                copyRegion.bufferOffset = stagingOffset;
+                copyRegion.bufferRowLength = 0;
+                copyRegion.bufferImageHeight = 0;
+                copyRegion.imageSubresource = {vk::ImageAspectFlagBits::eColor,0,0,1};
+                copyRegion.imageOffset = vk::Offset3D(0,0,0);
+                copyRegion.imageExtent = extent;
 
                 // Барьер памяти для смены размещения целевого изображения (подготовка к использованию в шейдере)
                 vk::ImageMemoryBarrier imageMemoryBarrierFinalize{};
@@ -214,51 +188,13 @@ namespace vk
                 imageMemoryBarrierFinalize.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
                 imageMemoryBarrierFinalize.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-                // Начало работу с буфером команд
-                cmdBuffers[0].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-
                 // Запись команд
-                cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierSrc);
-                cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierDst);
-                cmdBuffers[0].copyImage(srcImage,vk::ImageLayout::eTransferSrcOptimal,dstImage,vk::ImageLayout::eTransferDstOptimal,copyRegions);
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,vk::PipelineStageFlagBits::eTransfer,{},{},{},imageMemoryBarrierDst);
+                commandBuffer.copyBufferToImage(stagingBuffer,dstImage,vk::ImageLayout::eTransferDstOptimal,{copyRegion});
 
                 // Если нужно подготовить макет размещения к использованию
                 if(prepareForShaderSampling){
-                    cmdBuffers[0].pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eFragmentShader,{},{},{},imageMemoryBarrierFinalize);
-                }
-
-                // Завершить работу с буфером команд
-                cmdBuffers[0].end();
-
-                // Отправить команду в очередь и подождать выполнения, затем очистить буфер
-                pDevice_->getGraphicsQueue().submit({vk::SubmitInfo(0, nullptr, nullptr,cmdBuffers.size(),cmdBuffers.data())},{});
-                pDevice_->getGraphicsQueue().waitIdle();
-                pDevice_->getLogicalDevice()->freeCommandBuffers(pDevice_->getCommandGfxPool().get(),cmdBuffers);
-            }
-
-            /**
-             * Копирование байт во временное изображение
-             * @param pStagingImageData Указатель на размеченную область памяти во временном изображении
-             * @param imageBytes Байты изображения
-             * @param size Размер копируемого фрагмента в байтах
-             * @param imageSubResourceLayout Макет размещение под-ресурса изображения
-             */
-            void copyBytesToTmp(void* pStagingImageData, const unsigned char* imageBytes, size_t size, const vk::SubresourceLayout& imageSubResourceLayout)
-            {
-                // Если размер ряда байт в под-ресурсе равен размеру ряда байт в изображении (ширина на bpp),
-                // значит можно использовать обычный memcpy, ибо байты упакованы оптимально. Иначе, например если
-                // размер изображения не кратен степени двойки, нужно копировать ряд за рядом по отдельности
-                if(imageSubResourceLayout.rowPitch == width_ * bpp_){
-                    memcpy(pStagingImageData,imageBytes,size);
-                }
-                else{
-                    for(size_t i = 0; i < height_; i++)
-                    {
-                        memcpy(
-                                reinterpret_cast<unsigned char*>(pStagingImageData) + (i * imageSubResourceLayout.rowPitch),
-                                imageBytes + (i * width_ * bpp_),
-                                width_ * bpp_);
-                    }
+                    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,vk::PipelineStageFlagBits::eFragmentShader,{},{},{},imageMemoryBarrierFinalize);
                 }
             }
 
@@ -271,7 +207,9 @@ namespace vk
                     pDevice_(nullptr),
                     pSampler_(nullptr),
                     type_(TextureBufferType::e2D),
-                    width_(0),height_(0),bpp_(0){};
+                    width_(0),height_(0),bpp_(0),
+                    tableIndex_(0),
+                    uploadTicket_(0){};
 
             /**
              * Запрет копирования через инициализацию
@@ -300,6 +238,8 @@ namespace vk
                 std::swap(width_,other.width_);
                 std::swap(height_,other.height_);
                 std::swap(bpp_, other.bpp_);
+                std::swap(tableIndex_, other.tableIndex_);
+                std::swap(uploadTicket_, other.uploadTicket_);
                 image_ = std::move(other.image_);
             }
 
@@ -320,6 +260,8 @@ namespace vk
                 width_ = 0;
                 height_ = 0;
                 bpp_ = 0;
+                tableIndex_ = 0;
+                uploadTicket_ = 0;
 
                 std::swap(isReady_,other.isReady_);
                 std::swap(pDevice_,other.pDevice_);
@@ -328,6 +270,8 @@ namespace vk
                 std::swap(width_,other.width_);
                 std::swap(height_,other.height_);
                 std::swap(bpp_, other.bpp_);
+                std::swap(tableIndex_, other.tableIndex_);
+                std::swap(uploadTicket_, other.uploadTicket_);
                 image_ = std::move(other.image_);
 
                 return *this;
@@ -359,7 +303,9 @@ namespace vk
                     type_(TextureBufferType::e2D),
                     width_(width),
                     height_(height),
-                    bpp_(bpp)
+                    bpp_(bpp),
+                    tableIndex_(0),
+                    uploadTicket_(0)
             {
                 // Проверить устройство
                 if(pDevice_ == nullptr || !pDevice_->isReady()){
@@ -371,20 +317,7 @@ namespace vk
                     throw vk::InitializationFailedError("Sampler is not available");
                 }
 
-                // Создать промежуточное изображение (память хоста)
-                vk::tools::Image stagingImage(
-                        pDevice_,
-                        vk::ImageType::e2D,                       //TODO: добавить зависимость от типа
-                        this->getImageFormat(bpp_,sRgb),
-                        {width_,height_,1},
-                        vk::ImageUsageFlagBits::eTransferSrc|vk::ImageUsageFlagBits::eTransferDst|vk::ImageUsageFlagBits::eSampled,
-                        vk::ImageAspectFlagBits::eColor,
-                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent,
-                        vk::SharingMode::eExclusive,
-                        vk::ImageLayout::ePreinitialized,
-                        vk::ImageTiling::eLinear);
-
-                // Создать итоговое изображение (память устройства)
+                // Создать изображение (память устройства)
                 image_ = vk::tools::Image(pDevice_,
                         vk::ImageType::e2D,                       //TODO: добавить зависимость от типа
                         this->getImageFormat(bpp_,sRgb),
@@ -393,45 +326,45 @@ namespace vk
                         vk::ImageAspectFlagBits::eColor,
                         vk::MemoryPropertyFlagBits::eDeviceLocal,
                         vk::SharingMode::eExclusive,
-                        vk::ImageLayout::ePreinitialized,
+                        vk::ImageLayout::eUndefined,
                         vk::ImageTiling::eOptimal,
                         generateMip);
 
-                // Как и в случае с геометрическим буфером, данные текстур более оптимально хранить в памяти устройства,
-                // но доступ к ней на прямую закрыт. Нужен промежуточный буфер (stagingImage)
-
-                // Получить макет размещение под-ресурса
-                auto imageSubResourceLayout = pDevice_->getLogicalDevice()->getImageSubresourceLayout(
-                        stagingImage.getVulkanImage().get(),
-                        {vk::ImageAspectFlagBits::eColor,0,0});
-
-                // Разметить память
-                size_t size = width_ * height_ * bpp_;
-                auto pStagingImageData = stagingImage.mapMemory(0,size);
-                // Копировать во временное изображение
-                this->copyBytesToTmp(pStagingImageData,imageBytes,size,imageSubResourceLayout);
-                // Убрать разметку
-                stagingImage.unmapMemory();
-
-                // Копировать из временного изображения в целевое
-                this->copyTmpToDst(stagingImage.getVulkanImage().get(), image_.getVulkanImage().get(), {width_, height_, 1}, !generateMip);
-
-                // Если нужно генерировать mip-уровни
+                // Проверить поддержку линейного blit'а, который используется при генерации мип-уровней
                 if(generateMip){
-
-                    // Проверить поддержку линейного blit'а, который используется при генерации мип-уровней
                     auto formatProperties = pDevice_->getPhysicalDevice().getFormatProperties(this->getImageFormat(bpp_,sRgb));
                     if(!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)){
                         //TODO: сделать выбор другого типа blit'а
                         throw vk::FormatNotSupportedError("Can't use eSampledImageFilterLinear for generating mip maps");
                     }
-
-                    // Генерировать мип-уровни
-                    this->generateMipLevels(image_.getVulkanImage().get(),image_.getMipLevelCount(),{width_, height_, 1});
                 }
 
-                // Очищаем временное изображение
-                stagingImage.destroyVulkanResources();
+                // Как и в случае с геометрическим буфером, данные текстур более оптимально хранить в памяти устройства,
+                // но доступ к ней на прямую закрыт. Данные копируются через промежуточный буфер менеджера загрузки,
+                // команды копирования и генерации мип-уровней попадают в общую партию (без ожидания выполнения).
+                // Копирование выполняется очередью загрузки, после чего изображение передается графическому семейству:
+                // мип-уровни (blit) генерируются уже графической очередью
+                const vk::DeviceSize size = static_cast<vk::DeviceSize>(width_) * height_ * bpp_;
+                const vk::Image dstImage = image_.getVulkanImage().get();
+                const uint32_t mipLevelCount = image_.getMipLevelCount();
+                const vk::Extent3D extent = {width_, height_, 1};
+                uploadTicket_ = pDevice_->getUploadManager()->record(size,[&](const vk::tools::UploadCommands& commands, const vk::Buffer& stagingBuffer, vk::DeviceSize stagingOffset, unsigned char* pStagingData){
+                    memcpy(pStagingData, imageBytes, static_cast<size_t>(size));
+                    copyStagingToImage(commands.getTransferCommandBuffer(), stagingBuffer, stagingOffset, dstImage, extent, false);
+
+                    if(generateMip){
+                        commands.transferImageOwnership(dstImage, {vk::ImageAspectFlagBits::eColor, 0, mipLevelCount, 0, 1},
+                                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferDstOptimal);
+                        generateMipLevels(commands.getGraphicsCommandBuffer(), dstImage, mipLevelCount, extent);
+                    }
+                    else{
+                        commands.transferImageOwnership(dstImage, {vk::ImageAspectFlagBits::eColor, 0, mipLevelCount, 0, 1},
+                                vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+                    }
+                });
+
+                // Зарегистрировать текстуру в глобальной таблице (шейдеры обращаются к ней по индексу)
+                tableIndex_ = pDevice_->getTextureTable()->registerTexture(pSampler_->get(), image_.getImageView().get());
 
                 // Объект готов
                 isReady_ = true;
@@ -445,6 +378,16 @@ namespace vk
                 // Если объект инициализирован и устройство доступно
                 if(isReady_)
                 {
+                    // Изображение нельзя уничтожить, пока не выполнены команды его загрузки
+                    if(pDevice_->getUploadManager() != nullptr){
+                        pDevice_->getUploadManager()->wait(uploadTicket_);
+                    }
+
+                    // Освободить индекс в таблице текстур (до уничтожения изображения)
+                    if(pDevice_->getTextureTable() != nullptr){
+                        pDevice_->getTextureTable()->unregisterTexture(tableIndex_);
+                    }
+
                     image_.destroyVulkanResources();
                     isReady_ = false;
                 }
@@ -510,6 +453,24 @@ namespace vk
             {
                 return image_;
             }
+
+            /**
+             * Получить индекс текстуры в глобальной таблице текстур устройства
+             * @return Индекс элемента массива дескрипторов
+             */
+            uint32_t getTableIndex() const
+            {
+                return tableIndex_;
+            }
+
+            /**
+             * Получить номер загрузки данных изображения
+             * @return Номер партии менеджера загрузки (см. vk::tools::UploadManager::isComplete)
+             */
+            vk::tools::UploadTicket getUploadTicket() const
+            {
+                return uploadTicket_;
+            }
         };
 
         /**
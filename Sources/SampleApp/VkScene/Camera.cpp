@@ -15,10 +15,6 @@ namespace vk
                          isReady_(false),
                          pDevice_(nullptr),
                          pDescriptorPool_(nullptr),
-                         pUboViewMatrixData_(nullptr),
-                         pUboProjectionMatrixData_(nullptr),
-                         pUboCamPositionData_(nullptr),
-                         pUboMapped_(nullptr),
                          projectionMatrix_({}),
                          aspectRatio_(1.0f),
                          projectionType_(CameraProjectionType::ePerspective),
@@ -37,10 +33,6 @@ namespace vk
             std::swap(isReady_,other.isReady_);
             std::swap(pDevice_,other.pDevice_);
             std::swap(pDescriptorPool_,other.pDescriptorPool_);
-            std::swap(pUboViewMatrixData_, other.pUboViewMatrixData_);
-            std::swap(pUboProjectionMatrixData_, other.pUboProjectionMatrixData_);
-            std::swap(pUboCamPositionData_, other.pUboCamPositionData_);
-            std::swap(pUboMapped_, other.pUboMapped_);
 
             std::swap(projectionMatrix_, other.projectionMatrix_);
             std::swap(projectionType_, other.projectionType_);
@@ -49,7 +41,8 @@ namespace vk
             std::swap(fov_, other.fov_);
             std::swap(aspectRatio_, other.aspectRatio_);
 
-            descriptorSet_.swap(other.descriptorSet_);
+            descriptorSets_.swap(other.descriptorSets_);
+            frameUpdateFlags_.swap(other.frameUpdateFlags_);
             uboCameraBuffer_ = std::move(other.uboCameraBuffer_);
         }
 
@@ -66,18 +59,12 @@ namespace vk
             isReady_ = false;
             pDevice_ = nullptr;
             pDescriptorPool_ = nullptr;
-            pUboViewMatrixData_ = nullptr;
-            pUboProjectionMatrixData_ = nullptr;
-            pUboCamPositionData_ = nullptr;
-            pUboMapped_ = nullptr;
+            descriptorSets_.clear();
+            frameUpdateFlags_.clear();
 
             std::swap(isReady_,other.isReady_);
             std::swap(pDevice_,other.pDevice_);
             std::swap(pDescriptorPool_,other.pDescriptorPool_);
-            std::swap(pUboViewMatrixData_, other.pUboViewMatrixData_);
-            std::swap(pUboProjectionMatrixData_, other.pUboProjectionMatrixData_);
-            std::swap(pUboCamPositionData_, other.pUboCamPositionData_);
-            std::swap(pUboMapped_, other.pUboMapped_);
 
             std::swap(projectionMatrix_, other.projectionMatrix_);
             std::swap(projectionType_, other.projectionType_);
@@ -86,7 +73,8 @@ namespace vk
             std::swap(fov_, other.fov_);
             std::swap(aspectRatio_, other.aspectRatio_);
 
-            descriptorSet_.swap(other.descriptorSet_);
+            descriptorSets_.swap(other.descriptorSets_);
+            frameUpdateFlags_.swap(other.frameUpdateFlags_);
             uboCameraBuffer_ = std::move(other.uboCameraBuffer_);
 
             return *this;
@@ -97,6 +85,7 @@ namespace vk
          * @param pDevice Указатель на объект устройства
          * @param descriptorPool Unique smart pointer объекта дескрипторного пула
          * @param descriptorSetLayout Unique smart pointer макета размещения дескрипторного набора меша
+         * @param frameCount Кол-во кадров в полете (кол-во копий UBO и дескрипторных наборов)
          * @param position Изначальное положение камеры
          * @param orientation Ориентация камеры
          * @param aspectRatio Пропорции
@@ -108,6 +97,7 @@ namespace vk
         Camera::Camera(const vk::tools::Device *pDevice,
                        const UniqueHandle<DescriptorPool,::vk::DispatchLoaderStatic> &descriptorPool,
                        const UniqueHandle<DescriptorSetLayout, ::vk::DispatchLoaderStatic> &descriptorSetLayout,
+                       size_t frameCount,
                        const glm::vec3 &position, const glm::vec3 &orientation, const glm::float32 &aspectRatio,
                        const CameraProjectionType& projectionType, const glm::float32 &zNear, const glm::float32 &zFar,
                        const glm::float32 &fov):
@@ -115,10 +105,6 @@ namespace vk
                 isReady_(false),
                 pDevice_(pDevice),
                 pDescriptorPool_(&(descriptorPool.get())),
-                pUboViewMatrixData_(nullptr),
-                pUboProjectionMatrixData_(nullptr),
-                pUboCamPositionData_(nullptr),
-                pUboMapped_(nullptr),
                 projectionMatrix_({}),
                 aspectRatio_(aspectRatio),
                 projectionType_(projectionType),
@@ -131,48 +117,40 @@ namespace vk
                 throw vk::DeviceLostError("Device is not available");
             }
 
-            // Выделить буфер для матрицы модели
-            uboCameraBuffer_ = vk::tools::Buffer(pDevice_,
+            // Выделить буфер для матриц вида-проекции и положения камеры (блок на каждый кадр)
+            uboCameraBuffer_ = vk::tools::FrameUniformBuffer(pDevice_,
                     sizeof(glm::mat4) * 2 + sizeof(glm::vec3),
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+                    frameCount);
 
-            // Разметить память буфера, получив указатели на регионы
-            pUboMapped_ = uboCameraBuffer_.mapMemory(0, 2 * sizeof(glm::mat4) + sizeof(glm::vec3));
+            // Флаги обновления блоков (по одному значению на кадр)
+            frameUpdateFlags_.resize(frameCount, 0);
 
-            // Получить указатели на разные части размеченной области
-            pUboViewMatrixData_ = pUboMapped_;
-            pUboProjectionMatrixData_ = reinterpret_cast<glm::mat4*>(pUboMapped_) + 1;
-            pUboCamPositionData_ = reinterpret_cast<glm::mat4*>(pUboMapped_) + 2;
-
-            // Выделить дескрипторный набор
+            // Выделить дескрипторные наборы (по одному на каждый кадр)
+            std::vector<vk::DescriptorSetLayout> setLayouts(frameCount, descriptorSetLayout.get());
             vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{};
             descriptorSetAllocateInfo.descriptorPool = descriptorPool.get();
-            descriptorSetAllocateInfo.pSetLayouts = &(descriptorSetLayout.get());
-            descriptorSetAllocateInfo.descriptorSetCount = 1;
-            auto allocatedSets = pDevice_->getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo);
-
-            // Сохраняем набор
-            descriptorSet_ = vk::UniqueDescriptorSet(allocatedSets[0]);
-
-            // Информация о буферах
-            std::vector<vk::DescriptorBufferInfo> bufferInfos = {
-                    {uboCameraBuffer_.getBuffer().get(), 0, VK_WHOLE_SIZE},
-            };
+            descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+            descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(frameCount);
+            descriptorSets_ = pDevice_->getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo);
 
+            // Информация о буферах (каждый набор ссылается на блок своего кадра)
+            std::vector<vk::DescriptorBufferInfo> bufferInfos(frameCount);
             // Описываем связи дескрипторов с буферами (описание "записей")
-            std::vector<vk::WriteDescriptorSet> writes = {
-                    {
-                            descriptorSet_.get(),
-                            0,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            &(bufferInfos[0]),
-                            nullptr
-                    },
-            };
+            std::vector<vk::WriteDescriptorSet> writes(frameCount);
+
+            for(size_t i = 0; i < frameCount; i++)
+            {
+                bufferInfos[i] = uboCameraBuffer_.getDescriptorBufferInfo(i);
+                writes[i] = vk::WriteDescriptorSet(
+                        descriptorSets_[i],
+                        0,
+                        0,
+                        1,
+                        vk::DescriptorType::eUniformBuffer,
+                        nullptr,
+                        &(bufferInfos[i]),
+                        nullptr);
+            }
 
             // Связываем дескрипторы с ресурсами (буферами)
             pDevice_->getLogicalDevice()->updateDescriptorSets(writes.size(),writes.data(),0, nullptr);
@@ -202,21 +180,16 @@ namespace vk
         {
             if(isReady_ && pDevice_!= nullptr && pDevice_->isReady())
             {
-                // Вернуть в пул набор дескрипторов и освободить smart-pointer
-                pDevice_->getLogicalDevice()->freeDescriptorSets(*pDescriptorPool_,{descriptorSet_.get()});
-                descriptorSet_.release();
+                // Вернуть в пул наборы дескрипторов
+                pDevice_->getLogicalDevice()->freeDescriptorSets(*pDescriptorPool_,descriptorSets_);
+                descriptorSets_.clear();
 
                 // Очистить UBO буферы
-                uboCameraBuffer_.unmapMemory();
                 uboCameraBuffer_.destroyVulkanResources();
 
                 // Обнулить указатели
                 pDevice_ = nullptr;
                 pDescriptorPool_ = nullptr;
-                pUboViewMatrixData_ = nullptr;
-                pUboProjectionMatrixData_ = nullptr;
-                pUboCamPositionData_ = nullptr;
-                pUboMapped_ = nullptr;
 
                 // Объект де-инициализирован
                 isReady_ = false;
@@ -346,21 +319,40 @@ namespace vk
         }
 
         /**
-         * Обновление UBO буферов матриц модели
+         * Пометить UBO буферы матриц как требующие обновления
          * @param updateFlags Флаги обновления буферов (не всегда нужно обновлять все матрицы)
          */
         void Camera::updateUbo(const unsigned int updateFlags)
         {
-            if(uboCameraBuffer_.isReady())
+            // Блок каждого кадра должен получить новые данные, когда до него дойдет очередь
+            for(auto& frameFlags : frameUpdateFlags_){
+                frameFlags |= updateFlags;
+            }
+        }
+
+        /**
+         * Скопировать актуальные данные в блок UBO конкретного кадра
+         * @param frameIndex Индекс кадра в полете
+         */
+        void Camera::updateUniforms(size_t frameIndex)
+        {
+            if(uboCameraBuffer_.isReady() && frameUpdateFlags_[frameIndex] != 0)
             {
+                // Указатель на блок кадра
+                auto pData = uboCameraBuffer_.getFrameData(frameIndex);
+                auto updateFlags = frameUpdateFlags_[frameIndex];
+
                 if(updateFlags & BufferUpdateFlagBits::eView)
-                    memcpy(pUboViewMatrixData_,&(this->getViewMatrix()),sizeof(glm::mat4));
+                    memcpy(pData,&(this->getViewMatrix()),sizeof(glm::mat4));
 
                 if(updateFlags & BufferUpdateFlagBits::eProjection)
-                    memcpy(pUboProjectionMatrixData_,&(this->getProjectionMatrix()),sizeof(glm::mat4));
+                    memcpy(pData + sizeof(glm::mat4),&(this->getProjectionMatrix()),sizeof(glm::mat4));
 
                 if(updateFlags & BufferUpdateFlagBits::eCamPosition)
-                    memcpy(pUboCamPositionData_, &(this->getPosition()), sizeof(glm::vec3));
+                    memcpy(pData + sizeof(glm::mat4) * 2, &(this->getPosition()), sizeof(glm::vec3));
+
+                // Блок кадра актуален
+                frameUpdateFlags_[frameIndex] = 0;
             }
         }
 
@@ -388,11 +380,12 @@ namespace vk
 
         /**
          * Получить дескрипторный набор
+         * @param frameIndex Индекс кадра в полете
          * @return Константная ссылка на объект дескрипторного набора
          */
-        const vk::DescriptorSet& Camera::getDescriptorSet() const
+        const vk::DescriptorSet& Camera::getDescriptorSet(size_t frameIndex) const
         {
-            return descriptorSet_.get();
+            return descriptorSets_[frameIndex];
         }
     }
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "SceneElement.h"
-#include "../VkTools/Buffer.hpp"
+#include "../VkTools/FrameUniformBuffer.hpp"
 
 namespace vk
 {
@@ -42,21 +42,15 @@ namespace vk
             /// Соотношение сторон вью-порта
             glm::float32 aspectRatio_;
 
-            /// UBO буфер для матриц вида-проекции
-            vk::tools::Buffer uboCameraBuffer_;
-            /// Указатель на размеченную область буфера UBO
-            void* pUboMapped_;
-            /// Указатель на размеченную область буфера UBO для матриц вида
-            void* pUboViewMatrixData_;
-            /// Указатель на размеченную область буфера UBO для матрицы проекции
-            void* pUboProjectionMatrixData_;
-            /// Указатель на размеченную область буфера UBO для положения камеры
-            void* pUboCamPositionData_;
+            /// UBO буфер для матриц вида-проекции (отдельный блок на каждый кадр в полете)
+            vk::tools::FrameUniformBuffer uboCameraBuffer_;
+            /// Флаги обновления блоков UBO (на каждый кадр свои, см. BufferUpdateFlagBits)
+            std::vector<unsigned> frameUpdateFlags_;
 
             /// Указатель на пул дескрипторов, из которого выделяется набор дескрипторов меша
             const vk::DescriptorPool *pDescriptorPool_;
-            /// Дескрипторный набор
-            vk::UniqueDescriptorSet descriptorSet_;
+            /// Дескрипторные наборы (по одному на каждый кадр в полете)
+            std::vector<vk::DescriptorSet> descriptorSets_;
 
             /**
              * Обновление матрицы проекции с учетом всех параметров камеры
@@ -64,8 +58,10 @@ namespace vk
             void updateProjectionMatrix();
 
             /**
-             * Обновление UBO буферов матриц модели
+             * Пометить UBO буферы матриц как требующие обновления
              * @param updateFlags Флаги обновления буферов (не всегда нужно обновлять все матрицы)
+             *
+             * @details Сами данные копируются в UBO при вызове updateUniforms, отдельно для блока каждого кадра
              */
             void updateUbo(unsigned updateFlags = BufferUpdateFlagBits::eView | BufferUpdateFlagBits::eProjection | BufferUpdateFlagBits::eCamPosition);
 
@@ -87,6 +83,7 @@ namespace vk
              * @param pDevice Указатель на объект устройства
              * @param descriptorPool Unique smart pointer объекта дескрипторного пула
              * @param descriptorSetLayout Unique smart pointer макета размещения дескрипторного набора меша
+             * @param frameCount Кол-во кадров в полете (кол-во копий UBO и дескрипторных наборов)
              * @param position Изначальное положение камеры
              * @param orientation Ориентация камеры
              * @param aspectRatio Пропорции
@@ -98,6 +95,7 @@ namespace vk
             explicit Camera(const vk::tools::Device* pDevice,
                             const vk::UniqueDescriptorPool& descriptorPool,
                             const vk::UniqueDescriptorSetLayout& descriptorSetLayout,
+                            size_t frameCount,
                             const glm::vec3& position,
                             const glm::vec3& orientation,
                             const glm::float32& aspectRatio,
@@ -215,11 +213,20 @@ namespace vk
              */
             bool isReady() const;
 
+            /**
+             * Скопировать актуальные данные в блок UBO конкретного кадра
+             * @param frameIndex Индекс кадра в полете
+             *
+             * @details Вызывается рендерером в начале кадра, когда GPU гарантированно не использует блок этого кадра
+             */
+            void updateUniforms(size_t frameIndex);
+
             /**
              * Получить дескрипторный набор
+             * @param frameIndex Индекс кадра в полете
              * @return Константная ссылка на объект дескрипторного набора
              */
-            const vk::DescriptorSet& getDescriptorSet() const;
+            const vk::DescriptorSet& getDescriptorSet(size_t frameIndex) const;
         };
     }
 }
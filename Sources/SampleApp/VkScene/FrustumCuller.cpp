@@ -0,0 +1,222 @@
+#include "FrustumCuller.h"
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// SSE доступен на всех x64 платформах (на x86 - если компилятор собирает с его поддержкой)
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace vk
+{
+    namespace scene
+    {
+        /**
+         * Конструктор по умолчанию
+         */
+        FrustumCuller::FrustumCuller()
+        {
+            // Без заданной пирамиды видимости ничего не отсекается
+            for(auto& plane : planes_){
+                plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+        }
+
+        /**
+         * Очистить список объектов
+         */
+        void FrustumCuller::clear()
+        {
+            centerX_.clear();
+            centerY_.clear();
+            centerZ_.clear();
+            extentX_.clear();
+            extentY_.clear();
+            extentZ_.clear();
+            radius_.clear();
+        }
+
+        /**
+         * Зарезервировать место под объекты
+         * @param count Кол-во объектов
+         */
+        void FrustumCuller::reserve(size_t count)
+        {
+            centerX_.reserve(count);
+            centerY_.reserve(count);
+            centerZ_.reserve(count);
+            extentX_.reserve(count);
+            extentY_.reserve(count);
+            extentZ_.reserve(count);
+            radius_.reserve(count);
+        }
+
+        /**
+         * Добавить объект
+         * @param center Центр ограничивающих объемов (в мировом пространстве)
+         * @param extent Половина размера AABB
+         * @param radius Радиус ограничивающей сферы
+         * @return Индекс объекта (порядковый номер добавления)
+         */
+        uint32_t FrustumCuller::add(const glm::vec3 &center, const glm::vec3 &extent, float radius)
+        {
+            centerX_.push_back(center.x);
+            centerY_.push_back(center.y);
+            centerZ_.push_back(center.z);
+            extentX_.push_back(extent.x);
+            extentY_.push_back(extent.y);
+            extentZ_.push_back(extent.z);
+            radius_.push_back(radius);
+            return static_cast<uint32_t>(radius_.size() - 1);
+        }
+
+        /**
+         * Добавить объект, который никогда не отсекается
+         * @return Индекс объекта (порядковый номер добавления)
+         */
+        uint32_t FrustumCuller::addAlwaysVisible()
+        {
+            // Максимальные (но конечные, чтобы 0 * размер не давал NaN) объемы не лежат за плоскостью
+            return this->add(glm::vec3(0.0f), glm::vec3(FLT_MAX), FLT_MAX);
+        }
+
+        /**
+         * Получить кол-во объектов
+         * @return Целое число
+         */
+        size_t FrustumCuller::getCount() const
+        {
+            return radius_.size();
+        }
+
+        /**
+         * Установить пирамиду видимости
+         * @param viewProjection Матрица вида-проекции (глубина в диапазоне [0;1])
+         *
+         * @details Плоскости извлекаются из строк матрицы (метод Gribb-Hartmann), с учетом того,
+         * что ближняя плоскость соответствует z = 0, а не z = -w
+         */
+        void FrustumCuller::setFrustum(const glm::mat4 &viewProjection)
+        {
+            // Строки матрицы (glm хранит столбцы)
+            glm::vec4 rows[4];
+            for(glm::length_t i = 0; i < 4; i++){
+                rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+            }
+
+            planes_[0] = rows[3] + rows[0]; // Левая
+            planes_[1] = rows[3] - rows[0]; // Правая
+            planes_[2] = rows[3] + rows[1]; // Нижняя
+            planes_[3] = rows[3] - rows[1]; // Верхняя
+            planes_[4] = rows[2];           // Ближняя
+            planes_[5] = rows[3] - rows[2]; // Дальняя
+
+            // Нормализация (чтобы расстояния можно было сравнивать с радиусом и размерами)
+            for(auto& plane : planes_){
+                const float length = glm::length(glm::vec3(plane));
+                if(length > 0.0f) plane /= length;
+            }
+        }
+
+        /**
+         * Получить плоскости пирамиды видимости
+         * @return Указатель на массив из 6 плоскостей (xyz - нормаль, направленная внутрь, w - расстояние)
+         */
+        const glm::vec4* FrustumCuller::getPlanes() const
+        {
+            return planes_;
+        }
+
+        /**
+         * Проверка диапазона объектов без SIMD
+         * @param from Индекс первого объекта
+         * @param to Индекс следующего за последним объекта
+         * @param pVisible Указатель на массив индексов видимых объектов (дополняется)
+         */
+        void FrustumCuller::cullScalar(size_t from, size_t to, std::vector<uint32_t> *pVisible) const
+        {
+            for(size_t i = from; i < to; i++)
+            {
+                bool outside = false;
+                for(const auto& plane : planes_)
+                {
+                    const float distance = plane.x * centerX_[i] + plane.y * centerY_[i] + plane.z * centerZ_[i] + plane.w;
+                    const float projectedExtent = std::fabs(plane.x) * extentX_[i] + std::fabs(plane.y) * extentY_[i] + std::fabs(plane.z) * extentZ_[i];
+                    if(distance < -(std::min)(radius_[i], projectedExtent)){
+                        outside = true;
+                        break;
+                    }
+                }
+
+                if(!outside) pVisible->push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        /**
+         * Отсечь объекты
+         * @param pVisible Указатель на массив индексов видимых объектов (очищается и заполняется по возрастанию)
+         */
+        void FrustumCuller::cull(std::vector<uint32_t> *pVisible) const
+        {
+            pVisible->clear();
+            const size_t count = this->getCount();
+            size_t i = 0;
+
+#ifdef FRUSTUM_CULLER_SSE
+            // Компоненты плоскостей, размноженные на 4 объекта
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            __m128 planeAbsX[6], planeAbsY[6], planeAbsZ[6];
+            for(size_t p = 0; p < 6; p++){
+                planeX[p] = _mm_set1_ps(planes_[p].x);
+                planeY[p] = _mm_set1_ps(planes_[p].y);
+                planeZ[p] = _mm_set1_ps(planes_[p].z);
+                planeW[p] = _mm_set1_ps(planes_[p].w);
+                planeAbsX[p] = _mm_set1_ps(std::fabs(planes_[p].x));
+                planeAbsY[p] = _mm_set1_ps(std::fabs(planes_[p].y));
+                planeAbsZ[p] = _mm_set1_ps(std::fabs(planes_[p].z));
+            }
+            const __m128 zero = _mm_setzero_ps();
+
+            // По 4 объекта за итерацию
+            for(; i + 4 <= count; i += 4)
+            {
+                const __m128 cx = _mm_loadu_ps(&centerX_[i]);
+                const __m128 cy = _mm_loadu_ps(&centerY_[i]);
+                const __m128 cz = _mm_loadu_ps(&centerZ_[i]);
+                const __m128 ex = _mm_loadu_ps(&extentX_[i]);
+                const __m128 ey = _mm_loadu_ps(&extentY_[i]);
+                const __m128 ez = _mm_loadu_ps(&extentZ_[i]);
+                const __m128 r = _mm_loadu_ps(&radius_[i]);
+
+                // Маска объектов, лежащих за хотя бы одной из плоскостей
+                __m128 outside = zero;
+                for(size_t p = 0; p < 6; p++)
+                {
+                    const __m128 distance = _mm_add_ps(
+                            _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                            _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+                    const __m128 projectedExtent = _mm_add_ps(
+                            _mm_add_ps(_mm_mul_ps(planeAbsX[p], ex), _mm_mul_ps(planeAbsY[p], ey)),
+                            _mm_mul_ps(planeAbsZ[p], ez));
+                    const __m128 threshold = _mm_sub_ps(zero, _mm_min_ps(r, projectedExtent));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, threshold));
+                }
+
+                // Все 4 объекта отсечены - частый случай, без разбора по битам
+                const int outsideBits = _mm_movemask_ps(outside);
+                if(outsideBits == 0xF) continue;
+
+                for(uint32_t j = 0; j < 4; j++){
+                    if((outsideBits & (1 << j)) == 0) pVisible->push_back(static_cast<uint32_t>(i) + j);
+                }
+            }
+#endif
+
+            // Оставшиеся объекты (либо все, если SSE недоступен)
+            this->cullScalar(i, count, pVisible);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace vk
+{
+    namespace scene
+    {
+        /**
+         * Отсечение по пирамиде видимости (на CPU)
+         *
+         * @details Ограничивающие объемы хранятся в виде структуры массивов (отдельные массивы координат центра,
+         * половины размера AABB и радиуса сферы), что позволяет проверять по 4 объекта за раз инструкциями SSE.
+         * Объект отсекается, если он целиком лежит за одной из 6 плоскостей пирамиды. Для каждой плоскости берется
+         * меньшая из проекций AABB и сферы на нормаль плоскости - так тест точнее каждого из объемов по отдельности
+         */
+        class FrustumCuller
+        {
+        private:
+            /// Координаты центров
+            std::vector<float> centerX_;
+            std::vector<float> centerY_;
+            std::vector<float> centerZ_;
+            /// Половины размеров AABB
+            std::vector<float> extentX_;
+            std::vector<float> extentY_;
+            std::vector<float> extentZ_;
+            /// Радиусы сфер
+            std::vector<float> radius_;
+
+            /// Плоскости пирамиды видимости (xyz - нормаль, направленная внутрь, w - расстояние)
+            glm::vec4 planes_[6];
+
+            /**
+             * Проверка диапазона объектов без SIMD
+             * @param from Индекс первого объекта
+             * @param to Индекс следующего за последним объекта
+             * @param pVisible Указатель на массив индексов видимых объектов (дополняется)
+             */
+            void cullScalar(size_t from, size_t to, std::vector<uint32_t>* pVisible) const;
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            FrustumCuller();
+
+            /**
+             * Очистить список объектов
+             */
+            void clear();
+
+            /**
+             * Зарезервировать место под объекты
+             * @param count Кол-во объектов
+             */
+            void reserve(size_t count);
+
+            /**
+             * Добавить объект
+             * @param center Центр ограничивающих объемов (в мировом пространстве)
+             * @param extent Половина размера AABB
+             * @param radius Радиус ограничивающей сферы
+             * @return Индекс объекта (порядковый номер добавления)
+             */
+            uint32_t add(const glm::vec3& center, const glm::vec3& extent, float radius);
+
+            /**
+             * Добавить объект, который никогда не отсекается
+             * @return Индекс объекта (порядковый номер добавления)
+             *
+             * @details Для объектов, ограничивающие объемы которых неизвестны (например, анимированных скелетом)
+             */
+            uint32_t addAlwaysVisible();
+
+            /**
+             * Получить кол-во объектов
+             * @return Целое число
+             */
+            size_t getCount() const;
+
+            /**
+             * Установить пирамиду видимости
+             * @param viewProjection Матрица вида-проекции (глубина в диапазоне [0;1])
+             */
+            void setFrustum(const glm::mat4& viewProjection);
+
+            /**
+             * Получить плоскости пирамиды видимости
+             * @return Указатель на массив из 6 плоскостей (xyz - нормаль, направленная внутрь, w - расстояние)
+             */
+            const glm::vec4* getPlanes() const;
+
+            /**
+             * Отсечь объекты
+             * @param pVisible Указатель на массив индексов видимых объектов (очищается и заполняется по возрастанию)
+             */
+            void cull(std::vector<uint32_t>* pVisible) const;
+        };
+    }
+}
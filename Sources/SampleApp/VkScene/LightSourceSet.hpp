@@ -1,7 +1,7 @@
 #pragma once
 
 #include "LightSource.h"
-#include "../VkTools/Buffer.hpp"
+#include "../VkTools/FrameUniformBuffer.hpp"
 
 namespace vk
 {
@@ -10,13 +10,6 @@ namespace vk
         class LightSourceSet
         {
         private:
-            /// Флаги обновления буферов
-            enum BufferUpdateFlagBits
-            {
-                eCount = (1u << 0u),
-                eLightSources = ( 1u << 1u)
-            };
-
             /// Готово ли изображение
             bool isReady_;
             /// Указатель на устройство
@@ -27,20 +20,18 @@ namespace vk
             /// Массив источников света
             std::vector<LightSourcePtr> lightSources_;
 
-            /// UBO буфер для источников света
-            vk::tools::Buffer uboLightSources_;
-            /// Указатель на размеченную область буфера UBO для источников света
-            void* pUboLightSourcesData_;
+            /// Копия данных источников света в памяти хоста (источники пишут сюда, в UBO данные копируются перед кадром)
+            std::vector<unsigned char> lightSourcesData_;
 
-            /// UBO буфер для кол-ва источников
-            vk::tools::Buffer uboLightSourceCount_;
-            /// Указатель на размеченную область буфера UBO для кол-ва источников
-            void* pUboLightSourceCount_;
+            /// UBO буфер для источников света (блок на каждый кадр в полете)
+            vk::tools::FrameUniformBuffer uboLightSources_;
+            /// UBO буфер для кол-ва источников (блок на каждый кадр в полете)
+            vk::tools::FrameUniformBuffer uboLightSourceCount_;
 
             /// Указатель на пул дескрипторов, из которого выделяется набор дескрипторов
             const vk::DescriptorPool *pDescriptorPool_;
-            /// Дескрипторный набор
-            vk::UniqueDescriptorSet descriptorSet_;
+            /// Дескрипторные наборы (по одному на каждый кадр в полете)
+            std::vector<vk::DescriptorSet> descriptorSets_;
 
             /**
              * Обновление смещений у объектов в массиве источников
@@ -56,24 +47,6 @@ namespace vk
                 }
             }
 
-            /**
-             * Обновление UBO буфера
-             * @param updateFlags Тип обновляемого буфера (кол-во или сами источники)
-             */
-            void updateUbo(unsigned updateFlags = BufferUpdateFlagBits::eCount | BufferUpdateFlagBits::eLightSources)
-            {
-                if((updateFlags & BufferUpdateFlagBits::eCount) && pUboLightSourceCount_ != nullptr){
-                    auto count = static_cast<glm::uint32>(lightSources_.size());
-                    memcpy(pUboLightSourceCount_, &count, sizeof(glm::uint32));
-                }
-
-                if((updateFlags & BufferUpdateFlagBits::eLightSources) && pUboLightSourcesData_ != nullptr){
-                    for(auto& lightSource : lightSources_){
-                        lightSource->updateUboRegion();
-                    }
-                }
-            }
-
         public:
             /**
              * Основной конструктор
@@ -82,8 +55,6 @@ namespace vk
                     isReady_(false),
                     pDevice_(nullptr),
                     maxLightSources_(0),
-                    pUboLightSourcesData_(nullptr),
-                    pUboLightSourceCount_(nullptr),
                     pDescriptorPool_(nullptr){};
 
             /**
@@ -91,17 +62,18 @@ namespace vk
              * @param pDevice Указатель на объект устройства
              * @param descriptorPool Unique smart pointer объекта дескрипторного пула
              * @param descriptorSetLayout Unique smart pointer макета размещения дескрипторного набора для источников света
+             * @param frameCount Кол-во кадров в полете (кол-во копий UBO и дескрипторных наборов)
              * @param maxLightSources Максимальное число источников
              */
             LightSourceSet(const vk::tools::Device* pDevice,
                            const vk::UniqueDescriptorPool& descriptorPool,
                            const vk::UniqueDescriptorSetLayout& descriptorSetLayout,
+                           size_t frameCount,
                            size_t maxLightSources):
                     isReady_(false),
                     pDevice_(pDevice),
                     maxLightSources_(maxLightSources),
-                    pUboLightSourcesData_(nullptr),
-                    pUboLightSourceCount_(nullptr),
+                    lightSourcesData_(vk::scene::LIGHT_ENTRY_SIZE * maxLightSources, 0),
                     pDescriptorPool_(&(descriptorPool.get()))
             {
                 // Проверить устройство
@@ -110,60 +82,53 @@ namespace vk
                 }
 
                 // Выделить буфер для кол-ва источников света
-                uboLightSourceCount_ = vk::tools::Buffer(pDevice_,
+                uboLightSourceCount_ = vk::tools::FrameUniformBuffer(pDevice_,
                         sizeof(glm::uint32),
-                        vk::BufferUsageFlagBits::eUniformBuffer,
-                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+                        frameCount);
 
                 // Выделить буфер для массива источников света
-                uboLightSources_ = vk::tools::Buffer(pDevice_,
+                uboLightSources_ = vk::tools::FrameUniformBuffer(pDevice_,
                         vk::scene::LIGHT_ENTRY_SIZE * maxLightSources_,
-                        vk::BufferUsageFlagBits::eUniformBuffer,
-                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+                        frameCount);
 
-                // Разметить память буферов, получив указатели на регионы
-                pUboLightSourceCount_ = uboLightSourceCount_.mapMemory(0, sizeof(glm::uint32));
-                pUboLightSourcesData_ = uboLightSources_.mapMemory(0, vk::scene::LIGHT_ENTRY_SIZE * maxLightSources_);
-
-                // Выделить дескрипторный набор
+                // Выделить дескрипторные наборы (по одному на каждый кадр)
+                std::vector<vk::DescriptorSetLayout> setLayouts(frameCount, descriptorSetLayout.get());
                 vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{};
                 descriptorSetAllocateInfo.descriptorPool = descriptorPool.get();
-                descriptorSetAllocateInfo.pSetLayouts = &(descriptorSetLayout.get());
-                descriptorSetAllocateInfo.descriptorSetCount = 1;
-                auto allocatedSets = pDevice_->getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo);
-
-                // Сохраняем набор
-                descriptorSet_ = vk::UniqueDescriptorSet(allocatedSets[0]);
-
-                // Информация о буферах
-                std::vector<vk::DescriptorBufferInfo> bufferInfos = {
-                        {uboLightSourceCount_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                        {uboLightSources_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                };
+                descriptorSetAllocateInfo.pSetLayouts = setLayouts.data();
+                descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(frameCount);
+                descriptorSets_ = pDevice_->getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo);
 
+                // Информация о буферах (по 2 на каждый кадр)
+                std::vector<vk::DescriptorBufferInfo> bufferInfos(frameCount * 2);
                 // Описываем связи дескрипторов с буферами (описание "записей")
-                std::vector<vk::WriteDescriptorSet> writes = {
-                        {
-                                descriptorSet_.get(),
-                                0,
-                                0,
-                                1,
-                                vk::DescriptorType::eUniformBuffer,
-                                nullptr,
-                                &(bufferInfos[0]),
-                                nullptr
-                        },
-                        {
-                                descriptorSet_.get(),
-                                1,
-                                0,
-                                1,
-                                vk::DescriptorType::eUniformBuffer,
-                                nullptr,
-                                &(bufferInfos[1]),
-                                nullptr
-                        },
-                };
+                std::vector<vk::WriteDescriptorSet> writes(frameCount * 2);
+
+                for(size_t i = 0; i < frameCount; i++)
+                {
+                    bufferInfos[i * 2 + 0] = uboLightSourceCount_.getDescriptorBufferInfo(i);
+                    bufferInfos[i * 2 + 1] = uboLightSources_.getDescriptorBufferInfo(i);
+
+                    writes[i * 2 + 0] = vk::WriteDescriptorSet(
+                            descriptorSets_[i],
+                            0,
+                            0,
+                            1,
+                            vk::DescriptorType::eUniformBuffer,
+                            nullptr,
+                            &(bufferInfos[i * 2 + 0]),
+                            nullptr);
+
+                    writes[i * 2 + 1] = vk::WriteDescriptorSet(
+                            descriptorSets_[i],
+                            1,
+                            0,
+                            1,
+                            vk::DescriptorType::eUniformBuffer,
+                            nullptr,
+                            &(bufferInfos[i * 2 + 1]),
+                            nullptr);
+                }
 
                 // Связываем дескрипторы с ресурсами (буферами)
                 pDevice_->getLogicalDevice()->updateDescriptorSets(writes.size(),writes.data(),0, nullptr);
@@ -195,12 +160,11 @@ namespace vk
                 std::swap(isReady_,other.isReady_);
                 std::swap(pDevice_, other.pDevice_);
                 std::swap(maxLightSources_, other.maxLightSources_);
-                std::swap(pUboLightSourceCount_, other.pUboLightSourceCount_);
-                std::swap(pUboLightSourcesData_, other.pUboLightSourcesData_);
                 std::swap(pDescriptorPool_, other.pDescriptorPool_);
 
                 lightSources_.swap(other.lightSources_);
-                descriptorSet_.swap(other.descriptorSet_);
+                lightSourcesData_.swap(other.lightSourcesData_);
+                descriptorSets_.swap(other.descriptorSets_);
 
                 uboLightSources_ = std::move(other.uboLightSources_);
                 uboLightSourceCount_ = std::move(other.uboLightSourceCount_);
@@ -219,19 +183,19 @@ namespace vk
                 isReady_ = false;
                 pDevice_ = nullptr;
                 pDescriptorPool_ = nullptr;
-                pUboLightSourcesData_ = nullptr;
-                pUboLightSourceCount_ = nullptr;
                 maxLightSources_ = 0;
+                lightSources_.clear();
+                lightSourcesData_.clear();
+                descriptorSets_.clear();
 
                 std::swap(isReady_,other.isReady_);
                 std::swap(pDevice_, other.pDevice_);
                 std::swap(maxLightSources_, other.maxLightSources_);
-                std::swap(pUboLightSourceCount_, other.pUboLightSourceCount_);
-                std::swap(pUboLightSourcesData_, other.pUboLightSourcesData_);
                 std::swap(pDescriptorPool_, other.pDescriptorPool_);
 
                 lightSources_.swap(other.lightSources_);
-                descriptorSet_.swap(other.descriptorSet_);
+                lightSourcesData_.swap(other.lightSourcesData_);
+                descriptorSets_.swap(other.descriptorSets_);
 
                 uboLightSources_ = std::move(other.uboLightSources_);
                 uboLightSourceCount_ = std::move(other.uboLightSourceCount_);
@@ -253,22 +217,17 @@ namespace vk
             {
                 if(isReady_ && pDevice_!= nullptr && pDevice_->isReady())
                 {
-                    // Вернуть в пул набор дескрипторов и освободить smart-pointer
-                    pDevice_->getLogicalDevice()->freeDescriptorSets(*pDescriptorPool_,{descriptorSet_.get()});
-                    descriptorSet_.release();
+                    // Вернуть в пул наборы дескрипторов
+                    pDevice_->getLogicalDevice()->freeDescriptorSets(*pDescriptorPool_,descriptorSets_);
+                    descriptorSets_.clear();
 
                     // Очистить UBO буферы
-                    uboLightSourceCount_.unmapMemory();
                     uboLightSourceCount_.destroyVulkanResources();
-
-                    uboLightSources_.unmapMemory();
                     uboLightSources_.destroyVulkanResources();
 
                     // Обнулить указатели
                     pDevice_ = nullptr;
                     pDescriptorPool_ = nullptr;
-                    pUboLightSourcesData_ = nullptr;
-                    pUboLightSourceCount_ = nullptr;
 
                     // Объект де-инициализирован
                     isReady_ = false;
@@ -296,7 +255,7 @@ namespace vk
             {
                 // Создать источник света
                 auto lightSource = std::make_shared<vk::scene::LightSource>(
-                        reinterpret_cast<unsigned char*>(pUboLightSourcesData_),
+                        lightSourcesData_.data(),
                         lightSources_.size(),
                         type,
                         position,
@@ -309,9 +268,8 @@ namespace vk
                 // Добавить в массив
                 lightSources_.push_back(lightSource);
 
-                // Обновить UBO
+                // Обновить область источника (в UBO попадет при обновлении блока кадра)
                 lightSource->updateUboRegion();
-                this->updateUbo(BufferUpdateFlagBits::eCount);
 
                 // Отдать smart pointer
                 return lightSource;
@@ -331,8 +289,26 @@ namespace vk
                 // Обновить смещения в массиве объектов
                 this->refreshLightSourceOffsets();
 
-                // Обновить UBO
-                this->updateUbo(BufferUpdateFlagBits::eCount|BufferUpdateFlagBits::eLightSources);
+                // Обновить области всех источников (смещения изменились)
+                for(auto& lightSource : lightSources_){
+                    lightSource->updateUboRegion();
+                }
+            }
+
+            /**
+             * Скопировать актуальные данные источников в блок UBO конкретного кадра
+             * @param frameIndex Индекс кадра в полете
+             *
+             * @details Вызывается рендерером в начале кадра, когда GPU гарантированно не использует блок этого кадра.
+             * Копируется только занятая часть массива (источников немного, поэтому копирование дешевле отслеживания изменений)
+             */
+            void updateUniforms(size_t frameIndex)
+            {
+                if(!isReady_) return;
+
+                auto count = static_cast<glm::uint32>(lightSources_.size());
+                memcpy(uboLightSourceCount_.getFrameData(frameIndex), &count, sizeof(glm::uint32));
+                memcpy(uboLightSources_.getFrameData(frameIndex), lightSourcesData_.data(), vk::scene::LIGHT_ENTRY_SIZE * count);
             }
 
             /**
@@ -346,11 +322,12 @@ namespace vk
 
             /**
              * Получить дескрипторный набор
+             * @param frameIndex Индекс кадра в полете
              * @return Константная ссылка на объект дескрипторного набора
              */
-            const vk::DescriptorSet& getDescriptorSet() const
+            const vk::DescriptorSet& getDescriptorSet(size_t frameIndex) const
             {
-                return descriptorSet_.get();
+                return descriptorSets_[frameIndex];
             }
         };
     }
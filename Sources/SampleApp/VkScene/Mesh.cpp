@@ -1,6 +1,7 @@
 #include "Mesh.h"
 
 #include <utility>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 namespace vk
@@ -13,14 +14,13 @@ namespace vk
         Mesh::Mesh():SceneElement(),
         isReady_(false),
         pDevice_(nullptr),
-        pDescriptorPool_(nullptr),
-        pUboModelMatrixData_(nullptr),
-        pUboMaterialData_(nullptr),
-        pUboTextureMappingData_(nullptr),
-        pUboTextureUsageData_(nullptr),
-        pUboBoneCountData_(nullptr),
-        pUboBoneTransformsData_(nullptr),
-        skeleton_(nullptr){}
+        skeleton_(nullptr),
+        normalMatrix_(1.0f),
+        lod_(0),
+        uploadTicket_(0),
+        pChangedSlots_(nullptr),
+        sceneSlot_(0),
+        changed_(false){}
 
         /**
          * Конструктор перемещения
@@ -31,26 +31,22 @@ namespace vk
         {
             std::swap(isReady_,other.isReady_);
             std::swap(pDevice_,other.pDevice_);
-            std::swap(pDescriptorPool_,other.pDescriptorPool_);
-            std::swap(pUboModelMatrixData_, other.pUboModelMatrixData_);
-            std::swap(pUboMaterialData_, other.pUboMaterialData_);
-            std::swap(pUboTextureMappingData_, other.pUboTextureMappingData_);
-            std::swap(pUboTextureUsageData_,other.pUboTextureUsageData_);
-            std::swap(pUboBoneCountData_,other.pUboBoneCountData_);
-            std::swap(pUboBoneTransformsData_, other.pUboBoneTransformsData_);
             std::swap(materialSettings_,other.materialSettings_);
             std::swap(textureMapping_,other.textureMapping_);
             std::swap(textureSet_, other.textureSet_);
             std::swap(skeleton_, other.skeleton_);
+            std::swap(normalMatrix_, other.normalMatrix_);
+            std::swap(worldBounds_, other.worldBounds_);
+            std::swap(lod_, other.lod_);
+            std::swap(uploadTicket_, other.uploadTicket_);
+            std::swap(pChangedSlots_, other.pChangedSlots_);
+            std::swap(sceneSlot_, other.sceneSlot_);
+            std::swap(changed_, other.changed_);
+
+            std::swap(textureUsage_, other.textureUsage_);
+            std::swap(textureIndices_, other.textureIndices_);
 
             geometryBufferPtr_.swap(other.geometryBufferPtr_);
-            descriptorSet_.swap(other.descriptorSet_);
-            uboModelMatrix_ = std::move(other.uboModelMatrix_);
-            uboMaterial_ = std::move(other.uboMaterial_);
-            uboTextureMapping_ = std::move(other.uboTextureMapping_);
-            uboTextureUsage_ = std::move(other.uboTextureUsage_);
-            uboBoneCount_ = std::move(other.uboBoneCount_);
-            uboBoneTransforms_ = std::move(other.uboBoneTransforms_);
         }
 
         /**
@@ -65,38 +61,27 @@ namespace vk
             this->destroyVulkanResources();
             isReady_ = false;
             pDevice_ = nullptr;
-            pDescriptorPool_ = nullptr;
-            pUboModelMatrixData_ = nullptr;
-            pUboMaterialData_ = nullptr;
-            pUboTextureMappingData_ = nullptr;
-            pUboTextureUsageData_ = nullptr;
-            pUboBoneCountData_ = nullptr;
-            pUboBoneTransformsData_ = nullptr;
             materialSettings_ = {};
             textureMapping_ = {};
 
             std::swap(isReady_,other.isReady_);
             std::swap(pDevice_,other.pDevice_);
-            std::swap(pDescriptorPool_,other.pDescriptorPool_);
-            std::swap(pUboModelMatrixData_, other.pUboModelMatrixData_);
-            std::swap(pUboMaterialData_, other.pUboMaterialData_);
-            std::swap(pUboTextureMappingData_, other.pUboTextureMappingData_);
-            std::swap(pUboTextureUsageData_,other.pUboTextureUsageData_);
-            std::swap(pUboBoneCountData_,other.pUboBoneCountData_);
-            std::swap(pUboBoneTransformsData_, other.pUboBoneTransformsData_);
             std::swap(materialSettings_,other.materialSettings_);
             std::swap(textureMapping_,other.textureMapping_);
             std::swap(textureSet_, other.textureSet_);
             std::swap(skeleton_,other.skeleton_);
+            std::swap(normalMatrix_,other.normalMatrix_);
+            std::swap(worldBounds_,other.worldBounds_);
+            std::swap(lod_,other.lod_);
+            std::swap(uploadTicket_,other.uploadTicket_);
+            std::swap(pChangedSlots_,other.pChangedSlots_);
+            std::swap(sceneSlot_,other.sceneSlot_);
+            std::swap(changed_,other.changed_);
+
+            std::swap(textureUsage_, other.textureUsage_);
+            std::swap(textureIndices_, other.textureIndices_);
 
             geometryBufferPtr_.swap(other.geometryBufferPtr_);
-            descriptorSet_.swap(other.descriptorSet_);
-            uboModelMatrix_ = std::move(other.uboModelMatrix_);
-            uboMaterial_ = std::move(other.uboMaterial_);
-            uboTextureMapping_ = std::move(other.uboTextureMapping_);
-            uboTextureUsage_ = std::move(other.uboTextureUsage_);
-            uboBoneCount_ = std::move(other.uboBoneCount_);
-            uboBoneTransforms_ = std::move(other.uboBoneTransforms_);
 
             return *this;
         }
@@ -112,8 +97,6 @@ namespace vk
         /**
          * Основной конструктор
          * @param pDevice Указатель на объект устройства
-         * @param descriptorPool Unique smart pointer объекта дескрипторного пула
-         * @param descriptorSetLayout Unique smart pointer макета размещения дескрипторного набора меша
          * @param geometryBufferPtr Smart-pointer на объект геом. буфера
          * @param defaultTexturePtr Smart-pointer на объект текстурного буфера
          * @param textureSet Набор текстур меша
@@ -121,8 +104,6 @@ namespace vk
          * @param textureMappingSettings Параметры отображения текстуры
          */
         Mesh::Mesh(const vk::tools::Device* pDevice,
-                   const vk::UniqueDescriptorPool& descriptorPool,
-                   const vk::UniqueDescriptorSetLayout& descriptorSetLayout,
                    vk::resources::GeometryBufferPtr geometryBufferPtr,
                    const vk::resources::TextureBufferPtr& defaultTexturePtr,
                    vk::scene::MeshTextureSet textureSet,
@@ -130,148 +111,23 @@ namespace vk
                    const vk::scene::MeshTextureMapping& textureMappingSettings): SceneElement(),
         isReady_(false),
         pDevice_(pDevice),
-        pDescriptorPool_(&(descriptorPool.get())),
         geometryBufferPtr_(std::move(geometryBufferPtr)),
         textureSet_(std::move(textureSet)),
         materialSettings_(materialSettings),
-        skeleton_(new MeshSkeleton())
+        textureMapping_(textureMappingSettings),
+        skeleton_(new MeshSkeleton()),
+        normalMatrix_(1.0f),
+        lod_(0),
+        uploadTicket_(0),
+        pChangedSlots_(nullptr),
+        sceneSlot_(0),
+        changed_(false)
         {
             // Проверить устройство
             if(pDevice_ == nullptr || !pDevice_->isReady()){
                 throw vk::DeviceLostError("Device is not available");
             }
 
-            // Выделить буфер для матрицы модели
-            uboModelMatrix_ = vk::tools::Buffer(pDevice_,
-                    sizeof(glm::mat4),
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Выделить буфер для параметров материала
-            uboMaterial_ = vk::tools::Buffer(pDevice_,
-                    MATERIAL_UBO_SIZE,
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Выделить буфер для параметров отображения текстуры
-            uboTextureMapping_ = vk::tools::Buffer(pDevice_,
-                    sizeof(vk::scene::MeshTextureMapping),
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Выделить буфер для параметров использования текстур (какие текстуры используются а какие нет)
-            uboTextureUsage_ = vk::tools::Buffer(pDevice_,
-                    TEXTURES_USAGE_UBO_SIZE,
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Выделить буфер для кол-ва костей скелетной анимации
-            uboBoneCount_ = vk::tools::Buffer(pDevice_,
-                    sizeof(glm::uint32),
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Выделить буфер для матриц костей скелетной анимации
-            uboBoneTransforms_ = vk::tools::Buffer(pDevice_,
-                    sizeof(glm::mat4) * MAX_SKELETON_BONES,
-                    vk::BufferUsageFlagBits::eUniformBuffer,
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-
-            // Разметить память буферов, получив указатели
-            pUboModelMatrixData_ = uboModelMatrix_.mapMemory();
-            pUboMaterialData_ = uboMaterial_.mapMemory();
-            pUboTextureMappingData_ = uboTextureMapping_.mapMemory();
-            pUboTextureUsageData_ = uboTextureUsage_.mapMemory();
-            pUboBoneCountData_ = uboBoneCount_.mapMemory();
-            pUboBoneTransformsData_ = uboBoneTransforms_.mapMemory();
-
-            // Выделить дескрипторный набор
-            vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{};
-            descriptorSetAllocateInfo.descriptorPool = descriptorPool.get();
-            descriptorSetAllocateInfo.pSetLayouts = &(descriptorSetLayout.get());
-            descriptorSetAllocateInfo.descriptorSetCount = 1;
-            auto allocatedSets = pDevice_->getLogicalDevice()->allocateDescriptorSets(descriptorSetAllocateInfo);
-
-            // Сохраняем набор
-            descriptorSet_ = vk::UniqueDescriptorSet(allocatedSets[0]);
-
-            // Информация о буферах
-            std::vector<vk::DescriptorBufferInfo> bufferInfos = {
-                    {uboModelMatrix_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                    {uboTextureMapping_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                    {uboMaterial_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                    {uboTextureUsage_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                    {uboBoneCount_.getBuffer().get(),0,VK_WHOLE_SIZE},
-                    {uboBoneTransforms_.getBuffer().get(),0,VK_WHOLE_SIZE}
-            };
-
-            // Описываем связи дескрипторов с буферами (описание "записей")
-            std::vector<vk::WriteDescriptorSet> writes = {
-                    {
-                            descriptorSet_.get(),
-                            0,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 0,
-                            nullptr
-                    },
-                    {
-                            descriptorSet_.get(),
-                            1,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 1,
-                            nullptr
-                    },
-                    {
-                            descriptorSet_.get(),
-                            2,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 2,
-                            nullptr
-                    },
-                    {
-                            descriptorSet_.get(),
-                            4,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 3,
-                            nullptr
-                    },
-                    {
-                            descriptorSet_.get(),
-                            5,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 4,
-                            nullptr
-                    },
-                    {
-                            descriptorSet_.get(),
-                            6,
-                            0,
-                            1,
-                            vk::DescriptorType::eUniformBuffer,
-                            nullptr,
-                            bufferInfos.data() + 5,
-                            nullptr
-                    }
-            };
-
-            // Массив с информацией о текстурах привязываемых к дескриптору
-            std::vector<vk::DescriptorImageInfo> descriptorImageInfos = {};
-
             // Превращаем набор текстурных указателей в массив (для более удобной работы)
             std::vector<vk::resources::TextureBufferPtr> texturePointers(5);
             texturePointers[TEXTURE_TYPE_ALBEDO] = textureSet_.albedo;
@@ -280,64 +136,31 @@ namespace vk
             texturePointers[TEXTURE_TYPE_NORMAL] = textureSet_.normal;
             texturePointers[TEXTURE_TYPE_DISPLACE] = textureSet_.displace;
 
-            // Заполнение массива описаний изображений
+            // Индексы текстур в глобальной таблице (текстуры регистрируются в таблице при создании, набор дескрипторов
+            // у меша не нужен - шейдер выбирает текстуру по индексу из потока экземпляров)
             for(glm::uint32 i = 0; i < texturePointers.size(); i++)
             {
-                // Указатель на ресурс текстуры
-                vk::resources::TextureBufferPtr texture;
-
                 // Если текстура указана - использовать, отметить что она используется
                 if(texturePointers[i].get() != nullptr){
-                    texture = texturePointers[i];
+                    this->textureIndices_[i] = texturePointers[i]->getTableIndex();
                     this->textureUsage_[i] = static_cast<glm::uint32>(true);
                 }
                 // Если текстура не указана - использовать текстуру по умолчанию, отметить что она НЕ используется
                 else{
-                    texture = defaultTexturePtr;
+                    this->textureIndices_[i] = defaultTexturePtr != nullptr ? defaultTexturePtr->getTableIndex() : 0;
                     this->textureUsage_[i] = static_cast<glm::uint32>(false);
                 }
-
-                // Если в итоге текстура готова - добавить информацию для дескриптора
-                if(texture.get() != nullptr)
-                {
-                    descriptorImageInfos.emplace_back(
-                            vk::DescriptorImageInfo(
-                                    texture->getSampler()->get(),
-                                    texture->getImage().getImageView().get(),
-                                    vk::ImageLayout::eShaderReadOnlyOptimal));
-                }
             }
 
-            // Добавить запись для дескрипторов текстур (массив дескрипторов)
-            if(!descriptorImageInfos.empty()){
-                // Связь дескриптора с изображением
-                writes.emplace_back(vk::WriteDescriptorSet(
-                        descriptorSet_.get(),
-                        3,
-                        0,
-                        descriptorImageInfos.size(),
-                        vk::DescriptorType::eCombinedImageSampler,
-                        descriptorImageInfos.data(),
-                        nullptr,
-                        nullptr
-                ));
+            // Меш можно рисовать только после загрузки всех его ресурсов (партии видимы графической очереди по порядку)
+            uploadTicket_ = geometryBufferPtr_ != nullptr ? geometryBufferPtr_->getUploadTicket() : 0;
+            if(defaultTexturePtr != nullptr) uploadTicket_ = (std::max)(uploadTicket_, defaultTexturePtr->getUploadTicket());
+            for(const auto& texturePtr : texturePointers){
+                if(texturePtr != nullptr) uploadTicket_ = (std::max)(uploadTicket_, texturePtr->getUploadTicket());
             }
 
-            // Связываем дескрипторы с ресурсами (буферами и изображениями)
-            pDevice_->getLogicalDevice()->updateDescriptorSets(writes.size(),writes.data(),0, nullptr);
-
-            // Обновить UBO буферы
-            this->updateMatrixUbo();
-            this->updateMaterialSettingsUbo();
-            this->updateTextureMappingUbo();
-            this->updateTextureUsageUbo();
-            this->updateSkeletonBoneCountUbo();
-            this->updateSkeletonBoneTransformsUbo();
-
-            // Установить callback функция скелету, вызываемую при обновлении данных костей
-            skeleton_->setUpdateCallback([&](){
-                this->updateSkeletonBoneTransformsUbo();
-            });
+            // Ограничивающие объемы для отсечения по пирамиде видимости
+            this->updateWorldBounds();
 
             // Инициализация завершена
             isReady_ = true;
@@ -350,37 +173,8 @@ namespace vk
         {
             if(isReady_ && pDevice_!= nullptr && pDevice_->isReady())
             {
-                // Вернуть в пул набор дескрипторов и освободить smart-pointer
-                pDevice_->getLogicalDevice()->freeDescriptorSets(*pDescriptorPool_,{descriptorSet_.get()});
-                descriptorSet_.release();
-
-                // Очистить UBO буферы
-                uboModelMatrix_.unmapMemory();
-                uboModelMatrix_.destroyVulkanResources();
-                
-                uboMaterial_.unmapMemory();
-                uboMaterial_.destroyVulkanResources();
-
-                uboTextureMapping_.unmapMemory();
-                uboTextureMapping_.destroyVulkanResources();
-
-                uboTextureUsage_.unmapMemory();
-                uboTextureUsage_.destroyVulkanResources();
-
-                uboBoneCount_.unmapMemory();
-                uboBoneCount_.destroyVulkanResources();
-
-                uboBoneTransforms_.unmapMemory();
-                uboBoneTransforms_.destroyVulkanResources();
-
                 // Обнулить указатели
                 pDevice_ = nullptr;
-                pDescriptorPool_ = nullptr;
-                pUboModelMatrixData_ = nullptr;
-                pUboMaterialData_ = nullptr;
-                pUboTextureMappingData_ = nullptr;
-                pUboBoneCountData_ = nullptr;
-                pUboBoneTransformsData_ = nullptr;
 
                 // Объект де-инициализирован
                 isReady_ = false;
@@ -404,11 +198,100 @@ namespace vk
         }
 
         /**
-         * Получить дескрипторный набор
-         * @return Константная ссылка на объект дескрипторного набора
+         * Получить ключ перестановки шейдеров (см. SHADER_PERMUTATION_*)
+         * @return Ключ, по которому рендерер выбирает вариант основного конвейера
+         *
+         * @details Скелет по умолчанию состоит из одной (единичной) кости, такой меш рисуется без скелетной анимации
          */
-        const vk::DescriptorSet &Mesh::getDescriptorSet() const {
-            return descriptorSet_.get();
+        uint32_t Mesh::getShaderPermutation() const
+        {
+            uint32_t permutation = 0;
+
+            // Скелетная анимация возможна только если у геометрии есть поток весов
+            if(skeleton_ != nullptr && skeleton_->getBonesCount() > 1 && geometryBufferPtr_->hasSkinStream()){
+                permutation |= SHADER_PERMUTATION_SKINNED;
+            }
+
+            if(geometryBufferPtr_->hasColorStream()){
+                permutation |= SHADER_PERMUTATION_VERTEX_COLOR;
+            }
+
+            for(size_t i = 0; i <= TEXTURE_TYPE_NORMAL; i++){
+                if(textureUsage_[i]) permutation |= (1u << i) << SHADER_PERMUTATION_TEXTURE_SHIFT;
+            }
+
+            if(textureUsage_[TEXTURE_TYPE_DISPLACE]){
+                permutation |= SHADER_PERMUTATION_PARALLAX;
+            }
+
+            return permutation;
+        }
+
+        /**
+         * Получить ограничивающие объемы в мировом пространстве
+         * @return Константная ссылка на структуру
+         */
+        const vk::scene::MeshWorldBounds& Mesh::getWorldBounds() const
+        {
+            return worldBounds_;
+        }
+
+        /**
+         * Получить текущий уровень детализации геометрии
+         * @return Номер уровня (0 - исходная геометрия)
+         */
+        size_t Mesh::getLod() const
+        {
+            return lod_;
+        }
+
+        /**
+         * Установить текущий уровень детализации геометрии
+         * @param lod Номер уровня (ограничивается кол-вом уровней геометрического буфера)
+         */
+        void Mesh::setLod(size_t lod)
+        {
+            const size_t lodCount = geometryBufferPtr_ != nullptr ? geometryBufferPtr_->getLodCount() : 1;
+            lod_ = (std::min)(lod, lodCount - 1);
+        }
+
+        /**
+         * Получить матрицу преобразования нормалей
+         * @return Константная ссылка на матрицу (используется верхняя 3x3 часть)
+         */
+        const glm::mat4& Mesh::getNormalMatrix() const
+        {
+            return normalMatrix_;
+        }
+
+        /**
+         * Получить ключ инстансинга
+         * @return Ключ, равный у мешей, которые можно рисовать одним вызовом
+         */
+        vk::scene::MeshInstancingKey Mesh::getInstancingKey() const
+        {
+            vk::scene::MeshInstancingKey key{};
+            key.geometry = geometryBufferPtr_.get();
+            key.lod = static_cast<uint32_t>(lod_);
+            key.permutation = this->getShaderPermutation();
+            key.textureMapping = textureMapping_;
+            return key;
+        }
+
+        /**
+         * Получить индексы текстур в глобальной таблице текстур устройства
+         * @return Указатель на массив из 5 индексов (albedo, roughness, metallic, normal, displace)
+         */
+        const glm::uint32* Mesh::getTextureIndices() const {
+            return textureIndices_;
+        }
+
+        /**
+         * Получить номер последней партии загрузки геометрии и текстур меша
+         * @return Номер партии (меш можно рисовать, когда партия станет видимой графической очереди)
+         */
+        vk::tools::UploadTicket Mesh::getUploadTicket() const {
+            return uploadTicket_;
         }
 
         /**
@@ -419,84 +302,107 @@ namespace vk
         {
             if(updateMatrices){
                 this->updateModelMatrix();
-                this->updateMatrixUbo();
+
+                // Матрица нормалей учитывает только поворот, без искажения нормалей при неравномерном масштабировании
+                normalMatrix_ = glm::mat4(glm::transpose(glm::inverse(glm::mat3(this->getModelMatrix()))));
+
+                this->updateWorldBounds();
+                this->markChanged();
             }
         }
 
         /**
-         * Обновление UBO буферов матриц модели
+         * Пересчитать ограничивающие объемы в мировом пространстве
          */
-        void Mesh::updateMatrixUbo()
+        void Mesh::updateWorldBounds()
         {
-            if(uboModelMatrix_.isReady()){
-                memcpy(pUboModelMatrixData_,&(this->getModelMatrix()), sizeof(glm::mat4));
-            }
+            if(geometryBufferPtr_ == nullptr) return;
+
+            const vk::tools::Bounds& bounds = geometryBufferPtr_->getBounds();
+            const glm::mat4& model = this->getModelMatrix();
+            const glm::vec3 localCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+            const glm::vec3 localExtent = (bounds.aabbMax - bounds.aabbMin) * 0.5f;
+
+            // Половина размера AABB после поворота/масштаба - сумма проекций осей (модули элементов матрицы)
+            const glm::mat3 basis(model);
+            const glm::mat3 absBasis(glm::abs(basis[0]), glm::abs(basis[1]), glm::abs(basis[2]));
+
+            worldBounds_.center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+            worldBounds_.extent = absBasis * localExtent;
+            worldBounds_.radius = bounds.sphereRadius * glm::sqrt((std::max)({
+                glm::dot(basis[0], basis[0]),
+                glm::dot(basis[1], basis[1]),
+                glm::dot(basis[2], basis[2])}));
         }
 
         /**
-         * Обновление UBO буферов параметров материала меша
+         * Получить размер блока данных меша в кольцевом буфере кадра
+         * @return Размер в байтах (матрицы костей размещаются только для мешей со скелетной анимацией)
          */
-        void Mesh::updateMaterialSettingsUbo()
+        size_t Mesh::getUniformDataSize() const
         {
-            if(uboMaterial_.isReady()){
-                // Преобразование указателя (для возможности указывать побайтовое смещение)
-                auto pData = reinterpret_cast<unsigned char*>(pUboMaterialData_);
-
-                // Копирование в буфер (с учетом выравнивания std140)
-                memcpy(pData + 0,&materialSettings_.albedo,16);
-                memcpy(pData + 12,&materialSettings_.roughness,4);
-                memcpy(pData + 16, &materialSettings_.metallic,4);
-            }
+            return (this->getShaderPermutation() & SHADER_PERMUTATION_SKINNED) != 0 ? MESH_UNIFORM_SIZE : MESH_UNIFORM_HEADER_SIZE;
         }
 
         /**
-         * Обновление UBO буферов параметров отображения текстуры меша
+         * Записать блок данных меша (параметры отображения текстуры, кол-во и матрицы костей)
+         * @param pData Указатель на блок в размеченной памяти (размером не меньше getUniformDataSize())
          */
-        void Mesh::updateTextureMappingUbo()
+        void Mesh::writeUniforms(unsigned char* pData) const
         {
-            if(uboTextureMapping_.isReady()){
-                memcpy(pUboTextureMappingData_,&textureMapping_, sizeof(vk::scene::MeshTextureMapping));
+            // Параметры отображения текстуры (структура std140 занимает 32 байта)
+            memcpy(pData, &textureMapping_, sizeof(vk::scene::MeshTextureMapping));
+
+            // Кол-во костей скелетной анимации
+            const glm::uint32 boneCount = skeleton_ != nullptr ? static_cast<glm::uint32>(skeleton_->getBonesCount()) : 0;
+            memcpy(pData + 32, &boneCount, sizeof(glm::uint32));
+
+            // Матрицы трансформации костей (только если шейдер их читает)
+            if(skeleton_ != nullptr && (this->getShaderPermutation() & SHADER_PERMUTATION_SKINNED) != 0){
+                memcpy(pData + MESH_UNIFORM_HEADER_SIZE, skeleton_->getFinalBoneTransforms().data(),
+                        (std::min)(skeleton_->getTransformsDataSize(), sizeof(glm::mat4) * MAX_SKELETON_BONES));
             }
         }
 
         /**
-         * Обновление UBO параметров использования текстур
+         * Отметить меш как изменившийся (добавить слот в список изменившихся, если изменения отслеживаются)
          */
-        void Mesh::updateTextureUsageUbo()
+        void Mesh::markChanged()
         {
-            if(uboTextureUsage_.isReady()){
-                // Преобразование указателя (для возможности указывать побайтовое смещение)
-                auto pData = reinterpret_cast<unsigned char*>(pUboTextureUsageData_);
-
-                // Копирование в буфер (с учетом выравнивания std140)
-                memcpy(pData + 0, &(textureUsage_[0]), sizeof(glm::uint32));  // albedo (0)
-                memcpy(pData + 16, &(textureUsage_[1]), sizeof(glm::uint32)); // roughness (1)
-                memcpy(pData + 32, &(textureUsage_[2]), sizeof(glm::uint32)); // metallic (2)
-                memcpy(pData + 48, &(textureUsage_[3]), sizeof(glm::uint32)); // normal (3)
-                memcpy(pData + 64, &(textureUsage_[4]), sizeof(glm::uint32)); // displace (4)
+            if(pChangedSlots_ != nullptr && !changed_){
+                pChangedSlots_->push_back(sceneSlot_);
+                changed_ = true;
             }
         }
 
         /**
-         * Обновление UBO параметров скелетной анимации (кол-во костей)
+         * Начать (или прекратить) отслеживание изменений меша рендерером
+         * @param pChangedSlots Список слотов изменившихся мешей (nullptr - прекратить отслеживание)
+         * @param slot Слот меша в данных сцены рендерера
          */
-        void Mesh::updateSkeletonBoneCountUbo()
+        void Mesh::trackChanges(std::vector<uint32_t>* pChangedSlots, uint32_t slot)
         {
-            if(uboBoneCount_.isReady() && this->skeleton_ != nullptr)
-            {
-                glm::uint32 count = this->skeleton_->getBonesCount();
-                memcpy(pUboBoneCountData_, &count, sizeof(glm::uint32));
-            }
+            pChangedSlots_ = pChangedSlots;
+            sceneSlot_ = slot;
+            changed_ = false;
+            this->markChanged();
         }
 
         /**
-         * Обновление UBO параметров скелетной анимации (матрицы трансформации костей)
+         * Получить слот меша в данных сцены рендерера
+         * @return Номер слота
          */
-        void Mesh::updateSkeletonBoneTransformsUbo()
+        uint32_t Mesh::getSceneSlot() const
         {
-            if(uboBoneTransforms_.isReady() && this->skeleton_ != nullptr){
-                memcpy(pUboBoneTransformsData_,this->skeleton_->getFinalBoneTransforms().data(), this->skeleton_->getTransformsDataSize());
-            }
+            return sceneSlot_;
+        }
+
+        /**
+         * Сбросить признак изменения (рендерер обработал слот меша из списка изменившихся)
+         */
+        void Mesh::resetChanged()
+        {
+            changed_ = false;
         }
 
         /**
@@ -505,7 +411,7 @@ namespace vk
          */
         void Mesh::setMaterialSettings(const MeshMaterialSettings &settings) {
             materialSettings_ = settings;
-            this->updateMaterialSettingsUbo();
+            this->markChanged();
         }
 
         /**
@@ -523,7 +429,7 @@ namespace vk
         void Mesh::setTextureMapping(const MeshTextureMapping &textureMapping)
         {
             textureMapping_ = textureMapping;
-            this->updateTextureMappingUbo();
+            this->markChanged();
         }
 
         /**
@@ -542,17 +448,10 @@ namespace vk
         {
             // Сменить скелеты
             this->skeleton_ = std::move(skeleton);
-            // Пересчитать матрицы
+            // Пересчитать матрицы (в блок данных меша они попадут при подготовке следующего кадра)
             this->skeleton_->getRootBone()->calculateBranch(false);
-
-            // Обновить UBO
-            this->updateSkeletonBoneCountUbo();
-            this->updateSkeletonBoneTransformsUbo();
-
-            // Установить callback функция скелету, вызываемую при обновлении данных костей
-            this->skeleton_->setUpdateCallback([&](){
-                this->updateSkeletonBoneTransformsUbo();
-            });
+            // Наличие скелета меняет вариант конвейера меша
+            this->markChanged();
         }
 
         /**
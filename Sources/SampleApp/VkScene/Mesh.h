@@ -5,27 +5,29 @@
 #include "../VkResources/GeometryBuffer.hpp"
 #include "../VkResources/TextureBuffer.hpp"
 
+#include <functional>
+
 namespace vk
 {
     namespace scene
     {
         /**
-         * Размер UBO буфера материала меша
-         * С учетом выравнивания std140
+         * Количество костей скелетной анимации
+         * Определяет размер блока данных меша
          */
-        const size_t MATERIAL_UBO_SIZE = 24;
+        const size_t MAX_SKELETON_BONES = 50;
 
         /**
-         * Размер UBO буфера для статуса использования текустур
-         * С учетом выравнивания stf140 на 1 флаг приходится 16 байт (массив из 5 элементов)
+         * Размер заголовка блока данных меша (параметры отображения текстуры и кол-во костей)
+         * С учетом выравнивания std140 (структура параметров отображения занимает 32 байта, кол-во костей - 16)
          */
-        const size_t TEXTURES_USAGE_UBO_SIZE = 80;
+        const size_t MESH_UNIFORM_HEADER_SIZE = 48;
 
         /**
-         * Количество костей скелетной анимации
-         * Определяет размер буфера uboBoneTransforms_
+         * Полный размер блока данных меша (заголовок и матрицы костей)
+         * Диапазон дескриптора данных объекта, меши без скелетной анимации занимают в кольцевом буфере только заголовок
          */
-        const size_t MAX_SKELETON_BONES = 50;
+        const size_t MESH_UNIFORM_SIZE = MESH_UNIFORM_HEADER_SIZE + sizeof(glm::mat4) * MAX_SKELETON_BONES;
 
         // Типы текстур
         // Порядок индексов должен соответствовать порядку MeshTextureSet
@@ -35,6 +37,16 @@ namespace vk
         const size_t TEXTURE_TYPE_NORMAL    = 3;
         const size_t TEXTURE_TYPE_DISPLACE  = 4;
 
+        // Ключ перестановки шейдеров (определяет вариант основного конвейера, которым рисуется меш)
+        // Биты соответствуют специализационным константам шейдеров (SKINNED, TEXTURE_MASK, PARALLAX)
+        // и наличию необязательных потоков вершин (VERTEX_COLOR меняет только описание входных данных конвейера)
+        const uint32_t SHADER_PERMUTATION_SKINNED       = (1u << 0u);  // Скелетная анимация
+        const uint32_t SHADER_PERMUTATION_TEXTURE_SHIFT = 1u;          // Сдвиг маски используемых текстур (albedo, roughness, metallic, normal)
+        const uint32_t SHADER_PERMUTATION_TEXTURE_MASK  = 0xFu;        // Маска используемых текстур (после сдвига)
+        const uint32_t SHADER_PERMUTATION_PARALLAX      = (1u << 5u);  // Параллакс (используется карта глубины)
+        const uint32_t SHADER_PERMUTATION_VERTEX_COLOR  = (1u << 6u);  // Поток цветов вершин
+        const uint32_t SHADER_PERMUTATION_COUNT         = (1u << 7u);  // Кол-во перестановок
+
         struct MeshTextureSet
         {
             vk::resources::TextureBufferPtr albedo = nullptr;
@@ -59,6 +71,54 @@ namespace vk
             glm::float32 angle = 0.0f;
         };
 
+        /**
+         * Ограничивающие объемы меша в мировом пространстве
+         * @details AABB задан центром и половиной размера, сфера - тем же центром и радиусом
+         */
+        struct MeshWorldBounds
+        {
+            glm::vec3 center = {0.0f,0.0f,0.0f};
+            glm::vec3 extent = {0.0f,0.0f,0.0f};
+            glm::float32 radius = 0.0f;
+        };
+
+        /**
+         * Ключ инстансинга меша
+         * @details Меши с равными ключами рисуются одним вызовом с несколькими экземплярами (с блоком данных
+         * первого из них): у них общие участок геометрии, вариант конвейера и параметры отображения текстур.
+         * Матрица модели, параметры материала и индексы текстур в глобальной таблице у каждого экземпляра свои
+         * (поток экземпляров), поэтому меши с разными текстурами рисуются одним вызовом
+         */
+        struct MeshInstancingKey
+        {
+            const void* geometry = nullptr;
+            uint32_t lod = 0;
+            uint32_t permutation = 0;
+            MeshTextureMapping textureMapping;
+
+            bool operator==(const MeshInstancingKey& other) const
+            {
+                return geometry == other.geometry &&
+                       lod == other.lod &&
+                       permutation == other.permutation &&
+                       textureMapping.offset == other.textureMapping.offset &&
+                       textureMapping.origin == other.textureMapping.origin &&
+                       textureMapping.scale == other.textureMapping.scale &&
+                       textureMapping.angle == other.textureMapping.angle;
+            }
+        };
+
+        /**
+         * Хеш ключа инстансинга (параметры отображения текстур не учитываются - их сравнивает operator==)
+         */
+        struct MeshInstancingKeyHash
+        {
+            size_t operator()(const MeshInstancingKey& key) const
+            {
+                return std::hash<const void*>()(key.geometry) ^ (std::hash<uint32_t>()(key.permutation) << 1u) ^ (std::hash<uint32_t>()(key.lod) << 9u);
+            }
+        };
+
         class Mesh : public SceneElement
         {
         private:
@@ -76,73 +136,29 @@ namespace vk
             vk::scene::MeshTextureMapping textureMapping_;
             /// Параметры использования текстур
             glm::uint32 textureUsage_[5] = {0,0,0,0,0};
+            /// Индексы текстур в глобальной таблице текстур (у неиспользуемых - индекс текстуры по умолчанию)
+            glm::uint32 textureIndices_[5] = {0,0,0,0,0};
             /// Параметры скелета
             UniqueMeshSkeleton skeleton_;
-
-            /// UBO буфер для матрицы модели
-            vk::tools::Buffer uboModelMatrix_;
-            /// Указатель на размеченную область буфера UBO матрицы модели
-            void* pUboModelMatrixData_;
-
-            /// UBO буфер для параметров материала
-            vk::tools::Buffer uboMaterial_;
-            /// Указатель на размеченную область буфера UBO материала
-            void* pUboMaterialData_;
-
-            /// UBO буфер для параметров материала меша
-            vk::tools::Buffer uboTextureMapping_;
-            /// Указатель на размеченную область буфера UBO параметров материала
-            void* pUboTextureMappingData_;
-
-            /// UBO буфер для параметров использования текстур
-            vk::tools::Buffer uboTextureUsage_;
-            /// Указатель на размеченную область буфера UBO параметров использования текстур
-            void* pUboTextureUsageData_;
-
-            /// UBO буфер для кол-ва костей скелетной анимации
-            vk::tools::Buffer uboBoneCount_;
-            /// Указатель на размеченную область буфера UBO кол-ва костей скелетной анимации
-            void* pUboBoneCountData_;
-
-            /// UBO буфер для матриц костей скелетной анимации
-            vk::tools::Buffer uboBoneTransforms_;
-            /// Указатель на размеченную область буфера UBO матриц костей скелетной анимации
-            void* pUboBoneTransformsData_;
-
-            /// Указатель на пул дескрипторов, из которого выделяется набор дескрипторов меша
-            const vk::DescriptorPool *pDescriptorPool_;
-            /// Дескрипторный набор
-            vk::UniqueDescriptorSet descriptorSet_;
-
-            /**
-             * Обновление UBO буферов матриц модели
-             */
-            void updateMatrixUbo();
-
-            /**
-             * Обновление UBO буферов параметров материала меша
-             */
-            void updateMaterialSettingsUbo();
-
-            /**
-             * Обновление UBO буферов параметров отображения текстуры меша
-             */
-            void updateTextureMappingUbo();
-
-            /**
-             * Обновление UBO параметров использования текстур
-             */
-            void updateTextureUsageUbo();
-
-            /**
-             * Обновление UBO параметров скелетной анимации (кол-во костей)
-             */
-            void updateSkeletonBoneCountUbo();
+            /// Матрица преобразования нормалей (вычисляется на CPU при смене положения, а не для каждой вершины)
+            glm::mat4 normalMatrix_;
+            /// Ограничивающие объемы в мировом пространстве (пересчитываются при смене положения)
+            vk::scene::MeshWorldBounds worldBounds_;
+            /// Текущий уровень детализации геометрии (выбирается рендерером каждый кадр)
+            size_t lod_;
+            /// Номер последней партии загрузки геометрии и текстур меша
+            vk::tools::UploadTicket uploadTicket_;
+            /// Список слотов изменившихся мешей, который ведет рендерер (nullptr - изменения не отслеживаются)
+            std::vector<uint32_t>* pChangedSlots_;
+            /// Слот меша в данных сцены рендерера (добавляется в список изменившихся)
+            uint32_t sceneSlot_;
+            /// Добавлен ли слот в список изменившихся (повторные изменения до обработки списка не добавляют его снова)
+            bool changed_;
 
             /**
-             * Обновление UBO параметров скелетной анимации (матрицы трансформации костей)
+             * Отметить меш как изменившийся (добавить слот в список изменившихся, если изменения отслеживаются)
              */
-            void updateSkeletonBoneTransformsUbo();
+            void markChanged();
 
             /**
              * Событие смены положения
@@ -150,6 +166,13 @@ namespace vk
              */
             void onPlacementUpdated(bool updateMatrices) override;
 
+            /**
+             * Пересчитать ограничивающие объемы в мировом пространстве
+             * @details Локальный AABB преобразуется матрицей модели (размер - через модули элементов матрицы),
+             * радиус сферы масштабируется наибольшим масштабом по осям
+             */
+            void updateWorldBounds();
+
         public:
             /**
              * Конструктор по умолчанию
@@ -159,8 +182,6 @@ namespace vk
             /**
              * Основной конструктор
              * @param pDevice Указатель на объект устройства
-             * @param descriptorPool Unique smart pointer объекта дескрипторного пула
-             * @param descriptorSetLayout Unique smart pointer макета размещения дескрипторного набора меша
              * @param geometryBufferPtr Smart-pointer на объект геом. буфера
              * @param defaultTexturePtr Smart-pointer на объект текстурного буфера
              * @param textureSet Набор текстур меша
@@ -168,8 +189,6 @@ namespace vk
              * @param textureMappingSettings Параметры отображения текстуры
              */
             explicit Mesh(const vk::tools::Device* pDevice,
-                    const vk::UniqueDescriptorPool& descriptorPool,
-                    const vk::UniqueDescriptorSetLayout& descriptorSetLayout,
                     vk::resources::GeometryBufferPtr geometryBufferPtr,
                     const vk::resources::TextureBufferPtr& defaultTexturePtr,
                     vk::scene::MeshTextureSet textureSet = {},
@@ -226,10 +245,87 @@ namespace vk
             const vk::resources::GeometryBufferPtr& getGeometryBuffer() const;
 
             /**
-             * Получить дескрипторный набор
-             * @return Константная ссылка на объект дескрипторного набора
+             * Получить ключ перестановки шейдеров (см. SHADER_PERMUTATION_*)
+             * @return Ключ, по которому рендерер выбирает вариант основного конвейера
+             */
+            uint32_t getShaderPermutation() const;
+
+            /**
+             * Получить ограничивающие объемы в мировом пространстве
+             * @return Константная ссылка на структуру
+             */
+            const vk::scene::MeshWorldBounds& getWorldBounds() const;
+
+            /**
+             * Получить текущий уровень детализации геометрии
+             * @return Номер уровня (0 - исходная геометрия)
+             */
+            size_t getLod() const;
+
+            /**
+             * Установить текущий уровень детализации геометрии
+             * @param lod Номер уровня (ограничивается кол-вом уровней геометрического буфера)
+             */
+            void setLod(size_t lod);
+
+            /**
+             * Получить матрицу преобразования нормалей
+             * @return Константная ссылка на матрицу (используется верхняя 3x3 часть)
+             */
+            const glm::mat4& getNormalMatrix() const;
+
+            /**
+             * Получить ключ инстансинга
+             * @return Ключ, равный у мешей, которые можно рисовать одним вызовом
+             */
+            vk::scene::MeshInstancingKey getInstancingKey() const;
+
+            /**
+             * Получить размер блока данных меша в кольцевом буфере кадра
+             * @return Размер в байтах (матрицы костей размещаются только для мешей со скелетной анимацией)
+             */
+            size_t getUniformDataSize() const;
+
+            /**
+             * Записать блок данных меша (параметры отображения текстуры, кол-во и матрицы костей)
+             * @param pData Указатель на блок в размеченной памяти (размером не меньше getUniformDataSize())
+             *
+             * @details Вызывается рендерером каждый кадр для первого меша группы экземпляров
+             */
+            void writeUniforms(unsigned char* pData) const;
+
+            /**
+             * Получить индексы текстур в глобальной таблице текстур устройства
+             * @return Указатель на массив из 5 индексов (albedo, roughness, metallic, normal, displace)
+             */
+            const glm::uint32* getTextureIndices() const;
+
+            /**
+             * Получить номер последней партии загрузки геометрии и текстур меша
+             * @return Номер партии (меш можно рисовать, когда партия станет видимой графической очереди)
+             */
+            vk::tools::UploadTicket getUploadTicket() const;
+
+            /**
+             * Начать (или прекратить) отслеживание изменений меша рендерером
+             * @param pChangedSlots Список слотов изменившихся мешей (nullptr - прекратить отслеживание)
+             * @param slot Слот меша в данных сцены рендерера
+             *
+             * @details Слот добавляется в список при смене положения, материала, параметров отображения текстуры
+             * или скелета. Сразу после начала отслеживания меш считается изменившимся
+             */
+            void trackChanges(std::vector<uint32_t>* pChangedSlots, uint32_t slot);
+
+            /**
+             * Получить слот меша в данных сцены рендерера
+             * @return Номер слота (имеет смысл, только если изменения отслеживаются)
+             */
+            uint32_t getSceneSlot() const;
+
+            /**
+             * Сбросить признак изменения (рендерер обработал слот меша из списка изменившихся)
              */
-            const vk::DescriptorSet& getDescriptorSet() const;
+            void resetChanged();
 
             /**
              * Установить параметры материала
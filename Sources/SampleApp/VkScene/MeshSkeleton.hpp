@@ -6,6 +6,7 @@
 #pragma once
 
 #include "MeshSkeletonAnimation.hpp"
+#include "../Tools/Profiler.hpp"
 
 #include <vector>
 #include <functional>
@@ -445,6 +446,8 @@ namespace vk
              */
             void updateAnimation(float deltaMs)
             {
+                PROFILE_SCOPE("vk::scene::MeshSkeleton::updateAnimation");
+
                 // Если анимация установлена
                 if(currentAnimationPtr_ != nullptr)
                 {
@@ -16,8 +16,8 @@ namespace vk
             const vk::tools::Device* pDevice_;
             /// Буфер Vulkan (smart-pointer)
             vk::UniqueBuffer buffer_;
-            /// Память буфера
-            vk::UniqueDeviceMemory memory_;
+            /// Участок памяти буфера (выделяется распределителем устройства)
+            vk::tools::MemoryAllocation memory_;
             /// Размер буфера
             vk::DeviceSize size_;
 
@@ -50,7 +50,7 @@ namespace vk
                 std::swap(pDevice_,other.pDevice_);
                 std::swap(size_,other.size_);
                 buffer_.swap(other.buffer_);
-                memory_.swap(other.memory_);
+                std::swap(memory_,other.memory_);
             }
 
             /**
@@ -70,7 +70,7 @@ namespace vk
                 std::swap(pDevice_,other.pDevice_);
                 std::swap(size_,other.size_);
                 buffer_.swap(other.buffer_);
-                memory_.swap(other.memory_);
+                std::swap(memory_,other.memory_);
 
                 return *this;
             }
@@ -82,12 +82,15 @@ namespace vk
              * @param usageFlags Флаги использования (назначения) буфера
              * @param memoryPropertyFlags Тип и доступ к памяти (память устройства, хоста, видима ли хостом и тд.)
              * @param memoryRequirements Требования к памяти. Если передан указатель на структуры будут использованы они
+             * @param queueFamilyIndices Семейства очередей, использующих буфер (если их больше одного - буфер доступен им
+             * одновременно, без передачи владения)
              */
             Buffer(const vk::tools::Device* pDevice,
                    const vk::DeviceSize& size,
                    const vk::BufferUsageFlags& usageFlags,
                    const vk::MemoryPropertyFlags& memoryPropertyFlags,
-                   vk::MemoryRequirements* memoryRequirements = nullptr):
+                   vk::MemoryRequirements* memoryRequirements = nullptr,
+                   const std::vector<uint32_t>& queueFamilyIndices = {}):
                     isReady_(false),
                     pDevice_(pDevice),
                     size_(size)
@@ -101,9 +104,9 @@ namespace vk
                 vk::BufferCreateInfo bufferCreateInfo{};
                 bufferCreateInfo.size = size_;
                 bufferCreateInfo.usage = usageFlags;
-                bufferCreateInfo.sharingMode = vk::SharingMode::eExclusive;    //TODO: добавить параметр
-                bufferCreateInfo.queueFamilyIndexCount = 0;                    //TODO: добавить параметр
-                bufferCreateInfo.pQueueFamilyIndices = nullptr;                //TODO: добавить параметр
+                bufferCreateInfo.sharingMode = queueFamilyIndices.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+                bufferCreateInfo.queueFamilyIndexCount = queueFamilyIndices.size() > 1 ? static_cast<uint32_t>(queueFamilyIndices.size()) : 0;
+                bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.size() > 1 ? queueFamilyIndices.data() : nullptr;
                 bufferCreateInfo.flags = {};
                 buffer_ = pDevice->getLogicalDevice()->createBufferUnique(bufferCreateInfo);
 
@@ -114,23 +117,15 @@ namespace vk
                 const auto memoryTypeIndex = pDevice->getMemoryTypeIndex(memRequirements.memoryTypeBits,memoryPropertyFlags);
                 if(memoryTypeIndex == -1) throw vk::FeatureNotPresentError("Can't use required memory type");
 
-                // Выделить память для буфера
-                vk::MemoryAllocateInfo memoryAllocateInfo;
-                memoryAllocateInfo.allocationSize = memRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = static_cast<uint32_t>(memoryTypeIndex);
-
-                // Флаги выделения памяти - eDeviceAddress, используются если буфер создается с флагом eShaderDeviceAddress
-                vk::MemoryAllocateFlagsInfoKHR memoryAllocateFlagsInfoKhr{};
-                memoryAllocateFlagsInfoKhr.flags = vk::MemoryAllocateFlagBits::eDeviceAddress;
-
-                if(usageFlags & vk::BufferUsageFlagBits::eShaderDeviceAddress){
-                    memoryAllocateInfo.pNext = &memoryAllocateFlagsInfoKhr;
-                }
-
-                memory_ = pDevice->getLogicalDevice()->allocateMemoryUnique(memoryAllocateInfo);
+                // Выделить участок памяти для буфера (флаг eDeviceAddress нужен если буфер создается с eShaderDeviceAddress)
+                memory_ = pDevice->getMemoryAllocator()->allocate(
+                        memRequirements,
+                        static_cast<uint32_t>(memoryTypeIndex),
+                        false,
+                        !!(usageFlags & vk::BufferUsageFlagBits::eShaderDeviceAddress));
 
                 // Связать объект буфера и память
-                pDevice->getLogicalDevice()->bindBufferMemory(buffer_.get(),memory_.get(),0);
+                pDevice->getLogicalDevice()->bindBufferMemory(buffer_.get(),memory_.memory,memory_.offset);
 
                 // Буфер инициализирован
                 isReady_ = true;
@@ -148,9 +143,9 @@ namespace vk
                     pDevice_->getLogicalDevice()->destroyBuffer(buffer_.get());
                     buffer_.release();
 
-                    // Освободить память
-                    pDevice_->getLogicalDevice()->freeMemory(memory_.get());
-                    memory_.release();
+                    // Освободить участок памяти
+                    pDevice_->getMemoryAllocator()->free(memory_);
+                    memory_ = {};
 
                     isReady_ = false;
                 }
@@ -173,24 +168,27 @@ namespace vk
             }
 
             /**
-             * Разметить память и получить указатель на размеченную область
+             * Получить указатель на размеченную область памяти
              * @param offset Сдвиг в байтах
-             * @param size Размер в байтах
-             * @return Указатель на область
+             * @param size Размер в байтах (не используется, память размечена целиком)
+             * @return Указатель на область (nullptr если память не видима хостом)
+             *
+             * @details Видимая хостом память размечается распределителем один раз, при выделении блока
              */
             void* mapMemory(VkDeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE)
             {
-                if(pDevice_ == nullptr || !pDevice_->isReady()) return nullptr;
-                return pDevice_->getLogicalDevice()->mapMemory(memory_.get(),offset,size);
+                (void)size;
+                if(pDevice_ == nullptr || !pDevice_->isReady() || memory_.pMapped == nullptr) return nullptr;
+                return memory_.pMapped + offset;
             }
 
             /**
              * Отменить разметку памяти
+             *
+             * @details Ничего не делает - память остается размеченной до освобождения блока
              */
             void unmapMemory()
-            {
-                pDevice_->getLogicalDevice()->unmapMemory(memory_.get());
-            }
+            {}
 
             /**
              * Получить ресурс буфера Vulkan
@@ -202,12 +200,21 @@ namespace vk
             }
 
             /**
-             * Получить ресурс памяти Vulkan
-             * @return ссылка на smart-pointer
+             * Получить ресурс памяти Vulkan (блок, в котором размещен буфер)
+             * @return Объект памяти
+             */
+            vk::DeviceMemory getMemory() const
+            {
+                return memory_.memory;
+            }
+
+            /**
+             * Получить смещение буфера в объекте памяти
+             * @return Смещение в байтах
              */
-            const vk::UniqueDeviceMemory& getMemory() const
+            vk::DeviceSize getMemoryOffset() const
             {
-                return memory_;
+                return memory_.offset;
             }
 
             /**
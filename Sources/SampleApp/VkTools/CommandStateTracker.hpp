@@ -0,0 +1,214 @@
+#pragma once
+
+#include "Tools.h"
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Отслеживание состояния командного буфера (графический конвейер, наборы дескрипторов, буферы вершин и индексов)
+         *
+         * @details Команды привязки записываются только если привязываемый объект отличается от уже привязанного.
+         * Состояние не наследуется между командными буферами, поэтому на каждый записываемый буфер нужен свой объект
+         * (либо вызов reset() перед записью). Буферы вершин привязываются без смещений - смещения участков геометрии
+         * задаются параметрами команд рисования
+         */
+        class CommandStateTracker
+        {
+        public:
+            /// Максимальное отслеживаемое кол-во наборов дескрипторов
+            static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+            /// Максимальное отслеживаемое кол-во привязок буферов вершин
+            static constexpr uint32_t MAX_VERTEX_BINDINGS = 8;
+
+        private:
+            /// Привязанный конвейер
+            vk::Pipeline pipeline_;
+            /// Привязанные наборы дескрипторов
+            vk::DescriptorSet descriptorSets_[MAX_DESCRIPTOR_SETS];
+            /// Динамические смещения привязанных наборов (для наборов с одним динамическим UBO)
+            uint32_t dynamicOffsets_[MAX_DESCRIPTOR_SETS];
+            /// Привязанные буферы вершин
+            vk::Buffer vertexBuffers_[MAX_VERTEX_BINDINGS];
+            /// Привязанный буфер индексов
+            vk::Buffer indexBuffer_;
+            /// Тип индексов привязанного буфера
+            vk::IndexType indexType_;
+            /// Кол-во записанных команд привязки
+            uint32_t bindCount_;
+            /// Кол-во пропущенных (избыточных) привязок
+            uint32_t skippedCount_;
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            CommandStateTracker()
+            {
+                this->reset();
+            }
+
+            /**
+             * Сбросить состояние (ничего не привязано) и счетчики
+             */
+            void reset()
+            {
+                pipeline_ = nullptr;
+                for(auto& set : descriptorSets_) set = nullptr;
+                for(auto& offset : dynamicOffsets_) offset = 0;
+                for(auto& buffer : vertexBuffers_) buffer = nullptr;
+                indexBuffer_ = nullptr;
+                indexType_ = vk::IndexType::eUint32;
+                bindCount_ = 0;
+                skippedCount_ = 0;
+            }
+
+            /**
+             * Отметить набор дескрипторов как привязанный (если он был привязан в обход объекта)
+             * @param setIndex Номер набора
+             * @param set Набор дескрипторов
+             */
+            void setBoundDescriptorSet(uint32_t setIndex, const vk::DescriptorSet& set)
+            {
+                descriptorSets_[setIndex] = set;
+            }
+
+            /**
+             * Отметить буфер вершин как привязанный (если он был привязан в обход объекта)
+             * @param binding Номер привязки
+             * @param buffer Буфер
+             */
+            void setBoundVertexBuffer(uint32_t binding, const vk::Buffer& buffer)
+            {
+                vertexBuffers_[binding] = buffer;
+            }
+
+            /**
+             * Привязать графический конвейер
+             * @param commandBuffer Командный буфер
+             * @param pipeline Конвейер
+             */
+            void bindPipeline(const vk::CommandBuffer& commandBuffer, const vk::Pipeline& pipeline)
+            {
+                if(pipeline == pipeline_){
+                    skippedCount_++;
+                    return;
+                }
+
+                commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+                pipeline_ = pipeline;
+                bindCount_++;
+            }
+
+            /**
+             * Привязать набор дескрипторов
+             * @param commandBuffer Командный буфер
+             * @param layout Макет размещения конвейера
+             * @param setIndex Номер набора
+             * @param set Набор дескрипторов
+             *
+             * @details Конвейеры должны быть совместимы по макету размещения, иначе смена конвейера сбрасывает наборы
+             */
+            void bindDescriptorSet(const vk::CommandBuffer& commandBuffer, const vk::PipelineLayout& layout, uint32_t setIndex, const vk::DescriptorSet& set)
+            {
+                if(set == descriptorSets_[setIndex]){
+                    skippedCount_++;
+                    return;
+                }
+
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, setIndex, {set}, {});
+                descriptorSets_[setIndex] = set;
+                dynamicOffsets_[setIndex] = 0;
+                bindCount_++;
+            }
+
+            /**
+             * Привязать набор дескрипторов с одним динамическим UBO
+             * @param commandBuffer Командный буфер
+             * @param layout Макет размещения конвейера
+             * @param setIndex Номер набора
+             * @param set Набор дескрипторов
+             * @param dynamicOffset Динамическое смещение
+             *
+             * @details Привязка пропускается, только если совпадают и набор, и смещение
+             */
+            void bindDescriptorSet(const vk::CommandBuffer& commandBuffer, const vk::PipelineLayout& layout, uint32_t setIndex, const vk::DescriptorSet& set, uint32_t dynamicOffset)
+            {
+                if(set == descriptorSets_[setIndex] && dynamicOffset == dynamicOffsets_[setIndex]){
+                    skippedCount_++;
+                    return;
+                }
+
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, setIndex, {set}, {dynamicOffset});
+                descriptorSets_[setIndex] = set;
+                dynamicOffsets_[setIndex] = dynamicOffset;
+                bindCount_++;
+            }
+
+            /**
+             * Привязать буферы вершин (одной командой, если отличается хотя бы один из них)
+             * @param commandBuffer Командный буфер
+             * @param firstBinding Номер первой привязки
+             * @param count Кол-во буферов
+             * @param pBuffers Указатель на массив буферов
+             */
+            void bindVertexBuffers(const vk::CommandBuffer& commandBuffer, uint32_t firstBinding, uint32_t count, const vk::Buffer* pBuffers)
+            {
+                bool changed = false;
+                for(uint32_t i = 0; i < count && !changed; i++){
+                    changed = pBuffers[i] != vertexBuffers_[firstBinding + i];
+                }
+
+                if(!changed){
+                    skippedCount_++;
+                    return;
+                }
+
+                const vk::DeviceSize offsets[MAX_VERTEX_BINDINGS] = {};
+                commandBuffer.bindVertexBuffers(firstBinding, count, pBuffers, offsets);
+                for(uint32_t i = 0; i < count; i++){
+                    vertexBuffers_[firstBinding + i] = pBuffers[i];
+                }
+                bindCount_++;
+            }
+
+            /**
+             * Привязать буфер индексов
+             * @param commandBuffer Командный буфер
+             * @param buffer Буфер индексов
+             * @param indexType Тип индексов
+             */
+            void bindIndexBuffer(const vk::CommandBuffer& commandBuffer, const vk::Buffer& buffer, vk::IndexType indexType)
+            {
+                if(buffer == indexBuffer_ && indexType == indexType_){
+                    skippedCount_++;
+                    return;
+                }
+
+                commandBuffer.bindIndexBuffer(buffer, {}, indexType);
+                indexBuffer_ = buffer;
+                indexType_ = indexType;
+                bindCount_++;
+            }
+
+            /**
+             * Получить кол-во записанных команд привязки
+             * @return Целое число
+             */
+            uint32_t getBindCount() const
+            {
+                return bindCount_;
+            }
+
+            /**
+             * Получить кол-во пропущенных (избыточных) привязок
+             * @return Целое число
+             */
+            uint32_t getSkippedCount() const
+            {
+                return skippedCount_;
+            }
+        };
+    }
+}
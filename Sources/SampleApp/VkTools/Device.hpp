@@ -1,9 +1,13 @@
 #pragma once
 
 #include "Tools.h"
+#include "MemoryAllocator.hpp"
+#include "TextureTable.hpp"
+#include "UploadManager.hpp"
 
 #include <iostream>
 #include <memory>
+#include <algorithm>
 #include <utility>
 #include <unordered_map>
 
@@ -29,16 +33,30 @@ namespace vk
             int queueFamilyPresentIndex_;
             /// Индекс семейства очередей команд вычисления
             int queueFamilyComputeIndex_;
+            /// Индекс семейства очередей передачи (выделенного, без графики и вычислений; иначе совпадает с графическим)
+            int queueFamilyTransferIndex_;
+            /// Включено ли расширение непрямого рисования с кол-вом вызовов из буфера (VK_KHR_draw_indirect_count)
+            bool drawIndirectCountSupported_;
             /// Очередь графических команд
             vk::Queue queueGraphics_;
             /// Очередь команд представления
             vk::Queue queuePresent_;
             /// Очередь команд вычисления
             vk::Queue queueCompute_;
+            /// Очередь передачи (загрузка ресурсов)
+            vk::Queue queueTransfer_;
             /// Командный пул графического семейства (для выделения командных буферов)
             vk::UniqueCommandPool commandPoolGraphics_;
             /// Командный пул вычислительного семейства (для выделения командных буферов)
             vk::UniqueCommandPool commandPoolCompute_;
+            /// Свойства памяти физического устройства (запрашиваются один раз при выборе устройства)
+            vk::PhysicalDeviceMemoryProperties memoryProperties_;
+            /// Распределитель памяти устройства
+            std::unique_ptr<vk::tools::MemoryAllocator> memoryAllocator_;
+            /// Глобальная таблица текстур (bindless)
+            std::unique_ptr<vk::tools::TextureTable> textureTable_;
+            /// Менеджер загрузки данных в память устройства
+            std::unique_ptr<vk::tools::UploadManager> uploadManager_;
 
         public:
             /**
@@ -48,7 +66,9 @@ namespace vk
                     isReady_(false),
                     queueFamilyGraphicsIndex_(0),
                     queueFamilyPresentIndex_(0),
-                    queueFamilyComputeIndex_(0)
+                    queueFamilyComputeIndex_(0),
+                    queueFamilyTransferIndex_(0),
+                    drawIndirectCountSupported_(false)
             {};
 
             /**
@@ -76,10 +96,17 @@ namespace vk
                 std::swap(queueGraphics_,other.queueGraphics_);
                 std::swap(queuePresent_,other.queuePresent_);
                 std::swap(queueCompute_, other.queueCompute_);
+                std::swap(queueFamilyTransferIndex_,other.queueFamilyTransferIndex_);
+                std::swap(queueTransfer_, other.queueTransfer_);
+                std::swap(drawIndirectCountSupported_,other.drawIndirectCountSupported_);
                 std::swap(physicalDevice_ ,other.physicalDevice_);
                 device_.swap(other.device_);
                 commandPoolGraphics_.swap(other.commandPoolGraphics_);
                 commandPoolCompute_.swap(other.commandPoolCompute_);
+                std::swap(memoryProperties_,other.memoryProperties_);
+                memoryAllocator_.swap(other.memoryAllocator_);
+                textureTable_.swap(other.textureTable_);
+                uploadManager_.swap(other.uploadManager_);
             }
 
 
@@ -95,6 +122,8 @@ namespace vk
                 queueFamilyGraphicsIndex_ = 0;
                 queueFamilyPresentIndex_ = 0;
                 queueFamilyComputeIndex_ = 0;
+                queueFamilyTransferIndex_ = 0;
+                drawIndirectCountSupported_ = false;
 
                 std::swap(isReady_,other.isReady_);
                 std::swap(queueFamilyPresentIndex_,other.queueFamilyPresentIndex_);
@@ -102,10 +131,17 @@ namespace vk
                 std::swap(queueGraphics_,other.queueGraphics_);
                 std::swap(queuePresent_,other.queuePresent_);
                 std::swap(queueCompute_, other.queueCompute_);
+                std::swap(queueFamilyTransferIndex_,other.queueFamilyTransferIndex_);
+                std::swap(queueTransfer_, other.queueTransfer_);
+                std::swap(drawIndirectCountSupported_,other.drawIndirectCountSupported_);
                 std::swap(physicalDevice_ ,other.physicalDevice_);
                 device_.swap(other.device_);
                 commandPoolGraphics_.swap(other.commandPoolGraphics_);
                 commandPoolCompute_.swap(other.commandPoolCompute_);
+                std::swap(memoryProperties_,other.memoryProperties_);
+                memoryAllocator_.swap(other.memoryAllocator_);
+                textureTable_.swap(other.textureTable_);
+                uploadManager_.swap(other.uploadManager_);
 
                 return *this;
             }
@@ -113,7 +149,7 @@ namespace vk
             /**
              * Конструктор
              * @param instance Экземпляр Vulkan
-             * @param surfaceKhr Поверхность отображения на окне (для проверки доступности представления)
+             * @param surfaceKhr Поверхность отображения на окне (для проверки доступности представления, пустая при внеэкранном рендеринге)
              * @param requireExtensions Запрашивать расширения (названия расширений)
              * @param requireValidationLayers Запрашивать слои (названия слоев)
              * @param allowIntegrated Позволять использование встроенных устройств
@@ -123,7 +159,8 @@ namespace vk
                             const std::vector<const char*>& requireExtensions = {},
                             const std::vector<const char*>& requireValidationLayers = {},
                             bool allowIntegrated = false):
-        	isReady_(false)
+        	isReady_(false),
+        	drawIndirectCountSupported_(false)
             {
                 // Найти подходящее физ. устройство. Семейства очередей устройства должны поддерживать необходимые типы команд
                 auto physicalDevices = instance->enumeratePhysicalDevices();
@@ -137,6 +174,7 @@ namespace vk
                         int queueFamilyPresentIndex = -1;
                         int queueFamilyGraphicsIndex = -1;
                         int queueFamilyComputeIndex = -1;
+                        int queueFamilyTransferIndex = -1;
 
                         // Найти семейства поддерживающие графику и представление
                         for(size_t i = 0; i < queueFamilyProperties.size(); i++)
@@ -151,10 +189,27 @@ namespace vk
                                 queueFamilyComputeIndex = i;
                             }
 
-                            // Поддерживает ли семейство представление
-                            vk::Bool32 presentSupported = false;
-                            physicalDevice.getSurfaceSupportKHR(i,surfaceKhr.get(),&presentSupported);
-                            if(presentSupported) queueFamilyPresentIndex = i;
+                            // Выделенное семейство передачи (только копирование, без графики и вычислений) - обычно отдельный
+                            // DMA-блок, работающий параллельно с графикой. Копирование в изображения произвольного размера
+                            // возможно только при единичной гранулярности
+                            const auto& flags = queueFamilyProperties[i].queueFlags;
+                            const auto& granularity = queueFamilyProperties[i].minImageTransferGranularity;
+                            if((flags & vk::QueueFlagBits::eTransfer) && !(flags & vk::QueueFlagBits::eGraphics) && !(flags & vk::QueueFlagBits::eCompute) &&
+                               granularity.width == 1 && granularity.height == 1 && granularity.depth == 1){
+                                queueFamilyTransferIndex = i;
+                            }
+
+                            // Поддерживает ли семейство представление (только если есть поверхность)
+                            if(surfaceKhr){
+                                vk::Bool32 presentSupported = false;
+                                physicalDevice.getSurfaceSupportKHR(i,surfaceKhr.get(),&presentSupported);
+                                if(presentSupported) queueFamilyPresentIndex = i;
+                            }
+                        }
+
+                        // Без поверхности (внеэкранный рендеринг) показ не используется, семейство показа совпадает с графическим
+                        if(!surfaceKhr){
+                            queueFamilyPresentIndex = queueFamilyGraphicsIndex;
                         }
 
                         // Перейти к следующему устройству если необходимые возможности не поддерживаются
@@ -178,9 +233,16 @@ namespace vk
                         }
 
                         // Если для работы с поверхностью у устройства нет форматов и режимов представления - к следующему
-                        auto formats = physicalDevice.getSurfaceFormatsKHR(surfaceKhr.get());
-                        auto presentModes = physicalDevice.getSurfacePresentModesKHR(surfaceKhr.get());
-                        if(formats.empty() || presentModes.empty()){
+                        if(surfaceKhr){
+                            auto formats = physicalDevice.getSurfaceFormatsKHR(surfaceKhr.get());
+                            auto presentModes = physicalDevice.getSurfacePresentModesKHR(surfaceKhr.get());
+                            if(formats.empty() || presentModes.empty()){
+                                continue;
+                            }
+                        }
+
+                        // Глобальной таблице текстур нужны массивы дескрипторов переменной длины с обновлением после привязки
+                        if(!CheckDescriptorIndexingSupported(physicalDevice)){
                             continue;
                         }
 
@@ -190,6 +252,12 @@ namespace vk
                         queueFamilyPresentIndex_ = queueFamilyPresentIndex;
                         queueFamilyComputeIndex_ = queueFamilyComputeIndex;
 
+                        // Без выделенного семейства передачи ресурсы загружаются через графическую очередь
+                        queueFamilyTransferIndex_ = queueFamilyTransferIndex != -1 ? queueFamilyTransferIndex : queueFamilyGraphicsIndex;
+
+                        // Свойства памяти не меняются за время работы - запрашиваются один раз
+                        memoryProperties_ = physicalDevice.getMemoryProperties();
+
                         // Физическое устройство выбрано
                         physicalDeviceSelected = true;
 
@@ -211,6 +279,11 @@ namespace vk
                                 static_cast<uint32_t>(queueFamilyComputeIndex_)
                         };
 
+                        // Очередь передачи создается только в выделенном семействе (иначе используется графическая)
+                        if(queueFamilyTransferIndex_ != queueFamilyGraphicsIndex_){
+                            queueFamilies.push_back(static_cast<uint32_t>(queueFamilyTransferIndex_));
+                        }
+
                         // Ассоциативный массив - количества очередей выделяемых на каждое семейство
                         // Выделяется одна очередь на семейство, но если индексы семейств семейств совпадают то выделяется более одной
                         std::unordered_map<uint32_t,uint32_t> queueCounts;
@@ -246,21 +319,43 @@ namespace vk
                         }
 
                         // Особенности устройства
+                        const vk::PhysicalDeviceFeatures supportedFeatures = physicalDevice_.getFeatures();
                         vk::PhysicalDeviceFeatures physicalDeviceFeatures{};
-                        physicalDeviceFeatures.setGeometryShader(VK_TRUE);
                         physicalDeviceFeatures.setSamplerAnisotropy(VK_TRUE);
                         physicalDeviceFeatures.setMultiViewport(VK_TRUE);
+                        // Статистика конвейера (для профилирования) и ее наследование вторичными командными буферами, если поддерживается
+                        physicalDeviceFeatures.setPipelineStatisticsQuery(supportedFeatures.pipelineStatisticsQuery);
+                        physicalDeviceFeatures.setInheritedQueries(supportedFeatures.inheritedQueries);
+                        // Непрямое рисование с ненулевым первым экземпляром и несколькими вызовами за команду (для отсечения на GPU), если поддерживается
+                        physicalDeviceFeatures.setDrawIndirectFirstInstance(supportedFeatures.drawIndirectFirstInstance);
+                        physicalDeviceFeatures.setMultiDrawIndirect(supportedFeatures.multiDrawIndirect);
+
+                        // Расширения устройства (кол-во вызовов непрямого рисования из буфера - если поддерживается)
+                        std::vector<const char*> enabledExtensions = requireExtensions;
+                        drawIndirectCountSupported_ = CheckDeviceExtensionsSupported(physicalDevice_, {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME});
+                        if(drawIndirectCountSupported_){
+                            enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                        }
 
                         // Информация о создаваемом устройстве
                         vk::DeviceCreateInfo deviceCreateInfo{};
                         deviceCreateInfo.setQueueCreateInfoCount(queueCreateInfoEntries.size());
                         deviceCreateInfo.setPQueueCreateInfos(queueCreateInfoEntries.data());
-                        deviceCreateInfo.setPpEnabledExtensionNames(!requireExtensions.empty() ? requireExtensions.data() : nullptr);
-                        deviceCreateInfo.setEnabledExtensionCount(requireExtensions.size());
+                        deviceCreateInfo.setPpEnabledExtensionNames(!enabledExtensions.empty() ? enabledExtensions.data() : nullptr);
+                        deviceCreateInfo.setEnabledExtensionCount(enabledExtensions.size());
                         deviceCreateInfo.setPpEnabledLayerNames(!requireValidationLayers.empty() ? requireValidationLayers.data() : nullptr);
                         deviceCreateInfo.setEnabledLayerCount(requireValidationLayers.size());
                         deviceCreateInfo.setPEnabledFeatures(&physicalDeviceFeatures);
 
+                        // Индексирование дескрипторов (глобальная таблица текстур)
+                        vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+                        descriptorIndexingFeatures.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE);
+                        descriptorIndexingFeatures.setRuntimeDescriptorArray(VK_TRUE);
+                        descriptorIndexingFeatures.setDescriptorBindingPartiallyBound(VK_TRUE);
+                        descriptorIndexingFeatures.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE);
+                        descriptorIndexingFeatures.setDescriptorBindingVariableDescriptorCount(VK_TRUE);
+                        deviceCreateInfo.setPNext(&descriptorIndexingFeatures);
+
                         // Создание устройства
                         this->device_ = physicalDevice_.createDeviceUnique(deviceCreateInfo);
 
@@ -277,6 +372,9 @@ namespace vk
                         queueGraphics_ = queues[0];
                         queuePresent_ = queues[1];
                         queueCompute_ = queues[2];
+                        queueTransfer_ = queueFamilyTransferIndex_ != queueFamilyGraphicsIndex_
+                                ? device_->getQueue(static_cast<uint32_t>(queueFamilyTransferIndex_), 0)
+                                : queueGraphics_;
 
                         // Создание командного пула для графического семейства
                         commandPoolGraphics_ = device_->createCommandPoolUnique({
@@ -290,6 +388,31 @@ namespace vk
                                 static_cast<uint32_t>(queueFamilyComputeIndex_)
                         });
 
+                        // Распределитель памяти (ресурсы выделяются участками из общих блоков)
+                        memoryAllocator_.reset(new vk::tools::MemoryAllocator(
+                                device_.get(),
+                                memoryProperties_,
+                                physicalDevice_.getProperties().limits.bufferImageGranularity));
+
+                        // Глобальная таблица текстур (размер ограничен лимитами дескрипторов с обновлением после привязки)
+                        auto properties = physicalDevice_.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+                        const auto& indexingProperties = properties.get<vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+                        textureTable_.reset(new vk::tools::TextureTable(device_.get(), (std::min)({
+                                indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                indexingProperties.maxDescriptorSetUpdateAfterBindSamplers})));
+
+                        // Менеджер загрузки (копирование - в очереди передачи, владение передается графическому семейству)
+                        uploadManager_.reset(new vk::tools::UploadManager(
+                                device_.get(),
+                                memoryAllocator_.get(),
+                                memoryProperties_,
+                                queueTransfer_,
+                                static_cast<uint32_t>(queueFamilyTransferIndex_),
+                                queueGraphics_,
+                                static_cast<uint32_t>(queueFamilyGraphicsIndex_)));
+
                         // Инициализация успешно произведена
                         isReady_ = true;
                     }
@@ -322,6 +445,15 @@ namespace vk
                     this->device_->destroyCommandPool(commandPoolCompute_.get());
                     this->commandPoolCompute_.release();
 
+                    // Дождаться загрузок и уничтожить менеджер загрузки (до распределителя памяти)
+                    this->uploadManager_.reset();
+
+                    // Уничтожить таблицу текстур
+                    this->textureTable_.reset();
+
+                    // Освободить блоки памяти (до уничтожения устройства)
+                    this->memoryAllocator_.reset();
+
                     // Уничтожить логическое устройство
                     this->device_->destroy();
                     this->device_.release();
@@ -384,6 +516,15 @@ namespace vk
                 return queueCompute_;
             }
 
+            /**
+             * Получить очередь передачи (совпадает с графической, если у устройства нет выделенного семейства передачи)
+             * @return Очередь
+             */
+            vk::Queue getTransferQueue() const
+            {
+                return queueTransfer_;
+            }
+
             /**
              * Получить командный пул графических команд
              * @return Константная ссылка на smart pointer объекта командного пула
@@ -393,6 +534,26 @@ namespace vk
                 return commandPoolGraphics_;
             }
 
+            /**
+             * Создать дополнительный командный пул графического семейства
+             * @param flags Флаги создания пула
+             * @return Unique smart pointer объекта командного пула
+             *
+             * @details Командный пул (и выделенные из него буферы) нельзя использовать из нескольких потоков одновременно,
+             * поэтому для параллельной записи команд у каждого потока должен быть свой пул
+             */
+            vk::UniqueCommandPool createCommandGfxPool(const vk::CommandPoolCreateFlags& flags = {}) const
+            {
+                if(!isReady_){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                return device_->createCommandPoolUnique({
+                        flags,
+                        static_cast<uint32_t>(queueFamilyGraphicsIndex_)
+                });
+            }
+
             /**
              * Получить командный пул вычислительных команд
              * @return Константная ссылка на smart pointer объекта командного пула
@@ -409,15 +570,23 @@ namespace vk
              */
             template <typename T>
             vk::DeviceSize getDynamicallyAlignedUboBlockSize() const {
+                return this->getAlignedUboBlockSize(static_cast<vk::DeviceSize>(sizeof(T)));
+            }
+
+            /**
+             * Получить размер выравненного блока в UBO с учетом лимитов устройства
+             * @param size Размер данных блока в байтах
+             * @return Размер блока (кратный minUniformBufferOffsetAlignment)
+             */
+            vk::DeviceSize getAlignedUboBlockSize(vk::DeviceSize size) const {
                 if(!isReady_) return 0;
                 const auto minUboAlignment = physicalDevice_.getProperties().limits.minUniformBufferOffsetAlignment;
-                auto dynamicAlignment = static_cast<vk::DeviceSize>(sizeof(T));
 
                 if (minUboAlignment > 0) {
-                    dynamicAlignment = (dynamicAlignment + minUboAlignment - 1) & ~(minUboAlignment - 1);
+                    size = (size + minUboAlignment - 1) & ~(minUboAlignment - 1);
                 }
 
-                return dynamicAlignment;
+                return size;
             }
 
             /**
@@ -452,13 +621,18 @@ namespace vk
             /**
              * Поддерживается ли формат цветовых вложений устройством для конкретной поверхности
              * @param format Формат (отвечает за то, сколько байт приходится на цвет и в какой последовательности)
-             * @param surfaceKhr Поверхность
+             * @param surfaceKhr Поверхность (если пуста - проверяется возможность использования формата как цветового вложения)
              * @return Да или нет
              */
             bool isFormatSupported(const vk::Format& format, const vk::UniqueSurfaceKHR& surfaceKhr) const
             {
                 if(!isReady_) return false;
 
+                if(!surfaceKhr){
+                    const auto formatProperties = this->physicalDevice_.getFormatProperties(format);
+                    return !!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment);
+                }
+
                 auto surfaceFormats = this->physicalDevice_.getSurfaceFormatsKHR(surfaceKhr.get());
                 if(surfaceFormats.empty()) return false;
 
@@ -498,7 +672,7 @@ namespace vk
             {
                 if(!isReady_) return -1;
 
-                auto memoryProperties = this->physicalDevice_.getMemoryProperties();
+                const auto& memoryProperties = this->memoryProperties_;
 
 //                for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++){
 //                    if ((typeBits & 1) == 1){
@@ -520,6 +694,42 @@ namespace vk
                 return -1;
             }
 
+            /**
+             * Получить свойства памяти физического устройства
+             * @return Константная ссылка на структуру свойств
+             */
+            const vk::PhysicalDeviceMemoryProperties& getMemoryProperties() const
+            {
+                return memoryProperties_;
+            }
+
+            /**
+             * Получить распределитель памяти устройства
+             * @return Указатель на распределитель (nullptr если устройство не инициализировано)
+             */
+            vk::tools::MemoryAllocator* getMemoryAllocator() const
+            {
+                return memoryAllocator_.get();
+            }
+
+            /**
+             * Получить глобальную таблицу текстур
+             * @return Указатель на таблицу (nullptr если устройство не инициализировано)
+             */
+            vk::tools::TextureTable* getTextureTable() const
+            {
+                return textureTable_.get();
+            }
+
+            /**
+             * Получить менеджер загрузки данных в память устройства
+             * @return Указатель на менеджер (nullptr если устройство не инициализировано)
+             */
+            vk::tools::UploadManager* getUploadManager() const
+            {
+                return uploadManager_.get();
+            }
+
             /**
              * Используется ли для графических команд и для показа одно и то же семейство
              * @return Да или нет
@@ -529,6 +739,60 @@ namespace vk
                 return queueFamilyPresentIndex_ == queueFamilyGraphicsIndex_;
             }
 
+            /**
+             * Используется ли для графических команд и для вычислений одно и то же семейство
+             * @return Да или нет
+             */
+            bool isComputeAndGfxQueueFamilySame() const
+            {
+                return queueFamilyComputeIndex_ == queueFamilyGraphicsIndex_;
+            }
+
+            /**
+             * Доступно ли непрямое рисование с кол-вом вызовов из буфера (включено ли VK_KHR_draw_indirect_count)
+             * @return Да или нет
+             */
+            bool isDrawIndirectCountSupported() const
+            {
+                return drawIndirectCountSupported_;
+            }
+
+            /**
+             * Используется ли для графических команд и для передачи одно и то же семейство
+             * @return Да или нет
+             */
+            bool isTransferAndGfxQueueFamilySame() const
+            {
+                return queueFamilyTransferIndex_ == queueFamilyGraphicsIndex_;
+            }
+
+            /**
+             * Получить индекс семейства графической очереди
+             * @return Индекс семейства
+             */
+            uint32_t getQueueFamilyGraphicsIndex() const
+            {
+                return static_cast<uint32_t>(queueFamilyGraphicsIndex_);
+            }
+
+            /**
+             * Получить индекс семейства очереди вычислений
+             * @return Индекс семейства
+             */
+            uint32_t getQueueFamilyComputeIndex() const
+            {
+                return static_cast<uint32_t>(queueFamilyComputeIndex_);
+            }
+
+            /**
+             * Получить индекс семейства очереди передачи
+             * @return Индекс семейства
+             */
+            uint32_t getQueueFamilyTransferIndex() const
+            {
+                return static_cast<uint32_t>(queueFamilyTransferIndex_);
+            }
+
             /**
              * Получить массив индексов семейств очередей
              * @return Массив uint32_t значений
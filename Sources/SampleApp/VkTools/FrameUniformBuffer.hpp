@@ -0,0 +1,208 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * UBO буфер с отдельной копией данных на каждый кадр "в полете"
+         *
+         * @details Пока GPU читает данные кадра N, CPU может готовить кадр N+1. Чтобы не перезаписывать данные,
+         * которые еще используются, буфер содержит несколько выравненных блоков (по одному на кадр). Память буфера
+         * размечается один раз (persistent mapping) и остается размеченной до уничтожения
+         */
+        class FrameUniformBuffer
+        {
+        private:
+            /// Готов ли буфер
+            bool isReady_;
+            /// Буфер Vulkan
+            vk::tools::Buffer buffer_;
+            /// Указатель на размеченную область всего буфера
+            unsigned char* pMapped_;
+            /// Размер данных одного блока
+            vk::DeviceSize dataSize_;
+            /// Размер одного блока с учетом выравнивания
+            vk::DeviceSize blockSize_;
+            /// Кол-во блоков (кадров)
+            size_t frameCount_;
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            FrameUniformBuffer():isReady_(false),pMapped_(nullptr),dataSize_(0),blockSize_(0),frameCount_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            FrameUniformBuffer(const FrameUniformBuffer& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            FrameUniformBuffer& operator=(const FrameUniformBuffer& other) = delete;
+
+            /**
+             * Конструктор перемещения
+             * @param other R-value ссылка на другой объект
+             * @details Нельзя копировать объект, но можно обменяться с ним ресурсом
+             */
+            FrameUniformBuffer(FrameUniformBuffer&& other) noexcept:FrameUniformBuffer(){
+                std::swap(isReady_,other.isReady_);
+                std::swap(pMapped_,other.pMapped_);
+                std::swap(dataSize_,other.dataSize_);
+                std::swap(blockSize_,other.blockSize_);
+                std::swap(frameCount_,other.frameCount_);
+                buffer_ = std::move(other.buffer_);
+            }
+
+            /**
+             * Перемещение через присваивание
+             * @param other R-value ссылка на другой объект
+             * @return Ссылка на текущий объект
+             */
+            FrameUniformBuffer& operator=(FrameUniformBuffer&& other) noexcept {
+                if (this == &other) return *this;
+
+                this->destroyVulkanResources();
+                isReady_ = false;
+                pMapped_ = nullptr;
+                dataSize_ = 0;
+                blockSize_ = 0;
+                frameCount_ = 0;
+
+                std::swap(isReady_,other.isReady_);
+                std::swap(pMapped_,other.pMapped_);
+                std::swap(dataSize_,other.dataSize_);
+                std::swap(blockSize_,other.blockSize_);
+                std::swap(frameCount_,other.frameCount_);
+                buffer_ = std::move(other.buffer_);
+
+                return *this;
+            }
+
+            /**
+             * Основной конструктор
+             * @param pDevice Указатель на устройство
+             * @param dataSize Размер данных одного блока (одного кадра)
+             * @param frameCount Кол-во кадров (копий данных)
+             */
+            FrameUniformBuffer(const vk::tools::Device* pDevice, vk::DeviceSize dataSize, size_t frameCount):
+                    isReady_(false),
+                    pMapped_(nullptr),
+                    dataSize_(dataSize),
+                    blockSize_(0),
+                    frameCount_(frameCount)
+            {
+                // Проверить устройство
+                if(pDevice == nullptr || !pDevice->isReady()){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                // Хотя бы одна копия данных должна быть
+                if(frameCount_ == 0){
+                    throw vk::InitializationFailedError("Can't initialize uniform buffer. Frame count can't be zero");
+                }
+
+                // Размер блока должен быть кратен минимальному выравниванию смещений UBO
+                blockSize_ = pDevice->getAlignedUboBlockSize(dataSize_);
+
+                // Выделить буфер для всех блоков
+                buffer_ = vk::tools::Buffer(pDevice,
+                        blockSize_ * frameCount_,
+                        vk::BufferUsageFlagBits::eUniformBuffer,
+                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+
+                // Разметить память (остается размеченной на все время жизни буфера)
+                pMapped_ = reinterpret_cast<unsigned char*>(buffer_.mapMemory());
+
+                // Буфер инициализирован
+                isReady_ = true;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~FrameUniformBuffer(){
+                destroyVulkanResources();
+            }
+
+            /**
+             * Де-инициализация ресурсов Vulkan
+             */
+            void destroyVulkanResources()
+            {
+                if(isReady_)
+                {
+                    buffer_.unmapMemory();
+                    buffer_.destroyVulkanResources();
+                    pMapped_ = nullptr;
+                    isReady_ = false;
+                }
+            }
+
+            /**
+             * Был ли объект инициализирован
+             * @return Да или нет
+             */
+            bool isReady() const
+            {
+                return isReady_;
+            }
+
+            /**
+             * Получить указатель на размеченную область блока конкретного кадра
+             * @param frameIndex Индекс кадра
+             * @return Указатель на начало блока
+             */
+            unsigned char* getFrameData(size_t frameIndex) const
+            {
+                assert(frameIndex < frameCount_);
+                return pMapped_ + blockSize_ * frameIndex;
+            }
+
+            /**
+             * Получить описание блока конкретного кадра для записи в дескрипторный набор
+             * @param frameIndex Индекс кадра
+             * @return Структура описания буфера для дескриптора
+             */
+            vk::DescriptorBufferInfo getDescriptorBufferInfo(size_t frameIndex) const
+            {
+                return {buffer_.getBuffer().get(), blockSize_ * frameIndex, dataSize_};
+            }
+
+            /**
+             * Получить буфер Vulkan
+             * @return Константная ссылка на объект буфера
+             */
+            const vk::tools::Buffer& getBuffer() const
+            {
+                return buffer_;
+            }
+
+            /**
+             * Получить размер блока с учетом выравнивания
+             * @return Размер в байтах
+             */
+            vk::DeviceSize getBlockSize() const
+            {
+                return blockSize_;
+            }
+
+            /**
+             * Получить кол-во кадров (блоков)
+             * @return Кол-во блоков
+             */
+            size_t getFrameCount() const
+            {
+                return frameCount_;
+            }
+        };
+    }
+}
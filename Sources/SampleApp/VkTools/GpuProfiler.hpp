@@ -0,0 +1,540 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <fstream>
+#include <string>
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Профилируемые проходы рендеринга
+         */
+        enum class GpuProfilerPass : uint32_t
+        {
+            ePrimary = 0,
+            ePostProcess = 1,
+            eCount = 2
+        };
+
+        /**
+         * Результаты профилирования прохода
+         */
+        struct GpuPassProfile
+        {
+            /// Время выполнения прохода на GPU (мс)
+            double timeMs = 0.0;
+            /// Кол-во вызовов вершинного шейдера
+            uint64_t vertexShaderInvocations = 0;
+            /// Кол-во примитивов, поступивших на этап отсечения
+            uint64_t clippingInvocations = 0;
+            /// Кол-во примитивов, прошедших этап отсечения
+            uint64_t clippingPrimitives = 0;
+            /// Кол-во вызовов фрагментного шейдера
+            uint64_t fragmentShaderInvocations = 0;
+        };
+
+        /**
+         * Результаты профилирования кадра
+         */
+        struct GpuFrameProfile
+        {
+            /// Номер кадра
+            uint64_t frameNumber = 0;
+            /// Результаты по проходам (индекс - GpuProfilerPass)
+            GpuPassProfile passes[static_cast<size_t>(GpuProfilerPass::eCount)];
+            /// Время выполнения отдельных вызовов отрисовки основного прохода (мс, если включено)
+            std::vector<double> drawTimesMs;
+        };
+
+        /**
+         * Профилировщик GPU на основе пулов запросов (временные метки и статистика конвейера)
+         *
+         * @details У каждого кадра в полете свои пулы запросов. Результаты кадра читаются при следующем использовании
+         * его пулов (после ожидания барьера кадра), поэтому чтение не блокирует GPU и поток рендеринга.
+         * Результаты доступны с задержкой в кол-во кадров в полете
+         */
+        class GpuProfiler
+        {
+        private:
+            /// Флаги собираемой статистики конвейера (порядок значений в результате совпадает с порядком бит)
+            static constexpr VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+                    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+            /// Кол-во значений статистики на один запрос
+            static constexpr size_t STATISTIC_VALUE_COUNT = 4;
+            /// Кол-во проходов
+            static constexpr uint32_t PASS_COUNT = static_cast<uint32_t>(GpuProfilerPass::eCount);
+
+            /// Готов ли профилировщик
+            bool isReady_;
+            /// Указатель на устройство
+            const vk::tools::Device* pDevice_;
+            /// Собирать ли статистику конвейера (нужны pipelineStatisticsQuery и inheritedQueries, поддерживаются не всеми устройствами)
+            bool pipelineStatisticsEnabled_;
+            /// Максимальное кол-во вызовов отрисовки с временными метками (0 - метки только для проходов)
+            uint32_t maxDrawTimestamps_;
+            /// Длительность одного такта счетчика временных меток (нс)
+            double timestampPeriodNs_;
+            /// Маска значимых бит временных меток
+            uint64_t timestampMask_;
+
+            /// Пулы запросов временных меток (по одному на кадр в полете)
+            std::vector<vk::UniqueQueryPool> timestampPools_;
+            /// Пулы запросов статистики конвейера (по одному на кадр в полете)
+            std::vector<vk::UniqueQueryPool> statisticsPools_;
+            /// Номера кадров, записанных в пулы (по одному на кадр в полете)
+            std::vector<uint64_t> frameNumbers_;
+            /// Кол-во вызовов отрисовки с метками в записываемом кадре (по одному на кадр в полете)
+            std::vector<uint32_t> drawCounts_;
+            /// Кол-во вызовов отрисовки с метками, записанных в пулы при их последнем использовании (по одному на кадр в полете)
+            std::vector<uint32_t> writtenDrawCounts_;
+            /// Есть ли в пулах записанные, но еще не прочитанные результаты (по одному на кадр в полете)
+            std::vector<bool> pending_;
+
+            /// Последние прочитанные результаты
+            GpuFrameProfile latestProfile_;
+            /// Файл для записи результатов (CSV, строка на кадр)
+            std::ofstream csvFile_;
+
+            /**
+             * Индекс запроса временной метки начала прохода
+             * @param pass Проход
+             * @return Индекс запроса в пуле
+             */
+            static uint32_t passQueryIndex(GpuProfilerPass pass)
+            {
+                return static_cast<uint32_t>(pass) * 2;
+            }
+
+            /**
+             * Индекс запроса временной метки начала вызова отрисовки
+             * @param drawIndex Индекс вызова отрисовки
+             * @return Индекс запроса в пуле
+             */
+            static uint32_t drawQueryIndex(uint32_t drawIndex)
+            {
+                return PASS_COUNT * 2 + drawIndex * 2;
+            }
+
+            /**
+             * Разница временных меток в миллисекундах
+             * @param begin Метка начала
+             * @param end Метка конца
+             * @return Время в миллисекундах
+             */
+            double timestampDeltaMs(uint64_t begin, uint64_t end) const
+            {
+                const uint64_t delta = ((end & timestampMask_) - (begin & timestampMask_)) & timestampMask_;
+                return static_cast<double>(delta) * timestampPeriodNs_ / 1000000.0;
+            }
+
+            /**
+             * Записать результаты кадра в CSV файл
+             * @param profile Результаты кадра
+             */
+            void writeCsvLine(const GpuFrameProfile& profile)
+            {
+                if(!csvFile_.is_open()) return;
+
+                double drawTotalMs = 0.0;
+                for(double drawTimeMs : profile.drawTimesMs) drawTotalMs += drawTimeMs;
+
+                csvFile_ << profile.frameNumber;
+                for(const auto& pass : profile.passes){
+                    csvFile_ << ',' << pass.timeMs
+                             << ',' << pass.vertexShaderInvocations
+                             << ',' << pass.clippingInvocations
+                             << ',' << pass.clippingPrimitives
+                             << ',' << pass.fragmentShaderInvocations;
+                }
+                csvFile_ << ',' << profile.drawTimesMs.size() << ',' << drawTotalMs << '\n';
+            }
+
+            /**
+             * Прочитать результаты, записанные в пулы кадра
+             * @param frameIndex Индекс кадра в полете
+             *
+             * @details Вызывается только после ожидания барьера кадра, поэтому результаты уже готовы.
+             * Если результаты все же не готовы - они пропускаются (без ожидания)
+             */
+            void collectResults(size_t frameIndex)
+            {
+                if(!pending_[frameIndex]) return;
+                pending_[frameIndex] = false;
+
+                const auto& device = pDevice_->getLogicalDevice();
+                const uint32_t drawCount = writtenDrawCounts_[frameIndex];
+                const uint32_t timestampCount = drawQueryIndex(drawCount);
+
+                // Временные метки
+                std::vector<uint64_t> timestamps(timestampCount, 0);
+                vk::Result result = device->getQueryPoolResults(
+                        timestampPools_[frameIndex].get(),
+                        0,
+                        timestampCount,
+                        timestamps.size() * sizeof(uint64_t),
+                        timestamps.data(),
+                        sizeof(uint64_t),
+                        vk::QueryResultFlagBits::e64);
+
+                if(result != vk::Result::eSuccess) return;
+
+                GpuFrameProfile profile{};
+                profile.frameNumber = frameNumbers_[frameIndex];
+
+                for(uint32_t pass = 0; pass < PASS_COUNT; pass++){
+                    const uint32_t query = passQueryIndex(static_cast<GpuProfilerPass>(pass));
+                    profile.passes[pass].timeMs = timestampDeltaMs(timestamps[query], timestamps[query + 1]);
+                }
+
+                profile.drawTimesMs.resize(drawCount);
+                for(uint32_t draw = 0; draw < drawCount; draw++){
+                    const uint32_t query = drawQueryIndex(draw);
+                    profile.drawTimesMs[draw] = timestampDeltaMs(timestamps[query], timestamps[query + 1]);
+                }
+
+                // Статистика конвейера
+                if(pipelineStatisticsEnabled_)
+                {
+                    uint64_t statistics[PASS_COUNT][STATISTIC_VALUE_COUNT] = {};
+                    result = device->getQueryPoolResults(
+                            statisticsPools_[frameIndex].get(),
+                            0,
+                            PASS_COUNT,
+                            sizeof(statistics),
+                            statistics,
+                            sizeof(uint64_t) * STATISTIC_VALUE_COUNT,
+                            vk::QueryResultFlagBits::e64);
+
+                    if(result == vk::Result::eSuccess){
+                        for(uint32_t pass = 0; pass < PASS_COUNT; pass++){
+                            profile.passes[pass].vertexShaderInvocations = statistics[pass][0];
+                            profile.passes[pass].clippingInvocations = statistics[pass][1];
+                            profile.passes[pass].clippingPrimitives = statistics[pass][2];
+                            profile.passes[pass].fragmentShaderInvocations = statistics[pass][3];
+                        }
+                    }
+                }
+
+                this->writeCsvLine(profile);
+                latestProfile_ = std::move(profile);
+            }
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            GpuProfiler():
+                    isReady_(false),
+                    pDevice_(nullptr),
+                    pipelineStatisticsEnabled_(false),
+                    maxDrawTimestamps_(0),
+                    timestampPeriodNs_(1.0),
+                    timestampMask_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            GpuProfiler(const GpuProfiler& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            GpuProfiler& operator=(const GpuProfiler& other) = delete;
+
+            /**
+             * Конструктор перемещения
+             * @param other R-value ссылка на другой объект
+             * @details Нельзя копировать объект, но можно обменяться с ним ресурсом
+             */
+            GpuProfiler(GpuProfiler&& other) noexcept:GpuProfiler(){
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(pipelineStatisticsEnabled_,other.pipelineStatisticsEnabled_);
+                std::swap(maxDrawTimestamps_,other.maxDrawTimestamps_);
+                std::swap(timestampPeriodNs_,other.timestampPeriodNs_);
+                std::swap(timestampMask_,other.timestampMask_);
+                timestampPools_.swap(other.timestampPools_);
+                statisticsPools_.swap(other.statisticsPools_);
+                frameNumbers_.swap(other.frameNumbers_);
+                drawCounts_.swap(other.drawCounts_);
+                writtenDrawCounts_.swap(other.writtenDrawCounts_);
+                pending_.swap(other.pending_);
+                std::swap(latestProfile_,other.latestProfile_);
+                std::swap(csvFile_,other.csvFile_);
+            }
+
+            /**
+             * Перемещение через присваивание
+             * @param other R-value ссылка на другой объект
+             * @return Ссылка на текущий объект
+             */
+            GpuProfiler& operator=(GpuProfiler&& other) noexcept {
+                if (this == &other) return *this;
+
+                this->destroyVulkanResources();
+
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(pipelineStatisticsEnabled_,other.pipelineStatisticsEnabled_);
+                std::swap(maxDrawTimestamps_,other.maxDrawTimestamps_);
+                std::swap(timestampPeriodNs_,other.timestampPeriodNs_);
+                std::swap(timestampMask_,other.timestampMask_);
+                timestampPools_.swap(other.timestampPools_);
+                statisticsPools_.swap(other.statisticsPools_);
+                frameNumbers_.swap(other.frameNumbers_);
+                drawCounts_.swap(other.drawCounts_);
+                writtenDrawCounts_.swap(other.writtenDrawCounts_);
+                pending_.swap(other.pending_);
+                std::swap(latestProfile_,other.latestProfile_);
+                std::swap(csvFile_,other.csvFile_);
+
+                return *this;
+            }
+
+            /**
+             * Основной конструктор
+             * @param pDevice Указатель на устройство
+             * @param frameCount Кол-во кадров в полете (кол-во наборов пулов запросов)
+             * @param maxDrawTimestamps Максимальное кол-во вызовов отрисовки с временными метками (0 - метки только для проходов)
+             * @param csvPath Путь к CSV файлу для записи результатов (пустая строка - без записи)
+             */
+            GpuProfiler(const vk::tools::Device* pDevice, size_t frameCount, uint32_t maxDrawTimestamps = 0, const std::string& csvPath = ""):
+                    isReady_(false),
+                    pDevice_(pDevice),
+                    pipelineStatisticsEnabled_(false),
+                    maxDrawTimestamps_(maxDrawTimestamps),
+                    timestampPeriodNs_(1.0),
+                    timestampMask_(0),
+                    frameNumbers_(frameCount, 0),
+                    drawCounts_(frameCount, 0),
+                    writtenDrawCounts_(frameCount, 0),
+                    pending_(frameCount, false)
+            {
+                // Проверить устройство
+                if(pDevice_ == nullptr || !pDevice_->isReady()){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                // Поддерживает ли графическое семейство очередей временные метки
+                const auto queueFamilies = pDevice_->getPhysicalDevice().getQueueFamilyProperties();
+                const uint32_t validBits = queueFamilies[pDevice_->getQueueFamilyIndices()[0]].timestampValidBits;
+                if(validBits == 0){
+                    throw vk::FeatureNotPresentError("Can't initialize GPU profiler. Timestamps are not supported by graphics queue");
+                }
+
+                timestampMask_ = validBits >= 64 ? UINT64_MAX : ((1ull << validBits) - 1);
+                timestampPeriodNs_ = static_cast<double>(pDevice_->getPhysicalDevice().getProperties().limits.timestampPeriod);
+
+                // Основной проход записывается во вторичные буферы, поэтому запрос статистики должен наследоваться ими
+                // (без наследования запросов собираются только временные метки)
+                const auto features = pDevice_->getPhysicalDevice().getFeatures();
+                pipelineStatisticsEnabled_ = features.pipelineStatisticsQuery == VK_TRUE && features.inheritedQueries == VK_TRUE;
+
+                // Пулы запросов каждого кадра
+                for(size_t i = 0; i < frameCount; i++)
+                {
+                    vk::QueryPoolCreateInfo timestampPoolInfo{};
+                    timestampPoolInfo.queryType = vk::QueryType::eTimestamp;
+                    timestampPoolInfo.queryCount = drawQueryIndex(maxDrawTimestamps_);
+                    timestampPools_.push_back(pDevice_->getLogicalDevice()->createQueryPoolUnique(timestampPoolInfo));
+
+                    if(pipelineStatisticsEnabled_){
+                        vk::QueryPoolCreateInfo statisticsPoolInfo{};
+                        statisticsPoolInfo.queryType = vk::QueryType::ePipelineStatistics;
+                        statisticsPoolInfo.queryCount = PASS_COUNT;
+                        statisticsPoolInfo.pipelineStatistics = vk::QueryPipelineStatisticFlags(STATISTIC_FLAGS);
+                        statisticsPools_.push_back(pDevice_->getLogicalDevice()->createQueryPoolUnique(statisticsPoolInfo));
+                    }
+                }
+
+                // Файл результатов (заголовок - названия столбцов)
+                if(!csvPath.empty()){
+                    csvFile_.open(csvPath, std::ios::out | std::ios::trunc);
+                    csvFile_ << "frame";
+                    for(const char* pass : {"primary", "post_process"}){
+                        csvFile_ << ',' << pass << "_ms"
+                                 << ',' << pass << "_vs_invocations"
+                                 << ',' << pass << "_clipping_invocations"
+                                 << ',' << pass << "_clipping_primitives"
+                                 << ',' << pass << "_fs_invocations";
+                    }
+                    csvFile_ << ",draws,draws_ms\n";
+                }
+
+                isReady_ = true;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~GpuProfiler()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Де-инициализация ресурсов Vulkan
+             */
+            void destroyVulkanResources()
+            {
+                if(isReady_ && pDevice_ != nullptr && pDevice_->isReady())
+                {
+                    for(auto& pool : timestampPools_){
+                        pDevice_->getLogicalDevice()->destroyQueryPool(pool.get());
+                        pool.release();
+                    }
+
+                    for(auto& pool : statisticsPools_){
+                        pDevice_->getLogicalDevice()->destroyQueryPool(pool.get());
+                        pool.release();
+                    }
+
+                    timestampPools_.clear();
+                    statisticsPools_.clear();
+
+                    if(csvFile_.is_open()) csvFile_.close();
+
+                    pDevice_ = nullptr;
+                    isReady_ = false;
+                }
+            }
+
+            /**
+             * Начать профилирование кадра
+             * @param commandBuffer Основной командный буфер кадра (вне прохода рендеринга)
+             * @param frameIndex Индекс кадра в полете
+             * @param frameNumber Номер кадра
+             *
+             * @details Читает результаты предыдущего использования пулов кадра (с кол-вом вызовов, записанным тогда) и
+             * сбрасывает пулы. Кол-во вызовов текущего кадра (setDrawCount) запоминается для следующего чтения.
+             * Должен вызываться после ожидания барьера кадра
+             */
+            void beginFrame(const vk::CommandBuffer& commandBuffer, size_t frameIndex, uint64_t frameNumber)
+            {
+                if(!isReady_) return;
+
+                this->collectResults(frameIndex);
+
+                commandBuffer.resetQueryPool(timestampPools_[frameIndex].get(), 0, drawQueryIndex(maxDrawTimestamps_));
+                if(pipelineStatisticsEnabled_){
+                    commandBuffer.resetQueryPool(statisticsPools_[frameIndex].get(), 0, PASS_COUNT);
+                }
+
+                frameNumbers_[frameIndex] = frameNumber;
+                writtenDrawCounts_[frameIndex] = drawCounts_[frameIndex];
+                pending_[frameIndex] = true;
+            }
+
+            /**
+             * Указать кол-во вызовов отрисовки, для которых записываются метки в текущем кадре
+             * @param frameIndex Индекс кадра в полете
+             * @param drawCount Кол-во вызовов отрисовки (ограничивается максимумом)
+             * @return Фактическое кол-во вызовов с метками
+             *
+             * @details Вызывается каждый кадр до записи меток вызовов и до beginFrame
+             */
+            uint32_t setDrawCount(size_t frameIndex, size_t drawCount)
+            {
+                if(!isReady_) return 0;
+                drawCounts_[frameIndex] = static_cast<uint32_t>((std::min<size_t>)(drawCount, maxDrawTimestamps_));
+                return drawCounts_[frameIndex];
+            }
+
+            /**
+             * Начать профилирование прохода (до начала прохода рендеринга)
+             * @param commandBuffer Основной командный буфер кадра
+             * @param frameIndex Индекс кадра в полете
+             * @param pass Проход
+             */
+            void beginPass(const vk::CommandBuffer& commandBuffer, size_t frameIndex, GpuProfilerPass pass) const
+            {
+                if(!isReady_) return;
+
+                commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampPools_[frameIndex].get(), passQueryIndex(pass));
+                if(pipelineStatisticsEnabled_){
+                    commandBuffer.beginQuery(statisticsPools_[frameIndex].get(), static_cast<uint32_t>(pass), {});
+                }
+            }
+
+            /**
+             * Завершить профилирование прохода (после завершения прохода рендеринга)
+             * @param commandBuffer Основной командный буфер кадра
+             * @param frameIndex Индекс кадра в полете
+             * @param pass Проход
+             */
+            void endPass(const vk::CommandBuffer& commandBuffer, size_t frameIndex, GpuProfilerPass pass) const
+            {
+                if(!isReady_) return;
+
+                if(pipelineStatisticsEnabled_){
+                    commandBuffer.endQuery(statisticsPools_[frameIndex].get(), static_cast<uint32_t>(pass));
+                }
+                commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampPools_[frameIndex].get(), passQueryIndex(pass) + 1);
+            }
+
+            /**
+             * Записать временную метку вызова отрисовки
+             * @param commandBuffer Командный буфер (может быть вторичным)
+             * @param frameIndex Индекс кадра в полете
+             * @param drawIndex Индекс вызова отрисовки
+             * @param end Метка конца (иначе - начала) вызова
+             *
+             * @details Может вызываться из нескольких потоков записи - у каждого вызова свои запросы
+             */
+            void writeDrawTimestamp(const vk::CommandBuffer& commandBuffer, size_t frameIndex, size_t drawIndex, bool end) const
+            {
+                if(!isReady_ || drawIndex >= drawCounts_[frameIndex]) return;
+
+                commandBuffer.writeTimestamp(
+                        end ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eTopOfPipe,
+                        timestampPools_[frameIndex].get(),
+                        drawQueryIndex(static_cast<uint32_t>(drawIndex)) + (end ? 1 : 0));
+            }
+
+            /**
+             * Флаги статистики конвейера, которые должны наследовать вторичные командные буферы прохода
+             * @return Флаги статистики
+             */
+            vk::QueryPipelineStatisticFlags getInheritedPipelineStatistics() const
+            {
+                return isReady_ && pipelineStatisticsEnabled_ ? vk::QueryPipelineStatisticFlags(STATISTIC_FLAGS) : vk::QueryPipelineStatisticFlags();
+            }
+
+            /**
+             * Получить последние прочитанные результаты
+             * @return Константная ссылка на результаты кадра
+             */
+            const GpuFrameProfile& getLatestProfile() const
+            {
+                return latestProfile_;
+            }
+
+            /**
+             * Собирается ли статистика конвейера
+             * @return Да или нет
+             */
+            bool isPipelineStatisticsEnabled() const
+            {
+                return pipelineStatisticsEnabled_;
+            }
+
+            /**
+             * Был ли объект инициализирован
+             * @return Да или нет
+             */
+            bool isReady() const
+            {
+                return isReady_;
+            }
+        };
+    }
+}
@@ -23,8 +23,8 @@ namespace vk
             vk::UniqueImage image_;
             /// Объект для доступа к изображению
             vk::UniqueImageView imageView_;
-            /// Память изображения
-            vk::UniqueDeviceMemory memory_;
+            /// Участок памяти изображения (выделяется распределителем устройства)
+            vk::tools::MemoryAllocation memory_;
             /// Кол-во мип-уровней изображения
             size_t mipLevels_;
 
@@ -89,7 +89,7 @@ namespace vk
                 std::swap(mipLevels_,other.mipLevels_);
                 image_.swap(other.image_);
                 imageView_.swap(other.imageView_);
-                memory_.swap(other.memory_);
+                std::swap(memory_,other.memory_);
             }
 
             /**
@@ -112,7 +112,7 @@ namespace vk
                 std::swap(mipLevels_,other.mipLevels_);
                 image_.swap(other.image_);
                 imageView_.swap(other.imageView_);
-                memory_.swap(other.memory_);
+                std::swap(memory_,other.memory_);
 
                 return *this;
             }
@@ -192,14 +192,15 @@ namespace vk
                     throw vk::FeatureNotPresentError("Can't use required memory type");
                 }
 
-                // Выделить память для изображения (память на устройстве)
-                vk::MemoryAllocateInfo memoryAllocateInfo{};
-                memoryAllocateInfo.allocationSize = memRequirements.size;
-                memoryAllocateInfo.memoryTypeIndex = static_cast<uint32_t>(memTypeIndex);
-                memory_ = pDevice_->getLogicalDevice()->allocateMemoryUnique(memoryAllocateInfo);
+                // Выделить участок памяти для изображения (изображения с оптимальной раскладкой размещаются отдельно от линейных ресурсов)
+                memory_ = pDevice_->getMemoryAllocator()->allocate(
+                        memRequirements,
+                        static_cast<uint32_t>(memTypeIndex),
+                        imageTiling == vk::ImageTiling::eOptimal,
+                        false);
 
                 // Связать память и объект изображения
-                pDevice_->getLogicalDevice()->bindImageMemory(image_.get(),memory_.get(),0);
+                pDevice_->getLogicalDevice()->bindImageMemory(image_.get(),memory_.memory,memory_.offset);
 
                 // Создать image-view объект (связь с конкретным слоем/мип-уровнем) изображения
                 vk::ImageViewCreateInfo imageViewCreateInfo{};
@@ -284,8 +285,8 @@ namespace vk
                     // Освободить память изображения
                     // Если объект владеет изображением, то память тоже выделялась при создании
                     if(ownsImage_){
-                        pDevice_->getLogicalDevice()->freeMemory(memory_.get());
-                        memory_.release();
+                        pDevice_->getMemoryAllocator()->free(memory_);
+                        memory_ = {};
                     }
 
                     isReady_ = false;
@@ -327,33 +328,45 @@ namespace vk
             }
 
             /**
-             * Получить объект памяти устройства
-             * @return ссылка на smart-pointer
+             * Получить объект памяти устройства (блок, в котором размещено изображение)
+             * @return Объект памяти
+             */
+            vk::DeviceMemory getMemory() const
+            {
+                return memory_.memory;
+            }
+
+            /**
+             * Получить смещение изображения в объекте памяти
+             * @return Смещение в байтах
              */
-            const vk::UniqueDeviceMemory& getMemory() const
+            vk::DeviceSize getMemoryOffset() const
             {
-                return memory_;
+                return memory_.offset;
             }
 
             /**
-             * Разметить память и получить указатель на размеченную область
+             * Получить указатель на размеченную область памяти
              * @param offset Сдвиг в байтах
-             * @param size Размер в байтах
-             * @return Указатель на область
+             * @param size Размер в байтах (не используется, память размечена целиком)
+             * @return Указатель на область (nullptr если память не видима хостом)
+             *
+             * @details Видимая хостом память размечается распределителем один раз, при выделении блока
              */
             void* mapMemory(VkDeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE)
             {
-                if(pDevice_ == nullptr || !pDevice_->isReady()) return nullptr;
-                return pDevice_->getLogicalDevice()->mapMemory(memory_.get(),offset,size);
+                (void)size;
+                if(pDevice_ == nullptr || !pDevice_->isReady() || memory_.pMapped == nullptr) return nullptr;
+                return memory_.pMapped + offset;
             }
 
             /**
              * Отменить разметку памяти
+             *
+             * @details Ничего не делает - память остается размеченной до освобождения блока
              */
             void unmapMemory()
-            {
-                pDevice_->getLogicalDevice()->unmapMemory(memory_.get());
-            }
+            {}
 
             /**
              * Получить указатель на владеющее устройство
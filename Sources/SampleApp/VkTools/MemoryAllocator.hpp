@@ -0,0 +1,323 @@
+#pragma once
+
+#include "Tools.h"
+#include "../Tools/RangeAllocator.hpp"
+
+#include <iostream>
+#include <mutex>
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Участок памяти устройства, выделенный распределителем
+         */
+        struct MemoryAllocation
+        {
+            /// Объект памяти Vulkan (блок, либо отдельно выделенная память)
+            vk::DeviceMemory memory = nullptr;
+            /// Смещение участка в объекте памяти
+            vk::DeviceSize offset = 0;
+            /// Размер участка
+            vk::DeviceSize size = 0;
+            /// Указатель на начало участка в постоянно размеченной памяти (nullptr если память не видима хостом)
+            unsigned char* pMapped = nullptr;
+            /// Индекс пула блоков (не используется для отдельно выделенной памяти)
+            uint32_t poolIndex = 0;
+            /// Индекс блока в пуле (не используется для отдельно выделенной памяти)
+            uint32_t blockIndex = 0;
+            /// Выделена ли память отдельно (не из блока)
+            bool dedicated = false;
+        };
+
+        /**
+         * Распределитель памяти устройства (суб-аллокация ресурсов из крупных блоков)
+         *
+         * @details Для каждого типа памяти хранится пул блоков. Ресурсы с линейным (буферы, линейные изображения) и
+         * нелинейным (изображения с оптимальной раскладкой) размещением хранятся в разных пулах, если bufferImageGranularity
+         * больше 1 - так соседние ресурсы разных видов не могут оказаться на одной "странице" гранулярности. Память
+         * с флагом eDeviceAddress также выделяется в отдельных пулах. Крупные ресурсы (больше половины блока) получают
+         * отдельно выделенную память. Видимая хостом память размечается один раз при выделении блока. Потокобезопасен
+         */
+        class MemoryAllocator
+        {
+        public:
+            /// Предпочтительный размер блока (для небольших куч блок уменьшается до 1/8 размера кучи)
+            static constexpr vk::DeviceSize PREFERRED_BLOCK_SIZE = 64u * 1024u * 1024u;
+
+        private:
+            /**
+             * Блок памяти
+             */
+            struct Block
+            {
+                /// Объект памяти Vulkan (пустой, если блок освобожден)
+                vk::DeviceMemory memory = nullptr;
+                /// Распределитель участков блока
+                ::tools::RangeAllocator ranges;
+                /// Указатель на размеченную память блока (nullptr если память не видима хостом)
+                unsigned char* pMapped = nullptr;
+                /// Кол-во участков, выделенных из блока
+                size_t allocationCount = 0;
+            };
+
+            /// Логическое устройство
+            vk::Device device_;
+            /// Свойства памяти физического устройства
+            vk::PhysicalDeviceMemoryProperties memoryProperties_;
+            /// Гранулярность размещения линейных и нелинейных ресурсов
+            vk::DeviceSize bufferImageGranularity_;
+            /// Пулы блоков (по 4 пула на тип памяти - линейные/нелинейные ресурсы, с флагом eDeviceAddress и без)
+            std::vector<std::vector<Block>> pools_;
+            /// Кол-во объектов памяти Vulkan (блоки и отдельно выделенная память)
+            size_t deviceMemoryCount_;
+            /// Кол-во выделенных участков
+            size_t allocationCount_;
+            /// Мьютекс (ресурсы могут создаваться из разных потоков)
+            std::mutex mutex_;
+
+            /**
+             * Выделить объект памяти Vulkan
+             * @param size Размер
+             * @param memoryTypeIndex Индекс типа памяти
+             * @param deviceAddress Выделять с флагом eDeviceAddress
+             * @param ppMapped Указатель на указатель размеченной памяти (заполняется если память видима хостом)
+             * @return Объект памяти
+             */
+            vk::DeviceMemory allocateDeviceMemory(vk::DeviceSize size, uint32_t memoryTypeIndex, bool deviceAddress, unsigned char** ppMapped)
+            {
+                vk::MemoryAllocateInfo memoryAllocateInfo;
+                memoryAllocateInfo.allocationSize = size;
+                memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+                // Флаги выделения памяти - eDeviceAddress, используются для буферов с флагом eShaderDeviceAddress
+                vk::MemoryAllocateFlagsInfoKHR memoryAllocateFlagsInfoKhr{};
+                memoryAllocateFlagsInfoKhr.flags = vk::MemoryAllocateFlagBits::eDeviceAddress;
+                if(deviceAddress) memoryAllocateInfo.pNext = &memoryAllocateFlagsInfoKhr;
+
+                auto memory = device_.allocateMemory(memoryAllocateInfo);
+                deviceMemoryCount_++;
+
+                // Видимая хостом память размечается сразу и остается размеченной до освобождения
+                *ppMapped = nullptr;
+                if(memoryProperties_.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible){
+                    *ppMapped = static_cast<unsigned char*>(device_.mapMemory(memory, 0, VK_WHOLE_SIZE));
+                }
+
+                return memory;
+            }
+
+            /**
+             * Освободить объект памяти Vulkan
+             * @param memory Объект памяти
+             * @param mapped Размечена ли память
+             */
+            void freeDeviceMemory(const vk::DeviceMemory& memory, bool mapped)
+            {
+                if(mapped) device_.unmapMemory(memory);
+                device_.freeMemory(memory);
+                deviceMemoryCount_--;
+            }
+
+            /**
+             * Получить размер блока для типа памяти
+             * @param memoryTypeIndex Индекс типа памяти
+             * @return Размер блока
+             */
+            vk::DeviceSize getBlockSize(uint32_t memoryTypeIndex) const
+            {
+                const auto heapSize = memoryProperties_.memoryHeaps[memoryProperties_.memoryTypes[memoryTypeIndex].heapIndex].size;
+                return (std::min)(PREFERRED_BLOCK_SIZE, heapSize / 8);
+            }
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            MemoryAllocator():bufferImageGranularity_(1),deviceMemoryCount_(0),allocationCount_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            MemoryAllocator(const MemoryAllocator& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            MemoryAllocator& operator=(const MemoryAllocator& other) = delete;
+
+            /**
+             * Основной конструктор
+             * @param device Логическое устройство
+             * @param memoryProperties Свойства памяти физического устройства
+             * @param bufferImageGranularity Гранулярность размещения линейных и нелинейных ресурсов (лимит устройства)
+             */
+            MemoryAllocator(const vk::Device& device,
+                            const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+                            vk::DeviceSize bufferImageGranularity):
+                    device_(device),
+                    memoryProperties_(memoryProperties),
+                    bufferImageGranularity_((std::max)(bufferImageGranularity, static_cast<vk::DeviceSize>(1))),
+                    deviceMemoryCount_(0),
+                    allocationCount_(0)
+            {
+                pools_.resize(memoryProperties_.memoryTypeCount * 4);
+            }
+
+            /**
+             * Деструктор
+             */
+            ~MemoryAllocator()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Освободить все блоки (вызывается перед уничтожением устройства)
+             */
+            void destroyVulkanResources()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                for(auto& pool : pools_){
+                    for(auto& block : pool){
+                        if(block.memory) this->freeDeviceMemory(block.memory, block.pMapped != nullptr);
+                    }
+                    pool.clear();
+                }
+
+                if(allocationCount_ > 0){
+                    std::cout << "WARNING: Device memory allocator destroyed with " << allocationCount_ << " allocation(s) still in use" << std::endl;
+                }
+            }
+
+            /**
+             * Выделить участок памяти
+             * @param memoryRequirements Требования к памяти ресурса (размер, выравнивание)
+             * @param memoryTypeIndex Индекс типа памяти (должен входить в memoryRequirements.memoryTypeBits)
+             * @param nonLinear Нелинейный ли ресурс (изображение с оптимальной раскладкой)
+             * @param deviceAddress Нужен ли флаг eDeviceAddress (буферы с флагом eShaderDeviceAddress)
+             * @return Описание участка
+             */
+            MemoryAllocation allocate(const vk::MemoryRequirements& memoryRequirements, uint32_t memoryTypeIndex, bool nonLinear, bool deviceAddress)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                MemoryAllocation allocation{};
+                allocation.size = memoryRequirements.size;
+
+                // Крупные ресурсы получают отдельную память
+                const auto blockSize = this->getBlockSize(memoryTypeIndex);
+                if(memoryRequirements.size > blockSize / 2)
+                {
+                    allocation.memory = this->allocateDeviceMemory(memoryRequirements.size, memoryTypeIndex, deviceAddress, &allocation.pMapped);
+                    allocation.dedicated = true;
+                    allocationCount_++;
+                    return allocation;
+                }
+
+                // При гранулярности 1 линейные и нелинейные ресурсы могут соседствовать в одном блоке
+                if(bufferImageGranularity_ <= 1) nonLinear = false;
+                allocation.poolIndex = memoryTypeIndex * 4 + (nonLinear ? 2 : 0) + (deviceAddress ? 1 : 0);
+                auto& pool = pools_[allocation.poolIndex];
+
+                // Найти место в существующих блоках
+                const auto alignment = static_cast<size_t>((std::max)(memoryRequirements.alignment, static_cast<vk::DeviceSize>(1)));
+                size_t offset = 0;
+                uint32_t freeSlot = static_cast<uint32_t>(pool.size());
+                for(uint32_t i = 0; i < pool.size(); i++)
+                {
+                    auto& block = pool[i];
+                    if(!block.memory){
+                        freeSlot = (std::min)(freeSlot, i);
+                        continue;
+                    }
+
+                    if(block.ranges.getFreeSize() >= memoryRequirements.size &&
+                       block.ranges.allocate(static_cast<size_t>(memoryRequirements.size), alignment, &offset))
+                    {
+                        block.allocationCount++;
+                        allocation.memory = block.memory;
+                        allocation.offset = offset;
+                        allocation.pMapped = block.pMapped != nullptr ? block.pMapped + offset : nullptr;
+                        allocation.blockIndex = i;
+                        allocationCount_++;
+                        return allocation;
+                    }
+                }
+
+                // Выделить новый блок (в освободившуюся ячейку, чтобы индексы существующих блоков не менялись)
+                if(freeSlot == pool.size()) pool.emplace_back();
+                auto& block = pool[freeSlot];
+                block.memory = this->allocateDeviceMemory(blockSize, memoryTypeIndex, deviceAddress, &block.pMapped);
+                block.ranges = ::tools::RangeAllocator(static_cast<size_t>(blockSize));
+                block.allocationCount = 1;
+                block.ranges.allocate(static_cast<size_t>(memoryRequirements.size), alignment, &offset);
+
+                allocation.memory = block.memory;
+                allocation.offset = offset;
+                allocation.pMapped = block.pMapped != nullptr ? block.pMapped + offset : nullptr;
+                allocation.blockIndex = freeSlot;
+                allocationCount_++;
+                return allocation;
+            }
+
+            /**
+             * Освободить участок памяти
+             * @param allocation Описание участка (полученное при выделении)
+             *
+             * @details Пустые блоки освобождаются, кроме последнего блока в пуле (чтобы частое создание и удаление
+             * ресурсов не приводило к постоянному выделению памяти устройства)
+             */
+            void free(const MemoryAllocation& allocation)
+            {
+                if(!allocation.memory) return;
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                allocationCount_--;
+
+                if(allocation.dedicated){
+                    this->freeDeviceMemory(allocation.memory, allocation.pMapped != nullptr);
+                    return;
+                }
+
+                auto& pool = pools_[allocation.poolIndex];
+                auto& block = pool[allocation.blockIndex];
+                block.ranges.free(static_cast<size_t>(allocation.offset), static_cast<size_t>(allocation.size));
+                if(--block.allocationCount > 0) return;
+
+                // Оставить пустой блок, если других блоков в пуле нет
+                size_t liveBlocks = 0;
+                for(const auto& poolBlock : pool){
+                    if(poolBlock.memory) liveBlocks++;
+                }
+                if(liveBlocks <= 1) return;
+
+                this->freeDeviceMemory(block.memory, block.pMapped != nullptr);
+                block = Block{};
+            }
+
+            /**
+             * Получить кол-во объектов памяти Vulkan (блоки и отдельно выделенная память)
+             * @return Целое число
+             */
+            size_t getDeviceMemoryCount() const
+            {
+                return deviceMemoryCount_;
+            }
+
+            /**
+             * Получить кол-во выделенных участков
+             * @return Целое число
+             */
+            size_t getAllocationCount() const
+            {
+                return allocationCount_;
+            }
+        };
+    }
+}
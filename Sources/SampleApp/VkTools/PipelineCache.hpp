@@ -0,0 +1,335 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Кэш графических конвейеров, сохраняемый между запусками
+         *
+         * @details Данные кэша хранятся в файле с собственным заголовком (идентификаторы производителя, устройства,
+         * версии драйвера и UUID кэша). Данные, созданные другим устройством или драйвером, а также поврежденные данные
+         * не передаются драйверу - кэш создается пустым. Сохранение атомарное: данные пишутся во временный файл,
+         * который затем заменяет основной, поэтому прерванное сохранение не портит предыдущий кэш
+         */
+        class PipelineCache
+        {
+        private:
+            /// Сигнатура файла кэша
+            static constexpr uint32_t FILE_MAGIC = 0x43505256; // "VRPC"
+            /// Версия формата файла кэша
+            static constexpr uint32_t FILE_VERSION = 1;
+
+            /**
+             * Заголовок файла кэша
+             */
+            struct FileHeader
+            {
+                uint32_t magic;
+                uint32_t version;
+                uint32_t vendorId;
+                uint32_t deviceId;
+                uint32_t driverVersion;
+                uint8_t pipelineCacheUuid[VK_UUID_SIZE];
+                uint64_t dataSize;
+                uint64_t dataHash;
+            };
+
+            /// Готов ли кэш
+            bool isReady_;
+            /// Указатель на устройство
+            const vk::tools::Device* pDevice_;
+            /// Путь к файлу кэша (пустая строка - кэш не сохраняется)
+            std::string path_;
+            /// Объект кэша Vulkan
+            vk::UniquePipelineCache pipelineCache_;
+            /// Кол-во байт, загруженных из файла (0 - кэш создан пустым, "холодный" запуск)
+            size_t loadedDataSize_;
+
+            /**
+             * Хеш данных (FNV-1a)
+             * @param data Указатель на данные
+             * @param size Размер данных
+             * @return Значение хеша
+             */
+            static uint64_t hashData(const unsigned char* data, size_t size)
+            {
+                uint64_t hash = 14695981039346656037ull;
+                for(size_t i = 0; i < size; i++){
+                    hash ^= data[i];
+                    hash *= 1099511628211ull;
+                }
+                return hash;
+            }
+
+            /**
+             * Заполнить заголовок данными текущего устройства
+             * @param header Заголовок
+             */
+            void fillHeader(FileHeader& header) const
+            {
+                const auto properties = pDevice_->getPhysicalDevice().getProperties();
+                header.magic = FILE_MAGIC;
+                header.version = FILE_VERSION;
+                header.vendorId = properties.vendorID;
+                header.deviceId = properties.deviceID;
+                header.driverVersion = properties.driverVersion;
+                memcpy(header.pipelineCacheUuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+            }
+
+            /**
+             * Загрузить данные кэша из файла
+             * @return Данные кэша (пустой массив, если файла нет или данные не подходят устройству)
+             */
+            std::vector<unsigned char> loadData() const
+            {
+                if(path_.empty()) return {};
+
+                std::ifstream file(path_, std::ios::binary);
+                if(!file.is_open()) return {};
+
+                FileHeader stored{};
+                if(!file.read(reinterpret_cast<char*>(&stored), sizeof(FileHeader))) return {};
+
+                FileHeader expected{};
+                this->fillHeader(expected);
+
+                // Файл другого формата, устройства или версии драйвера
+                if(stored.magic != expected.magic ||
+                   stored.version != expected.version ||
+                   stored.vendorId != expected.vendorId ||
+                   stored.deviceId != expected.deviceId ||
+                   stored.driverVersion != expected.driverVersion ||
+                   memcmp(stored.pipelineCacheUuid, expected.pipelineCacheUuid, VK_UUID_SIZE) != 0)
+                {
+                    return {};
+                }
+
+                // Размер данных из заголовка должен совпадать с остатком файла (иначе файл обрезан или поврежден)
+                const std::streamoff dataOffset = file.tellg();
+                file.seekg(0, std::ios::end);
+                const std::streamoff fileSize = file.tellg();
+                if(dataOffset < 0 || fileSize < dataOffset || stored.dataSize != static_cast<uint64_t>(fileSize - dataOffset)){
+                    return {};
+                }
+                file.seekg(dataOffset, std::ios::beg);
+
+                // Данные не полные или повреждены
+                std::vector<unsigned char> data(static_cast<size_t>(stored.dataSize));
+                if(data.empty() || !file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))){
+                    return {};
+                }
+                if(hashData(data.data(), data.size()) != stored.dataHash){
+                    return {};
+                }
+
+                return data;
+            }
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            PipelineCache():
+                    isReady_(false),
+                    pDevice_(nullptr),
+                    loadedDataSize_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            PipelineCache(const PipelineCache& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            PipelineCache& operator=(const PipelineCache& other) = delete;
+
+            /**
+             * Конструктор перемещения
+             * @param other R-value ссылка на другой объект
+             * @details Нельзя копировать объект, но можно обменяться с ним ресурсом
+             */
+            PipelineCache(PipelineCache&& other) noexcept:PipelineCache(){
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(path_,other.path_);
+                std::swap(pipelineCache_,other.pipelineCache_);
+                std::swap(loadedDataSize_,other.loadedDataSize_);
+            }
+
+            /**
+             * Перемещение через присваивание
+             * @param other R-value ссылка на другой объект
+             * @return Ссылка на текущий объект
+             */
+            PipelineCache& operator=(PipelineCache&& other) noexcept {
+                if (this == &other) return *this;
+
+                this->destroyVulkanResources();
+
+                std::swap(isReady_,other.isReady_);
+                std::swap(pDevice_,other.pDevice_);
+                std::swap(path_,other.path_);
+                std::swap(pipelineCache_,other.pipelineCache_);
+                std::swap(loadedDataSize_,other.loadedDataSize_);
+
+                return *this;
+            }
+
+            /**
+             * Основной конструктор
+             * @param pDevice Указатель на устройство
+             * @param path Путь к файлу кэша (пустая строка - кэш только в памяти)
+             */
+            PipelineCache(const vk::tools::Device* pDevice, const std::string& path):
+                    isReady_(false),
+                    pDevice_(pDevice),
+                    path_(path),
+                    loadedDataSize_(0)
+            {
+                // Проверить устройство
+                if(pDevice_ == nullptr || !pDevice_->isReady()){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                // Загрузить данные предыдущего запуска (если они подходят устройству)
+                auto data = this->loadData();
+
+                vk::PipelineCacheCreateInfo createInfo{};
+                createInfo.initialDataSize = data.size();
+                createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+                try{
+                    pipelineCache_ = pDevice_->getLogicalDevice()->createPipelineCacheUnique(createInfo);
+                    loadedDataSize_ = data.size();
+                }
+                catch(vk::SystemError&){
+                    // Драйвер отверг данные - создать пустой кэш
+                    createInfo.initialDataSize = 0;
+                    createInfo.pInitialData = nullptr;
+                    pipelineCache_ = pDevice_->getLogicalDevice()->createPipelineCacheUnique(createInfo);
+                }
+
+                isReady_ = true;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~PipelineCache()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Де-инициализация ресурсов Vulkan
+             * @details Данные не сохраняются автоматически, для сохранения следует вызвать save()
+             */
+            void destroyVulkanResources()
+            {
+                if(isReady_ && pDevice_ != nullptr && pDevice_->isReady())
+                {
+                    pDevice_->getLogicalDevice()->destroyPipelineCache(pipelineCache_.get());
+                    pipelineCache_.release();
+
+                    pDevice_ = nullptr;
+                    isReady_ = false;
+                }
+            }
+
+            /**
+             * Сохранить данные кэша в файл
+             * @return Удалось ли сохранить
+             */
+            bool save() const
+            {
+                if(!isReady_ || path_.empty()) return false;
+
+                auto data = pDevice_->getLogicalDevice()->getPipelineCacheData(pipelineCache_.get());
+                if(data.empty()) return false;
+
+                FileHeader header{};
+                this->fillHeader(header);
+                header.dataSize = data.size();
+                header.dataHash = hashData(data.data(), data.size());
+
+                // Записать во временный файл
+                const std::string tempPath = path_ + ".tmp";
+                {
+                    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                    if(!file.is_open()) return false;
+
+                    file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+                    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+                    file.flush();
+
+                    if(!file.good()){
+                        file.close();
+                        std::remove(tempPath.c_str());
+                        return false;
+                    }
+                }
+
+                // Заменить основной файл временным
+#ifdef _WIN32
+                const bool replaced = MoveFileExA(tempPath.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+                const bool replaced = std::rename(tempPath.c_str(), path_.c_str()) == 0;
+#endif
+                if(!replaced) std::remove(tempPath.c_str());
+                return replaced;
+            }
+
+            /**
+             * Был ли объект инициализирован
+             * @return Да или нет
+             */
+            bool isReady() const
+            {
+                return isReady_;
+            }
+
+            /**
+             * Был ли кэш загружен из файла ("теплый" запуск)
+             * @return Да или нет
+             */
+            bool isWarm() const
+            {
+                return loadedDataSize_ > 0;
+            }
+
+            /**
+             * Кол-во байт, загруженных из файла
+             * @return Размер данных
+             */
+            size_t getLoadedDataSize() const
+            {
+                return loadedDataSize_;
+            }
+
+            /**
+             * Получить объект кэша Vulkan
+             * @return Ссылка на unique smart pointer объекта кэша
+             */
+            const vk::UniquePipelineCache& getVulkanPipelineCache() const
+            {
+                return pipelineCache_;
+            }
+        };
+    }
+}
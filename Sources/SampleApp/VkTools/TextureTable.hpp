@@ -0,0 +1,243 @@
+#pragma once
+
+#include "Tools.h"
+
+#include <iostream>
+#include <mutex>
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Глобальная таблица текстур (bindless, один массив дескрипторов на все текстуры)
+         *
+         * @details Таблица - единственный набор дескрипторов с массивом переменной длины (combined image sampler).
+         * Текстура регистрируется при создании и получает постоянный индекс, по которому шейдер выбирает ее из массива
+         * (nonuniformEXT). Набор создается с флагами partially bound и update after bind: незаполненные элементы
+         * допустимы, а новые текстуры можно записывать в набор, уже привязанный к командным буферам. Освобожденные
+         * индексы используются повторно. Элемент, который читают команды в полете, перезаписывать нельзя - текстуры
+         * уничтожаются только после ожидания устройства. Потокобезопасен
+         */
+        class TextureTable
+        {
+        public:
+            /// Предпочтительное кол-во элементов (уменьшается до лимитов устройства, не больше 65536 - индексы в потоке экземпляров 16-битные)
+            static constexpr uint32_t PREFERRED_CAPACITY = 4096;
+
+        private:
+            /// Логическое устройство
+            vk::Device device_;
+            /// Пул дескрипторов (с флагом update after bind)
+            vk::DescriptorPool descriptorPool_;
+            /// Макет размещения набора
+            vk::DescriptorSetLayout descriptorSetLayout_;
+            /// Набор дескрипторов таблицы
+            vk::DescriptorSet descriptorSet_;
+            /// Кол-во элементов массива
+            uint32_t capacity_;
+            /// Следующий никогда не использованный индекс
+            uint32_t nextIndex_;
+            /// Освобожденные индексы
+            std::vector<uint32_t> freeIndices_;
+            /// Мьютекс (текстуры могут создаваться из разных потоков)
+            std::mutex mutex_;
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            TextureTable():capacity_(0),nextIndex_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            TextureTable(const TextureTable& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            TextureTable& operator=(const TextureTable& other) = delete;
+
+            /**
+             * Основной конструктор
+             * @param device Логическое устройство
+             * @param maxDescriptors Наибольшее кол-во элементов, допустимое лимитами устройства
+             */
+            TextureTable(const vk::Device& device, uint32_t maxDescriptors):
+                    device_(device),
+                    capacity_((std::min)(PREFERRED_CAPACITY, maxDescriptors)),
+                    nextIndex_(0)
+            {
+                if(capacity_ == 0){
+                    throw vk::InitializationFailedError("Can't initialize texture table. Descriptor limit is zero");
+                }
+
+                // Пул на один набор (массив дескрипторов текстур)
+                vk::DescriptorPoolSize descriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, capacity_};
+                vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+                descriptorPoolCreateInfo.poolSizeCount = 1;
+                descriptorPoolCreateInfo.pPoolSizes = &descriptorPoolSize;
+                descriptorPoolCreateInfo.maxSets = 1;
+                descriptorPoolCreateInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT;
+                descriptorPool_ = device_.createDescriptorPool(descriptorPoolCreateInfo);
+
+                // Привязка - массив переменной длины (должна быть последней в наборе)
+                vk::DescriptorSetLayoutBinding binding{
+                        0,
+                        vk::DescriptorType::eCombinedImageSampler,
+                        capacity_,
+                        vk::ShaderStageFlagBits::eFragment,
+                        nullptr};
+
+                vk::DescriptorBindingFlagsEXT bindingFlags =
+                        vk::DescriptorBindingFlagBitsEXT::ePartiallyBound |
+                        vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind |
+                        vk::DescriptorBindingFlagBitsEXT::eVariableDescriptorCount;
+
+                vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo{};
+                bindingFlagsCreateInfo.bindingCount = 1;
+                bindingFlagsCreateInfo.pBindingFlags = &bindingFlags;
+
+                vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo{};
+                descriptorSetLayoutCreateInfo.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT;
+                descriptorSetLayoutCreateInfo.bindingCount = 1;
+                descriptorSetLayoutCreateInfo.pBindings = &binding;
+                descriptorSetLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+                descriptorSetLayout_ = device_.createDescriptorSetLayout(descriptorSetLayoutCreateInfo);
+
+                // Выделить набор (фактическая длина массива задается при выделении)
+                vk::DescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountAllocateInfo{};
+                variableCountAllocateInfo.descriptorSetCount = 1;
+                variableCountAllocateInfo.pDescriptorCounts = &capacity_;
+
+                vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+                descriptorSetAllocateInfo.descriptorPool = descriptorPool_;
+                descriptorSetAllocateInfo.descriptorSetCount = 1;
+                descriptorSetAllocateInfo.pSetLayouts = &descriptorSetLayout_;
+                descriptorSetAllocateInfo.pNext = &variableCountAllocateInfo;
+                descriptorSet_ = device_.allocateDescriptorSets(descriptorSetAllocateInfo)[0];
+            }
+
+            /**
+             * Деструктор
+             */
+            ~TextureTable()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Уничтожить набор, пул и макет (вызывается перед уничтожением устройства)
+             */
+            void destroyVulkanResources()
+            {
+                if(descriptorPool_)
+                {
+                    if(nextIndex_ != freeIndices_.size()){
+                        std::cout << "Texture table destroyed with " << (nextIndex_ - freeIndices_.size()) << " registered texture(s)" << std::endl;
+                    }
+
+                    // Набор освобождается вместе с пулом
+                    device_.destroyDescriptorPool(descriptorPool_);
+                    device_.destroyDescriptorSetLayout(descriptorSetLayout_);
+                    descriptorPool_ = nullptr;
+                    descriptorSetLayout_ = nullptr;
+                    descriptorSet_ = nullptr;
+                    freeIndices_.clear();
+                    nextIndex_ = 0;
+                }
+            }
+
+            /**
+             * Зарегистрировать текстуру
+             * @param sampler Семплер
+             * @param imageView Вид изображения (в раскладке eShaderReadOnlyOptimal)
+             * @return Индекс текстуры в таблице (постоянный до отмены регистрации)
+             */
+            uint32_t registerTexture(const vk::Sampler& sampler, const vk::ImageView& imageView)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                uint32_t index;
+                if(!freeIndices_.empty()){
+                    index = freeIndices_.back();
+                    freeIndices_.pop_back();
+                }
+                else if(nextIndex_ < capacity_){
+                    index = nextIndex_++;
+                }
+                else{
+                    throw vk::OutOfPoolMemoryError("Can't register texture. Texture table is full");
+                }
+
+                vk::DescriptorImageInfo imageInfo(sampler, imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
+                vk::WriteDescriptorSet write(
+                        descriptorSet_,
+                        0,
+                        index,
+                        1,
+                        vk::DescriptorType::eCombinedImageSampler,
+                        &imageInfo,
+                        nullptr,
+                        nullptr);
+                device_.updateDescriptorSets(1, &write, 0, nullptr);
+
+                return index;
+            }
+
+            /**
+             * Отменить регистрацию текстуры (индекс может быть выдан другой текстуре)
+             * @param index Индекс текстуры в таблице
+             *
+             * @details Дескриптор не очищается - незаполненные и устаревшие элементы допустимы (partially bound),
+             * пока шейдеры их не читают
+             */
+            void unregisterTexture(uint32_t index)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                assert(index < nextIndex_);
+                freeIndices_.push_back(index);
+            }
+
+            /**
+             * Получить макет размещения набора
+             * @return Константная ссылка на макет
+             */
+            const vk::DescriptorSetLayout& getDescriptorSetLayout() const
+            {
+                return descriptorSetLayout_;
+            }
+
+            /**
+             * Получить набор дескрипторов таблицы
+             * @return Константная ссылка на набор
+             */
+            const vk::DescriptorSet& getDescriptorSet() const
+            {
+                return descriptorSet_;
+            }
+
+            /**
+             * Получить кол-во элементов массива
+             * @return Целое число
+             */
+            uint32_t getCapacity() const
+            {
+                return capacity_;
+            }
+
+            /**
+             * Получить кол-во зарегистрированных текстур
+             * @return Целое число
+             */
+            uint32_t getTextureCount() const
+            {
+                return nextIndex_ - static_cast<uint32_t>(freeIndices_.size());
+            }
+        };
+    }
+}
@@ -1,4 +1,6 @@
 #include "Tools.h"
+#include <glm/packing.hpp>
+#include <algorithm>
 #include <iostream>
 
 namespace vk
@@ -56,6 +58,35 @@ namespace vk
             return true;
         }
 
+        /**
+         * Проверить поддерживает ли физ. устройство индексирование дескрипторов, нужное глобальной таблице текстур
+         * @param device Физ устройство
+         * @return Да или нет
+         */
+        bool CheckDescriptorIndexingSupported(const vk::PhysicalDevice &device)
+        {
+            auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+            const auto& indexingFeatures = features.get<vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+
+            return indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+                   indexingFeatures.runtimeDescriptorArray &&
+                   indexingFeatures.descriptorBindingPartiallyBound &&
+                   indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                   indexingFeatures.descriptorBindingVariableDescriptorCount;
+        }
+
+        /**
+         * Упаковать индексы текстур в глобальной таблице (по два 16-битных индекса в значении)
+         * @param indices Индексы текстур (albedo, roughness, metallic, normal, displace)
+         * @param packed Массив упакованных значений (см. vk::tools::InstanceData::textures)
+         */
+        void PackTextureIndices(const glm::uint32 indices[5], glm::uint32 packed[3])
+        {
+            packed[0] = (indices[0] & 0xFFFFu) | (indices[1] << 16u);
+            packed[1] = (indices[2] & 0xFFFFu) | (indices[3] << 16u);
+            packed[2] = (indices[4] & 0xFFFFu);
+        }
+
         /**
          * Проверить доступны ли указанные слои валидации
          * @param layerNames Список наименований слоев
@@ -226,5 +257,154 @@ namespace vk
 
             return device.createSamplerUnique(samplerCreateInfo);
         }
+        /**
+         * Вычислить касательные вершин
+         * @param vertices Массив вершин (должны быть заполнены положения, UV и нормали)
+         * @param indices Массив индексов треугольников (пустой - вершины идут тройками подряд)
+         *
+         * @details Касательные накапливаются по всем треугольникам вершины, после чего ортогонализируются относительно
+         * нормали (Грам-Шмидт). Знак битангенса сохраняется в компоненте w касательной
+         */
+        void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+        {
+            // Накопленные касательные и битангенсы вершин
+            std::vector<glm::vec3> tangents(vertices.size(), glm::vec3(0.0f));
+            std::vector<glm::vec3> bitangents(vertices.size(), glm::vec3(0.0f));
+
+            // Кол-во треугольников
+            const size_t triangleCount = (indices.empty() ? vertices.size() : indices.size()) / 3;
+
+            for(size_t t = 0; t < triangleCount; t++)
+            {
+                // Индексы вершин треугольника
+                const size_t i0 = indices.empty() ? t * 3 + 0 : indices[t * 3 + 0];
+                const size_t i1 = indices.empty() ? t * 3 + 1 : indices[t * 3 + 1];
+                const size_t i2 = indices.empty() ? t * 3 + 2 : indices[t * 3 + 2];
+
+                // Ребра треугольника в пространстве модели и в пространстве текстуры
+                const glm::vec3 edge1 = vertices[i1].position - vertices[i0].position;
+                const glm::vec3 edge2 = vertices[i2].position - vertices[i0].position;
+                const glm::vec2 deltaUv1 = vertices[i1].uv - vertices[i0].uv;
+                const glm::vec2 deltaUv2 = vertices[i2].uv - vertices[i0].uv;
+
+                // Вырожденная развертка - треугольник не влияет на касательные
+                const float determinant = deltaUv1.x * deltaUv2.y - deltaUv2.x * deltaUv1.y;
+                if(glm::abs(determinant) < 1e-12f) continue;
+                const float f = 1.0f / determinant;
+
+                const glm::vec3 tangent = f * (deltaUv2.y * edge1 - deltaUv1.y * edge2);
+                const glm::vec3 bitangent = f * (-deltaUv2.x * edge1 + deltaUv1.x * edge2);
+
+                tangents[i0] += tangent; tangents[i1] += tangent; tangents[i2] += tangent;
+                bitangents[i0] += bitangent; bitangents[i1] += bitangent; bitangents[i2] += bitangent;
+            }
+
+            for(size_t i = 0; i < vertices.size(); i++)
+            {
+                const glm::vec3& n = vertices[i].normal;
+
+                // Ортогонализация относительно нормали
+                glm::vec3 t = tangents[i] - n * glm::dot(n, tangents[i]);
+
+                // Если касательную получить не удалось - любой вектор, перпендикулярный нормали
+                if(glm::dot(t, t) < 1e-12f){
+                    t = glm::abs(n.x) < 0.9f ? glm::cross(n, glm::vec3(1.0f,0.0f,0.0f)) : glm::cross(n, glm::vec3(0.0f,1.0f,0.0f));
+                }
+
+                t = glm::normalize(t);
+
+                // Знак битангенса (зеркальная развертка дает отрицательный знак)
+                const float w = glm::dot(glm::cross(n, t), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+
+                vertices[i].tangent = glm::vec4(t, w);
+            }
+        }
+        /**
+         * Октаэдрическое кодирование единичного вектора
+         * @param v Единичный вектор
+         * @return Координаты на развертке октаэдра (в диапазоне [-1;1])
+         */
+        glm::vec2 OctahedralEncode(const glm::vec3& v)
+        {
+            // Проекция на октаэдр
+            const glm::vec3 n = v / (glm::abs(v.x) + glm::abs(v.y) + glm::abs(v.z));
+            if(n.z >= 0.0f) return {n.x, n.y};
+
+            // Нижняя половина октаэдра "заворачивается" на углы развертки
+            return {
+                (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+            };
+        }
+
+        /**
+         * Упаковать основные атрибуты вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованная вершина
+         */
+        VertexPacked PackVertex(const Vertex& vertex)
+        {
+            VertexPacked packed{};
+            packed.position = vertex.position;
+            packed.normal = glm::packSnorm2x16(OctahedralEncode(glm::normalize(vertex.normal)));
+            packed.tangent = glm::packSnorm4x8(glm::vec4(OctahedralEncode(glm::normalize(glm::vec3(vertex.tangent))), vertex.tangent.w < 0.0f ? -1.0f : 1.0f, 0.0f));
+            packed.uv = glm::packHalf2x16(vertex.uv);
+            return packed;
+        }
+
+        /**
+         * Упаковать данные скелета вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованные индексы костей и веса
+         */
+        VertexSkinPacked PackVertexSkin(const Vertex& vertex)
+        {
+            VertexSkinPacked packed{};
+            for(glm::length_t i = 0; i < 4; i++){
+                const auto boneIndex = static_cast<uint32_t>(glm::clamp(vertex.boneIndices[i], 0, 255));
+                packed.boneIndices |= boneIndex << (8u * static_cast<uint32_t>(i));
+            }
+            packed.weights = glm::packUnorm4x8(vertex.weights);
+            return packed;
+        }
+
+        /**
+         * Упаковать цвет вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованный цвет
+         */
+        VertexColorPacked PackVertexColor(const Vertex& vertex)
+        {
+            return glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+        }
+
+        /**
+         * Вычислить ограничивающие объемы (AABB и сфера) для набора вершин
+         * @param vertices Массив вершин
+         * @return Ограничивающие объемы
+         */
+        Bounds ComputeBounds(const std::vector<Vertex>& vertices)
+        {
+            Bounds bounds{};
+            if(vertices.empty()) return bounds;
+
+            bounds.aabbMin = vertices[0].position;
+            bounds.aabbMax = vertices[0].position;
+            for(const auto& vertex : vertices){
+                bounds.aabbMin = glm::min(bounds.aabbMin, vertex.position);
+                bounds.aabbMax = glm::max(bounds.aabbMax, vertex.position);
+            }
+
+            // Радиус сферы считается от центра AABB (не минимальная сфера, но всегда охватывающая)
+            const glm::vec3 center = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+            float radiusSq = 0.0f;
+            for(const auto& vertex : vertices){
+                const glm::vec3 d = vertex.position - center;
+                radiusSq = (std::max)(radiusSq, glm::dot(d, d));
+            }
+            bounds.sphereRadius = glm::sqrt(radiusSq);
+
+            return bounds;
+        }
     }
 }
\ No newline at end of file
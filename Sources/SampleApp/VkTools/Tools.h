@@ -1,6 +1,8 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define VK_ENABLE_BETA_EXTENSIONS
 #define VULKAN_HPP_TYPESAFE_CONVERSION
 
@@ -25,12 +27,129 @@ namespace vk
             glm::vec3 color;
             glm::vec2 uv;
             glm::vec3 normal;
+            glm::vec4 tangent = {1.0f,0,0,1.0f}; // w - знак битангенса (B = cross(N,T) * w)
 
             // Данные для скелета
             glm::ivec4 boneIndices = {0,0,0,0};
             glm::vec4 weights = {1.0f,0,0,0};
         };
 
+        /**
+         * Вершина в формате GPU (основной поток)
+         * @details Нормаль - октаэдрическое кодирование (2 x snorm16), касательная - октаэдрическое кодирование
+         * и знак битангенса (snorm8 x,y,z), UV - 2 x half float. Цвет и данные скелета хранятся в отдельных потоках
+         * (VertexColorPacked, VertexSkinPacked), которые создаются только при необходимости
+         */
+        struct VertexPacked
+        {
+            glm::vec3 position;
+            uint32_t normal;
+            uint32_t tangent;
+            uint32_t uv;
+        };
+
+        /**
+         * Данные скелета вершины в формате GPU (отдельный поток, только у геометрии с весами)
+         */
+        struct VertexSkinPacked
+        {
+            uint32_t boneIndices;   // 4 x uint8
+            uint32_t weights;       // 4 x unorm8
+        };
+
+        /// Цвет вершины в формате GPU (отдельный поток, только у геометрии с цветами вершин) - 4 x unorm8
+        typedef uint32_t VertexColorPacked;
+
+        /**
+         * Ограничивающие объемы геометрии (в локальном пространстве)
+         * @details Центр сферы совпадает с центром AABB, радиус - расстояние до самой удаленной от центра вершины
+         */
+        struct Bounds
+        {
+            glm::vec3 aabbMin = {0.0f,0.0f,0.0f};
+            glm::vec3 aabbMax = {0.0f,0.0f,0.0f};
+            float sphereRadius = 0.0f;
+        };
+
+        /**
+         * Заголовок буфера объектов отсечения на GPU (std430, см. Shaders/cull.comp)
+         * @details Заполняется CPU каждый кадр (камера и параметры выбора уровней детализации), счетчики видимых
+         * объектов и треугольников накапливает шейдер - CPU читает их при следующем использовании буфера
+         */
+        struct GpuCullingHeader
+        {
+            glm::vec4 planes[6];
+            glm::vec4 cameraPositionScale;
+            uint32_t objectCount;
+            uint32_t visibleCount;
+            uint32_t triangleCount;
+            uint32_t compact;
+            uint32_t lodEnabled;
+            uint32_t perspective;
+            float minPixelSize;
+            float maxPixelError;
+            float lodHysteresis;
+            uint32_t reserved;
+            uint32_t uploadsReadyTicket[2];
+        };
+
+        /// Флаги объекта отсечения на GPU
+        const uint32_t GPU_CULLING_OBJECT_ALWAYS_VISIBLE = (1u << 0u); // Объект не отсекается (ограничивающие объемы неизвестны)
+        const uint32_t GPU_CULLING_OBJECT_INDEXED        = (1u << 1u); // Индексированная геометрия
+
+        /// Максимальное кол-во уровней детализации объекта отсечения на GPU (более грубые уровни не используются)
+        const uint32_t GPU_CULLING_MAX_LODS = 4;
+
+        /**
+         * Объект отсечения на GPU - данные меша сцены (std430, см. Shaders/cull.comp)
+         * @details Лежит в слоте меша и перезаписывается CPU, только когда меш изменился. Шейдер выбирает уровень
+         * детализации по участкам индексов уровней и пишет выбранный уровень в последнее поле (CPU его не перезаписывает,
+         * уровень нужен для гистерезиса). У неиндексированной геометрии один уровень - участок вершин, у меша
+         * с неготовыми ресурсами уровней нет (шейдер его не рисует)
+         */
+        struct GpuCullingObject
+        {
+            glm::vec4 centerRadius;
+            glm::vec3 extent;
+            uint32_t flags;
+            uint32_t lodCount;
+            int32_t vertexOffset;
+            float localRadius;
+            uint32_t reserved;
+            uint32_t lodFirst[GPU_CULLING_MAX_LODS];
+            uint32_t lodElementCount[GPU_CULLING_MAX_LODS];
+            float lodError[GPU_CULLING_MAX_LODS];
+            uint32_t uploadTicket[2];
+            uint32_t reserved2;
+            uint32_t lod;
+        };
+
+        /**
+         * Объект пакета непрямого рисования (std430, см. Shaders/cull.comp)
+         * @details Объекты одного пакета лежат подряд, начиная с drawFirst. Без сжатия аргументы рисования объекта
+         * пишутся на его место, со сжатием - на следующее свободное место пакета (счетчик пакета - по индексу drawFirst).
+         * Данные экземпляра лежат в потоке экземпляров по номеру слота
+         */
+        struct GpuCullingBatchObject
+        {
+            uint32_t slot;
+            uint32_t drawFirst;
+        };
+
+        /**
+         * Данные экземпляра (поток экземпляров, см. атрибуты 7-15 в Shaders/base.vert)
+         * @details Матрица нормалей хранится по столбцам, компонент w столбцов не используется. Металличность и индексы
+         * текстур в глобальной таблице (по 16 бит, см. PackTextureIndices) читаются шейдером одним целочисленным атрибутом
+         */
+        struct InstanceData
+        {
+            glm::mat4 model;
+            glm::vec4 normalMatrix[3];
+            glm::vec4 material;
+            glm::float32 metallic;
+            glm::uint32 textures[3];
+        };
+
         /// В С П О М О Г А Т Е Л Ь Н Ы Е  М Е Т О Д Ы
 
         /**
@@ -62,6 +181,20 @@ namespace vk
          */
         bool CheckDeviceLayersSupported(const vk::PhysicalDevice& device, const std::vector<const char *> &layerNames);
 
+        /**
+         * Проверить поддерживает ли физ. устройство индексирование дескрипторов, нужное глобальной таблице текстур
+         * @param device Физ устройство
+         * @return Да или нет
+         */
+        bool CheckDescriptorIndexingSupported(const vk::PhysicalDevice& device);
+
+        /**
+         * Упаковать индексы текстур в глобальной таблице (по два 16-битных индекса в значении)
+         * @param indices Индексы текстур (albedo, roughness, metallic, normal, displace)
+         * @param packed Массив упакованных значений (см. vk::tools::InstanceData::textures)
+         */
+        void PackTextureIndices(const glm::uint32 indices[5], glm::uint32 packed[3]);
+
         /**
          * Создать экземпляр Vulkan
          * @param appName Наименование приложения
@@ -113,5 +246,50 @@ namespace vk
                                              const vk::Filter& filtering,
                                              const vk::SamplerAddressMode& addressMode,
                                              float anisotropyLevel = 0);
+
+        /**
+         * Вычислить касательные вершин
+         * @param vertices Массив вершин (должны быть заполнены положения, UV и нормали)
+         * @param indices Массив индексов треугольников (пустой - вершины идут тройками подряд)
+         *
+         * @details Касательные накапливаются по всем треугольникам вершины, после чего ортогонализируются относительно
+         * нормали (Грам-Шмидт). Знак битангенса сохраняется в компоненте w касательной
+         */
+        void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+        /**
+         * Октаэдрическое кодирование единичного вектора
+         * @param v Единичный вектор
+         * @return Координаты на развертке октаэдра (в диапазоне [-1;1])
+         */
+        glm::vec2 OctahedralEncode(const glm::vec3& v);
+
+        /**
+         * Упаковать основные атрибуты вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованная вершина
+         */
+        VertexPacked PackVertex(const Vertex& vertex);
+
+        /**
+         * Упаковать данные скелета вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованные индексы костей и веса
+         */
+        VertexSkinPacked PackVertexSkin(const Vertex& vertex);
+
+        /**
+         * Упаковать цвет вершины в формат GPU
+         * @param vertex Вершина
+         * @return Упакованный цвет
+         */
+        VertexColorPacked PackVertexColor(const Vertex& vertex);
+
+        /**
+         * Вычислить ограничивающие объемы (AABB и сфера) для набора вершин
+         * @param vertices Массив вершин
+         * @return Ограничивающие объемы
+         */
+        Bounds ComputeBounds(const std::vector<Vertex>& vertices);
     }
 }
\ No newline at end of file
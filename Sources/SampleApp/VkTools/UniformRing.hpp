@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Кольцевой UBO буфер кадров (линейное выделение блоков данных объектов)
+         *
+         * @details Буфер разбит на участки по одному на каждый кадр "в полете". В начале кадра участок кадра очищается,
+         * после чего данные объектов размещаются в нем подряд, с выравниванием minUniformBufferOffsetAlignment. Смещение
+         * блока передается при привязке набора дескрипторов (динамический UBO), поэтому на все объекты достаточно одного
+         * набора. В конце буфера есть запас размером с наибольший диапазон дескриптора - блок, размещенный в конце
+         * участка, может быть меньше диапазона. Память размечена постоянно. Не потокобезопасен
+         */
+        class UniformRing
+        {
+        private:
+            /// Готов ли буфер
+            bool isReady_;
+            /// Буфер Vulkan
+            vk::tools::Buffer buffer_;
+            /// Указатель на размеченную область всего буфера
+            unsigned char* pMapped_;
+            /// Выравнивание блоков
+            vk::DeviceSize alignment_;
+            /// Размер участка одного кадра
+            vk::DeviceSize frameCapacity_;
+            /// Наибольший диапазон дескриптора (запас в конце буфера)
+            vk::DeviceSize maxRange_;
+            /// Кол-во участков (кадров)
+            size_t frameCount_;
+            /// Текущий кадр
+            size_t frameIndex_;
+            /// Занятый объем участка текущего кадра
+            vk::DeviceSize head_;
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            UniformRing():isReady_(false),pMapped_(nullptr),alignment_(1),frameCapacity_(0),maxRange_(0),frameCount_(0),frameIndex_(0),head_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            UniformRing(const UniformRing& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            UniformRing& operator=(const UniformRing& other) = delete;
+
+            /**
+             * Конструктор перемещения
+             * @param other R-value ссылка на другой объект
+             * @details Нельзя копировать объект, но можно обменяться с ним ресурсом
+             */
+            UniformRing(UniformRing&& other) noexcept:UniformRing(){
+                std::swap(isReady_,other.isReady_);
+                std::swap(pMapped_,other.pMapped_);
+                std::swap(alignment_,other.alignment_);
+                std::swap(frameCapacity_,other.frameCapacity_);
+                std::swap(maxRange_,other.maxRange_);
+                std::swap(frameCount_,other.frameCount_);
+                std::swap(frameIndex_,other.frameIndex_);
+                std::swap(head_,other.head_);
+                buffer_ = std::move(other.buffer_);
+            }
+
+            /**
+             * Перемещение через присваивание
+             * @param other R-value ссылка на другой объект
+             * @return Ссылка на текущий объект
+             */
+            UniformRing& operator=(UniformRing&& other) noexcept {
+                if (this == &other) return *this;
+
+                this->destroyVulkanResources();
+                isReady_ = false;
+                pMapped_ = nullptr;
+                alignment_ = 1;
+                frameCapacity_ = 0;
+                maxRange_ = 0;
+                frameCount_ = 0;
+                frameIndex_ = 0;
+                head_ = 0;
+
+                std::swap(isReady_,other.isReady_);
+                std::swap(pMapped_,other.pMapped_);
+                std::swap(alignment_,other.alignment_);
+                std::swap(frameCapacity_,other.frameCapacity_);
+                std::swap(maxRange_,other.maxRange_);
+                std::swap(frameCount_,other.frameCount_);
+                std::swap(frameIndex_,other.frameIndex_);
+                std::swap(head_,other.head_);
+                buffer_ = std::move(other.buffer_);
+
+                return *this;
+            }
+
+            /**
+             * Основной конструктор
+             * @param pDevice Указатель на устройство
+             * @param frameCapacity Размер участка одного кадра (округляется до выравнивания блоков)
+             * @param maxRange Наибольший диапазон дескриптора (размер блока данных, объявленного в шейдере)
+             * @param frameCount Кол-во кадров (участков)
+             */
+            UniformRing(const vk::tools::Device* pDevice, vk::DeviceSize frameCapacity, vk::DeviceSize maxRange, size_t frameCount):
+                    isReady_(false),
+                    pMapped_(nullptr),
+                    alignment_(1),
+                    frameCapacity_(0),
+                    maxRange_(maxRange),
+                    frameCount_(frameCount),
+                    frameIndex_(0),
+                    head_(0)
+            {
+                // Проверить устройство
+                if(pDevice == nullptr || !pDevice->isReady()){
+                    throw vk::DeviceLostError("Device is not available");
+                }
+
+                // Хотя бы один участок должен быть
+                if(frameCount_ == 0){
+                    throw vk::InitializationFailedError("Can't initialize uniform ring. Frame count can't be zero");
+                }
+
+                // Смещения блоков (и участков) должны быть кратны минимальному выравниванию смещений UBO
+                alignment_ = pDevice->getAlignedUboBlockSize(1);
+                frameCapacity_ = pDevice->getAlignedUboBlockSize(frameCapacity);
+
+                // Выделить буфер для всех участков (и запас под диапазон последнего блока)
+                buffer_ = vk::tools::Buffer(pDevice,
+                        frameCapacity_ * frameCount_ + maxRange_,
+                        vk::BufferUsageFlagBits::eUniformBuffer,
+                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+
+                // Разметить память (остается размеченной на все время жизни буфера)
+                pMapped_ = reinterpret_cast<unsigned char*>(buffer_.mapMemory());
+
+                // Буфер инициализирован
+                isReady_ = true;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~UniformRing(){
+                destroyVulkanResources();
+            }
+
+            /**
+             * Де-инициализация ресурсов Vulkan
+             */
+            void destroyVulkanResources()
+            {
+                if(isReady_)
+                {
+                    buffer_.unmapMemory();
+                    buffer_.destroyVulkanResources();
+                    pMapped_ = nullptr;
+                    isReady_ = false;
+                }
+            }
+
+            /**
+             * Был ли объект инициализирован
+             * @return Да или нет
+             */
+            bool isReady() const
+            {
+                return isReady_;
+            }
+
+            /**
+             * Начать заполнение участка кадра (ранее размещенные в нем блоки становятся недействительными)
+             * @param frameIndex Индекс кадра
+             *
+             * @details Вызывается когда GPU гарантированно не использует данные этого кадра
+             */
+            void begin(size_t frameIndex)
+            {
+                assert(frameIndex < frameCount_);
+                frameIndex_ = frameIndex;
+                head_ = 0;
+            }
+
+            /**
+             * Разместить блок данных в участке текущего кадра
+             * @param size Размер данных
+             * @param pOffset Указатель на смещение блока от начала буфера (динамическое смещение дескриптора)
+             * @return Указатель на размеченную область блока (nullptr если в участке нет места)
+             */
+            unsigned char* allocate(vk::DeviceSize size, uint32_t* pOffset)
+            {
+                const vk::DeviceSize alignedSize = this->getAlignedSize(size);
+                if(head_ + alignedSize > frameCapacity_) return nullptr;
+
+                const vk::DeviceSize offset = frameCapacity_ * frameIndex_ + head_;
+                head_ += alignedSize;
+
+                *pOffset = static_cast<uint32_t>(offset);
+                return pMapped_ + offset;
+            }
+
+            /**
+             * Получить размер блока с учетом выравнивания
+             * @param size Размер данных
+             * @return Размер в байтах
+             */
+            vk::DeviceSize getAlignedSize(vk::DeviceSize size) const
+            {
+                return ((size + alignment_ - 1) / alignment_) * alignment_;
+            }
+
+            /**
+             * Получить описание буфера для записи в дескрипторный набор (динамический UBO)
+             * @param range Диапазон дескриптора (размер блока данных, объявленного в шейдере)
+             * @return Структура описания буфера для дескриптора
+             */
+            vk::DescriptorBufferInfo getDescriptorBufferInfo(vk::DeviceSize range) const
+            {
+                assert(range <= maxRange_);
+                return {buffer_.getBuffer().get(), 0, range};
+            }
+
+            /**
+             * Получить размер участка одного кадра
+             * @return Размер в байтах
+             */
+            vk::DeviceSize getFrameCapacity() const
+            {
+                return frameCapacity_;
+            }
+
+            /**
+             * Получить занятый объем участка текущего кадра
+             * @return Размер в байтах
+             */
+            vk::DeviceSize getUsedSize() const
+            {
+                return head_;
+            }
+
+            /**
+             * Получить кол-во кадров (участков)
+             * @return Кол-во участков
+             */
+            size_t getFrameCount() const
+            {
+                return frameCount_;
+            }
+        };
+    }
+}
@@ -0,0 +1,764 @@
+#pragma once
+
+#include "Tools.h"
+#include "MemoryAllocator.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <deque>
+#include <functional>
+
+namespace vk
+{
+    namespace tools
+    {
+        /**
+         * Номер загрузки (партии команд копирования) - по нему можно узнать, выполнена ли загрузка ресурса
+         */
+        typedef uint64_t UploadTicket;
+
+        /**
+         * Командные буферы записываемой партии загрузки
+         *
+         * @details Копирование записывается в буфер очереди загрузки. Если загрузка идет через выделенную очередь передачи
+         * (семейство без графики), ресурс после копирования нужно передать графическому семейству: барьер освобождения
+         * записывается в буфер очереди загрузки, барьер захвата - в графический буфер партии. Графический буфер выполняется
+         * в графической очереди после завершения копирования, в него записываются команды, которым нужна графическая
+         * очередь (например blit при генерации мип-уровней). Если семейство одно, оба буфера совпадают
+         */
+        class UploadCommands
+        {
+        private:
+            /// Командный буфер очереди загрузки
+            vk::CommandBuffer transferCommandBuffer_;
+            /// Командный буфер графической очереди
+            vk::CommandBuffer graphicsCommandBuffer_;
+            /// Индекс семейства очереди загрузки
+            uint32_t transferQueueFamilyIndex_;
+            /// Индекс графического семейства
+            uint32_t graphicsQueueFamilyIndex_;
+
+        public:
+            /**
+             * Основной конструктор
+             * @param transferCommandBuffer Командный буфер очереди загрузки (в состоянии записи)
+             * @param graphicsCommandBuffer Командный буфер графической очереди (в состоянии записи)
+             * @param transferQueueFamilyIndex Индекс семейства очереди загрузки
+             * @param graphicsQueueFamilyIndex Индекс графического семейства
+             */
+            UploadCommands(const vk::CommandBuffer& transferCommandBuffer,
+                           const vk::CommandBuffer& graphicsCommandBuffer,
+                           uint32_t transferQueueFamilyIndex,
+                           uint32_t graphicsQueueFamilyIndex):
+                    transferCommandBuffer_(transferCommandBuffer),
+                    graphicsCommandBuffer_(graphicsCommandBuffer),
+                    transferQueueFamilyIndex_(transferQueueFamilyIndex),
+                    graphicsQueueFamilyIndex_(graphicsQueueFamilyIndex){}
+
+            /**
+             * Получить командный буфер очереди загрузки (команды копирования)
+             * @return Константная ссылка на командный буфер
+             */
+            const vk::CommandBuffer& getTransferCommandBuffer() const
+            {
+                return transferCommandBuffer_;
+            }
+
+            /**
+             * Получить командный буфер графической очереди (выполняется после передачи владения ресурсами)
+             * @return Константная ссылка на командный буфер
+             */
+            const vk::CommandBuffer& getGraphicsCommandBuffer() const
+            {
+                return graphicsCommandBuffer_;
+            }
+
+            /**
+             * Нужна ли передача владения ресурсами между семействами
+             * @return Да или нет
+             */
+            bool isOwnershipTransferRequired() const
+            {
+                return transferQueueFamilyIndex_ != graphicsQueueFamilyIndex_;
+            }
+
+            /**
+             * Передать графическому семейству участок буфера, записанный командами копирования
+             * @param buffer Буфер
+             * @param offset Смещение участка
+             * @param size Размер участка
+             *
+             * @details Если семейство одно, барьер не нужен - его заменяет барьер памяти в конце партии
+             */
+            void transferBufferOwnership(const vk::Buffer& buffer, vk::DeviceSize offset, vk::DeviceSize size) const
+            {
+                if(!this->isOwnershipTransferRequired()) return;
+
+                vk::BufferMemoryBarrier bufferMemoryBarrier{};
+                bufferMemoryBarrier.buffer = buffer;
+                bufferMemoryBarrier.offset = offset;
+                bufferMemoryBarrier.size = size;
+                bufferMemoryBarrier.srcQueueFamilyIndex = transferQueueFamilyIndex_;
+                bufferMemoryBarrier.dstQueueFamilyIndex = graphicsQueueFamilyIndex_;
+
+                // Освобождение (очередь загрузки) - делает доступными результаты копирования
+                bufferMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                bufferMemoryBarrier.dstAccessMask = {};
+                transferCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {bufferMemoryBarrier}, {});
+
+                // Захват (графическая очередь) - делает их видимыми для последующих команд
+                bufferMemoryBarrier.srcAccessMask = {};
+                bufferMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+                graphicsCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {bufferMemoryBarrier}, {});
+            }
+
+            /**
+             * Передать графическому семейству изображение, записанное командами копирования (со сменой макета размещения)
+             * @param image Изображение
+             * @param subresourceRange Диапазон под-ресурсов
+             * @param oldLayout Макет размещения после копирования
+             * @param newLayout Макет размещения, нужный командам графической очереди
+             *
+             * @details Барьеры освобождения и захвата описывают одну и ту же смену макета. Если семейство одно, записывается
+             * обычный барьер в общий командный буфер
+             */
+            void transferImageOwnership(const vk::Image& image,
+                                        const vk::ImageSubresourceRange& subresourceRange,
+                                        vk::ImageLayout oldLayout,
+                                        vk::ImageLayout newLayout) const
+            {
+                vk::ImageMemoryBarrier imageMemoryBarrier{};
+                imageMemoryBarrier.image = image;
+                imageMemoryBarrier.subresourceRange = subresourceRange;
+                imageMemoryBarrier.oldLayout = oldLayout;
+                imageMemoryBarrier.newLayout = newLayout;
+
+                if(!this->isOwnershipTransferRequired())
+                {
+                    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    imageMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                    imageMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead|vk::AccessFlagBits::eMemoryWrite;
+                    transferCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, {imageMemoryBarrier});
+                    return;
+                }
+
+                imageMemoryBarrier.srcQueueFamilyIndex = transferQueueFamilyIndex_;
+                imageMemoryBarrier.dstQueueFamilyIndex = graphicsQueueFamilyIndex_;
+
+                // Освобождение (очередь загрузки)
+                imageMemoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                imageMemoryBarrier.dstAccessMask = {};
+                transferCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, {imageMemoryBarrier});
+
+                // Захват (графическая очередь) - после него изображение можно читать и записывать (blit)
+                imageMemoryBarrier.srcAccessMask = {};
+                imageMemoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead|vk::AccessFlagBits::eMemoryWrite;
+                graphicsCommandBuffer_.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {}, {imageMemoryBarrier});
+            }
+        };
+
+        /**
+         * Менеджер загрузки данных в память устройства (пакетная загрузка через кольцевой промежуточный буфер)
+         *
+         * @details Данные ресурсов копируются в постоянно размеченный кольцевой буфер (память хоста), а команды копирования
+         * записываются в общий командный буфер текущей партии. Партия отправляется в очередь загрузки одним вызовом с
+         * барьером (fence) - при заполнении кольцевого буфера, по запросу (flush) или при ожидании загрузки. Место в
+         * кольцевом буфере освобождается, когда барьер партии сигнализирован. Данные, не помещающиеся в кольцевой буфер,
+         * копируются через отдельный временный буфер, который освобождается вместе с партией.
+         *
+         * Если у устройства есть выделенное семейство передачи, загрузка идет в его очереди параллельно с рендерингом.
+         * Графическая часть партии (захват владения ресурсами, генерация мип-уровней) отправляется в графическую очередь
+         * только после завершения копирования - из flush, поэтому графическая очередь не ждет очередь передачи. Если
+         * семейство одно, партия целиком выполняется в графической очереди. В обоих случаях в конце графической части
+         * записывается барьер памяти - команды, отправленные в графическую очередь позже, видят загруженные данные.
+         * Потокобезопасен (отправка в графическую очередь из flush и wait не должна пересекаться с отправкой кадра)
+         */
+        class UploadManager
+        {
+        public:
+            /// Размер кольцевого буфера по умолчанию
+            static constexpr vk::DeviceSize DEFAULT_STAGING_SIZE = 32u * 1024u * 1024u;
+            /// Выравнивание участков кольцевого буфера (подходит для копирования в изображения форматов до 16 байт на пиксель)
+            static constexpr vk::DeviceSize STAGING_ALIGNMENT = 16u;
+
+            /**
+             * Функция записи команд загрузки
+             * @param commands Командные буферы партии (в состоянии записи)
+             * @param stagingBuffer Промежуточный буфер
+             * @param stagingOffset Смещение выделенного участка в промежуточном буфере
+             * @param pStagingData Указатель на размеченную память участка (данные нужно скопировать до записи команд)
+             */
+            typedef std::function<void(const UploadCommands& commands, const vk::Buffer& stagingBuffer, vk::DeviceSize stagingOffset, unsigned char* pStagingData)> Recorder;
+
+        private:
+            /**
+             * Временный промежуточный буфер (для данных, не помещающихся в кольцевой буфер)
+             */
+            struct OversizedStaging
+            {
+                vk::Buffer buffer;
+                vk::tools::MemoryAllocation memory;
+            };
+
+            /**
+             * Партия команд загрузки
+             */
+            struct Batch
+            {
+                /// Номер партии
+                UploadTicket ticket = 0;
+                /// Командный буфер очереди загрузки
+                vk::CommandBuffer commandBuffer;
+                /// Барьер выполнения (сигнализируется по завершении копирования)
+                vk::Fence fence;
+                /// Командный буфер графической части (только при выделенной очереди передачи)
+                vk::CommandBuffer graphicsCommandBuffer;
+                /// Барьер выполнения графической части
+                vk::Fence graphicsFence;
+                /// Отправлена ли графическая часть
+                bool graphicsSubmitted = false;
+                /// Позиция конца кольцевого буфера на момент отправки (место до нее освобождается по завершении)
+                vk::DeviceSize ringEnd = 0;
+                /// Временные промежуточные буферы партии
+                std::vector<OversizedStaging> oversized;
+            };
+
+            /// Логическое устройство
+            vk::Device device_;
+            /// Распределитель памяти устройства
+            vk::tools::MemoryAllocator* pAllocator_;
+            /// Индекс типа видимой хостом памяти для промежуточных буферов
+            uint32_t stagingMemoryTypeIndex_;
+            /// Очередь, в которую отправляются партии
+            vk::Queue queue_;
+            /// Индекс семейства очереди загрузки
+            uint32_t queueFamilyIndex_;
+            /// Командный пул (семейство очереди загрузки)
+            vk::CommandPool commandPool_;
+            /// Графическая очередь
+            vk::Queue graphicsQueue_;
+            /// Индекс графического семейства
+            uint32_t graphicsQueueFamilyIndex_;
+            /// Командный пул графических частей партий (только при выделенной очереди передачи)
+            vk::CommandPool graphicsCommandPool_;
+
+            /// Кольцевой промежуточный буфер
+            vk::Buffer stagingBuffer_;
+            /// Память кольцевого буфера
+            vk::tools::MemoryAllocation stagingMemory_;
+            /// Размер кольцевого буфера
+            vk::DeviceSize stagingSize_;
+            /// Позиция начала занятой области (монотонно растет, в буфере - по модулю размера)
+            vk::DeviceSize stagingTail_;
+            /// Позиция конца занятой области (монотонно растет, в буфере - по модулю размера)
+            vk::DeviceSize stagingHead_;
+
+            /// Записываемая партия (командный буфер пуст, если в партии нет команд)
+            Batch recording_;
+            /// Отправленные партии с незавершенным копированием (в порядке отправки)
+            std::deque<Batch> pending_;
+            /// Партии с завершенным копированием и незавершенной графической частью (в порядке отправки)
+            std::deque<Batch> acquiring_;
+            /// Завершенные партии (командные буферы и барьеры для повторного использования)
+            std::vector<Batch> free_;
+            /// Номер последней завершенной партии (все партии с меньшими номерами тоже завершены)
+            UploadTicket completedTicket_;
+            /// Номер последней партии, данные которой видны командам, отправленным в графическую очередь позже
+            UploadTicket readyTicket_;
+
+            /// Мьютекс (загрузка может запрашиваться из разных потоков)
+            std::mutex mutex_;
+
+            /**
+             * Создать буфер-источник копирования в видимой хостом памяти
+             * @param size Размер
+             * @param pMemory Указатель на описание выделенного участка памяти
+             * @return Буфер Vulkan
+             */
+            vk::Buffer createStagingBuffer(vk::DeviceSize size, vk::tools::MemoryAllocation* pMemory)
+            {
+                vk::BufferCreateInfo bufferCreateInfo{};
+                bufferCreateInfo.size = size;
+                bufferCreateInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+                bufferCreateInfo.sharingMode = vk::SharingMode::eExclusive;
+                auto buffer = device_.createBuffer(bufferCreateInfo);
+
+                *pMemory = pAllocator_->allocate(device_.getBufferMemoryRequirements(buffer), stagingMemoryTypeIndex_, false, false);
+                device_.bindBufferMemory(buffer, pMemory->memory, pMemory->offset);
+                return buffer;
+            }
+
+            /**
+             * Уничтожить буфер-источник копирования
+             * @param buffer Буфер Vulkan
+             * @param memory Описание участка памяти
+             */
+            void destroyStagingBuffer(const vk::Buffer& buffer, const vk::tools::MemoryAllocation& memory)
+            {
+                device_.destroyBuffer(buffer);
+                pAllocator_->free(memory);
+            }
+
+            /**
+             * Начать запись партии (если еще не начата)
+             */
+            void beginBatch()
+            {
+                if(recording_.commandBuffer) return;
+
+                // Использовать командные буферы и барьеры одной из завершенных партий, либо выделить новые
+                if(!free_.empty()){
+                    recording_.commandBuffer = free_.back().commandBuffer;
+                    recording_.fence = free_.back().fence;
+                    recording_.graphicsCommandBuffer = free_.back().graphicsCommandBuffer;
+                    recording_.graphicsFence = free_.back().graphicsFence;
+                    free_.pop_back();
+                    device_.resetFences({recording_.fence});
+                    if(recording_.graphicsFence) device_.resetFences({recording_.graphicsFence});
+                }
+                else{
+                    vk::CommandBufferAllocateInfo commandBufferAllocateInfo{};
+                    commandBufferAllocateInfo.commandBufferCount = 1;
+                    commandBufferAllocateInfo.commandPool = commandPool_;
+                    commandBufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
+                    recording_.commandBuffer = device_.allocateCommandBuffers(commandBufferAllocateInfo)[0];
+                    recording_.fence = device_.createFence({});
+
+                    if(this->isDedicatedTransferQueue()){
+                        commandBufferAllocateInfo.commandPool = graphicsCommandPool_;
+                        recording_.graphicsCommandBuffer = device_.allocateCommandBuffers(commandBufferAllocateInfo)[0];
+                        recording_.graphicsFence = device_.createFence({});
+                    }
+                }
+
+                recording_.graphicsSubmitted = false;
+                recording_.commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+                if(recording_.graphicsCommandBuffer){
+                    recording_.graphicsCommandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+                }
+            }
+
+            /**
+             * Получить командные буферы записываемой партии
+             * @return Объект командных буферов
+             */
+            UploadCommands getRecordingCommands() const
+            {
+                return UploadCommands(
+                        recording_.commandBuffer,
+                        recording_.graphicsCommandBuffer ? recording_.graphicsCommandBuffer : recording_.commandBuffer,
+                        queueFamilyIndex_,
+                        graphicsQueueFamilyIndex_);
+            }
+
+            /**
+             * Отправить записываемую партию в очередь загрузки (если в ней есть команды)
+             */
+            void submitBatch()
+            {
+                if(!recording_.commandBuffer) return;
+
+                // Сделать результаты копирования (и blit'а) видимыми для всех последующих команд графической очереди
+                vk::MemoryBarrier memoryBarrier{};
+                memoryBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                memoryBarrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+                const vk::CommandBuffer& graphicsCommandBuffer = recording_.graphicsCommandBuffer ? recording_.graphicsCommandBuffer : recording_.commandBuffer;
+                graphicsCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {memoryBarrier}, {}, {});
+
+                // Графическая часть отправляется после завершения копирования (см. collectBatches)
+                if(recording_.graphicsCommandBuffer) recording_.graphicsCommandBuffer.end();
+                recording_.commandBuffer.end();
+
+                vk::SubmitInfo submitInfo{};
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = &recording_.commandBuffer;
+                queue_.submit({submitInfo}, recording_.fence);
+
+                // Без выделенной очереди передачи партия выполняется в графической очереди - данные видны командам,
+                // отправленным после нее
+                if(!recording_.graphicsCommandBuffer) readyTicket_ = recording_.ticket;
+
+                // Новая партия получает следующий номер
+                recording_.ringEnd = stagingHead_;
+                const UploadTicket nextTicket = recording_.ticket + 1;
+                pending_.push_back(std::move(recording_));
+                recording_ = Batch{};
+                recording_.ticket = nextTicket;
+            }
+
+            /**
+             * Освободить ресурсы завершенных партий
+             * @param waitTicket Дождаться завершения партий с номерами до указанного включительно (0 - не ждать)
+             * @param submitGraphics Отправить в графическую очередь графические части партий с завершенным копированием
+             *
+             * @details Графическая часть партии отправляется только после завершения ее копирования (барьер партии уже
+             * сигнализирован), поэтому освобождение и захват владения упорядочены без семафоров, а графическая очередь
+             * не простаивает в ожидании очереди передачи
+             */
+            void collectBatches(UploadTicket waitTicket, bool submitGraphics)
+            {
+                // Партии с отправленным копированием
+                while(!pending_.empty())
+                {
+                    Batch& batch = pending_.front();
+
+                    if(batch.ticket <= waitTicket){
+                        device_.waitForFences({batch.fence}, VK_TRUE, UINT64_MAX);
+                    }
+                    else if(device_.getFenceStatus(batch.fence) != vk::Result::eSuccess){
+                        break;
+                    }
+
+                    // Место в кольцевом буфере и временные буферы больше не используются
+                    stagingTail_ = batch.ringEnd;
+                    for(const auto& staging : batch.oversized){
+                        this->destroyStagingBuffer(staging.buffer, staging.memory);
+                    }
+                    batch.oversized.clear();
+
+                    // Партия без графической части завершена
+                    if(batch.graphicsCommandBuffer){
+                        acquiring_.push_back(std::move(batch));
+                    }
+                    else{
+                        completedTicket_ = batch.ticket;
+                        free_.push_back(std::move(batch));
+                    }
+                    pending_.pop_front();
+                }
+
+                // Отправить графические части (в порядке номеров партий)
+                if(submitGraphics){
+                    for(auto& batch : acquiring_)
+                    {
+                        if(batch.graphicsSubmitted) continue;
+
+                        vk::SubmitInfo submitInfo{};
+                        submitInfo.commandBufferCount = 1;
+                        submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+                        graphicsQueue_.submit({submitInfo}, batch.graphicsFence);
+
+                        batch.graphicsSubmitted = true;
+                        readyTicket_ = batch.ticket;
+                    }
+                }
+
+                // Партии с отправленной графической частью
+                while(!acquiring_.empty() && acquiring_.front().graphicsSubmitted)
+                {
+                    Batch& batch = acquiring_.front();
+
+                    if(batch.ticket <= waitTicket){
+                        device_.waitForFences({batch.graphicsFence}, VK_TRUE, UINT64_MAX);
+                    }
+                    else if(device_.getFenceStatus(batch.graphicsFence) != vk::Result::eSuccess){
+                        break;
+                    }
+
+                    completedTicket_ = batch.ticket;
+                    free_.push_back(std::move(batch));
+                    acquiring_.pop_front();
+                }
+            }
+
+            /**
+             * Выделить участок кольцевого буфера (при нехватке места отправляет партию и ждет завершения предыдущих)
+             * @param size Размер (не больше размера буфера)
+             * @return Смещение участка в буфере
+             */
+            vk::DeviceSize allocateStaging(vk::DeviceSize size)
+            {
+                const vk::DeviceSize alignedSize = ((size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT) * STAGING_ALIGNMENT;
+
+                while(true)
+                {
+                    // Участок не должен пересекать конец буфера - остаток до конца пропускается
+                    vk::DeviceSize head = stagingHead_;
+                    const vk::DeviceSize offset = head % stagingSize_;
+                    if(offset + alignedSize > stagingSize_) head += stagingSize_ - offset;
+
+                    if(head + alignedSize - stagingTail_ <= stagingSize_){
+                        stagingHead_ = head + alignedSize;
+                        return head % stagingSize_;
+                    }
+
+                    // Все партии завершены (занятых участков нет) - начать с начала буфера
+                    if(pending_.empty() && !recording_.commandBuffer){
+                        stagingTail_ = stagingHead_ = ((stagingHead_ + stagingSize_ - 1) / stagingSize_) * stagingSize_;
+                        continue;
+                    }
+
+                    // Места нет - место освобождают только отправленные партии (достаточно завершения копирования)
+                    this->collectBatches(0, false);
+                    if(pending_.empty()) this->submitBatch();
+                    if(!pending_.empty()) this->collectBatches(pending_.front().ticket, false);
+                }
+            }
+
+        public:
+            /**
+             * Конструктор по умолчанию
+             */
+            UploadManager():
+                    pAllocator_(nullptr),
+                    stagingMemoryTypeIndex_(0),
+                    queueFamilyIndex_(0),
+                    graphicsQueueFamilyIndex_(0),
+                    stagingSize_(0),
+                    stagingTail_(0),
+                    stagingHead_(0),
+                    completedTicket_(0),
+                    readyTicket_(0){};
+
+            /**
+             * Запрет копирования через инициализацию
+             * @param other Ссылка на копируемый объекта
+             */
+            UploadManager(const UploadManager& other) = delete;
+
+            /**
+             * Запрет копирования через присваивание
+             * @param other Ссылка на копируемый объекта
+             * @return Ссылка на текущий объект
+             */
+            UploadManager& operator=(const UploadManager& other) = delete;
+
+            /**
+             * Основной конструктор
+             * @param device Логическое устройство
+             * @param pAllocator Распределитель памяти устройства
+             * @param memoryProperties Свойства памяти физического устройства
+             * @param queue Очередь, в которую отправляются партии (очередь передачи или графическая)
+             * @param queueFamilyIndex Индекс семейства очереди
+             * @param graphicsQueue Графическая очередь
+             * @param graphicsQueueFamilyIndex Индекс графического семейства (если совпадает с queueFamilyIndex - владение не передается)
+             * @param stagingSize Размер кольцевого буфера
+             */
+            UploadManager(const vk::Device& device,
+                          vk::tools::MemoryAllocator* pAllocator,
+                          const vk::PhysicalDeviceMemoryProperties& memoryProperties,
+                          const vk::Queue& queue,
+                          uint32_t queueFamilyIndex,
+                          const vk::Queue& graphicsQueue,
+                          uint32_t graphicsQueueFamilyIndex,
+                          vk::DeviceSize stagingSize = DEFAULT_STAGING_SIZE):
+                    device_(device),
+                    pAllocator_(pAllocator),
+                    stagingMemoryTypeIndex_(0),
+                    queue_(queue),
+                    queueFamilyIndex_(queueFamilyIndex),
+                    graphicsQueue_(graphicsQueue),
+                    graphicsQueueFamilyIndex_(graphicsQueueFamilyIndex),
+                    stagingSize_(stagingSize),
+                    stagingTail_(0),
+                    stagingHead_(0),
+                    completedTicket_(0),
+                    readyTicket_(0)
+            {
+                if(pAllocator_ == nullptr){
+                    throw vk::InitializationFailedError("Can't initialize upload manager. Memory allocator is not available");
+                }
+
+                // Командные буферы партий перезаписываются после завершения
+                commandPool_ = device_.createCommandPool({
+                        vk::CommandPoolCreateFlagBits::eResetCommandBuffer|vk::CommandPoolCreateFlagBits::eTransient,
+                        queueFamilyIndex});
+
+                // Графические части партий (захват владения, генерация мип-уровней) - только при выделенной очереди передачи
+                if(this->isDedicatedTransferQueue()){
+                    graphicsCommandPool_ = device_.createCommandPool({
+                            vk::CommandPoolCreateFlagBits::eResetCommandBuffer|vk::CommandPoolCreateFlagBits::eTransient,
+                            graphicsQueueFamilyIndex});
+                }
+
+                // Тип памяти для промежуточных буферов (видимая хостом, без явного сброса кешей)
+                vk::BufferCreateInfo bufferCreateInfo{};
+                bufferCreateInfo.size = stagingSize_;
+                bufferCreateInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+                bufferCreateInfo.sharingMode = vk::SharingMode::eExclusive;
+                stagingBuffer_ = device_.createBuffer(bufferCreateInfo);
+
+                const auto memoryRequirements = device_.getBufferMemoryRequirements(stagingBuffer_);
+                const vk::MemoryPropertyFlags stagingFlags = vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent;
+                bool found = false;
+                for(uint32_t i = 0; i < memoryProperties.memoryTypeCount && !found; i++){
+                    if((memoryRequirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & stagingFlags) == stagingFlags){
+                        stagingMemoryTypeIndex_ = i;
+                        found = true;
+                    }
+                }
+                if(!found){
+                    throw vk::InitializationFailedError("Can't initialize upload manager. Host visible memory type not found");
+                }
+
+                // Кольцевой буфер (размечен на все время жизни)
+                stagingMemory_ = pAllocator_->allocate(memoryRequirements, stagingMemoryTypeIndex_, false, false);
+                device_.bindBufferMemory(stagingBuffer_, stagingMemory_.memory, stagingMemory_.offset);
+
+                // Первая партия
+                recording_.ticket = 1;
+            }
+
+            /**
+             * Деструктор
+             */
+            ~UploadManager()
+            {
+                destroyVulkanResources();
+            }
+
+            /**
+             * Дождаться всех загрузок и уничтожить ресурсы (вызывается перед уничтожением устройства)
+             */
+            void destroyVulkanResources()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(!commandPool_) return;
+
+                // Дождаться отправленных партий (включая графические части)
+                this->collectBatches(recording_.ticket - 1, true);
+
+                // Неотправленная партия отбрасывается - ресурсы, на которые ссылаются ее команды, могут быть уже уничтожены
+                if(recording_.commandBuffer){
+                    recording_.commandBuffer.end();
+                    if(recording_.graphicsCommandBuffer) recording_.graphicsCommandBuffer.end();
+                    for(const auto& staging : recording_.oversized){
+                        this->destroyStagingBuffer(staging.buffer, staging.memory);
+                    }
+                    free_.push_back(std::move(recording_));
+                    recording_ = Batch{};
+                }
+
+                for(auto& batch : free_){
+                    device_.destroyFence(batch.fence);
+                    if(batch.graphicsFence) device_.destroyFence(batch.graphicsFence);
+                }
+                free_.clear();
+
+                // Командные буферы освобождаются вместе с пулами
+                device_.destroyCommandPool(commandPool_);
+                commandPool_ = nullptr;
+                if(graphicsCommandPool_){
+                    device_.destroyCommandPool(graphicsCommandPool_);
+                    graphicsCommandPool_ = nullptr;
+                }
+
+                this->destroyStagingBuffer(stagingBuffer_, stagingMemory_);
+                stagingBuffer_ = nullptr;
+                stagingMemory_ = {};
+            }
+
+            /**
+             * Записать загрузку в текущую партию
+             * @param size Размер данных (участок промежуточного буфера, выделяемый под загрузку)
+             * @param recorder Функция, которая копирует данные в участок и записывает команды копирования
+             * @return Номер партии, в которую попала загрузка
+             *
+             * @details Функция записи вызывается под мьютексом менеджера, команды записываются сразу после предыдущих
+             * команд партии (с теми же ресурсами командам нужны свои барьеры). Ресурсы, записанные командами копирования,
+             * функция передает графическому семейству (UploadCommands::transferBufferOwnership, transferImageOwnership)
+             */
+            UploadTicket record(vk::DeviceSize size, const Recorder& recorder)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                // Освободить место завершенных партий
+                this->collectBatches(0, false);
+
+                // Данные больше кольцевого буфера - временный буфер, освобождаемый вместе с партией
+                if(size > stagingSize_){
+                    this->beginBatch();
+                    OversizedStaging staging{};
+                    staging.buffer = this->createStagingBuffer(size, &staging.memory);
+                    recorder(this->getRecordingCommands(), staging.buffer, 0, staging.memory.pMapped);
+                    recording_.oversized.push_back(staging);
+                    return recording_.ticket;
+                }
+
+                // Выделение может отправить текущую партию, поэтому запись партии начинается после него
+                const vk::DeviceSize offset = this->allocateStaging(size);
+                this->beginBatch();
+                recorder(this->getRecordingCommands(), stagingBuffer_, offset, stagingMemory_.pMapped + offset);
+                return recording_.ticket;
+            }
+
+            /**
+             * Отправить записанные загрузки в очередь (без ожидания)
+             * @return Номер последней партии, данные которой видны командам, отправленным в графическую очередь после вызова
+             *
+             * @details Рендерер вызывает перед записью команд кадра. Без выделенной очереди передачи видны все отправленные
+             * партии. С выделенной очередью - только партии с завершенным копированием (их графические части отправляются
+             * здесь), остальные станут видны в одном из следующих кадров - ресурсы из них рисовать пока нельзя
+             */
+            UploadTicket flush()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                this->submitBatch();
+                this->collectBatches(0, true);
+                return readyTicket_;
+            }
+
+            /**
+             * Завершена ли загрузка
+             * @param ticket Номер партии
+             * @return Да или нет
+             */
+            bool isComplete(UploadTicket ticket)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                this->collectBatches(0, false);
+                return ticket <= completedTicket_;
+            }
+
+            /**
+             * Дождаться завершения загрузки (партия отправляется, если еще записывается)
+             * @param ticket Номер партии
+             */
+            void wait(UploadTicket ticket)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if(ticket <= completedTicket_) return;
+                if(ticket >= recording_.ticket) this->submitBatch();
+                this->collectBatches(ticket, true);
+            }
+
+            /**
+             * Отправить записанные загрузки и дождаться завершения всех партий
+             */
+            void waitIdle()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                this->submitBatch();
+                this->collectBatches(recording_.ticket - 1, true);
+            }
+
+            /**
+             * Получить размер кольцевого буфера
+             * @return Размер в байтах
+             */
+            vk::DeviceSize getStagingSize() const
+            {
+                return stagingSize_;
+            }
+
+            /**
+             * Используется ли выделенная очередь передачи (с передачей владения ресурсами графическому семейству)
+             * @return Да или нет
+             */
+            bool isDedicatedTransferQueue() const
+            {
+                return queueFamilyIndex_ != graphicsQueueFamilyIndex_;
+            }
+
+            /**
+             * Получить кол-во отправленных и еще не завершенных партий
+             * @return Целое число
+             */
+            size_t getPendingBatchCount() const
+            {
+                return pending_.size() + acquiring_.size();
+            }
+        };
+    }
+}